@@ -3,16 +3,20 @@
 #include <fstream>
 #include <array>
 #include <DirectXColors.h>
-#include "DDSTextureLoader.h"
 
 #include "../Common/mathhelper.h"
 #include "../Common/geometrygenerator.h"
+#include "../Common/terrain.h"
+#include "../Common/meshcache.h"
 #include "effects.h"
 #include "vertex.h"
 #include "renderstates.h"
 
 CBlendApp::CBlendApp(HINSTANCE hInstance) :
 	CD3DApp(hInstance),
+	m_grassTexture(CTextureManager::InvalidHandle),
+	m_wavesTexture(CTextureManager::InvalidHandle),
+	m_boxTexture(CTextureManager::InvalidHandle),
 	m_landIndexCount(0),
 	m_theta(1.5f * XM_PI),
 	m_phi(0.1f * XM_PI),
@@ -81,26 +85,20 @@ bool CBlendApp::initialize()
 	CInputLayouts::initAll(m_d3dDevice.Get());
 	CRenderStates::initAll(m_d3dDevice.Get());
 
-	ThrowIfFailed(CreateDDSTextureFromFile(
-		m_d3dDevice.Get(),
-		L"Textures/grass.dds",
-		nullptr,
-		m_grassMapSRV.GetAddressOf()
-	));
+	m_textureManager.initialize(m_d3dDevice.Get(), STextureManagerDesc());
+	m_grassTexture = m_textureManager.add("Textures/grass.dds");
+	m_wavesTexture = m_textureManager.add("Textures/water2.dds");
+	m_boxTexture = m_textureManager.add("Textures/WireFence.dds");
 
-	ThrowIfFailed(CreateDDSTextureFromFile(
-		m_d3dDevice.Get(),
-		L"Textures/water2.dds",
-		nullptr,
-		m_wavesMapSRV.GetAddressOf()
-	));
-
-	ThrowIfFailed(CreateDDSTextureFromFile(
-		m_d3dDevice.Get(),
-		L"Textures/wirefence.dds",
-		nullptr,
-		m_boxMapSRV.GetAddressOf()
-	));
+	for (CTextureManager::Handle texture : { m_grassTexture, m_wavesTexture, m_boxTexture })
+	{
+		std::string error;
+		if (!m_textureManager.acquire(texture, &error))
+		{
+			MessageBox(nullptr, ansiToWString(error).c_str(), 0, 0);
+			return false;
+		}
+	}
 
 	buildLandGeometryBuffers();
 	buildWaveGeometryBuffers();
@@ -258,7 +256,7 @@ void CBlendApp::draw(const CGameTimer& timer)
 		CEffects::ms_basicFX->setWorldViewProj(worldViewProj);
 		CEffects::ms_basicFX->setTexTransform(XMMatrixIdentity());
 		CEffects::ms_basicFX->setMaterial(m_boxMat);
-		CEffects::ms_basicFX->setDiffuseMap(m_boxMapSRV.Get());
+		CEffects::ms_basicFX->setDiffuseMap(m_textureManager.acquire(m_boxTexture));
 
 		m_d3dImmediateContext->RSSetState(CRenderStates::ms_noCullRS.Get());
 		boxTech->GetPassByIndex(p)->Apply(0, m_d3dImmediateContext.Get());
@@ -287,7 +285,7 @@ void CBlendApp::draw(const CGameTimer& timer)
 		CEffects::ms_basicFX->setWorldViewProj(worldViewProj);
 		CEffects::ms_basicFX->setTexTransform(XMLoadFloat4x4(&m_grassTexTransform));
 		CEffects::ms_basicFX->setMaterial(m_landMat);
-		CEffects::ms_basicFX->setDiffuseMap(m_grassMapSRV.Get());
+		CEffects::ms_basicFX->setDiffuseMap(m_textureManager.acquire(m_grassTexture));
 
 		landAndWavesTech->GetPassByIndex(p)->Apply(0, m_d3dImmediateContext.Get());
 		m_d3dImmediateContext->DrawIndexed(
@@ -309,7 +307,7 @@ void CBlendApp::draw(const CGameTimer& timer)
 		CEffects::ms_basicFX->setWorldViewProj(worldViewProj);
 		CEffects::ms_basicFX->setTexTransform(XMLoadFloat4x4(&m_waterTexTransform));
 		CEffects::ms_basicFX->setMaterial(m_wavesMat);
-		CEffects::ms_basicFX->setDiffuseMap(m_wavesMapSRV.Get());
+		CEffects::ms_basicFX->setDiffuseMap(m_textureManager.acquire(m_wavesTexture));
 
 		m_d3dImmediateContext->OMSetBlendState(
 			CRenderStates::ms_transparentBS.Get(),
@@ -328,6 +326,8 @@ void CBlendApp::draw(const CGameTimer& timer)
 	}
 
 	ThrowIfFailed(m_swapChain->Present(0, 0));
+
+	m_textureManager.update();
 }
 
 void CBlendApp::onResize()
@@ -378,25 +378,6 @@ void CBlendApp::onMouseMove(WPARAM btnState, int x, int y)
 	m_lastMousePos = { x, y };
 }
 
-float CBlendApp::getHillHeight(float x, float z) const
-{
-	return 0.3f * (z * sinf(0.1f * x) + x * cosf(0.1f * z));
-}
-
-DirectX::XMFLOAT3 CBlendApp::getHillNormal(float x, float z) const
-{
-	XMFLOAT3 n(
-		-0.03f * z * cosf(0.1f * x) - 0.3f * cosf(0.1f * z),
-		1.0f,
-		-0.3f * sinf(0.1f * x) + 0.03f * x * sinf(0.1f * z)
-	);
-
-	XMVECTOR unitNormal = XMVector3Normalize(XMLoadFloat3(&n));
-	XMStoreFloat3(&n, unitNormal);
-
-	return n;
-}
-
 void CBlendApp::buildLandGeometryBuffers()
 {
 	GeometryGenerator::SMeshData grid;
@@ -405,15 +386,15 @@ void CBlendApp::buildLandGeometryBuffers()
 
 	m_landIndexCount = grid.m_indices.size();
 
+	std::vector<XMFLOAT3> positions;
+	std::vector<XMFLOAT3> normals;
+	Terrain::evaluateGrid(160.0f, 160.0f, 50, 50, Terrain::hills, positions, &normals);
+
 	std::vector<Vertex::SBasic32> vertices(grid.m_vertices.size());
 	for (size_t i = 0; i < grid.m_vertices.size(); ++i)
 	{
-		XMFLOAT3 p = grid.m_vertices[i].m_position;
-
-		p.y = getHillHeight(p.x, p.z);
-
-		vertices[i].m_pos = p;
-		vertices[i].m_normal = getHillNormal(p.x, p.z);
+		vertices[i].m_pos = positions[i];
+		vertices[i].m_normal = normals[i];
 		vertices[i].m_tex = grid.m_vertices[i].m_texC;
 	}
 
@@ -503,9 +484,8 @@ void CBlendApp::buildWaveGeometryBuffers()
 
 void CBlendApp::buildCrateGeometryBuffers()
 {
-	GeometryGenerator::SMeshData box;
-
-	createBox(1.0f, 1.0f, 1.0f, box);
+	CMeshCache::MeshPtr boxMesh = CMeshCache::getShared().getBox(1.0f, 1.0f, 1.0f);
+	const GeometryGenerator::SMeshData& box = *boxMesh;
 
 	std::vector<Vertex::SBasic32> vertices(box.m_vertices.size());
 
@@ -2,6 +2,7 @@
 
 #include "../Common/d3dapp.h"
 #include "../Common/lighthelper.h"
+#include "../Common/texturemanager.h"
 #include "../Common/waves.h"
 
 using namespace DirectX;
@@ -31,8 +32,6 @@ protected:
 	virtual void onMouseMove(WPARAM btnState, int x, int y) override;
 
 private:
-	float getHillHeight(float x, float z) const;
-	XMFLOAT3 getHillNormal(float x, float z) const;
 	void buildLandGeometryBuffers();
 	void buildWaveGeometryBuffers();
 	void buildCrateGeometryBuffers();
@@ -47,9 +46,10 @@ protected:
 	ComPtr<ID3D11Buffer> m_boxVB;
 	ComPtr<ID3D11Buffer> m_boxIB;
 
-	ComPtr<ID3D11ShaderResourceView> m_grassMapSRV;
-	ComPtr<ID3D11ShaderResourceView> m_wavesMapSRV;
-	ComPtr<ID3D11ShaderResourceView> m_boxMapSRV;
+	CTextureManager m_textureManager;
+	CTextureManager::Handle m_grassTexture;
+	CTextureManager::Handle m_wavesTexture;
+	CTextureManager::Handle m_boxTexture;
 
 	CWaves m_waves;
 
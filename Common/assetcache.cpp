@@ -0,0 +1,515 @@
+﻿#include "assetcache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <vector>
+
+#include "blockcompressor.h"
+#include "fileutil.h"
+#include "modelloader.h"
+#include "textureatlas.h"
+#include "threadpool.h"
+
+using FileUtil::setError;
+
+namespace
+{
+	const unsigned long long Prime1 = 0x9E3779B185EBCA87ull;
+	const unsigned long long Prime2 = 0xC2B2AE3D27D4EB4Full;
+	const unsigned long long Prime3 = 0x165667B19E3779F9ull;
+	const unsigned long long Prime4 = 0x85EBCA77C2B2AE63ull;
+	const unsigned long long Prime5 = 0x27D4EB2F165667C5ull;
+
+	inline unsigned long long rotateLeft(unsigned long long value, int bits)
+	{
+		return (value << bits) | (value >> (64 - bits));
+	}
+
+	inline unsigned long long read64(const unsigned char* p)
+	{
+		unsigned long long value;
+		std::memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	inline unsigned long long read32(const unsigned char* p)
+	{
+		UINT value;
+		std::memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	inline unsigned long long hashRound(unsigned long long accumulator, unsigned long long input)
+	{
+		accumulator += input * Prime2;
+		accumulator = rotateLeft(accumulator, 31);
+		return accumulator * Prime1;
+	}
+
+	inline unsigned long long mergeRound(unsigned long long hash, unsigned long long lane)
+	{
+		hash ^= hashRound(0, lane);
+		return hash * Prime1 + Prime4;
+	}
+
+	// xxHash64. Four independent lanes keep the multiplier busy, so hashing
+	// a source costs far less than reading it from disk.
+	unsigned long long hashBytes(const unsigned char* data, size_t size)
+	{
+		const unsigned char* p = data;
+		const unsigned char* end = data + size;
+		unsigned long long hash;
+
+		if (size >= 32)
+		{
+			unsigned long long lane0 = Prime1 + Prime2;
+			unsigned long long lane1 = Prime2;
+			unsigned long long lane2 = 0;
+			unsigned long long lane3 = 0 - Prime1;
+
+			const unsigned char* limit = end - 32;
+			do
+			{
+				lane0 = hashRound(lane0, read64(p));
+				lane1 = hashRound(lane1, read64(p + 8));
+				lane2 = hashRound(lane2, read64(p + 16));
+				lane3 = hashRound(lane3, read64(p + 24));
+				p += 32;
+			} while (p <= limit);
+
+			hash = rotateLeft(lane0, 1) + rotateLeft(lane1, 7) + rotateLeft(lane2, 12) + rotateLeft(lane3, 18);
+			hash = mergeRound(hash, lane0);
+			hash = mergeRound(hash, lane1);
+			hash = mergeRound(hash, lane2);
+			hash = mergeRound(hash, lane3);
+		}
+		else
+		{
+			hash = Prime5;
+		}
+
+		hash += (unsigned long long)size;
+
+		for (; p + 8 <= end; p += 8)
+		{
+			hash ^= hashRound(0, read64(p));
+			hash = rotateLeft(hash, 27) * Prime1 + Prime4;
+		}
+		if (p + 4 <= end)
+		{
+			hash ^= read32(p) * Prime1;
+			hash = rotateLeft(hash, 23) * Prime2 + Prime3;
+			p += 4;
+		}
+		for (; p < end; ++p)
+		{
+			hash ^= *p * Prime5;
+			hash = rotateLeft(hash, 11) * Prime1;
+		}
+
+		hash ^= hash >> 33;
+		hash *= Prime2;
+		hash ^= hash >> 29;
+		hash *= Prime3;
+		hash ^= hash >> 32;
+		return hash;
+	}
+
+	bool endsWith(const std::string& text, const std::string& suffix)
+	{
+		return text.size() >= suffix.size() &&
+			text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+	}
+
+	bool convertTextModel(
+		const std::string& sourcePath,
+		const CMappedFile& source,
+		const std::string& outputPath,
+		std::string* error)
+	{
+		MeshStreams::SMeshStreams mesh;
+		if (!ModelLoader::parseTextModel(
+			reinterpret_cast<const char*>(source.getData()),
+			source.getSize(),
+			mesh,
+			error,
+			CThreadPool::getShared()))
+		{
+			if (error)
+			{
+				*error = sourcePath + ": " + *error;
+			}
+			return false;
+		}
+
+		return BinaryMesh::write(outputPath, mesh, error, BinaryMesh::VertexCodecFlag | BinaryMesh::IndexCodecFlag);
+	}
+
+	bool convertFlipbook(
+		const std::string& sourcePath,
+		const CMappedFile& source,
+		const std::string& outputPath,
+		std::string* error)
+	{
+		return Flipbook::convertManifest(
+			sourcePath,
+			reinterpret_cast<const char*>(source.getData()),
+			source.getSize(),
+			outputPath,
+			error
+		);
+	}
+
+	bool listFlipbookFrames(
+		const std::string& sourcePath,
+		const CMappedFile& source,
+		std::vector<std::string>& dependencies,
+		std::string* error)
+	{
+		return Flipbook::getFramePaths(
+			sourcePath,
+			reinterpret_cast<const char*>(source.getData()),
+			source.getSize(),
+			dependencies,
+			error
+		);
+	}
+
+	bool listAtlasImages(
+		const std::string& sourcePath,
+		const CMappedFile& source,
+		std::vector<std::string>& dependencies,
+		std::string* error)
+	{
+		TextureAtlas::SManifest manifest;
+		if (!TextureAtlas::parseManifest(
+			sourcePath,
+			reinterpret_cast<const char*>(source.getData()),
+			source.getSize(),
+			manifest,
+			error))
+		{
+			return false;
+		}
+
+		dependencies = manifest.m_imagePaths;
+		return true;
+	}
+
+	// Folds the size and modification time of each dependency into hash;
+	// a missing file counts as one of size zero, and fails the conversion.
+	unsigned long long hashDependencies(unsigned long long hash, const std::vector<std::string>& dependencies)
+	{
+		std::vector<unsigned char> key(reinterpret_cast<const unsigned char*>(&hash),
+			reinterpret_cast<const unsigned char*>(&hash) + sizeof(hash));
+		for (const std::string& dependency : dependencies)
+		{
+			std::error_code errorCode;
+			unsigned long long size = std::filesystem::file_size(dependency, errorCode);
+			if (errorCode)
+			{
+				size = 0;
+			}
+
+			long long time = 0;
+			const std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(dependency, errorCode);
+			if (!errorCode)
+			{
+				time = (long long)writeTime.time_since_epoch().count();
+			}
+
+			key.insert(key.end(), dependency.begin(), dependency.end());
+			key.insert(key.end(), reinterpret_cast<const unsigned char*>(&size),
+				reinterpret_cast<const unsigned char*>(&size) + sizeof(size));
+			key.insert(key.end(), reinterpret_cast<const unsigned char*>(&time),
+				reinterpret_cast<const unsigned char*>(&time) + sizeof(time));
+		}
+
+		return hashBytes(key.data(), key.size());
+	}
+
+	bool convertAtlas(
+		const std::string& sourcePath,
+		const CMappedFile& source,
+		const std::string& outputPath,
+		std::string* error)
+	{
+		return TextureAtlas::convertManifest(
+			sourcePath,
+			reinterpret_cast<const char*>(source.getData()),
+			source.getSize(),
+			outputPath,
+			error
+		);
+	}
+
+	bool convertTexture(
+		const std::string& sourcePath,
+		const CMappedFile& source,
+		const std::string& outputPath,
+		std::string* error)
+	{
+		return BlockCompressor::convertBmp(
+			sourcePath,
+			source.getData(),
+			source.getSize(),
+			outputPath,
+			BlockCompressor::EQuality::Normal,
+			error
+		);
+	}
+}
+
+CAssetCache::CAssetCache() :
+	m_cacheDirectory("Cache"),
+	m_hitCount(0),
+	m_missCount(0),
+	m_staleCount(0)
+{
+	registerConverter(".txt", ".bmsh", TextModelConverterVersion, convertTextModel);
+	registerConverter(".flipbook", ".flip", FlipbookConverterVersion, convertFlipbook, listFlipbookFrames);
+	registerConverter(".bmp", ".dds", TextureConverterVersion, convertTexture);
+	registerConverter(".atlas", ".dds", AtlasConverterVersion, convertAtlas, listAtlasImages);
+}
+
+CAssetCache& CAssetCache::getShared()
+{
+	static CAssetCache cache;
+	return cache;
+}
+
+void CAssetCache::setCacheDirectory(const std::string& directory)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_cacheDirectory = directory;
+}
+
+std::string CAssetCache::getCacheDirectory() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_cacheDirectory;
+}
+
+void CAssetCache::registerConverter(
+	const std::string& sourceExtension,
+	const std::string& outputExtension,
+	UINT version,
+	const Converter& converter,
+	const DependencyLister& listDependencies)
+{
+	SConverterEntry entry;
+	entry.m_outputExtension = outputExtension;
+	entry.m_version = version;
+	entry.m_converter = converter;
+	entry.m_listDependencies = listDependencies;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_converters[sourceExtension] = entry;
+}
+
+bool CAssetCache::getConvertedPath(const std::string& sourcePath, std::string& convertedPath, std::string* error)
+{
+	return acquire(sourcePath, Validator(), convertedPath, error);
+}
+
+bool CAssetCache::loadMesh(const std::string& sourcePath, CBinaryMesh& mesh, std::string* error)
+{
+	std::string convertedPath;
+	return acquire(sourcePath, [&](const std::string& path, std::string* openError)
+	{
+		return mesh.open(path, openError);
+	}, convertedPath, error);
+}
+
+bool CAssetCache::loadMesh(const std::string& sourcePath, MeshStreams::SMeshStreams& mesh, std::string* error)
+{
+	CBinaryMesh binaryMesh;
+	if (!loadMesh(sourcePath, binaryMesh, error))
+	{
+		return false;
+	}
+
+	binaryMesh.getStreams(mesh);
+	return true;
+}
+
+bool CAssetCache::loadFlipbook(
+	const std::string& sourcePath,
+	CFlipbook& flipbook,
+	UINT residentFrameCount,
+	std::string* error)
+{
+	std::string convertedPath;
+	return acquire(sourcePath, [&](const std::string& path, std::string* openError)
+	{
+		return flipbook.open(path, residentFrameCount, openError);
+	}, convertedPath, error);
+}
+
+bool CAssetCache::loadTexture(const std::string& sourcePath, CDdsFile& texture, std::string* error)
+{
+	std::string convertedPath;
+	return acquire(sourcePath, [&](const std::string& path, std::string* openError)
+	{
+		return texture.open(path, openError);
+	}, convertedPath, error);
+}
+
+UINT CAssetCache::getHitCount() const
+{
+	return m_hitCount;
+}
+
+UINT CAssetCache::getMissCount() const
+{
+	return m_missCount;
+}
+
+UINT CAssetCache::getStaleCount() const
+{
+	return m_staleCount;
+}
+
+bool CAssetCache::acquire(
+	const std::string& sourcePath,
+	const Validator& validate,
+	std::string& convertedPath,
+	std::string* error)
+{
+	std::string directory;
+	SConverterEntry entry;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		directory = m_cacheDirectory;
+
+		bool isFound = false;
+		for (const std::pair<const std::string, SConverterEntry>& converter : m_converters)
+		{
+			if (endsWith(sourcePath, converter.first))
+			{
+				entry = converter.second;
+				isFound = true;
+				break;
+			}
+		}
+
+		if (!isFound)
+		{
+			return setError(error, sourcePath + ": no converter for this file type");
+		}
+	}
+
+	CMappedFile source;
+	if (!source.open(sourcePath))
+	{
+		return setError(error, sourcePath + " not found");
+	}
+
+	std::string normalizedPath = sourcePath;
+	for (char& c : normalizedPath)
+	{
+		if (c == '\\')
+		{
+			c = '/';
+		}
+	}
+
+	const std::string fileName = std::filesystem::path(sourcePath).filename().string();
+	const unsigned long long pathHash = hashBytes(
+		reinterpret_cast<const unsigned char*>(normalizedPath.data()), normalizedPath.size());
+	unsigned long long contentHash = hashBytes(source.getData(), source.getSize());
+
+	if (entry.m_listDependencies)
+	{
+		std::vector<std::string> dependencies;
+		if (!entry.m_listDependencies(sourcePath, source, dependencies, error))
+		{
+			return false;
+		}
+		contentHash = hashDependencies(contentHash, dependencies);
+	}
+
+	char buffer[64];
+	std::snprintf(buffer, sizeof(buffer), "-%08x-", (UINT)pathHash);
+	const std::string prefix = fileName + buffer;
+
+	std::snprintf(buffer, sizeof(buffer), "%016llx-v%u", contentHash, entry.m_version);
+	const std::string entryName = prefix + buffer + entry.m_outputExtension;
+
+	convertedPath = directory.empty() ? entryName : directory + "/" + entryName;
+
+	// Hits take no lock: entries are only ever replaced whole, by a rename.
+	std::error_code errorCode;
+	if (std::filesystem::exists(convertedPath, errorCode) && (!validate || validate(convertedPath, nullptr)))
+	{
+		++m_hitCount;
+		return true;
+	}
+
+	std::mutex* convertMutex;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		convertMutex = &m_convertMutexes[prefix];
+	}
+	std::lock_guard<std::mutex> convertLock(*convertMutex);
+
+	// Another thread may have converted the source while this one waited.
+	if (std::filesystem::exists(convertedPath, errorCode))
+	{
+		if (!validate || validate(convertedPath, nullptr))
+		{
+			++m_hitCount;
+			return true;
+		}
+
+		// Written by an older build or damaged; convert it again.
+		++m_staleCount;
+	}
+
+	++m_missCount;
+
+	if (!directory.empty())
+	{
+		std::filesystem::create_directories(directory, errorCode);
+	}
+
+	if (!entry.m_converter(sourcePath, source, convertedPath, error))
+	{
+		return false;
+	}
+
+	removeStaleEntries(directory, prefix, entryName);
+
+	return !validate || validate(convertedPath, error);
+}
+
+void CAssetCache::removeStaleEntries(const std::string& directory, const std::string& prefix, const std::string& keep)
+{
+	std::error_code errorCode;
+	std::filesystem::directory_iterator it(directory.empty() ? "." : directory, errorCode);
+	if (errorCode)
+	{
+		return;
+	}
+
+	std::vector<std::filesystem::path> stalePaths;
+	for (; it != std::filesystem::directory_iterator(); it.increment(errorCode))
+	{
+		const std::string name = it->path().filename().string();
+		if (name != keep && name.compare(0, prefix.size(), prefix) == 0)
+		{
+			stalePaths.push_back(it->path());
+		}
+	}
+
+	// Entries still mapped elsewhere may refuse to go; they are retried on
+	// the next conversion of the source.
+	for (const std::filesystem::path& path : stalePaths)
+	{
+		if (std::filesystem::remove(path, errorCode))
+		{
+			++m_staleCount;
+		}
+	}
+}
@@ -0,0 +1,141 @@
+﻿#pragma once
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "binarymesh.h"
+#include "ddsfile.h"
+#include "flipbook.h"
+#include "mappedfile.h"
+
+// Keeps converted forms of source assets in a cache directory so the sources
+// (e.g. the text models under Models/) can keep shipping while only the
+// first run pays for conversion. A converted file is named after the source
+// file name, a hash of the source path, a hash of the source content and the
+// converter version:
+//
+//   <cache>/skull.txt-<path hash>-<content hash>-v<version>.bmsh
+//
+// For sources that name other files, e.g. the frames of a flipbook
+// manifest, the content hash covers the size and modification time of each
+// of those files too. An edited source or dependency, or a bumped converter
+// version, therefore never matches an old entry; the old entries of the
+// same source are deleted when the new one is written. Cached files that
+// fail validation are converted again. All methods may be called from any
+// thread.
+class CAssetCache
+{
+public:
+	// Converts the mapped source into a file at outputPath.
+	typedef std::function<bool(
+		const std::string& sourcePath,
+		const CMappedFile& source,
+		const std::string& outputPath,
+		std::string* error
+	)> Converter;
+
+	// Lists the files, besides the source, that a conversion reads.
+	typedef std::function<bool(
+		const std::string& sourcePath,
+		const CMappedFile& source,
+		std::vector<std::string>& dependencies,
+		std::string* error
+	)> DependencyLister;
+
+	// Version of the built-in text model converter; bump it whenever its
+	// output changes.
+	static const UINT TextModelConverterVersion = 3;
+	static const UINT FlipbookConverterVersion = 2;
+	static const UINT TextureConverterVersion = 2;
+	static const UINT AtlasConverterVersion = 1;
+
+	// Starts out with the converters for ".txt" models to ".bmsh" meshes,
+	// with both blobs encoded by MeshCodec, for ".flipbook" manifests to
+	// ".flip" packs, and for ".bmp" textures and ".atlas" manifests to
+	// block-compressed ".dds" files.
+	CAssetCache();
+
+	// Process wide cache shared by all scenes, in the directory "Cache".
+	static CAssetCache& getShared();
+
+	void setCacheDirectory(const std::string& directory);
+	std::string getCacheDirectory() const;
+
+	// Registers the converter for sources whose path ends in
+	// sourceExtension, e.g. ".txt", replacing an earlier one.
+	void registerConverter(
+		const std::string& sourceExtension,
+		const std::string& outputExtension,
+		UINT version,
+		const Converter& converter,
+		const DependencyLister& listDependencies = DependencyLister()
+	);
+
+	// Path of the converted form of sourcePath, converting the source first
+	// when the cache holds no entry for its current content.
+	bool getConvertedPath(const std::string& sourcePath, std::string& convertedPath, std::string* error = nullptr);
+
+	// Maps the converted form of a mesh source; the data is not copied.
+	bool loadMesh(const std::string& sourcePath, CBinaryMesh& mesh, std::string* error = nullptr);
+
+	// Same, copied out into streams for callers that process the mesh.
+	bool loadMesh(const std::string& sourcePath, MeshStreams::SMeshStreams& mesh, std::string* error = nullptr);
+
+	// Opens the pack of a flipbook manifest for playback.
+	bool loadFlipbook(
+		const std::string& sourcePath,
+		CFlipbook& flipbook,
+		UINT residentFrameCount,
+		std::string* error = nullptr
+	);
+
+	// Maps the DDS file a texture source, e.g. a BMP or an atlas manifest,
+	// is converted to.
+	bool loadTexture(const std::string& sourcePath, CDdsFile& texture, std::string* error = nullptr);
+
+	UINT getHitCount() const;
+	UINT getMissCount() const;
+
+	// Entries replaced because their source or converter changed, or because
+	// they were unreadable.
+	UINT getStaleCount() const;
+
+private:
+	struct SConverterEntry
+	{
+		std::string m_outputExtension;
+		UINT m_version;
+		Converter m_converter;
+		DependencyLister m_listDependencies;
+	};
+
+	// Opens a cached file for the caller; false marks the entry as stale.
+	typedef std::function<bool(const std::string& path, std::string* error)> Validator;
+
+	bool acquire(
+		const std::string& sourcePath,
+		const Validator& validate,
+		std::string& convertedPath,
+		std::string* error
+	);
+
+	void removeStaleEntries(const std::string& directory, const std::string& prefix, const std::string& keep);
+
+	mutable std::mutex m_mutex;
+	std::string m_cacheDirectory;
+	std::unordered_map<std::string, SConverterEntry> m_converters;
+
+	// Per source, by the entry name prefix: held while a miss converts, so
+	// two threads never convert the same source at once. Hits and other
+	// sources go on meanwhile. Guarded by m_mutex; entries are never
+	// removed, so the mutexes stay put.
+	std::unordered_map<std::string, std::mutex> m_convertMutexes;
+
+	std::atomic<UINT> m_hitCount;
+	std::atomic<UINT> m_missCount;
+	std::atomic<UINT> m_staleCount;
+};
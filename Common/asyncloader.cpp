@@ -0,0 +1,133 @@
+﻿#include "asyncloader.h"
+
+CAsyncLoader::CAsyncLoader(CThreadPool& threadPool) :
+	m_threadPool(threadPool),
+	m_pendingJobCount(0)
+{
+
+}
+
+CAsyncLoader::~CAsyncLoader()
+{
+	// Worker jobs hold a pointer to the loader until they finish.
+	wait();
+}
+
+UINT CAsyncLoader::update()
+{
+	std::vector<JobPtr> jobs;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		jobs.swap(m_ownerJobs);
+	}
+
+	for (const JobPtr& job : jobs)
+	{
+		run(job);
+	}
+
+	return (UINT)jobs.size();
+}
+
+void CAsyncLoader::wait()
+{
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_condition.wait(lock, [this]()
+			{
+				return m_pendingJobCount == 0 || !m_ownerJobs.empty();
+			});
+
+			if (m_pendingJobCount == 0)
+			{
+				return;
+			}
+		}
+
+		update();
+	}
+}
+
+UINT CAsyncLoader::getPendingJobCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_pendingJobCount;
+}
+
+void CAsyncLoader::schedule(const JobPtr& job, const std::vector<JobPtr>& dependencies)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		++m_pendingJobCount;
+
+		for (const JobPtr& dependency : dependencies)
+		{
+			if (dependency && !dependency->m_isDone)
+			{
+				dependency->m_dependents.push_back(job);
+				++job->m_waitCount;
+			}
+		}
+
+		if (job->m_waitCount > 0)
+		{
+			return;
+		}
+	}
+
+	dispatch(job);
+}
+
+void CAsyncLoader::dispatch(const JobPtr& job)
+{
+	if (job->m_isOwnerJob)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_ownerJobs.push_back(job);
+		m_condition.notify_all();
+	}
+	else
+	{
+		m_threadPool.submit([this, job]()
+		{
+			run(job);
+		});
+	}
+}
+
+void CAsyncLoader::run(const JobPtr& job)
+{
+	// The packaged task stores exceptions in the future, so this never
+	// throws.
+	job->m_run();
+	job->m_run = nullptr;
+
+	std::vector<JobPtr> readyJobs;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		job->m_isDone = true;
+
+		for (const JobPtr& dependent : job->m_dependents)
+		{
+			if (--dependent->m_waitCount == 0)
+			{
+				readyJobs.push_back(dependent);
+			}
+		}
+		job->m_dependents.clear();
+	}
+
+	for (const JobPtr& readyJob : readyJobs)
+	{
+		dispatch(readyJob);
+	}
+
+	// Dependents are counted before this job stops being pending, so wait()
+	// cannot see zero while work is still about to be dispatched. Notified
+	// under the lock, as the loader may be destroyed right after wait().
+	std::lock_guard<std::mutex> lock(m_mutex);
+	--m_pendingJobCount;
+	m_condition.notify_all();
+}
@@ -0,0 +1,136 @@
+﻿#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "threadpool.h"
+
+// Loads assets as a graph of jobs, so start-up costs about as long as the
+// slowest chain of jobs instead of the sum of all of them.
+//
+// Worker jobs (file reads, decoding, mesh processing) run on the thread pool
+// as soon as the jobs they depend on have finished. Owner jobs (resource
+// creation and anything else that has to stay on one thread) are queued for
+// the thread that created the loader and run there inside update() or
+// wait(). Each job hands out a shared_future of its result; an exception
+// thrown by a job is stored in it and rethrown by get(), and does not stop
+// the jobs that depend on it from running.
+//
+//   CAsyncLoader loader;
+//   auto image = loader.submit([]() { return loadImage("a.bmp"); });
+//   auto texture = loader.submitToOwner([=]() { return createTexture(image.get()); }, { image.m_job });
+//   loader.wait();
+//   texture.get();
+class CAsyncLoader
+{
+	struct SJob;
+
+public:
+	typedef std::shared_ptr<SJob> JobPtr;
+
+	template<class TResult>
+	struct SHandle
+	{
+		JobPtr m_job;
+		std::shared_future<TResult> m_result;
+
+		// Blocks until the job has run; call it from a job that depends on
+		// this one, or after wait(), so it never blocks.
+		decltype(std::declval<const std::shared_future<TResult>&>().get()) get() const
+		{
+			return m_result.get();
+		}
+	};
+
+	explicit CAsyncLoader(CThreadPool& threadPool = CThreadPool::getShared());
+
+	// Waits for every job, running owner jobs meanwhile.
+	~CAsyncLoader();
+
+	CAsyncLoader(const CAsyncLoader&) = delete;
+	CAsyncLoader& operator=(const CAsyncLoader&) = delete;
+
+	template<class TFunction>
+	auto submit(TFunction&& function, const std::vector<JobPtr>& dependencies = {})
+		-> SHandle<decltype(function())>;
+
+	template<class TFunction>
+	auto submitToOwner(TFunction&& function, const std::vector<JobPtr>& dependencies = {})
+		-> SHandle<decltype(function())>;
+
+	// Runs the owner jobs that are ready, without waiting for others.
+	// Returns the number of jobs run. Owner thread only.
+	UINT update();
+
+	// Returns once every job submitted so far has run. Owner thread only.
+	void wait();
+
+	UINT getPendingJobCount() const;
+
+private:
+	struct SJob
+	{
+		std::function<void()> m_run;
+		bool m_isOwnerJob = false;
+		bool m_isDone = false;
+
+		// Unfinished dependencies, and the jobs waiting on this one.
+		UINT m_waitCount = 0;
+		std::vector<JobPtr> m_dependents;
+	};
+
+	template<class TFunction>
+	auto createJob(TFunction&& function, const std::vector<JobPtr>& dependencies, bool isOwnerJob)
+		-> SHandle<decltype(function())>;
+
+	void schedule(const JobPtr& job, const std::vector<JobPtr>& dependencies);
+	void dispatch(const JobPtr& job);
+	void run(const JobPtr& job);
+
+	CThreadPool& m_threadPool;
+
+	mutable std::mutex m_mutex;
+	std::condition_variable m_condition;
+	std::vector<JobPtr> m_ownerJobs;
+	UINT m_pendingJobCount;
+};
+
+template<class TFunction>
+auto CAsyncLoader::submit(TFunction&& function, const std::vector<JobPtr>& dependencies)
+	-> SHandle<decltype(function())>
+{
+	return createJob(std::forward<TFunction>(function), dependencies, false);
+}
+
+template<class TFunction>
+auto CAsyncLoader::submitToOwner(TFunction&& function, const std::vector<JobPtr>& dependencies)
+	-> SHandle<decltype(function())>
+{
+	return createJob(std::forward<TFunction>(function), dependencies, true);
+}
+
+template<class TFunction>
+auto CAsyncLoader::createJob(TFunction&& function, const std::vector<JobPtr>& dependencies, bool isOwnerJob)
+	-> SHandle<decltype(function())>
+{
+	typedef decltype(function()) TResult;
+
+	// packaged_task is move-only, std::function needs a copyable target.
+	auto task = std::make_shared<std::packaged_task<TResult()>>(std::forward<TFunction>(function));
+
+	SHandle<TResult> handle;
+	handle.m_result = task->get_future().share();
+	handle.m_job = std::make_shared<SJob>();
+	handle.m_job->m_run = [task]()
+	{
+		(*task)();
+	};
+	handle.m_job->m_isOwnerJob = isOwnerJob;
+
+	schedule(handle.m_job, dependencies);
+	return handle;
+}
@@ -0,0 +1,475 @@
+﻿#include "binarymesh.h"
+
+#include <cstring>
+
+#include "fileutil.h"
+#include "meshcodec.h"
+#include "modelloader.h"
+
+using FileUtil::setError;
+
+namespace
+{
+	UINT alignUp(UINT value, UINT alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	UINT getFormatSize(UINT format)
+	{
+		switch (format)
+		{
+		case DXGI_FORMAT_R32G32B32A32_FLOAT:
+			return 16;
+		case DXGI_FORMAT_R32G32B32_FLOAT:
+			return 12;
+		case DXGI_FORMAT_R32G32_FLOAT:
+		case DXGI_FORMAT_R16G16B16A16_FLOAT:
+		case DXGI_FORMAT_R16G16B16A16_UNORM:
+		case DXGI_FORMAT_R16G16B16A16_SNORM:
+			return 8;
+		case DXGI_FORMAT_R8G8B8A8_UNORM:
+		case DXGI_FORMAT_R8G8B8A8_SNORM:
+		case DXGI_FORMAT_R16G16_FLOAT:
+		case DXGI_FORMAT_R16G16_UNORM:
+		case DXGI_FORMAT_R16G16_SNORM:
+		case DXGI_FORMAT_R10G10B10A2_UNORM:
+			return 4;
+		default:
+			return 0;
+		}
+	}
+
+	template<class TElement>
+	void addStream(
+		const std::vector<TElement>& stream,
+		BinaryMesh::ESemantic semantic,
+		DXGI_FORMAT format,
+		BinaryMesh::SHeader& header,
+		std::vector<const void*>& sources)
+	{
+		if (stream.empty())
+		{
+			return;
+		}
+
+		BinaryMesh::SAttribute& attribute = header.m_attributes[header.m_attributeCount++];
+		attribute.m_semantic = semantic;
+		attribute.m_semanticIndex = 0;
+		attribute.m_format = format;
+		attribute.m_offset = header.m_vertexStride;
+
+		header.m_vertexStride += sizeof(TElement);
+		sources.push_back(stream.data());
+	}
+
+	template<class TElement>
+	void readStream(const char* vertices, UINT vertexCount, UINT stride, UINT offset, std::vector<TElement>& stream)
+	{
+		stream.resize(vertexCount);
+		for (UINT i = 0; i < vertexCount; ++i)
+		{
+			std::memcpy(&stream[i], vertices + i * stride + offset, sizeof(TElement));
+		}
+	}
+}
+
+bool BinaryMesh::write(const std::string& path, const MeshStreams::SMeshStreams& mesh, std::string* error, UINT flags)
+{
+	const UINT vertexCount = mesh.getVertexCount();
+
+	const bool areStreamsComplete =
+		(mesh.m_normals.empty() || mesh.m_normals.size() == vertexCount) &&
+		(mesh.m_tangentsU.empty() || mesh.m_tangentsU.size() == vertexCount) &&
+		(mesh.m_texCs.empty() || mesh.m_texCs.size() == vertexCount) &&
+		(mesh.m_colors.empty() || mesh.m_colors.size() == vertexCount);
+	if (!areStreamsComplete)
+	{
+		return setError(error, path + ": streams differ in length");
+	}
+
+	if ((flags & IndexCodecFlag) && mesh.m_indices.size() % 3 != 0)
+	{
+		return setError(error, path + ": encoded indices must form triangles");
+	}
+
+	SHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.m_magic, Magic, sizeof(Magic));
+	header.m_version = Version;
+	header.m_headerSize = sizeof(SHeader);
+	header.m_flags = flags & (VertexCodecFlag | IndexCodecFlag);
+	header.m_vertexCount = vertexCount;
+	header.m_indexCount = (UINT)mesh.m_indices.size();
+	header.m_indexSize = vertexCount <= 0x10000 ? sizeof(USHORT) : sizeof(UINT);
+
+	std::vector<const void*> sources;
+	addStream(mesh.m_positions, ESemantic::Position, DXGI_FORMAT_R32G32B32_FLOAT, header, sources);
+	addStream(mesh.m_normals, ESemantic::Normal, DXGI_FORMAT_R32G32B32_FLOAT, header, sources);
+	addStream(mesh.m_tangentsU, ESemantic::TangentU, DXGI_FORMAT_R32G32B32_FLOAT, header, sources);
+	addStream(mesh.m_texCs, ESemantic::TexCoord, DXGI_FORMAT_R32G32_FLOAT, header, sources);
+	addStream(mesh.m_colors, ESemantic::Color, DXGI_FORMAT_R32G32B32A32_FLOAT, header, sources);
+
+	if (!mesh.m_positions.empty())
+	{
+		MeshStreams::computeBounds(mesh.m_positions, header.m_boundsMin, header.m_boundsMax);
+	}
+
+	std::vector<unsigned char> vertexBlob((size_t)vertexCount * header.m_vertexStride);
+	for (UINT a = 0; a < header.m_attributeCount; ++a)
+	{
+		const SAttribute& attribute = header.m_attributes[a];
+		const UINT size = getFormatSize(attribute.m_format);
+		const unsigned char* source = static_cast<const unsigned char*>(sources[a]);
+		unsigned char* destination = vertexBlob.data() + attribute.m_offset;
+
+		for (UINT i = 0; i < vertexCount; ++i)
+		{
+			std::memcpy(destination + i * header.m_vertexStride, source + i * size, size);
+		}
+	}
+
+	std::vector<unsigned char> indexBlob((size_t)header.m_indexCount * header.m_indexSize);
+	for (UINT i = 0; i < header.m_indexCount; ++i)
+	{
+		if (header.m_indexSize == sizeof(USHORT))
+		{
+			const USHORT index = (USHORT)mesh.m_indices[i];
+			std::memcpy(&indexBlob[i * sizeof(USHORT)], &index, sizeof(USHORT));
+		}
+		else
+		{
+			std::memcpy(&indexBlob[i * sizeof(UINT)], &mesh.m_indices[i], sizeof(UINT));
+		}
+	}
+
+	if (header.m_flags & VertexCodecFlag)
+	{
+		std::vector<unsigned char> encoded;
+		MeshCodec::encodeVertexBuffer(vertexBlob.data(), vertexCount, header.m_vertexStride, encoded);
+		vertexBlob.swap(encoded);
+		header.m_vertexEncodedSize = (UINT)vertexBlob.size();
+	}
+
+	if (header.m_flags & IndexCodecFlag)
+	{
+		std::vector<unsigned char> encoded;
+		MeshCodec::encodeIndexBuffer(mesh.m_indices.data(), header.m_indexCount, encoded);
+		indexBlob.swap(encoded);
+		header.m_indexEncodedSize = (UINT)indexBlob.size();
+	}
+
+	header.m_vertexOffset = alignUp(sizeof(SHeader), BlobAlignment);
+	header.m_indexOffset = alignUp(header.m_vertexOffset + (UINT)vertexBlob.size(), BlobAlignment);
+
+	// The file image, padding included.
+	std::vector<char> image(header.m_indexOffset + indexBlob.size(), 0);
+	std::memcpy(image.data(), &header, sizeof(header));
+	if (!vertexBlob.empty())
+	{
+		std::memcpy(image.data() + header.m_vertexOffset, vertexBlob.data(), vertexBlob.size());
+	}
+	if (!indexBlob.empty())
+	{
+		std::memcpy(image.data() + header.m_indexOffset, indexBlob.data(), indexBlob.size());
+	}
+
+	return FileUtil::writeFile(path, image.data(), image.size(), error);
+}
+
+bool BinaryMesh::convertTextModel(const std::string& sourcePath, const std::string& path, std::string* error)
+{
+	MeshStreams::SMeshStreams mesh;
+	if (!ModelLoader::loadTextModel(sourcePath, mesh, error))
+	{
+		return false;
+	}
+
+	return write(path, mesh, error);
+}
+
+const char* BinaryMesh::getSemanticName(ESemantic semantic)
+{
+	switch (semantic)
+	{
+	case ESemantic::Position:
+		return "POSITION";
+	case ESemantic::Normal:
+		return "NORMAL";
+	case ESemantic::TangentU:
+		return "TANGENT";
+	case ESemantic::TexCoord:
+		return "TEXCOORD";
+	case ESemantic::Color:
+		return "COLOR";
+	default:
+		return "";
+	}
+}
+
+CBinaryMesh::CBinaryMesh() :
+	m_header(nullptr)
+{
+
+}
+
+bool CBinaryMesh::open(const std::string& path, std::string* error)
+{
+	close();
+
+	if (!m_file.open(path))
+	{
+		return setError(error, path + " not found");
+	}
+
+	const BinaryMesh::SHeader* header = reinterpret_cast<const BinaryMesh::SHeader*>(m_file.getData());
+	const size_t fileSize = m_file.getSize();
+
+	if (fileSize < sizeof(BinaryMesh::SHeader) ||
+		std::memcmp(header->m_magic, BinaryMesh::Magic, sizeof(BinaryMesh::Magic)) != 0)
+	{
+		close();
+		return setError(error, path + " is not a binary mesh");
+	}
+
+	if (header->m_version != BinaryMesh::Version || header->m_headerSize != sizeof(BinaryMesh::SHeader))
+	{
+		close();
+		return setError(error, path + " has version " + std::to_string(header->m_version) +
+			", expected " + std::to_string(BinaryMesh::Version));
+	}
+
+	const bool isVertexEncoded = (header->m_flags & BinaryMesh::VertexCodecFlag) != 0;
+	const bool isIndexEncoded = (header->m_flags & BinaryMesh::IndexCodecFlag) != 0;
+
+	const unsigned long long vertexBlobSize = isVertexEncoded ?
+		header->m_vertexEncodedSize :
+		(unsigned long long)header->m_vertexCount * header->m_vertexStride;
+	const unsigned long long indexBlobSize = isIndexEncoded ?
+		header->m_indexEncodedSize :
+		(unsigned long long)header->m_indexCount * header->m_indexSize;
+
+	bool isValid =
+		header->m_attributeCount <= BinaryMesh::MaxAttributeCount &&
+		(header->m_indexSize == sizeof(USHORT) || header->m_indexSize == sizeof(UINT)) &&
+		header->m_vertexOffset % BinaryMesh::BlobAlignment == 0 &&
+		header->m_indexOffset % BinaryMesh::BlobAlignment == 0 &&
+		header->m_vertexOffset >= sizeof(BinaryMesh::SHeader) &&
+		header->m_vertexOffset + vertexBlobSize <= header->m_indexOffset &&
+		header->m_indexOffset + indexBlobSize <= fileSize;
+
+	for (UINT a = 0; isValid && a < header->m_attributeCount; ++a)
+	{
+		const BinaryMesh::SAttribute& attribute = header->m_attributes[a];
+		const UINT size = getFormatSize(attribute.m_format);
+		isValid = size != 0 && attribute.m_offset + size <= header->m_vertexStride;
+	}
+
+	if (!isValid)
+	{
+		close();
+		return setError(error, path + " has an inconsistent header");
+	}
+
+	if (isVertexEncoded)
+	{
+		m_decodedVertices.resize((size_t)header->m_vertexCount * header->m_vertexStride);
+		isValid = MeshCodec::decodeVertexBuffer(
+			m_decodedVertices.data(),
+			header->m_vertexCount,
+			header->m_vertexStride,
+			m_file.getData() + header->m_vertexOffset,
+			header->m_vertexEncodedSize
+		);
+	}
+
+	if (isValid && isIndexEncoded)
+	{
+		m_decodedIndices.resize((size_t)header->m_indexCount * header->m_indexSize);
+		isValid = MeshCodec::decodeIndexBuffer(
+			m_decodedIndices.data(),
+			header->m_indexCount,
+			header->m_indexSize,
+			header->m_vertexCount,
+			m_file.getData() + header->m_indexOffset,
+			header->m_indexEncodedSize
+		);
+	}
+
+	if (!isValid)
+	{
+		close();
+		return setError(error, path + " holds a malformed encoded blob");
+	}
+
+	m_header = header;
+	return true;
+}
+
+void CBinaryMesh::close()
+{
+	m_header = nullptr;
+	m_file.close();
+
+	m_decodedVertices.clear();
+	m_decodedVertices.shrink_to_fit();
+	m_decodedIndices.clear();
+	m_decodedIndices.shrink_to_fit();
+}
+
+const BinaryMesh::SHeader& CBinaryMesh::getHeader() const
+{
+	return *m_header;
+}
+
+const void* CBinaryMesh::getVertexData() const
+{
+	if (m_header->m_flags & BinaryMesh::VertexCodecFlag)
+	{
+		return m_decodedVertices.data();
+	}
+	return m_file.getData() + m_header->m_vertexOffset;
+}
+
+UINT CBinaryMesh::getVertexDataSize() const
+{
+	return m_header->m_vertexCount * m_header->m_vertexStride;
+}
+
+const void* CBinaryMesh::getIndexData() const
+{
+	if (m_header->m_flags & BinaryMesh::IndexCodecFlag)
+	{
+		return m_decodedIndices.data();
+	}
+	return m_file.getData() + m_header->m_indexOffset;
+}
+
+UINT CBinaryMesh::getIndexDataSize() const
+{
+	return m_header->m_indexCount * m_header->m_indexSize;
+}
+
+DXGI_FORMAT CBinaryMesh::getIndexFormat() const
+{
+	return m_header->m_indexSize == sizeof(USHORT) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+}
+
+void CBinaryMesh::getInputElements(std::vector<D3D11_INPUT_ELEMENT_DESC>& elements) const
+{
+	elements.clear();
+	for (UINT a = 0; a < m_header->m_attributeCount; ++a)
+	{
+		const BinaryMesh::SAttribute& attribute = m_header->m_attributes[a];
+
+		D3D11_INPUT_ELEMENT_DESC element;
+		element.SemanticName = BinaryMesh::getSemanticName(attribute.m_semantic);
+		element.SemanticIndex = attribute.m_semanticIndex;
+		element.Format = (DXGI_FORMAT)attribute.m_format;
+		element.InputSlot = 0;
+		element.AlignedByteOffset = attribute.m_offset;
+		element.InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+		element.InstanceDataStepRate = 0;
+		elements.push_back(element);
+	}
+}
+
+void CBinaryMesh::createBuffers(ID3D11Device* device, ID3D11Buffer** vertexBuffer, ID3D11Buffer** indexBuffer) const
+{
+	D3D11_BUFFER_DESC vbDesc;
+	vbDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	vbDesc.ByteWidth = getVertexDataSize();
+	vbDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	vbDesc.CPUAccessFlags = 0;
+	vbDesc.MiscFlags = 0;
+	vbDesc.StructureByteStride = 0;
+
+	D3D11_SUBRESOURCE_DATA vInitData;
+	vInitData.pSysMem = getVertexData();
+	vInitData.SysMemPitch = 0;
+	vInitData.SysMemSlicePitch = 0;
+
+	ThrowIfFailed(device->CreateBuffer(&vbDesc, &vInitData, vertexBuffer));
+
+	D3D11_BUFFER_DESC ibDesc;
+	ibDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	ibDesc.ByteWidth = getIndexDataSize();
+	ibDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	ibDesc.CPUAccessFlags = 0;
+	ibDesc.MiscFlags = 0;
+	ibDesc.StructureByteStride = 0;
+
+	D3D11_SUBRESOURCE_DATA iInitData;
+	iInitData.pSysMem = getIndexData();
+	iInitData.SysMemPitch = 0;
+	iInitData.SysMemSlicePitch = 0;
+
+	ThrowIfFailed(device->CreateBuffer(&ibDesc, &iInitData, indexBuffer));
+}
+
+void CBinaryMesh::getStreams(MeshStreams::SMeshStreams& mesh) const
+{
+	mesh = MeshStreams::SMeshStreams();
+
+	const char* vertices = static_cast<const char*>(getVertexData());
+	const UINT vertexCount = m_header->m_vertexCount;
+	const UINT stride = m_header->m_vertexStride;
+
+	// write() only produces these formats; other attributes are skipped.
+	for (UINT a = 0; a < m_header->m_attributeCount; ++a)
+	{
+		const BinaryMesh::SAttribute& attribute = m_header->m_attributes[a];
+		switch (attribute.m_semantic)
+		{
+		case BinaryMesh::ESemantic::Position:
+			if (attribute.m_format == DXGI_FORMAT_R32G32B32_FLOAT)
+			{
+				readStream(vertices, vertexCount, stride, attribute.m_offset, mesh.m_positions);
+			}
+			break;
+		case BinaryMesh::ESemantic::Normal:
+			if (attribute.m_format == DXGI_FORMAT_R32G32B32_FLOAT)
+			{
+				readStream(vertices, vertexCount, stride, attribute.m_offset, mesh.m_normals);
+			}
+			break;
+		case BinaryMesh::ESemantic::TangentU:
+			if (attribute.m_format == DXGI_FORMAT_R32G32B32_FLOAT)
+			{
+				readStream(vertices, vertexCount, stride, attribute.m_offset, mesh.m_tangentsU);
+			}
+			break;
+		case BinaryMesh::ESemantic::TexCoord:
+			if (attribute.m_format == DXGI_FORMAT_R32G32_FLOAT)
+			{
+				readStream(vertices, vertexCount, stride, attribute.m_offset, mesh.m_texCs);
+			}
+			break;
+		case BinaryMesh::ESemantic::Color:
+			if (attribute.m_format == DXGI_FORMAT_R32G32B32A32_FLOAT)
+			{
+				readStream(vertices, vertexCount, stride, attribute.m_offset, mesh.m_colors);
+			}
+			break;
+		default:
+			break;
+		}
+	}
+
+	const UINT indexCount = m_header->m_indexCount;
+	mesh.m_indices.resize(indexCount);
+	if (m_header->m_indexSize == sizeof(USHORT))
+	{
+		const char* indices = static_cast<const char*>(getIndexData());
+		for (UINT i = 0; i < indexCount; ++i)
+		{
+			USHORT index;
+			std::memcpy(&index, indices + i * sizeof(USHORT), sizeof(USHORT));
+			mesh.m_indices[i] = index;
+		}
+	}
+	else if (indexCount > 0)
+	{
+		std::memcpy(mesh.m_indices.data(), getIndexData(), indexCount * sizeof(UINT));
+	}
+}
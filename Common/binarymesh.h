@@ -0,0 +1,132 @@
+﻿#pragma once
+
+#include <string>
+#include <vector>
+
+#include "d3dutil.h"
+#include "mappedfile.h"
+#include "meshstreams.h"
+
+using namespace DirectX;
+
+// Versioned binary mesh laid out so that a memory mapping of the file can
+// be handed to buffer creation as is:
+//
+//   SHeader | padding | vertex blob | padding | index blob
+//
+// Both blobs start on BlobAlignment boundaries. Vertices are interleaved
+// with the stride and attribute offsets of the header; indices are 16-bit
+// when every vertex can be addressed with them. Files are little-endian.
+//
+// Files meant for shipping may store either blob encoded with MeshCodec,
+// marked in m_flags; such blobs take m_vertexEncodedSize or
+// m_indexEncodedSize bytes and are decoded into memory on open().
+namespace BinaryMesh
+{
+	const char Magic[4] = { 'B', 'M', 'S', 'H' };
+	const UINT Version = 2;
+	const UINT BlobAlignment = 64;
+	const UINT MaxAttributeCount = 8;
+
+	// m_flags bits.
+	const UINT VertexCodecFlag = 0x1;
+	const UINT IndexCodecFlag = 0x2;
+
+	enum class ESemantic : UINT
+	{
+		Position = 0,
+		Normal = 1,
+		TangentU = 2,
+		TexCoord = 3,
+		Color = 4
+	};
+
+	struct SAttribute
+	{
+		ESemantic m_semantic;
+		UINT m_semanticIndex;
+
+		// A DXGI_FORMAT.
+		UINT m_format;
+		UINT m_offset;
+	};
+
+	struct SHeader
+	{
+		char m_magic[4];
+		UINT m_version;
+		UINT m_headerSize;
+		UINT m_flags;
+
+		UINT m_vertexCount;
+		UINT m_vertexStride;
+		UINT m_vertexOffset;
+		UINT m_vertexEncodedSize;
+
+		UINT m_indexCount;
+		UINT m_indexSize;
+		UINT m_indexOffset;
+		UINT m_indexEncodedSize;
+
+		UINT m_attributeCount;
+		SAttribute m_attributes[MaxAttributeCount];
+
+		XMFLOAT3 m_boundsMin;
+		XMFLOAT3 m_boundsMax;
+	};
+
+	// Interleaves the streams present in the mesh, in the order positions,
+	// normals, tangents, texture coordinates, colors, as 32-bit floats, and
+	// encodes the blobs named by flags. The file is written under a
+	// temporary name and renamed when complete.
+	bool write(
+		const std::string& path,
+		const MeshStreams::SMeshStreams& mesh,
+		std::string* error = nullptr,
+		UINT flags = 0
+	);
+
+	// Converts a text model (see ModelLoader) to a position and normal mesh.
+	bool convertTextModel(const std::string& sourcePath, const std::string& path, std::string* error = nullptr);
+
+	const char* getSemanticName(ESemantic semantic);
+}
+
+// A binary mesh file mapped into memory. open() checks the header and that
+// the blobs lie inside the file; nothing is parsed or copied per element,
+// the data pointers point into the mapping. Encoded blobs are the exception:
+// they are decoded into buffers owned by the mesh.
+class CBinaryMesh
+{
+public:
+	CBinaryMesh();
+
+	bool open(const std::string& path, std::string* error = nullptr);
+	void close();
+
+	const BinaryMesh::SHeader& getHeader() const;
+
+	const void* getVertexData() const;
+	UINT getVertexDataSize() const;
+
+	const void* getIndexData() const;
+	UINT getIndexDataSize() const;
+	DXGI_FORMAT getIndexFormat() const;
+
+	// Input layout elements for the stored attributes, in input slot 0.
+	void getInputElements(std::vector<D3D11_INPUT_ELEMENT_DESC>& elements) const;
+
+	// Immutable vertex and index buffers initialized from the mapping.
+	void createBuffers(ID3D11Device* device, ID3D11Buffer** vertexBuffer, ID3D11Buffer** indexBuffer) const;
+
+	// Copies the attributes back out into separate streams and the indices
+	// into 32-bit ones, for callers that still process the mesh on the CPU.
+	void getStreams(MeshStreams::SMeshStreams& mesh) const;
+
+private:
+	CMappedFile m_file;
+	const BinaryMesh::SHeader* m_header;
+
+	std::vector<unsigned char> m_decodedVertices;
+	std::vector<unsigned char> m_decodedIndices;
+};
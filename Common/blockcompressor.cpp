@@ -0,0 +1,1020 @@
+﻿#include "blockcompressor.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include <DirectXMath.h>
+
+#include "bmpdecoder.h"
+#include "ddsformat.h"
+#include "mipgenerator.h"
+#include "threadpool.h"
+
+namespace
+{
+	// BC1 pixels with less alpha decode as transparent black.
+	const UINT Bc1AlphaThreshold = 128;
+
+	// Blocks compressed per thread pool task.
+	const UINT BlocksPerChunk = 1024;
+
+	const UINT PowerIterationCount = 8;
+	const UINT RefinementCount = 2;
+	const UINT MaxSearchPassCount = 8;
+
+	// Palette entry no pixel is close to, standing in for the transparent
+	// entry of 3-color BC1 blocks.
+	const float UnreachableColor = 1.0e6f;
+
+	struct SColorBlock
+	{
+		// Channels in 0..255, one array each so four pixels load at once.
+		// Transparent pixels weigh 0 and take the transparent entry.
+		alignas(16) float m_red[16];
+		alignas(16) float m_green[16];
+		alignas(16) float m_blue[16];
+		alignas(16) float m_weight[16];
+
+		// BC1 blocks decode as 3-color blocks when the first endpoint is not
+		// the larger one; BC3 color blocks always have four colors.
+		bool m_isBc1;
+		bool m_hasTransparent;
+	};
+
+	struct SColorFit
+	{
+		USHORT m_endpoints[2];
+		bool m_isFourColor;
+		UINT m_indices;
+		float m_error;
+	};
+
+	struct SAlphaFit
+	{
+		int m_endpoints[2];
+		unsigned long long m_indices;
+		UINT m_error;
+	};
+
+	inline int clampInt(int value, int low, int high)
+	{
+		return value < low ? low : (value > high ? high : value);
+	}
+
+	inline float clampChannel(float value)
+	{
+		return value < 0.0f ? 0.0f : (value > 255.0f ? 255.0f : value);
+	}
+
+	USHORT packRgb565(const float color[3])
+	{
+		const int r = clampInt((int)(color[0] * (31.0f / 255.0f) + 0.5f), 0, 31);
+		const int g = clampInt((int)(color[1] * (63.0f / 255.0f) + 0.5f), 0, 63);
+		const int b = clampInt((int)(color[2] * (31.0f / 255.0f) + 0.5f), 0, 31);
+		return (USHORT)((r << 11) | (g << 5) | b);
+	}
+
+	void unpackRgb565(USHORT color, int rgb[3])
+	{
+		const int r = (color >> 11) & 31;
+		const int g = (color >> 5) & 63;
+		const int b = color & 31;
+		rgb[0] = (r << 3) | (r >> 2);
+		rgb[1] = (g << 2) | (g >> 4);
+		rgb[2] = (b << 3) | (b >> 2);
+	}
+
+	// The colors the decoder derives from two endpoints: two thirds and one
+	// third of the way in 4-color blocks, the midpoint and black otherwise.
+	void buildColorPalette(USHORT color0, USHORT color1, bool isFourColor, int palette[4][3])
+	{
+		unpackRgb565(color0, palette[0]);
+		unpackRgb565(color1, palette[1]);
+
+		for (UINT c = 0; c < 3; ++c)
+		{
+			const int a = palette[0][c];
+			const int b = palette[1][c];
+			if (isFourColor)
+			{
+				palette[2][c] = (2 * a + b + 1) / 3;
+				palette[3][c] = (a + 2 * b + 1) / 3;
+			}
+			else
+			{
+				palette[2][c] = (a + b + 1) / 2;
+				palette[3][c] = 0;
+			}
+		}
+	}
+
+	// Picks the nearest palette entry for every pixel and returns the
+	// weighted squared error; indices get two bits per pixel, pixel 0 lowest.
+	float fitColorIndices(const SColorBlock& block, const float palette[4][3], UINT& indices)
+	{
+		indices = 0;
+		float error = 0.0f;
+
+#if defined(_XM_SSE_INTRINSICS_)
+		__m128 paletteRed[4];
+		__m128 paletteGreen[4];
+		__m128 paletteBlue[4];
+		for (UINT p = 0; p < 4; ++p)
+		{
+			paletteRed[p] = _mm_set1_ps(palette[p][0]);
+			paletteGreen[p] = _mm_set1_ps(palette[p][1]);
+			paletteBlue[p] = _mm_set1_ps(palette[p][2]);
+		}
+
+		__m128 total = _mm_setzero_ps();
+		for (UINT i = 0; i < 16; i += 4)
+		{
+			const __m128 r = _mm_load_ps(block.m_red + i);
+			const __m128 g = _mm_load_ps(block.m_green + i);
+			const __m128 b = _mm_load_ps(block.m_blue + i);
+
+			__m128 best = _mm_set1_ps(FLT_MAX);
+			__m128i bestIndex = _mm_setzero_si128();
+			for (UINT p = 0; p < 4; ++p)
+			{
+				const __m128 dr = _mm_sub_ps(r, paletteRed[p]);
+				const __m128 dg = _mm_sub_ps(g, paletteGreen[p]);
+				const __m128 db = _mm_sub_ps(b, paletteBlue[p]);
+				const __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)), _mm_mul_ps(db, db));
+
+				const __m128i isBetter = _mm_castps_si128(_mm_cmplt_ps(distance, best));
+				best = _mm_min_ps(distance, best);
+				bestIndex = _mm_or_si128(_mm_and_si128(isBetter, _mm_set1_epi32((int)p)), _mm_andnot_si128(isBetter, bestIndex));
+			}
+
+			total = _mm_add_ps(total, _mm_mul_ps(best, _mm_load_ps(block.m_weight + i)));
+
+			alignas(16) UINT lanes[4];
+			_mm_store_si128(reinterpret_cast<__m128i*>(lanes), bestIndex);
+			indices |= (lanes[0] | (lanes[1] << 2) | (lanes[2] << 4) | (lanes[3] << 6)) << (i * 2);
+		}
+
+		alignas(16) float sums[4];
+		_mm_store_ps(sums, total);
+		error = (sums[0] + sums[1]) + (sums[2] + sums[3]);
+#else
+		for (UINT i = 0; i < 16; ++i)
+		{
+			float best = FLT_MAX;
+			UINT bestIndex = 0;
+			for (UINT p = 0; p < 4; ++p)
+			{
+				const float dr = block.m_red[i] - palette[p][0];
+				const float dg = block.m_green[i] - palette[p][1];
+				const float db = block.m_blue[i] - palette[p][2];
+				const float distance = dr * dr + dg * dg + db * db;
+				if (distance < best)
+				{
+					best = distance;
+					bestIndex = p;
+				}
+			}
+
+			error += best * block.m_weight[i];
+			indices |= bestIndex << (i * 2);
+		}
+#endif
+
+		if (block.m_hasTransparent)
+		{
+			for (UINT i = 0; i < 16; ++i)
+			{
+				if (block.m_weight[i] == 0.0f)
+				{
+					indices |= 3u << (i * 2);
+				}
+			}
+		}
+
+		return error;
+	}
+
+	// Scores a pair of endpoints in the requested mode and keeps it in best
+	// if it beats it. The endpoints are ordered for the mode first.
+	bool tryColorEndpoints(const SColorBlock& block, USHORT color0, USHORT color1, bool isFourColor, SColorFit& best)
+	{
+		if ((isFourColor && color0 < color1) || (!isFourColor && color0 > color1))
+		{
+			std::swap(color0, color1);
+		}
+
+		// Equal endpoints make a 3-color BC1 block, whose entries 0 to 2 are
+		// all that color anyway.
+		const bool isFourColorBlock = !block.m_isBc1 || color0 > color1;
+
+		int palette[4][3];
+		buildColorPalette(color0, color1, isFourColorBlock, palette);
+
+		float paletteColors[4][3];
+		for (UINT p = 0; p < 4; ++p)
+		{
+			for (UINT c = 0; c < 3; ++c)
+			{
+				paletteColors[p][c] = (float)palette[p][c];
+			}
+		}
+
+		// Entry 3 of a 3-color BC1 block is transparent black, for the
+		// transparent pixels alone; opaque ones would lose their alpha.
+		if (!isFourColorBlock)
+		{
+			paletteColors[3][0] = paletteColors[3][1] = paletteColors[3][2] = UnreachableColor;
+		}
+
+		UINT indices;
+		const float error = fitColorIndices(block, paletteColors, indices);
+		if (error >= best.m_error)
+		{
+			return false;
+		}
+
+		best.m_endpoints[0] = color0;
+		best.m_endpoints[1] = color1;
+		best.m_isFourColor = isFourColorBlock;
+		best.m_indices = indices;
+		best.m_error = error;
+		return true;
+	}
+
+	bool tryColorEndpoints(const SColorBlock& block, const float color0[3], const float color1[3], bool isFourColor, SColorFit& best)
+	{
+		return tryColorEndpoints(block, packRgb565(color0), packRgb565(color1), isFourColor, best);
+	}
+
+	// Mean and main direction of the block's colors, by power iteration on
+	// their covariance, started from the covariance column with the largest
+	// variance.
+	void computePrincipalAxis(const SColorBlock& block, UINT iterationCount, float mean[3], float axis[3])
+	{
+		float weightSum = 0.0f;
+		mean[0] = mean[1] = mean[2] = 0.0f;
+		for (UINT i = 0; i < 16; ++i)
+		{
+			weightSum += block.m_weight[i];
+			mean[0] += block.m_red[i] * block.m_weight[i];
+			mean[1] += block.m_green[i] * block.m_weight[i];
+			mean[2] += block.m_blue[i] * block.m_weight[i];
+		}
+		for (UINT c = 0; c < 3; ++c)
+		{
+			mean[c] /= weightSum;
+		}
+
+		float covariance[3][3] = {};
+		for (UINT i = 0; i < 16; ++i)
+		{
+			const float d[3] =
+			{
+				block.m_red[i] - mean[0],
+				block.m_green[i] - mean[1],
+				block.m_blue[i] - mean[2]
+			};
+			for (UINT row = 0; row < 3; ++row)
+			{
+				for (UINT column = row; column < 3; ++column)
+				{
+					covariance[row][column] += d[row] * d[column] * block.m_weight[i];
+				}
+			}
+		}
+		covariance[1][0] = covariance[0][1];
+		covariance[2][0] = covariance[0][2];
+		covariance[2][1] = covariance[1][2];
+
+		UINT largest = 0;
+		for (UINT c = 1; c < 3; ++c)
+		{
+			if (covariance[c][c] > covariance[largest][largest])
+			{
+				largest = c;
+			}
+		}
+
+		float v[3] = { covariance[0][largest], covariance[1][largest], covariance[2][largest] };
+		for (UINT iteration = 0; iteration < iterationCount; ++iteration)
+		{
+			float next[3];
+			for (UINT row = 0; row < 3; ++row)
+			{
+				next[row] = covariance[row][0] * v[0] + covariance[row][1] * v[1] + covariance[row][2] * v[2];
+			}
+
+			// Rescaled every step, the products would overflow otherwise.
+			const float scale = std::max(std::max(std::fabs(next[0]), std::fabs(next[1])), std::fabs(next[2]));
+			if (scale == 0.0f)
+			{
+				break;
+			}
+			for (UINT c = 0; c < 3; ++c)
+			{
+				v[c] = next[c] / scale;
+			}
+		}
+
+		const float length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+		for (UINT c = 0; c < 3; ++c)
+		{
+			axis[c] = length > 0.0f ? v[c] / length : 0.0f;
+		}
+	}
+
+	// Endpoints that minimize the squared error for the indices of a fit,
+	// by least squares on the palette weights; false if the indices do not
+	// pin both endpoints down.
+	bool solveColorEndpoints(const SColorBlock& block, const SColorFit& fit, float color0[3], float color1[3])
+	{
+		static const float FourColorWeights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+		static const float ThreeColorWeights[4] = { 0.0f, 1.0f, 0.5f, 0.0f };
+		const float* weights = fit.m_isFourColor ? FourColorWeights : ThreeColorWeights;
+
+		float aa = 0.0f;
+		float bb = 0.0f;
+		float ab = 0.0f;
+		float ax[3] = {};
+		float bx[3] = {};
+		for (UINT i = 0; i < 16; ++i)
+		{
+			const UINT index = (fit.m_indices >> (i * 2)) & 3;
+			if (block.m_weight[i] == 0.0f || (!fit.m_isFourColor && index == 3))
+			{
+				continue;
+			}
+
+			const float beta = weights[index];
+			const float alpha = 1.0f - beta;
+			const float x[3] = { block.m_red[i], block.m_green[i], block.m_blue[i] };
+
+			aa += alpha * alpha;
+			bb += beta * beta;
+			ab += alpha * beta;
+			for (UINT c = 0; c < 3; ++c)
+			{
+				ax[c] += alpha * x[c];
+				bx[c] += beta * x[c];
+			}
+		}
+
+		const float determinant = aa * bb - ab * ab;
+		if (std::fabs(determinant) < 1.0e-4f)
+		{
+			return false;
+		}
+
+		for (UINT c = 0; c < 3; ++c)
+		{
+			color0[c] = clampChannel((bb * ax[c] - ab * bx[c]) / determinant);
+			color1[c] = clampChannel((aa * bx[c] - ab * ax[c]) / determinant);
+		}
+		return true;
+	}
+
+	void refineColorFit(const SColorBlock& block, SColorFit& best)
+	{
+		for (UINT round = 0; round < RefinementCount; ++round)
+		{
+			float color0[3];
+			float color1[3];
+			if (!solveColorEndpoints(block, best, color0, color1) ||
+				!tryColorEndpoints(block, color0, color1, best.m_isFourColor, best))
+			{
+				break;
+			}
+		}
+	}
+
+	// Moves single channels of the endpoints one step up or down while that
+	// lowers the error.
+	void searchColorEndpoints(const SColorBlock& block, SColorFit& best)
+	{
+		static const int Shifts[3] = { 11, 5, 0 };
+		static const int Limits[3] = { 31, 63, 31 };
+
+		for (UINT pass = 0; pass < MaxSearchPassCount; ++pass)
+		{
+			bool isImproved = false;
+			for (UINT e = 0; e < 2; ++e)
+			{
+				for (UINT c = 0; c < 3; ++c)
+				{
+					for (int step = -1; step <= 1; step += 2)
+					{
+						const USHORT endpoint = best.m_endpoints[e];
+						const int value = ((endpoint >> Shifts[c]) & Limits[c]) + step;
+						if (value < 0 || value > Limits[c])
+						{
+							continue;
+						}
+
+						USHORT endpoints[2] = { best.m_endpoints[0], best.m_endpoints[1] };
+						endpoints[e] = (USHORT)((endpoint & ~(Limits[c] << Shifts[c])) | (value << Shifts[c]));
+						isImproved |= tryColorEndpoints(block, endpoints[0], endpoints[1], best.m_isFourColor, best);
+					}
+				}
+			}
+
+			if (!isImproved)
+			{
+				break;
+			}
+		}
+	}
+
+	void compressColorBlock(const UINT pixels[16], BlockCompressor::EQuality quality, bool isBc1, unsigned char* output)
+	{
+		SColorBlock block;
+		block.m_isBc1 = isBc1;
+		block.m_hasTransparent = false;
+		for (UINT i = 0; i < 16; ++i)
+		{
+			block.m_red[i] = (float)(pixels[i] & 0xFF);
+			block.m_green[i] = (float)((pixels[i] >> 8) & 0xFF);
+			block.m_blue[i] = (float)((pixels[i] >> 16) & 0xFF);
+
+			const bool isTransparent = isBc1 && (pixels[i] >> 24) < Bc1AlphaThreshold;
+			block.m_weight[i] = isTransparent ? 0.0f : 1.0f;
+			block.m_hasTransparent |= isTransparent;
+		}
+
+		SColorFit best;
+		best.m_endpoints[0] = 0;
+		best.m_endpoints[1] = 0;
+		best.m_isFourColor = false;
+		best.m_indices = 0xFFFFFFFF;
+		best.m_error = FLT_MAX;
+
+		// Fully transparent blocks keep the all-transparent fit.
+		if (std::count(block.m_weight, block.m_weight + 16, 0.0f) < 16)
+		{
+			float mean[3];
+			float axis[3];
+			computePrincipalAxis(block, quality == BlockCompressor::EQuality::Fast ? 0 : PowerIterationCount, mean, axis);
+
+			float lowest = FLT_MAX;
+			float highest = -FLT_MAX;
+			for (UINT i = 0; i < 16; ++i)
+			{
+				if (block.m_weight[i] != 0.0f)
+				{
+					const float t =
+						(block.m_red[i] - mean[0]) * axis[0] +
+						(block.m_green[i] - mean[1]) * axis[1] +
+						(block.m_blue[i] - mean[2]) * axis[2];
+					lowest = std::min(lowest, t);
+					highest = std::max(highest, t);
+				}
+			}
+
+			float color0[3];
+			float color1[3];
+			for (UINT c = 0; c < 3; ++c)
+			{
+				color0[c] = clampChannel(mean[c] + axis[c] * highest);
+				color1[c] = clampChannel(mean[c] + axis[c] * lowest);
+			}
+
+			tryColorEndpoints(block, color0, color1, !block.m_hasTransparent, best);
+
+			if (quality != BlockCompressor::EQuality::Fast)
+			{
+				refineColorFit(block, best);
+			}
+
+			if (quality == BlockCompressor::EQuality::High)
+			{
+				searchColorEndpoints(block, best);
+			}
+		}
+
+		std::memcpy(output, &best.m_endpoints[0], 2);
+		std::memcpy(output + 2, &best.m_endpoints[1], 2);
+		std::memcpy(output + 4, &best.m_indices, 4);
+	}
+
+	void decompressColorBlock(const unsigned char* input, bool isBc1, UINT pixels[16])
+	{
+		USHORT color0;
+		USHORT color1;
+		UINT indices;
+		std::memcpy(&color0, input, 2);
+		std::memcpy(&color1, input + 2, 2);
+		std::memcpy(&indices, input + 4, 4);
+
+		const bool isFourColor = !isBc1 || color0 > color1;
+
+		int palette[4][3];
+		buildColorPalette(color0, color1, isFourColor, palette);
+
+		UINT colors[4];
+		for (UINT p = 0; p < 4; ++p)
+		{
+			colors[p] = (UINT)palette[p][0] | ((UINT)palette[p][1] << 8) | ((UINT)palette[p][2] << 16) | 0xFF000000;
+		}
+		if (!isFourColor)
+		{
+			colors[3] = 0;
+		}
+
+		for (UINT i = 0; i < 16; ++i)
+		{
+			pixels[i] = colors[(indices >> (i * 2)) & 3];
+		}
+	}
+
+	// The values the decoder derives from two endpoints: six evenly spaced
+	// between them if the first is larger, four and the extremes otherwise.
+	void buildAlphaPalette(int alpha0, int alpha1, int palette[8])
+	{
+		palette[0] = alpha0;
+		palette[1] = alpha1;
+
+		if (alpha0 > alpha1)
+		{
+			for (int i = 2; i < 8; ++i)
+			{
+				palette[i] = ((8 - i) * alpha0 + (i - 1) * alpha1 + 3) / 7;
+			}
+		}
+		else
+		{
+			for (int i = 2; i < 6; ++i)
+			{
+				palette[i] = ((6 - i) * alpha0 + (i - 1) * alpha1 + 2) / 5;
+			}
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+	}
+
+	// Same as fitColorIndices() for one channel, three bits per pixel.
+	UINT fitAlphaIndices(const unsigned char values[16], const int palette[8], unsigned long long& indices)
+	{
+		unsigned short bestIndices[16];
+		UINT error = 0;
+
+#if defined(_XM_SSE_INTRINSICS_)
+		const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values));
+		const __m128i halves[2] =
+		{
+			_mm_unpacklo_epi8(bytes, _mm_setzero_si128()),
+			_mm_unpackhi_epi8(bytes, _mm_setzero_si128())
+		};
+
+		__m128i total = _mm_setzero_si128();
+		for (UINT h = 0; h < 2; ++h)
+		{
+			__m128i best = _mm_set1_epi16(0x7FFF);
+			__m128i bestIndex = _mm_setzero_si128();
+			for (int p = 0; p < 8; ++p)
+			{
+				const __m128i entry = _mm_set1_epi16((short)palette[p]);
+				const __m128i distance = _mm_max_epi16(_mm_sub_epi16(halves[h], entry), _mm_sub_epi16(entry, halves[h]));
+
+				const __m128i isBetter = _mm_cmplt_epi16(distance, best);
+				best = _mm_min_epi16(distance, best);
+				bestIndex = _mm_or_si128(_mm_and_si128(isBetter, _mm_set1_epi16((short)p)), _mm_andnot_si128(isBetter, bestIndex));
+			}
+
+			total = _mm_add_epi32(total, _mm_madd_epi16(best, best));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(bestIndices + h * 8), bestIndex);
+		}
+
+		alignas(16) UINT sums[4];
+		_mm_store_si128(reinterpret_cast<__m128i*>(sums), total);
+		error = sums[0] + sums[1] + sums[2] + sums[3];
+#else
+		for (UINT i = 0; i < 16; ++i)
+		{
+			int best = INT_MAX;
+			for (int p = 0; p < 8; ++p)
+			{
+				const int distance = std::abs((int)values[i] - palette[p]);
+				if (distance < best)
+				{
+					best = distance;
+					bestIndices[i] = (unsigned short)p;
+				}
+			}
+			error += (UINT)(best * best);
+		}
+#endif
+
+		indices = 0;
+		for (UINT i = 0; i < 16; ++i)
+		{
+			indices |= (unsigned long long)bestIndices[i] << (i * 3);
+		}
+		return error;
+	}
+
+	bool tryAlphaEndpoints(const unsigned char values[16], int alpha0, int alpha1, SAlphaFit& best)
+	{
+		int palette[8];
+		buildAlphaPalette(alpha0, alpha1, palette);
+
+		unsigned long long indices;
+		const UINT error = fitAlphaIndices(values, palette, indices);
+		if (error >= best.m_error)
+		{
+			return false;
+		}
+
+		best.m_endpoints[0] = alpha0;
+		best.m_endpoints[1] = alpha1;
+		best.m_indices = indices;
+		best.m_error = error;
+		return true;
+	}
+
+	// Least-squares endpoints for the indices of a fit, see
+	// solveColorEndpoints().
+	bool solveAlphaEndpoints(const unsigned char values[16], const SAlphaFit& fit, int& alpha0, int& alpha1)
+	{
+		const bool isEightValue = fit.m_endpoints[0] > fit.m_endpoints[1];
+
+		float aa = 0.0f;
+		float bb = 0.0f;
+		float ab = 0.0f;
+		float ax = 0.0f;
+		float bx = 0.0f;
+		for (UINT i = 0; i < 16; ++i)
+		{
+			const UINT index = (UINT)(fit.m_indices >> (i * 3)) & 7;
+			if (!isEightValue && index >= 6)
+			{
+				continue;
+			}
+
+			const float beta = index < 2 ? (float)index : (float)(index - 1) / (isEightValue ? 7.0f : 5.0f);
+			const float alpha = 1.0f - beta;
+			aa += alpha * alpha;
+			bb += beta * beta;
+			ab += alpha * beta;
+			ax += alpha * values[i];
+			bx += beta * values[i];
+		}
+
+		const float determinant = aa * bb - ab * ab;
+		if (std::fabs(determinant) < 1.0e-4f)
+		{
+			return false;
+		}
+
+		alpha0 = clampInt((int)std::lround((bb * ax - ab * bx) / determinant), 0, 255);
+		alpha1 = clampInt((int)std::lround((aa * bx - ab * ax) / determinant), 0, 255);
+
+		// Keep the mode the indices were chosen for.
+		return isEightValue ? alpha0 > alpha1 : alpha0 <= alpha1;
+	}
+
+	void compressAlphaBlock(const unsigned char values[16], BlockCompressor::EQuality quality, unsigned char* output)
+	{
+		int lowest = 255;
+		int highest = 0;
+		int innerLowest = 255;
+		int innerHighest = 0;
+		for (UINT i = 0; i < 16; ++i)
+		{
+			lowest = std::min(lowest, (int)values[i]);
+			highest = std::max(highest, (int)values[i]);
+			if (values[i] != 0 && values[i] != 255)
+			{
+				innerLowest = std::min(innerLowest, (int)values[i]);
+				innerHighest = std::max(innerHighest, (int)values[i]);
+			}
+		}
+
+		SAlphaFit best;
+		best.m_endpoints[0] = highest;
+		best.m_endpoints[1] = lowest;
+		best.m_indices = 0;
+		best.m_error = UINT_MAX;
+
+		if (lowest == highest)
+		{
+			best.m_error = 0;
+		}
+		else
+		{
+			tryAlphaEndpoints(values, highest, lowest, best);
+
+			if (quality != BlockCompressor::EQuality::Fast)
+			{
+				// Blocks with fully clear or opaque pixels get those exactly
+				// from the 6-value mode and spread its ramp over the rest.
+				if ((lowest == 0 || highest == 255) && innerLowest <= innerHighest)
+				{
+					tryAlphaEndpoints(values, innerLowest, innerHighest, best);
+				}
+
+				for (UINT round = 0; round < RefinementCount; ++round)
+				{
+					int alpha0;
+					int alpha1;
+					if (!solveAlphaEndpoints(values, best, alpha0, alpha1) ||
+						!tryAlphaEndpoints(values, alpha0, alpha1, best))
+					{
+						break;
+					}
+				}
+			}
+
+			if (quality == BlockCompressor::EQuality::High)
+			{
+				for (UINT pass = 0; pass < MaxSearchPassCount && best.m_error != 0; ++pass)
+				{
+					bool isImproved = false;
+					for (UINT e = 0; e < 2; ++e)
+					{
+						for (int step = -1; step <= 1; step += 2)
+						{
+							int endpoints[2] = { best.m_endpoints[0], best.m_endpoints[1] };
+							endpoints[e] += step;
+							if (endpoints[e] >= 0 && endpoints[e] <= 255)
+							{
+								isImproved |= tryAlphaEndpoints(values, endpoints[0], endpoints[1], best);
+							}
+						}
+					}
+
+					if (!isImproved)
+					{
+						break;
+					}
+				}
+			}
+		}
+
+		output[0] = (unsigned char)best.m_endpoints[0];
+		output[1] = (unsigned char)best.m_endpoints[1];
+		for (UINT i = 0; i < 6; ++i)
+		{
+			output[2 + i] = (unsigned char)(best.m_indices >> (i * 8));
+		}
+	}
+
+	void decompressAlphaBlock(const unsigned char* input, unsigned char values[16])
+	{
+		int palette[8];
+		buildAlphaPalette(input[0], input[1], palette);
+
+		unsigned long long indices = 0;
+		for (UINT i = 0; i < 6; ++i)
+		{
+			indices |= (unsigned long long)input[2 + i] << (i * 8);
+		}
+
+		for (UINT i = 0; i < 16; ++i)
+		{
+			values[i] = (unsigned char)palette[(indices >> (i * 3)) & 7];
+		}
+	}
+
+	void extractChannel(const UINT pixels[16], UINT shift, unsigned char values[16])
+	{
+		for (UINT i = 0; i < 16; ++i)
+		{
+			values[i] = (unsigned char)(pixels[i] >> shift);
+		}
+	}
+}
+
+DXGI_FORMAT BlockCompressor::getDxgiFormat(EFormat format)
+{
+	switch (format)
+	{
+	case EFormat::Bc1:
+		return DXGI_FORMAT_BC1_UNORM;
+	case EFormat::Bc3:
+		return DXGI_FORMAT_BC3_UNORM;
+	case EFormat::Bc4:
+		return DXGI_FORMAT_BC4_UNORM;
+	default:
+		return DXGI_FORMAT_BC5_UNORM;
+	}
+}
+
+UINT BlockCompressor::getBlockSize(EFormat format)
+{
+	return format == EFormat::Bc1 || format == EFormat::Bc4 ? 8 : 16;
+}
+
+size_t BlockCompressor::getCompressedSize(EFormat format, UINT width, UINT height)
+{
+	const size_t blockCount = (size_t)((width + BlockDimension - 1) / BlockDimension) * ((height + BlockDimension - 1) / BlockDimension);
+	return blockCount * getBlockSize(format);
+}
+
+void BlockCompressor::compressBlock(EFormat format, EQuality quality, const UINT pixels[16], void* block)
+{
+	unsigned char* output = static_cast<unsigned char*>(block);
+	unsigned char values[16];
+
+	switch (format)
+	{
+	case EFormat::Bc1:
+		compressColorBlock(pixels, quality, true, output);
+		break;
+
+	case EFormat::Bc3:
+		extractChannel(pixels, 24, values);
+		compressAlphaBlock(values, quality, output);
+		compressColorBlock(pixels, quality, false, output + 8);
+		break;
+
+	case EFormat::Bc4:
+		extractChannel(pixels, 0, values);
+		compressAlphaBlock(values, quality, output);
+		break;
+
+	case EFormat::Bc5:
+		extractChannel(pixels, 0, values);
+		compressAlphaBlock(values, quality, output);
+		extractChannel(pixels, 8, values);
+		compressAlphaBlock(values, quality, output + 8);
+		break;
+	}
+}
+
+void BlockCompressor::decompressBlock(EFormat format, const void* block, UINT pixels[16])
+{
+	const unsigned char* input = static_cast<const unsigned char*>(block);
+	unsigned char values[16];
+
+	switch (format)
+	{
+	case EFormat::Bc1:
+		decompressColorBlock(input, true, pixels);
+		break;
+
+	case EFormat::Bc3:
+		decompressColorBlock(input + 8, false, pixels);
+		decompressAlphaBlock(input, values);
+		for (UINT i = 0; i < 16; ++i)
+		{
+			pixels[i] = (pixels[i] & 0x00FFFFFF) | ((UINT)values[i] << 24);
+		}
+		break;
+
+	case EFormat::Bc4:
+		decompressAlphaBlock(input, values);
+		for (UINT i = 0; i < 16; ++i)
+		{
+			pixels[i] = values[i] | 0xFF000000;
+		}
+		break;
+
+	case EFormat::Bc5:
+		decompressAlphaBlock(input, values);
+		for (UINT i = 0; i < 16; ++i)
+		{
+			pixels[i] = values[i] | 0xFF000000;
+		}
+		decompressAlphaBlock(input + 8, values);
+		for (UINT i = 0; i < 16; ++i)
+		{
+			pixels[i] |= (UINT)values[i] << 8;
+		}
+		break;
+	}
+}
+
+void BlockCompressor::compress(
+	EFormat format,
+	EQuality quality,
+	const UINT* pixels,
+	UINT width,
+	UINT height,
+	UINT rowPitch,
+	void* blocks)
+{
+	const UINT blocksWide = (width + BlockDimension - 1) / BlockDimension;
+	const UINT blocksHigh = (height + BlockDimension - 1) / BlockDimension;
+	const UINT blockSize = getBlockSize(format);
+	const UINT rowsPerChunk = std::max(1u, BlocksPerChunk / blocksWide);
+
+	const unsigned char* source = reinterpret_cast<const unsigned char*>(pixels);
+	unsigned char* destination = static_cast<unsigned char*>(blocks);
+
+	CThreadPool::getShared().parallelFor(0, blocksHigh, rowsPerChunk, [&](UINT rowBegin, UINT rowEnd)
+	{
+		UINT blockPixels[16];
+		for (UINT by = rowBegin; by < rowEnd; ++by)
+		{
+			for (UINT bx = 0; bx < blocksWide; ++bx)
+			{
+				for (UINT y = 0; y < BlockDimension; ++y)
+				{
+					const UINT sourceY = std::min(by * BlockDimension + y, height - 1);
+					const unsigned char* row = source + (size_t)sourceY * rowPitch;
+					for (UINT x = 0; x < BlockDimension; ++x)
+					{
+						const UINT sourceX = std::min(bx * BlockDimension + x, width - 1);
+						std::memcpy(&blockPixels[y * BlockDimension + x], row + sourceX * 4, 4);
+					}
+				}
+
+				compressBlock(format, quality, blockPixels, destination + ((size_t)by * blocksWide + bx) * blockSize);
+			}
+		}
+	});
+}
+
+void BlockCompressor::decompress(EFormat format, const void* blocks, UINT width, UINT height, UINT* pixels, UINT rowPitch)
+{
+	const UINT blocksWide = (width + BlockDimension - 1) / BlockDimension;
+	const UINT blocksHigh = (height + BlockDimension - 1) / BlockDimension;
+	const UINT blockSize = getBlockSize(format);
+
+	const unsigned char* source = static_cast<const unsigned char*>(blocks);
+	unsigned char* destination = reinterpret_cast<unsigned char*>(pixels);
+
+	UINT blockPixels[16];
+	for (UINT by = 0; by < blocksHigh; ++by)
+	{
+		for (UINT bx = 0; bx < blocksWide; ++bx)
+		{
+			decompressBlock(format, source + ((size_t)by * blocksWide + bx) * blockSize, blockPixels);
+
+			const UINT columnCount = std::min(BlockDimension, width - bx * BlockDimension);
+			const UINT rowCount = std::min(BlockDimension, height - by * BlockDimension);
+			for (UINT y = 0; y < rowCount; ++y)
+			{
+				std::memcpy(
+					destination + (size_t)(by * BlockDimension + y) * rowPitch + bx * BlockDimension * 4,
+					&blockPixels[y * BlockDimension],
+					columnCount * 4
+				);
+			}
+		}
+	}
+}
+
+bool BlockCompressor::convertBmp(
+	const std::string& sourcePath,
+	const unsigned char* data,
+	size_t size,
+	const std::string& path,
+	EQuality quality,
+	std::string* error)
+{
+	BmpDecoder::SInfo info;
+	if (!BmpDecoder::readInfo(data, size, info, error))
+	{
+		if (error)
+		{
+			*error = sourcePath + ": " + *error;
+		}
+		return false;
+	}
+
+	std::vector<UINT> pixels((size_t)info.m_width * info.m_height);
+	BmpDecoder::decode(data, size, pixels.data(), info.m_width * 4);
+
+	const bool hasAlpha = std::any_of(pixels.begin(), pixels.end(), [](UINT pixel)
+	{
+		return (pixel >> 24) != 0xFF;
+	});
+	const EFormat format = hasAlpha ? EFormat::Bc3 : EFormat::Bc1;
+
+	MipGenerator::SSource source;
+	source.m_pixels = pixels.data();
+	source.m_width = info.m_width;
+	source.m_height = info.m_height;
+	source.m_rowPitch = info.m_width * 4;
+
+	std::vector<MipGenerator::SMip> mips;
+	MipGenerator::generate(source, MipGenerator::SOptions(), mips);
+
+	size_t blocksSize = 0;
+	for (const MipGenerator::SMip& mip : mips)
+	{
+		blocksSize += getCompressedSize(format, mip.m_width, mip.m_height);
+	}
+
+	std::vector<unsigned char> blocks(blocksSize);
+	size_t offset = 0;
+	for (const MipGenerator::SMip& mip : mips)
+	{
+		compress(format, quality, mip.m_pixels.data(), mip.m_width, mip.m_height, mip.m_width * 4, blocks.data() + offset);
+		offset += getCompressedSize(format, mip.m_width, mip.m_height);
+	}
+
+	return DdsFile::write(
+		path,
+		getDxgiFormat(format),
+		info.m_width,
+		info.m_height,
+		(UINT)mips.size(),
+		blocks.data(),
+		blocks.size(),
+		error
+	);
+}
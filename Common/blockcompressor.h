@@ -0,0 +1,88 @@
+﻿#pragma once
+
+#include <string>
+#include <windows.h>
+
+#include "ddsformat.h"
+
+// Encoder for the block-compressed texture formats, which the GPU samples
+// directly at a quarter to an eighth of the memory of R8G8B8A8:
+//
+//   Bc1  RGB with optional 1-bit alpha, 8 bytes per 4x4 block
+//   Bc3  RGB plus smooth alpha, 16 bytes per block
+//   Bc4  one channel (red), 8 bytes per block
+//   Bc5  two channels (red, green), e.g. normal maps, 16 bytes per block
+//
+// Color endpoints are fitted along the principal axis of the block's
+// colors and refined by least squares; each candidate pair is scored by
+// matching all 16 pixels against the 4-color palette at once with SSE.
+// Images are compressed a row of blocks at a time on the shared thread
+// pool. Source pixels are R8G8B8A8 rows; edges of images whose size is not
+// a multiple of 4 are filled by repeating the last row and column.
+//
+// BC7 is not supported yet; its mode and partition search would dwarf the
+// rest of the encoder.
+namespace BlockCompressor
+{
+	const UINT BlockDimension = 4;
+
+	enum class EFormat
+	{
+		Bc1,
+		Bc3,
+		Bc4,
+		Bc5
+	};
+
+	enum class EQuality
+	{
+		// Endpoints straight from the principal axis, for previews.
+		Fast,
+
+		// Plus least-squares refinement; the default for builds.
+		Normal,
+
+		// Plus a search around the refined endpoints; about three times
+		// slower than Normal.
+		High
+	};
+
+	DXGI_FORMAT getDxgiFormat(EFormat format);
+
+	// Bytes per 4x4 block, 8 or 16.
+	UINT getBlockSize(EFormat format);
+
+	size_t getCompressedSize(EFormat format, UINT width, UINT height);
+
+	// Compresses rows of rowPitch bytes into rows of blocks, top row first.
+	void compress(
+		EFormat format,
+		EQuality quality,
+		const UINT* pixels,
+		UINT width,
+		UINT height,
+		UINT rowPitch,
+		void* blocks
+	);
+
+	void compressBlock(EFormat format, EQuality quality, const UINT pixels[16], void* block);
+
+	// Decodes a block the way the GPU does, within its rounding; BC4 and
+	// BC5 decode to red and red-green with opaque alpha, as the GPU returns
+	// them, and zero in the channels between.
+	void decompressBlock(EFormat format, const void* block, UINT pixels[16]);
+
+	void decompress(EFormat format, const void* blocks, UINT width, UINT height, UINT* pixels, UINT rowPitch);
+
+	// Compresses a BMP and its mip chain, built by MipGenerator with the
+	// default options, into a DDS file, BC1 for opaque images and BC3 for
+	// ones with alpha; the asset cache converter for ".bmp" textures.
+	bool convertBmp(
+		const std::string& sourcePath,
+		const unsigned char* data,
+		size_t size,
+		const std::string& path,
+		EQuality quality,
+		std::string* error = nullptr
+	);
+}
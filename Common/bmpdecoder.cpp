@@ -0,0 +1,152 @@
+﻿#include "bmpdecoder.h"
+
+#include <climits>
+#include <cstring>
+
+#include "fileutil.h"
+#include "mappedfile.h"
+
+using FileUtil::setError;
+
+namespace
+{
+	const size_t FileHeaderSize = 14;
+	const size_t InfoHeaderSize = 40;
+
+	// BI_RGB, the uncompressed layout, and BI_BITFIELDS, uncompressed with
+	// channel masks.
+	const UINT CompressionNone = 0;
+	const UINT CompressionBitFields = 3;
+
+	// Info headers from BITMAPV3INFOHEADER on hold the masks, older ones
+	// are followed by them.
+	const size_t MaskOffset = 40;
+	const size_t AlphaMaskInfoSize = 56;
+
+	template<class T>
+	T readValue(const unsigned char* p)
+	{
+		T value;
+		std::memcpy(&value, p, sizeof(value));
+		return value;
+	}
+}
+
+bool BmpDecoder::readInfo(const unsigned char* data, size_t size, SInfo& info, std::string* error)
+{
+	if (size < FileHeaderSize + InfoHeaderSize || data[0] != 'B' || data[1] != 'M')
+	{
+		return setError(error, "not a BMP file");
+	}
+
+	const UINT pixelOffset = readValue<UINT>(data + 10);
+	const unsigned char* infoHeader = data + FileHeaderSize;
+
+	const UINT infoSize = readValue<UINT>(infoHeader);
+	const int width = readValue<int>(infoHeader + 4);
+	const int height = readValue<int>(infoHeader + 8);
+	const USHORT bitCount = readValue<USHORT>(infoHeader + 14);
+	const UINT compression = readValue<UINT>(infoHeader + 16);
+
+	const bool isSupported =
+		infoSize >= InfoHeaderSize &&
+		((bitCount == 24 && compression == CompressionNone) ||
+		(bitCount == 32 && (compression == CompressionNone || compression == CompressionBitFields)));
+	if (!isSupported)
+	{
+		return setError(error, "only uncompressed 24 and 32-bit BMP files are supported");
+	}
+
+	info.m_format = bitCount == 24 ? PixelFormat::EFormat::Bgr8 : PixelFormat::EFormat::Bgrx8;
+
+	if (compression == CompressionBitFields)
+	{
+		const bool hasAlphaMask = infoSize >= AlphaMaskInfoSize;
+		if (size < FileHeaderSize + MaskOffset + (hasAlphaMask ? 16 : 12))
+		{
+			return setError(error, "BMP channel masks are truncated");
+		}
+
+		const UINT redMask = readValue<UINT>(infoHeader + MaskOffset);
+		const UINT greenMask = readValue<UINT>(infoHeader + MaskOffset + 4);
+		const UINT blueMask = readValue<UINT>(infoHeader + MaskOffset + 8);
+		const UINT alphaMask = hasAlphaMask ? readValue<UINT>(infoHeader + MaskOffset + 12) : 0;
+
+		if (redMask != 0x00FF0000 || greenMask != 0x0000FF00 || blueMask != 0x000000FF ||
+			(alphaMask != 0 && alphaMask != 0xFF000000))
+		{
+			return setError(error, "only BGR and BGRA channel masks are supported");
+		}
+
+		if (alphaMask != 0)
+		{
+			info.m_format = PixelFormat::EFormat::Bgra8;
+		}
+	}
+
+	if (width <= 0 || height == 0 || height == INT_MIN)
+	{
+		return setError(error, "BMP has no pixels");
+	}
+
+	info.m_width = (UINT)width;
+	info.m_height = (UINT)(height < 0 ? -height : height);
+	info.m_bitCount = bitCount;
+	info.m_isTopDown = height < 0;
+	info.m_pixelOffset = pixelOffset;
+
+	// Rows are padded to 4 bytes.
+	info.m_sourcePitch = (info.m_width * (bitCount / 8) + 3) & ~3u;
+
+	if ((unsigned long long)pixelOffset + (unsigned long long)info.m_sourcePitch * info.m_height > size)
+	{
+		return setError(error, "BMP pixel data is truncated");
+	}
+
+	return true;
+}
+
+bool BmpDecoder::decode(const unsigned char* data, size_t size, void* pixels, UINT rowPitch, std::string* error)
+{
+	SInfo info;
+	if (!readInfo(data, size, info, error))
+	{
+		return false;
+	}
+
+	for (UINT y = 0; y < info.m_height; ++y)
+	{
+		const UINT sourceRow = info.m_isTopDown ? y : info.m_height - 1 - y;
+		const unsigned char* source = data + info.m_pixelOffset + (size_t)sourceRow * info.m_sourcePitch;
+		unsigned char* destination = static_cast<unsigned char*>(pixels) + (size_t)y * rowPitch;
+
+		PixelFormat::convertToRgba8(info.m_format, source, destination, info.m_width);
+	}
+
+	return true;
+}
+
+bool BmpDecoder::load(const std::string& path, SImage& image, std::string* error)
+{
+	CMappedFile file;
+	if (!file.open(path))
+	{
+		return setError(error, path + " not found");
+	}
+
+	SInfo info;
+	if (!readInfo(file.getData(), file.getSize(), info, error))
+	{
+		if (error)
+		{
+			*error = path + ": " + *error;
+		}
+		return false;
+	}
+
+	image.m_width = info.m_width;
+	image.m_height = info.m_height;
+	image.m_pixels.resize((size_t)info.m_width * info.m_height);
+
+	return decode(file.getData(), file.getSize(), image.m_pixels.data(), info.m_width * 4, error);
+}
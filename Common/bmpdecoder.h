@@ -0,0 +1,43 @@
+﻿#pragma once
+
+#include <string>
+#include <vector>
+#include <windows.h>
+
+#include "pixelformat.h"
+
+// Reader for uncompressed 24 and 32-bit BMP files, bottom-up or top-down,
+// such as the fire animation frames. It needs neither WIC nor COM, so it
+// runs on worker threads and on hosts without Windows imaging. Pixels come
+// out as R8G8B8A8, top row first, converted a row at a time by
+// PixelFormat; alpha is 255 unless the file has an alpha mask.
+namespace BmpDecoder
+{
+	struct SInfo
+	{
+		UINT m_width;
+		UINT m_height;
+		UINT m_bitCount;
+		bool m_isTopDown;
+		PixelFormat::EFormat m_format;
+
+		UINT m_pixelOffset;
+		UINT m_sourcePitch;
+	};
+
+	struct SImage
+	{
+		UINT m_width = 0;
+		UINT m_height = 0;
+		std::vector<UINT> m_pixels;
+	};
+
+	// Checks the headers and that the pixel rows lie inside the data.
+	bool readInfo(const unsigned char* data, size_t size, SInfo& info, std::string* error = nullptr);
+
+	// Decodes into rows of rowPitch bytes, each at least 4 * width, e.g.
+	// straight into a mapped staging texture.
+	bool decode(const unsigned char* data, size_t size, void* pixels, UINT rowPitch, std::string* error = nullptr);
+
+	bool load(const std::string& path, SImage& image, std::string* error = nullptr);
+}
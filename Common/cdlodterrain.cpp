@@ -0,0 +1,501 @@
+﻿#include "cdlodterrain.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+
+#include "mathhelper.h"
+#include "threadpool.h"
+
+namespace
+{
+	float distanceSqToBox(const XMFLOAT3& p, const XMFLOAT3& boxMin, const XMFLOAT3& boxMax)
+	{
+		XMVECTOR point = XMLoadFloat3(&p);
+		XMVECTOR clamped = XMVectorClamp(point, XMLoadFloat3(&boxMin), XMLoadFloat3(&boxMax));
+		return XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(point, clamped)));
+	}
+}
+
+CCdlodTerrain::CCdlodTerrain() :
+	m_quadrantIndexCount(0),
+	m_residentBytes(0),
+	m_frame(0),
+	m_eyePosW(0.0f, 0.0f, 0.0f)
+{
+
+}
+
+CCdlodTerrain::~CCdlodTerrain()
+{
+	// Don't leave generations running against a device being released.
+	for (auto& pending : m_pendingChunks)
+	{
+		pending.second.wait();
+	}
+}
+
+void CCdlodTerrain::initialize(ID3D11Device* device, const SCdlodDesc& desc)
+{
+	m_device = device;
+	m_desc = desc;
+	m_desc.m_chunkQuads = MathHelper::max(2u, m_desc.m_chunkQuads & ~1u);
+	m_desc.m_lodCount = MathHelper::max(1u, m_desc.m_lodCount);
+
+	m_chunks.clear();
+	m_pendingChunks.clear();
+	m_drawItems.clear();
+	m_residentBytes = 0;
+	m_frame = 0;
+
+	// Level L is used up to m_lodRanges[L] from the eye.
+	const float leafSize = getNodeSize(0);
+	m_lodRanges.resize(m_desc.m_lodCount);
+	for (UINT level = 0; level < m_desc.m_lodCount; ++level)
+	{
+		m_lodRanges[level] = m_desc.m_detailDistance * leafSize * (float)(1u << level);
+	}
+
+	// Grid indices with the createGrid triangulation, grouped by quadrant:
+	// quadrant bit 0 is +x, bit 1 is +z, matching the child numbering.
+	const UINT n = m_desc.m_chunkQuads;
+	const UINT rowLength = n + 1;
+	const UINT half = n / 2;
+
+	std::vector<UINT> indices;
+	indices.reserve(n * n * 6);
+	for (UINT quadrant = 0; quadrant < 4; ++quadrant)
+	{
+		const UINT columnBegin = (quadrant & 1) ? half : 0;
+
+		// Row 0 is the +z edge of the chunk.
+		const UINT rowBegin = (quadrant & 2) ? 0 : half;
+
+		for (UINT i = rowBegin; i < rowBegin + half; ++i)
+		{
+			for (UINT j = columnBegin; j < columnBegin + half; ++j)
+			{
+				indices.push_back(i * rowLength + j);
+				indices.push_back(i * rowLength + j + 1);
+				indices.push_back((i + 1) * rowLength + j);
+
+				indices.push_back((i + 1) * rowLength + j);
+				indices.push_back(i * rowLength + j + 1);
+				indices.push_back((i + 1) * rowLength + j + 1);
+			}
+		}
+	}
+	m_quadrantIndexCount = half * half * 6;
+
+	D3D11_BUFFER_DESC ibDesc;
+	ibDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	ibDesc.ByteWidth = sizeof(UINT) * (UINT)indices.size();
+	ibDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	ibDesc.CPUAccessFlags = 0;
+	ibDesc.MiscFlags = 0;
+	ibDesc.StructureByteStride = 0;
+
+	D3D11_SUBRESOURCE_DATA iInitData;
+	iInitData.pSysMem = indices.data();
+	iInitData.SysMemPitch = 0;
+	iInitData.SysMemSlicePitch = 0;
+
+	ThrowIfFailed(m_device->CreateBuffer(
+		&ibDesc, &iInitData, m_indexBuffer.ReleaseAndGetAddressOf()
+	));
+
+	// The root is always resident so there is something to draw from the
+	// first frame on.
+	const UINT rootLevel = m_desc.m_lodCount - 1;
+	std::shared_ptr<SChunkData> root = generateChunk(
+		m_desc.m_heightFunction, m_desc.m_chunkQuads, 0.0f, 0.0f, m_desc.m_worldSize
+	);
+	uploadChunk(makeKey(rootLevel, 0, 0), *root);
+}
+
+void CCdlodTerrain::update(FXMVECTOR eyePosW, CXMMATRIX viewProj)
+{
+	++m_frame;
+	XMStoreFloat3(&m_eyePosW, eyePosW);
+
+	XMMATRIX M = XMMatrixTranspose(viewProj);
+	XMStoreFloat4(&m_frustumPlanes[0], XMPlaneNormalize(XMVectorAdd(M.r[3], M.r[0])));
+	XMStoreFloat4(&m_frustumPlanes[1], XMPlaneNormalize(XMVectorSubtract(M.r[3], M.r[0])));
+	XMStoreFloat4(&m_frustumPlanes[2], XMPlaneNormalize(XMVectorAdd(M.r[3], M.r[1])));
+	XMStoreFloat4(&m_frustumPlanes[3], XMPlaneNormalize(XMVectorSubtract(M.r[3], M.r[1])));
+	XMStoreFloat4(&m_frustumPlanes[4], XMPlaneNormalize(M.r[2]));
+	XMStoreFloat4(&m_frustumPlanes[5], XMPlaneNormalize(XMVectorSubtract(M.r[3], M.r[2])));
+
+	collectFinishedChunks();
+
+	m_drawItems.clear();
+
+	const UINT rootLevel = m_desc.m_lodCount - 1;
+	auto root = m_chunks.find(makeKey(rootLevel, 0, 0));
+	if (root != m_chunks.end())
+	{
+		// Out of range of even the coarsest level: still draw the root.
+		if (!selectNode(rootLevel, 0, 0, root->second.m_minHeight, root->second.m_maxHeight))
+		{
+			addDrawItem(rootLevel, root->second, 0xf);
+		}
+	}
+
+	evictOverBudget();
+}
+
+ID3D11Buffer* CCdlodTerrain::getIndexBuffer() const
+{
+	return m_indexBuffer.Get();
+}
+
+const std::vector<SCdlodDrawItem>& CCdlodTerrain::getDrawItems() const
+{
+	return m_drawItems;
+}
+
+UINT CCdlodTerrain::getResidentChunkCount() const
+{
+	return (UINT)m_chunks.size();
+}
+
+UINT CCdlodTerrain::getResidentBytes() const
+{
+	return m_residentBytes;
+}
+
+UINT CCdlodTerrain::getPendingChunkCount() const
+{
+	return (UINT)m_pendingChunks.size();
+}
+
+UINT CCdlodTerrain::getSelectedTriangleCount() const
+{
+	UINT indexCount = 0;
+	for (const SCdlodDrawItem& item : m_drawItems)
+	{
+		indexCount += item.m_indexCount;
+	}
+	return indexCount / 3;
+}
+
+CCdlodTerrain::NodeKey CCdlodTerrain::makeKey(UINT level, UINT x, UINT z)
+{
+	return ((NodeKey)level << 48) | ((NodeKey)x << 24) | (NodeKey)z;
+}
+
+float CCdlodTerrain::getNodeSize(UINT level) const
+{
+	const UINT rootLevel = m_desc.m_lodCount - 1;
+	return m_desc.m_worldSize / (float)(1u << (rootLevel - level));
+}
+
+void CCdlodTerrain::getNodeBounds(UINT level, UINT x, UINT z, float minHeight, float maxHeight, XMFLOAT3& boxMin, XMFLOAT3& boxMax) const
+{
+	const float size = getNodeSize(level);
+	const float worldMin = -0.5f * m_desc.m_worldSize;
+
+	boxMin = XMFLOAT3(worldMin + x * size, minHeight, worldMin + z * size);
+	boxMax = XMFLOAT3(boxMin.x + size, maxHeight, boxMin.z + size);
+}
+
+std::shared_ptr<CCdlodTerrain::SChunkData> CCdlodTerrain::generateChunk(const Terrain::HeightGradientFunction& function, UINT chunkQuads, float centerX, float centerZ, float size)
+{
+	const UINT rowLength = chunkQuads + 1;
+
+	// evaluateGrid works on a grid centered on the origin; shift the
+	// samples to the node.
+	const XMVECTOR offsetX = XMVectorReplicate(centerX);
+	const XMVECTOR offsetZ = XMVectorReplicate(centerZ);
+
+	std::vector<XMFLOAT3> positions;
+	std::vector<XMFLOAT3> normals;
+	Terrain::evaluateGrid(size, size, rowLength, rowLength,
+		[&](FXMVECTOR px, FXMVECTOR pz, XMVECTOR& dhdx, XMVECTOR& dhdz)
+		{
+			return function(XMVectorAdd(px, offsetX), XMVectorAdd(pz, offsetZ), dhdx, dhdz);
+		},
+		positions, &normals);
+
+	auto data = std::make_shared<SChunkData>();
+	data->m_vertices.resize(positions.size());
+	data->m_minHeight = FLT_MAX;
+	data->m_maxHeight = -FLT_MAX;
+
+	for (UINT i = 0; i < rowLength; ++i)
+	{
+		for (UINT j = 0; j < rowLength; ++j)
+		{
+			const UINT index = i * rowLength + j;
+			XMFLOAT3& p = positions[index];
+			p.x += centerX;
+			p.z += centerZ;
+
+			data->m_minHeight = MathHelper::min(data->m_minHeight, p.y);
+			data->m_maxHeight = MathHelper::max(data->m_maxHeight, p.y);
+		}
+	}
+
+	for (UINT i = 0; i < rowLength; ++i)
+	{
+		for (UINT j = 0; j < rowLength; ++j)
+		{
+			// Vertices on odd rows or columns slide onto the parent's edge or
+			// diagonal between their even neighbours, so at full morph the
+			// chunk has exactly the shape of the parent's grid. The diagonal
+			// runs from (i - 1, j + 1) to (i + 1, j - 1), as in createGrid.
+			const UINT index = i * rowLength + j;
+			UINT first = index;
+			UINT second = index;
+			if ((i & 1) && (j & 1))
+			{
+				first = (i - 1) * rowLength + j + 1;
+				second = (i + 1) * rowLength + j - 1;
+			}
+			else if (i & 1)
+			{
+				first = index - rowLength;
+				second = index + rowLength;
+			}
+			else if (j & 1)
+			{
+				first = index - 1;
+				second = index + 1;
+			}
+
+			SCdlodVertex& vertex = data->m_vertices[index];
+			vertex.m_position = positions[index];
+			vertex.m_normal = normals[index];
+
+			XMStoreFloat3(&vertex.m_morphPosition, XMVectorLerp(
+				XMLoadFloat3(&positions[first]), XMLoadFloat3(&positions[second]), 0.5f
+			));
+			XMStoreFloat3(&vertex.m_morphNormal, XMVector3Normalize(XMVectorAdd(
+				XMLoadFloat3(&normals[first]), XMLoadFloat3(&normals[second])
+			)));
+		}
+	}
+
+	return data;
+}
+
+void CCdlodTerrain::uploadChunk(NodeKey key, const SChunkData& data)
+{
+	D3D11_BUFFER_DESC vbDesc;
+	vbDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	vbDesc.ByteWidth = sizeof(SCdlodVertex) * (UINT)data.m_vertices.size();
+	vbDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	vbDesc.CPUAccessFlags = 0;
+	vbDesc.MiscFlags = 0;
+	vbDesc.StructureByteStride = 0;
+
+	D3D11_SUBRESOURCE_DATA vInitData;
+	vInitData.pSysMem = data.m_vertices.data();
+	vInitData.SysMemPitch = 0;
+	vInitData.SysMemSlicePitch = 0;
+
+	SChunk& chunk = m_chunks[key];
+	ThrowIfFailed(m_device->CreateBuffer(
+		&vbDesc, &vInitData, chunk.m_vertexBuffer.ReleaseAndGetAddressOf()
+	));
+
+	chunk.m_minHeight = data.m_minHeight;
+	chunk.m_maxHeight = data.m_maxHeight;
+	chunk.m_lastUsedFrame = m_frame;
+
+	m_residentBytes += vbDesc.ByteWidth;
+}
+
+void CCdlodTerrain::requestChunk(UINT level, UINT x, UINT z)
+{
+	const NodeKey key = makeKey(level, x, z);
+	if (m_pendingChunks.count(key) != 0 || m_pendingChunks.size() >= m_desc.m_maxPendingChunks)
+	{
+		return;
+	}
+
+	// Stop streaming in once the budget is spent on chunks in use.
+	if (m_residentBytes >= m_desc.m_memoryBudget)
+	{
+		return;
+	}
+
+	XMFLOAT3 boxMin, boxMax;
+	getNodeBounds(level, x, z, 0.0f, 0.0f, boxMin, boxMax);
+
+	// The task gets its own copies, so it does not depend on the terrain.
+	Terrain::HeightGradientFunction function = m_desc.m_heightFunction;
+	const UINT chunkQuads = m_desc.m_chunkQuads;
+	const float centerX = 0.5f * (boxMin.x + boxMax.x);
+	const float centerZ = 0.5f * (boxMin.z + boxMax.z);
+	const float size = boxMax.x - boxMin.x;
+
+	m_pendingChunks.emplace(key, CThreadPool::getShared().submit([=]()
+	{
+		return generateChunk(function, chunkQuads, centerX, centerZ, size);
+	}));
+}
+
+void CCdlodTerrain::collectFinishedChunks()
+{
+	for (auto it = m_pendingChunks.begin(); it != m_pendingChunks.end();)
+	{
+		if (it->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		{
+			++it;
+			continue;
+		}
+
+		std::shared_ptr<SChunkData> data = it->second.get();
+		uploadChunk(it->first, *data);
+		it = m_pendingChunks.erase(it);
+	}
+}
+
+void CCdlodTerrain::evictOverBudget()
+{
+	if (m_residentBytes <= m_desc.m_memoryBudget)
+	{
+		return;
+	}
+
+	// Least recently used first; chunks drawn this frame and the root stay.
+	const NodeKey rootKey = makeKey(m_desc.m_lodCount - 1, 0, 0);
+
+	std::vector<std::pair<UINT, NodeKey>> candidates;
+	for (const auto& chunk : m_chunks)
+	{
+		if (chunk.first != rootKey && chunk.second.m_lastUsedFrame != m_frame)
+		{
+			candidates.emplace_back(chunk.second.m_lastUsedFrame, chunk.first);
+		}
+	}
+	std::sort(candidates.begin(), candidates.end());
+
+	const UINT chunkBytes = sizeof(SCdlodVertex) * (m_desc.m_chunkQuads + 1) * (m_desc.m_chunkQuads + 1);
+	for (size_t i = 0; i < candidates.size() && m_residentBytes > m_desc.m_memoryBudget; ++i)
+	{
+		m_chunks.erase(candidates[i].second);
+		m_residentBytes -= chunkBytes;
+	}
+}
+
+bool CCdlodTerrain::selectNode(UINT level, UINT x, UINT z, float minHeight, float maxHeight)
+{
+	XMFLOAT3 boxMin, boxMax;
+	getNodeBounds(level, x, z, minHeight, maxHeight, boxMin, boxMax);
+
+	// Not in this level's range: the parent covers the area.
+	const float range = m_lodRanges[level];
+	if (distanceSqToBox(m_eyePosW, boxMin, boxMax) > range * range)
+	{
+		return false;
+	}
+
+	// Outside the view: handled, nothing to draw.
+	XMVECTOR vMin = XMLoadFloat3(&boxMin);
+	XMVECTOR vMax = XMLoadFloat3(&boxMax);
+	for (UINT p = 0; p < 6; ++p)
+	{
+		XMVECTOR plane = XMLoadFloat4(&m_frustumPlanes[p]);
+		XMVECTOR farthest = XMVectorSelect(vMin, vMax, XMVectorGreaterOrEqual(plane, XMVectorZero()));
+		if (XMVectorGetX(XMPlaneDotCoord(plane, farthest)) < 0.0f)
+		{
+			return true;
+		}
+	}
+
+	SChunk& chunk = m_chunks.at(makeKey(level, x, z));
+	chunk.m_lastUsedFrame = m_frame;
+
+	if (level == 0)
+	{
+		addDrawItem(level, chunk, 0xf);
+		return true;
+	}
+
+	const float childRange = m_lodRanges[level - 1];
+	if (distanceSqToBox(m_eyePosW, boxMin, boxMax) > childRange * childRange)
+	{
+		addDrawItem(level, chunk, 0xf);
+		return true;
+	}
+
+	// Refining needs all four children; until they stream in the node is
+	// drawn at its own level.
+	bool areChildrenResident = true;
+	for (UINT child = 0; child < 4; ++child)
+	{
+		const UINT childX = 2 * x + (child & 1);
+		const UINT childZ = 2 * z + (child >> 1);
+		if (m_chunks.count(makeKey(level - 1, childX, childZ)) == 0)
+		{
+			areChildrenResident = false;
+			requestChunk(level - 1, childX, childZ);
+		}
+	}
+
+	if (!areChildrenResident)
+	{
+		addDrawItem(level, chunk, 0xf);
+		return true;
+	}
+
+	UINT uncoveredQuadrants = 0;
+	for (UINT child = 0; child < 4; ++child)
+	{
+		const UINT childX = 2 * x + (child & 1);
+		const UINT childZ = 2 * z + (child >> 1);
+		const SChunk& childChunk = m_chunks.at(makeKey(level - 1, childX, childZ));
+
+		if (!selectNode(level - 1, childX, childZ, childChunk.m_minHeight, childChunk.m_maxHeight))
+		{
+			uncoveredQuadrants |= 1u << child;
+		}
+	}
+
+	if (uncoveredQuadrants != 0)
+	{
+		addDrawItem(level, chunk, uncoveredQuadrants);
+	}
+
+	return true;
+}
+
+void CCdlodTerrain::addDrawItem(UINT level, SChunk& chunk, UINT quadrantMask)
+{
+	chunk.m_lastUsedFrame = m_frame;
+
+	const float morphEnd = m_lodRanges[level];
+	const float previousRange = level > 0 ? m_lodRanges[level - 1] : 0.0f;
+	const float morphStart = previousRange + (morphEnd - previousRange) * m_desc.m_morphStartRatio;
+
+	// Adjacent quadrants are contiguous in the index buffer, so runs of set
+	// bits become a single draw.
+	UINT quadrant = 0;
+	while (quadrant < 4)
+	{
+		if ((quadrantMask & (1u << quadrant)) == 0)
+		{
+			++quadrant;
+			continue;
+		}
+
+		UINT runEnd = quadrant + 1;
+		while (runEnd < 4 && (quadrantMask & (1u << runEnd)) != 0)
+		{
+			++runEnd;
+		}
+
+		SCdlodDrawItem item;
+		item.m_vertexBuffer = chunk.m_vertexBuffer.Get();
+		item.m_indexOffset = quadrant * m_quadrantIndexCount;
+		item.m_indexCount = (runEnd - quadrant) * m_quadrantIndexCount;
+		item.m_morphStart = morphStart;
+		item.m_morphEnd = morphEnd;
+		item.m_level = level;
+		m_drawItems.push_back(item);
+
+		quadrant = runEnd;
+	}
+}
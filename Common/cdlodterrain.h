@@ -0,0 +1,146 @@
+﻿#pragma once
+
+#include <future>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "d3dutil.h"
+#include "terrain.h"
+
+using Microsoft::WRL::ComPtr;
+
+// Continuous distance-dependent LOD terrain over a quadtree. Every node,
+// whatever its level, is drawn with the same (m_chunkQuads + 1)^2 vertex
+// grid, so one index buffer serves all levels, and the per-level detail
+// comes from the node size. Chunk vertices are generated from the height
+// function on the shared thread pool and uploaded on the render thread.
+//
+// Each vertex carries a second position and normal: where it lies on the
+// surface of the next coarser level. The vertex shader blends
+// towards them as the eye moves away,
+//   float k = saturate((distance(position, eyePosW) - morphStart) / (morphEnd - morphStart));
+//   position = lerp(position, morphPosition, k);
+// so a node reaches the shape of its parent exactly where the parent
+// takes over and no seams open between levels.
+struct SCdlodVertex
+{
+	XMFLOAT3 m_position;
+	XMFLOAT3 m_morphPosition;
+	XMFLOAT3 m_normal;
+	XMFLOAT3 m_morphNormal;
+};
+
+struct SCdlodDesc
+{
+	// Square world centered on the origin.
+	float m_worldSize = 1024.0f;
+
+	// Quadtree depth; the root is level m_lodCount - 1, leaves are level 0.
+	UINT m_lodCount = 5;
+
+	// Quads per chunk side, must be even.
+	UINT m_chunkQuads = 32;
+
+	// Distance up to which level 0 is used, in leaf node sizes; each
+	// coarser level doubles it.
+	float m_detailDistance = 3.0f;
+
+	// Fraction of a level's distance band after which morphing starts.
+	float m_morphStartRatio = 0.66f;
+
+	// Chunk vertex buffer memory above which unused chunks are evicted.
+	UINT m_memoryBudget = 64 * 1024 * 1024;
+
+	// Chunks generated in the background at the same time.
+	UINT m_maxPendingChunks = 16;
+
+	Terrain::HeightGradientFunction m_heightFunction;
+};
+
+struct SCdlodDrawItem
+{
+	ID3D11Buffer* m_vertexBuffer;
+	UINT m_indexOffset;
+	UINT m_indexCount;
+	float m_morphStart;
+	float m_morphEnd;
+	UINT m_level;
+};
+
+class CCdlodTerrain
+{
+public:
+	CCdlodTerrain();
+	~CCdlodTerrain();
+
+	// Builds the shared index buffer and generates the root chunk
+	// synchronously; everything else streams in on demand, so the cost does
+	// not grow with the world size.
+	void initialize(ID3D11Device* device, const SCdlodDesc& desc);
+
+	// Call once per frame on the thread owning the device: uploads finished
+	// chunks, selects the nodes to draw, schedules missing chunks and evicts
+	// over budget.
+	void update(FXMVECTOR eyePosW, CXMMATRIX viewProj);
+
+	ID3D11Buffer* getIndexBuffer() const;
+	const std::vector<SCdlodDrawItem>& getDrawItems() const;
+
+	UINT getResidentChunkCount() const;
+	UINT getResidentBytes() const;
+	UINT getPendingChunkCount() const;
+	UINT getSelectedTriangleCount() const;
+
+private:
+	typedef unsigned long long NodeKey;
+
+	struct SChunk
+	{
+		ComPtr<ID3D11Buffer> m_vertexBuffer;
+		float m_minHeight = 0.0f;
+		float m_maxHeight = 0.0f;
+		UINT m_lastUsedFrame = 0;
+	};
+
+	struct SChunkData
+	{
+		std::vector<SCdlodVertex> m_vertices;
+		float m_minHeight = 0.0f;
+		float m_maxHeight = 0.0f;
+	};
+
+	static NodeKey makeKey(UINT level, UINT x, UINT z);
+
+	float getNodeSize(UINT level) const;
+	void getNodeBounds(UINT level, UINT x, UINT z, float minHeight, float maxHeight, XMFLOAT3& boxMin, XMFLOAT3& boxMax) const;
+
+	static std::shared_ptr<SChunkData> generateChunk(const Terrain::HeightGradientFunction& function, UINT chunkQuads, float centerX, float centerZ, float size);
+	void uploadChunk(NodeKey key, const SChunkData& data);
+	void requestChunk(UINT level, UINT x, UINT z);
+	void collectFinishedChunks();
+	void evictOverBudget();
+
+	bool selectNode(UINT level, UINT x, UINT z, float minHeight, float maxHeight);
+	void addDrawItem(UINT level, SChunk& chunk, UINT quadrantMask);
+
+	ComPtr<ID3D11Device> m_device;
+	ComPtr<ID3D11Buffer> m_indexBuffer;
+
+	SCdlodDesc m_desc;
+	std::vector<float> m_lodRanges;
+
+	// Index ranges of the four chunk quadrants, so a node can draw only the
+	// parts its children do not cover.
+	UINT m_quadrantIndexCount;
+
+	std::unordered_map<NodeKey, SChunk> m_chunks;
+	std::unordered_map<NodeKey, std::future<std::shared_ptr<SChunkData>>> m_pendingChunks;
+	UINT m_residentBytes;
+
+	std::vector<SCdlodDrawItem> m_drawItems;
+	UINT m_frame;
+
+	XMFLOAT3 m_eyePosW;
+	XMFLOAT4 m_frustumPlanes[6];
+};
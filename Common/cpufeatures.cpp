@@ -0,0 +1,100 @@
+﻿#include "cpufeatures.h"
+
+#include <DirectXMath.h>
+
+#if defined(_XM_SSE_INTRINSICS_)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace
+{
+#if defined(_XM_SSE_INTRINSICS_)
+	// EAX, EBX, ECX and EDX of CPUID leaf and subleaf, zeros for leaves the
+	// CPU does not have.
+	void getCpuInfo(unsigned int leaf, unsigned int subleaf, unsigned int info[4])
+	{
+#if defined(_MSC_VER)
+		int maxInfo[4];
+		__cpuid(maxInfo, 0);
+		if (leaf > (unsigned int)maxInfo[0])
+		{
+			info[0] = info[1] = info[2] = info[3] = 0;
+			return;
+		}
+
+		int values[4];
+		__cpuidex(values, (int)leaf, (int)subleaf);
+		for (int i = 0; i < 4; ++i)
+		{
+			info[i] = (unsigned int)values[i];
+		}
+#else
+		if (!__get_cpuid_count(leaf, subleaf, &info[0], &info[1], &info[2], &info[3]))
+		{
+			info[0] = info[1] = info[2] = info[3] = 0;
+		}
+#endif
+	}
+
+	bool detectSsse3()
+	{
+		unsigned int info[4];
+		getCpuInfo(1, 0, info);
+		return (info[2] & (1u << 9)) != 0;
+	}
+
+	bool detectAvx2()
+	{
+		// AVX state must be enabled by the OS too.
+		unsigned int info[4];
+		getCpuInfo(1, 0, info);
+		const bool hasOsxsave = (info[2] & (1u << 27)) != 0;
+		const bool hasAvx = (info[2] & (1u << 28)) != 0;
+		if (!hasOsxsave || !hasAvx)
+		{
+			return false;
+		}
+
+#if defined(_MSC_VER)
+		const unsigned long long enabledState = _xgetbv(0);
+#else
+		unsigned int eax, edx;
+		__asm__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+		const unsigned long long enabledState = ((unsigned long long)edx << 32) | eax;
+#endif
+		if ((enabledState & 6) != 6)
+		{
+			return false;
+		}
+
+		getCpuInfo(7, 0, info);
+		return (info[1] & (1u << 5)) != 0;
+	}
+#else
+	bool detectSsse3()
+	{
+		return false;
+	}
+
+	bool detectAvx2()
+	{
+		return false;
+	}
+#endif
+}
+
+bool CpuFeatures::hasSsse3()
+{
+	static const bool hasSsse3 = detectSsse3();
+	return hasSsse3;
+}
+
+bool CpuFeatures::hasAvx2()
+{
+	static const bool hasAvx2 = detectAvx2();
+	return hasAvx2;
+}
@@ -0,0 +1,12 @@
+﻿#pragma once
+
+// Instruction set extensions of the CPU running the program, for the code
+// paths that pick SIMD versions at run time. Each is detected once, on the
+// first call; false on CPUs other than x86 and x64.
+namespace CpuFeatures
+{
+	bool hasSsse3();
+
+	// Also false when the OS does not save the AVX registers.
+	bool hasAvx2();
+}
@@ -0,0 +1,208 @@
+﻿#include "ddsfile.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "fileutil.h"
+
+using FileUtil::setError;
+using Microsoft::WRL::ComPtr;
+
+CDdsFile::CDdsFile() :
+	m_description()
+{
+
+}
+
+bool CDdsFile::open(const std::string& path, std::string* error)
+{
+	close();
+
+	if (!m_file.open(path))
+	{
+		return setError(error, path + " not found");
+	}
+
+	if (!DdsFile::parse(m_file.getData(), m_file.getSize(), m_description, m_subresources, error))
+	{
+		if (error)
+		{
+			*error = path + " " + *error;
+		}
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+void CDdsFile::close()
+{
+	m_file.close();
+	m_description = DdsFile::SDescription();
+	m_subresources.clear();
+}
+
+bool CDdsFile::isOpen() const
+{
+	return m_file.isOpen();
+}
+
+const DdsFile::SDescription& CDdsFile::getDescription() const
+{
+	return m_description;
+}
+
+UINT CDdsFile::getSubresourceCount() const
+{
+	return (UINT)m_subresources.size();
+}
+
+const D3D11_SUBRESOURCE_DATA& CDdsFile::getSubresource(UINT mip, UINT arraySlice) const
+{
+	return m_subresources[mip + arraySlice * m_description.m_mipCount];
+}
+
+const D3D11_SUBRESOURCE_DATA* CDdsFile::getSubresources() const
+{
+	return m_subresources.data();
+}
+
+size_t CDdsFile::getByteCount(UINT topMip) const
+{
+	size_t byteCount = 0;
+	for (UINT slice = 0; slice < m_description.m_arraySize; ++slice)
+	{
+		for (UINT mip = topMip; mip < m_description.m_mipCount; ++mip)
+		{
+			const UINT depth = std::max(m_description.m_depth >> mip, 1u);
+			byteCount += (size_t)getSubresource(mip, slice).SysMemSlicePitch * depth;
+		}
+	}
+	return byteCount;
+}
+
+HRESULT CDdsFile::createShaderResourceView(ID3D11Device* device, ID3D11ShaderResourceView** view, UINT topMip) const
+{
+	if (!isOpen() || topMip >= m_description.m_mipCount)
+	{
+		return E_INVALIDARG;
+	}
+
+	const UINT width = std::max(m_description.m_width >> topMip, 1u);
+	const UINT height = std::max(m_description.m_height >> topMip, 1u);
+	const UINT depth = std::max(m_description.m_depth >> topMip, 1u);
+	const UINT mipCount = m_description.m_mipCount - topMip;
+
+	// The top level of a block-compressed texture has to be whole blocks.
+	if (DdsFile::getBlockSize(m_description.m_format) != 0 && topMip > 0 && (width % 4 != 0 || height % 4 != 0))
+	{
+		return E_INVALIDARG;
+	}
+
+	std::vector<D3D11_SUBRESOURCE_DATA> subresources;
+	subresources.reserve((size_t)m_description.m_arraySize * mipCount);
+	for (UINT slice = 0; slice < m_description.m_arraySize; ++slice)
+	{
+		for (UINT mip = topMip; mip < m_description.m_mipCount; ++mip)
+		{
+			subresources.push_back(getSubresource(mip, slice));
+		}
+	}
+
+	ComPtr<ID3D11Resource> resource;
+	HRESULT result = E_FAIL;
+
+	switch (m_description.m_dimension)
+	{
+	case D3D11_RESOURCE_DIMENSION_TEXTURE1D:
+	{
+		D3D11_TEXTURE1D_DESC desc;
+		desc.Width = width;
+		desc.MipLevels = mipCount;
+		desc.ArraySize = m_description.m_arraySize;
+		desc.Format = m_description.m_format;
+		desc.Usage = D3D11_USAGE_IMMUTABLE;
+		desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		desc.CPUAccessFlags = 0;
+		desc.MiscFlags = 0;
+
+		ComPtr<ID3D11Texture1D> texture;
+		result = device->CreateTexture1D(&desc, subresources.data(), texture.GetAddressOf());
+		resource = texture.Get();
+		break;
+	}
+
+	case D3D11_RESOURCE_DIMENSION_TEXTURE2D:
+	{
+		D3D11_TEXTURE2D_DESC desc;
+		desc.Width = width;
+		desc.Height = height;
+		desc.MipLevels = mipCount;
+		desc.ArraySize = m_description.m_arraySize;
+		desc.Format = m_description.m_format;
+		desc.SampleDesc.Count = 1;
+		desc.SampleDesc.Quality = 0;
+		desc.Usage = D3D11_USAGE_IMMUTABLE;
+		desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		desc.CPUAccessFlags = 0;
+		desc.MiscFlags = m_description.m_isCubeMap ? D3D11_RESOURCE_MISC_TEXTURECUBE : 0;
+
+		ComPtr<ID3D11Texture2D> texture;
+		result = device->CreateTexture2D(&desc, subresources.data(), texture.GetAddressOf());
+		resource = texture.Get();
+		break;
+	}
+
+	case D3D11_RESOURCE_DIMENSION_TEXTURE3D:
+	{
+		D3D11_TEXTURE3D_DESC desc;
+		desc.Width = width;
+		desc.Height = height;
+		desc.Depth = depth;
+		desc.MipLevels = mipCount;
+		desc.Format = m_description.m_format;
+		desc.Usage = D3D11_USAGE_IMMUTABLE;
+		desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		desc.CPUAccessFlags = 0;
+		desc.MiscFlags = 0;
+
+		ComPtr<ID3D11Texture3D> texture;
+		result = device->CreateTexture3D(&desc, subresources.data(), texture.GetAddressOf());
+		resource = texture.Get();
+		break;
+	}
+
+	default:
+		return E_INVALIDARG;
+	}
+
+	if (FAILED(result))
+	{
+		return result;
+	}
+
+	// The default view of a cube map would be a 2D array.
+	if (m_description.m_isCubeMap)
+	{
+		D3D11_SHADER_RESOURCE_VIEW_DESC viewDesc;
+		viewDesc.Format = m_description.m_format;
+		if (m_description.m_arraySize > 6)
+		{
+			viewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBEARRAY;
+			viewDesc.TextureCubeArray.MostDetailedMip = 0;
+			viewDesc.TextureCubeArray.MipLevels = mipCount;
+			viewDesc.TextureCubeArray.First2DArrayFace = 0;
+			viewDesc.TextureCubeArray.NumCubes = m_description.m_arraySize / 6;
+		}
+		else
+		{
+			viewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBE;
+			viewDesc.TextureCube.MostDetailedMip = 0;
+			viewDesc.TextureCube.MipLevels = mipCount;
+		}
+		return device->CreateShaderResourceView(resource.Get(), &viewDesc, view);
+	}
+
+	return device->CreateShaderResourceView(resource.Get(), nullptr, view);
+}
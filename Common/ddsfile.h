@@ -0,0 +1,44 @@
+﻿#pragma once
+
+#include <string>
+#include <vector>
+
+#include "d3dutil.h"
+#include "ddsformat.h"
+#include "mappedfile.h"
+
+// A DDS file mapped into memory. The subresources point into the mapping,
+// so they go to texture creation without being read or copied first, and
+// only the pages the driver uploads are ever loaded.
+class CDdsFile
+{
+public:
+	CDdsFile();
+
+	CDdsFile(const CDdsFile&) = delete;
+	CDdsFile& operator=(const CDdsFile&) = delete;
+
+	bool open(const std::string& path, std::string* error = nullptr);
+	void close();
+
+	bool isOpen() const;
+	const DdsFile::SDescription& getDescription() const;
+
+	UINT getSubresourceCount() const;
+	const D3D11_SUBRESOURCE_DATA& getSubresource(UINT mip, UINT arraySlice = 0) const;
+
+	// All subresources in order, as CreateTexture2D() and friends take them.
+	const D3D11_SUBRESOURCE_DATA* getSubresources() const;
+
+	// Bytes of the subresources from mip topMip down, over all slices.
+	size_t getByteCount(UINT topMip = 0) const;
+
+	// Immutable texture with the file's contents from mip topMip down and a
+	// view of all of it; a topMip above zero leaves out the largest mips.
+	HRESULT createShaderResourceView(ID3D11Device* device, ID3D11ShaderResourceView** view, UINT topMip = 0) const;
+
+private:
+	CMappedFile m_file;
+	DdsFile::SDescription m_description;
+	std::vector<D3D11_SUBRESOURCE_DATA> m_subresources;
+};
@@ -0,0 +1,618 @@
+﻿#include "ddsformat.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "fileutil.h"
+
+using FileUtil::setError;
+
+namespace
+{
+	const UINT HeaderFlagCaps = 0x1;
+	const UINT HeaderFlagHeight = 0x2;
+	const UINT HeaderFlagWidth = 0x4;
+	const UINT HeaderFlagPitch = 0x8;
+	const UINT HeaderFlagPixelFormat = 0x1000;
+	const UINT HeaderFlagMipCount = 0x20000;
+	const UINT HeaderFlagLinearSize = 0x80000;
+	const UINT HeaderFlagDepth = 0x800000;
+
+	const UINT PixelFormatFlagAlphaPixels = 0x1;
+	const UINT PixelFormatFlagAlpha = 0x2;
+	const UINT PixelFormatFlagFourCC = 0x4;
+	const UINT PixelFormatFlagRgb = 0x40;
+	const UINT PixelFormatFlagLuminance = 0x20000;
+	const UINT PixelFormatFlagBumpDuDv = 0x80000;
+
+	const UINT CapsComplex = 0x8;
+	const UINT CapsTexture = 0x1000;
+	const UINT CapsMipmap = 0x400000;
+
+	const UINT Caps2CubeMap = 0x200;
+	const UINT Caps2CubeMapAllFaces = 0xFC00;
+	const UINT Caps2Volume = 0x200000;
+
+	const UINT Dx10MiscTextureCube = 0x4;
+
+	// Direct3D 11 resource limits.
+	const UINT MaxTextureSize = 16384;
+	const UINT MaxVolumeSize = 2048;
+	const UINT MaxArraySize = 2048;
+
+	constexpr UINT makeFourCC(char a, char b, char c, char d)
+	{
+		return (UINT)(unsigned char)a | ((UINT)(unsigned char)b << 8) | ((UINT)(unsigned char)c << 16) | ((UINT)(unsigned char)d << 24);
+	}
+
+	const UINT FourCCDxt1 = makeFourCC('D', 'X', 'T', '1');
+	const UINT FourCCDxt2 = makeFourCC('D', 'X', 'T', '2');
+	const UINT FourCCDxt3 = makeFourCC('D', 'X', 'T', '3');
+	const UINT FourCCDxt4 = makeFourCC('D', 'X', 'T', '4');
+	const UINT FourCCDxt5 = makeFourCC('D', 'X', 'T', '5');
+	const UINT FourCCAti1 = makeFourCC('A', 'T', 'I', '1');
+	const UINT FourCCBc4Unorm = makeFourCC('B', 'C', '4', 'U');
+	const UINT FourCCBc4Snorm = makeFourCC('B', 'C', '4', 'S');
+	const UINT FourCCAti2 = makeFourCC('A', 'T', 'I', '2');
+	const UINT FourCCBc5Unorm = makeFourCC('B', 'C', '5', 'U');
+	const UINT FourCCBc5Snorm = makeFourCC('B', 'C', '5', 'S');
+	const UINT FourCCDx10 = makeFourCC('D', 'X', '1', '0');
+
+	// D3DFORMAT values that legacy writers store as the FourCC.
+	const UINT FourCCA16B16G16R16 = 36;
+	const UINT FourCCQ16W16V16U16 = 110;
+	const UINT FourCCR16F = 111;
+	const UINT FourCCG16R16F = 112;
+	const UINT FourCCA16B16G16R16F = 113;
+	const UINT FourCCR32F = 114;
+	const UINT FourCCG32R32F = 115;
+	const UINT FourCCA32B32G32R32F = 116;
+
+	template<class T>
+	T readValue(const unsigned char* p)
+	{
+		T value;
+		std::memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	// Bytes per pixel of the uncompressed formats, 0 for the others.
+	UINT getPixelSize(DXGI_FORMAT format)
+	{
+		switch (format)
+		{
+		case DXGI_FORMAT_R8_UNORM:
+		case DXGI_FORMAT_A8_UNORM:
+			return 1;
+
+		case DXGI_FORMAT_R8G8_UNORM:
+		case DXGI_FORMAT_R8G8_SNORM:
+		case DXGI_FORMAT_R16_UNORM:
+		case DXGI_FORMAT_R16_FLOAT:
+		case DXGI_FORMAT_B5G6R5_UNORM:
+		case DXGI_FORMAT_B5G5R5A1_UNORM:
+		case DXGI_FORMAT_B4G4R4A4_UNORM:
+			return 2;
+
+		case DXGI_FORMAT_R8G8B8A8_UNORM:
+		case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+		case DXGI_FORMAT_R8G8B8A8_SNORM:
+		case DXGI_FORMAT_B8G8R8A8_UNORM:
+		case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+		case DXGI_FORMAT_B8G8R8X8_UNORM:
+		case DXGI_FORMAT_R10G10B10A2_UNORM:
+		case DXGI_FORMAT_R16G16_UNORM:
+		case DXGI_FORMAT_R16G16_SNORM:
+		case DXGI_FORMAT_R16G16_FLOAT:
+		case DXGI_FORMAT_R32_FLOAT:
+		case DXGI_FORMAT_R32_UINT:
+			return 4;
+
+		case DXGI_FORMAT_R16G16B16A16_UNORM:
+		case DXGI_FORMAT_R16G16B16A16_SNORM:
+		case DXGI_FORMAT_R16G16B16A16_FLOAT:
+		case DXGI_FORMAT_R32G32_FLOAT:
+			return 8;
+
+		case DXGI_FORMAT_R32G32B32A32_FLOAT:
+		case DXGI_FORMAT_R32G32B32A32_UINT:
+			return 16;
+
+		default:
+			return 0;
+		}
+	}
+
+	// Fills the legacy pixel format of the formats old readers know; false
+	// means the format needs the DX10 header.
+	bool getLegacyPixelFormat(DXGI_FORMAT format, DdsFile::SPixelFormat& pixelFormat)
+	{
+		std::memset(&pixelFormat, 0, sizeof(pixelFormat));
+		pixelFormat.m_size = sizeof(pixelFormat);
+
+		UINT fourCC = 0;
+		switch (format)
+		{
+		case DXGI_FORMAT_BC1_UNORM:
+			fourCC = FourCCDxt1;
+			break;
+		case DXGI_FORMAT_BC2_UNORM:
+			fourCC = FourCCDxt3;
+			break;
+		case DXGI_FORMAT_BC3_UNORM:
+			fourCC = FourCCDxt5;
+			break;
+		case DXGI_FORMAT_BC4_UNORM:
+			fourCC = FourCCAti1;
+			break;
+		case DXGI_FORMAT_BC5_UNORM:
+			fourCC = FourCCAti2;
+			break;
+
+		case DXGI_FORMAT_R8G8B8A8_UNORM:
+			pixelFormat.m_flags = PixelFormatFlagRgb | PixelFormatFlagAlphaPixels;
+			pixelFormat.m_rgbBitCount = 32;
+			pixelFormat.m_redMask = 0x000000FF;
+			pixelFormat.m_greenMask = 0x0000FF00;
+			pixelFormat.m_blueMask = 0x00FF0000;
+			pixelFormat.m_alphaMask = 0xFF000000;
+			return true;
+
+		case DXGI_FORMAT_B8G8R8A8_UNORM:
+			pixelFormat.m_flags = PixelFormatFlagRgb | PixelFormatFlagAlphaPixels;
+			pixelFormat.m_rgbBitCount = 32;
+			pixelFormat.m_redMask = 0x00FF0000;
+			pixelFormat.m_greenMask = 0x0000FF00;
+			pixelFormat.m_blueMask = 0x000000FF;
+			pixelFormat.m_alphaMask = 0xFF000000;
+			return true;
+
+		default:
+			return false;
+		}
+
+		pixelFormat.m_flags = PixelFormatFlagFourCC;
+		pixelFormat.m_fourCC = fourCC;
+		return true;
+	}
+
+	bool hasMasks(const DdsFile::SPixelFormat& pixelFormat, UINT red, UINT green, UINT blue, UINT alpha)
+	{
+		return pixelFormat.m_redMask == red &&
+			pixelFormat.m_greenMask == green &&
+			pixelFormat.m_blueMask == blue &&
+			pixelFormat.m_alphaMask == alpha;
+	}
+
+	// The DXGI format of a legacy pixel format, as D3DX and DirectXTex
+	// write them; unknown for the rest, e.g. 24-bit RGB.
+	DXGI_FORMAT getFormat(const DdsFile::SPixelFormat& pixelFormat)
+	{
+		if (pixelFormat.m_flags & PixelFormatFlagFourCC)
+		{
+			switch (pixelFormat.m_fourCC)
+			{
+			case FourCCDxt1:
+				return DXGI_FORMAT_BC1_UNORM;
+			case FourCCDxt2:
+			case FourCCDxt3:
+				return DXGI_FORMAT_BC2_UNORM;
+			case FourCCDxt4:
+			case FourCCDxt5:
+				return DXGI_FORMAT_BC3_UNORM;
+			case FourCCAti1:
+			case FourCCBc4Unorm:
+				return DXGI_FORMAT_BC4_UNORM;
+			case FourCCBc4Snorm:
+				return DXGI_FORMAT_BC4_SNORM;
+			case FourCCAti2:
+			case FourCCBc5Unorm:
+				return DXGI_FORMAT_BC5_UNORM;
+			case FourCCBc5Snorm:
+				return DXGI_FORMAT_BC5_SNORM;
+			case FourCCA16B16G16R16:
+				return DXGI_FORMAT_R16G16B16A16_UNORM;
+			case FourCCQ16W16V16U16:
+				return DXGI_FORMAT_R16G16B16A16_SNORM;
+			case FourCCR16F:
+				return DXGI_FORMAT_R16_FLOAT;
+			case FourCCG16R16F:
+				return DXGI_FORMAT_R16G16_FLOAT;
+			case FourCCA16B16G16R16F:
+				return DXGI_FORMAT_R16G16B16A16_FLOAT;
+			case FourCCR32F:
+				return DXGI_FORMAT_R32_FLOAT;
+			case FourCCG32R32F:
+				return DXGI_FORMAT_R32G32_FLOAT;
+			case FourCCA32B32G32R32F:
+				return DXGI_FORMAT_R32G32B32A32_FLOAT;
+			default:
+				return DXGI_FORMAT_UNKNOWN;
+			}
+		}
+
+		const UINT bitCount = pixelFormat.m_rgbBitCount;
+
+		if (pixelFormat.m_flags & PixelFormatFlagRgb)
+		{
+			if (bitCount == 32)
+			{
+				if (hasMasks(pixelFormat, 0x000000FF, 0x0000FF00, 0x00FF0000, 0xFF000000))
+				{
+					return DXGI_FORMAT_R8G8B8A8_UNORM;
+				}
+				if (hasMasks(pixelFormat, 0x00FF0000, 0x0000FF00, 0x000000FF, 0xFF000000))
+				{
+					return DXGI_FORMAT_B8G8R8A8_UNORM;
+				}
+				if (hasMasks(pixelFormat, 0x00FF0000, 0x0000FF00, 0x000000FF, 0))
+				{
+					return DXGI_FORMAT_B8G8R8X8_UNORM;
+				}
+				if (hasMasks(pixelFormat, 0x000003FF, 0x000FFC00, 0x3FF00000, 0xC0000000))
+				{
+					return DXGI_FORMAT_R10G10B10A2_UNORM;
+				}
+				if (hasMasks(pixelFormat, 0x0000FFFF, 0xFFFF0000, 0, 0))
+				{
+					return DXGI_FORMAT_R16G16_UNORM;
+				}
+				if (hasMasks(pixelFormat, 0xFFFFFFFF, 0, 0, 0))
+				{
+					return DXGI_FORMAT_R32_FLOAT;
+				}
+			}
+			else if (bitCount == 16)
+			{
+				if (hasMasks(pixelFormat, 0xF800, 0x07E0, 0x001F, 0))
+				{
+					return DXGI_FORMAT_B5G6R5_UNORM;
+				}
+				if (hasMasks(pixelFormat, 0x7C00, 0x03E0, 0x001F, 0x8000))
+				{
+					return DXGI_FORMAT_B5G5R5A1_UNORM;
+				}
+				if (hasMasks(pixelFormat, 0x0F00, 0x00F0, 0x000F, 0xF000))
+				{
+					return DXGI_FORMAT_B4G4R4A4_UNORM;
+				}
+			}
+		}
+		else if (pixelFormat.m_flags & PixelFormatFlagLuminance)
+		{
+			if (bitCount == 8 && hasMasks(pixelFormat, 0xFF, 0, 0, 0))
+			{
+				return DXGI_FORMAT_R8_UNORM;
+			}
+			if (bitCount == 16 && hasMasks(pixelFormat, 0xFFFF, 0, 0, 0))
+			{
+				return DXGI_FORMAT_R16_UNORM;
+			}
+			if (bitCount == 16 && hasMasks(pixelFormat, 0x00FF, 0, 0, 0xFF00))
+			{
+				return DXGI_FORMAT_R8G8_UNORM;
+			}
+		}
+		else if (pixelFormat.m_flags & PixelFormatFlagAlpha)
+		{
+			if (bitCount == 8)
+			{
+				return DXGI_FORMAT_A8_UNORM;
+			}
+		}
+		else if (pixelFormat.m_flags & PixelFormatFlagBumpDuDv)
+		{
+			if (bitCount == 16 && hasMasks(pixelFormat, 0x00FF, 0xFF00, 0, 0))
+			{
+				return DXGI_FORMAT_R8G8_SNORM;
+			}
+			if (bitCount == 32 && hasMasks(pixelFormat, 0x000000FF, 0x0000FF00, 0x00FF0000, 0xFF000000))
+			{
+				return DXGI_FORMAT_R8G8B8A8_SNORM;
+			}
+			if (bitCount == 32 && hasMasks(pixelFormat, 0x0000FFFF, 0xFFFF0000, 0, 0))
+			{
+				return DXGI_FORMAT_R16G16_SNORM;
+			}
+		}
+
+		return DXGI_FORMAT_UNKNOWN;
+	}
+}
+
+UINT DdsFile::getBlockSize(DXGI_FORMAT format)
+{
+	switch (format)
+	{
+	case DXGI_FORMAT_BC1_UNORM:
+	case DXGI_FORMAT_BC1_UNORM_SRGB:
+	case DXGI_FORMAT_BC4_UNORM:
+	case DXGI_FORMAT_BC4_SNORM:
+		return 8;
+
+	case DXGI_FORMAT_BC2_UNORM:
+	case DXGI_FORMAT_BC2_UNORM_SRGB:
+	case DXGI_FORMAT_BC3_UNORM:
+	case DXGI_FORMAT_BC3_UNORM_SRGB:
+	case DXGI_FORMAT_BC5_UNORM:
+	case DXGI_FORMAT_BC5_SNORM:
+	case DXGI_FORMAT_BC6H_UF16:
+	case DXGI_FORMAT_BC6H_SF16:
+	case DXGI_FORMAT_BC7_UNORM:
+	case DXGI_FORMAT_BC7_UNORM_SRGB:
+		return 16;
+
+	default:
+		return 0;
+	}
+}
+
+bool DdsFile::getSurfaceLayout(DXGI_FORMAT format, UINT width, UINT height, UINT& rowPitch, UINT& rowCount)
+{
+	if (const UINT blockSize = getBlockSize(format))
+	{
+		rowPitch = ((width + 3) / 4) * blockSize;
+		rowCount = (height + 3) / 4;
+		return true;
+	}
+
+	if (const UINT pixelSize = getPixelSize(format))
+	{
+		rowPitch = width * pixelSize;
+		rowCount = height;
+		return true;
+	}
+
+	return false;
+}
+
+bool DdsFile::parse(
+	const unsigned char* data,
+	size_t size,
+	SDescription& description,
+	std::vector<D3D11_SUBRESOURCE_DATA>& subresources,
+	std::string* error)
+{
+	if (size < sizeof(Magic) + sizeof(SHeader) || readValue<UINT>(data) != Magic)
+	{
+		return setError(error, "is not a DDS file");
+	}
+
+	const SHeader header = readValue<SHeader>(data + sizeof(Magic));
+	if (header.m_size != sizeof(SHeader) || header.m_pixelFormat.m_size != sizeof(SPixelFormat))
+	{
+		return setError(error, "has an inconsistent header");
+	}
+
+	size_t offset = sizeof(Magic) + sizeof(SHeader);
+
+	description.m_dimension = D3D11_RESOURCE_DIMENSION_TEXTURE2D;
+	description.m_width = header.m_width;
+	description.m_height = header.m_height;
+	description.m_depth = 1;
+	description.m_mipCount = std::max(header.m_mipCount, 1u);
+	description.m_arraySize = 1;
+	description.m_isCubeMap = false;
+
+	const SPixelFormat& pixelFormat = header.m_pixelFormat;
+	if ((pixelFormat.m_flags & PixelFormatFlagFourCC) && pixelFormat.m_fourCC == FourCCDx10)
+	{
+		if (size < offset + sizeof(SHeaderDx10))
+		{
+			return setError(error, "has a truncated DX10 header");
+		}
+
+		const SHeaderDx10 headerDx10 = readValue<SHeaderDx10>(data + offset);
+		offset += sizeof(SHeaderDx10);
+
+		description.m_format = headerDx10.m_format;
+		description.m_arraySize = headerDx10.m_arraySize;
+		if (description.m_arraySize == 0)
+		{
+			return setError(error, "has an array size of 0");
+		}
+
+		switch (headerDx10.m_dimension)
+		{
+		case D3D11_RESOURCE_DIMENSION_TEXTURE1D:
+			if ((header.m_flags & HeaderFlagHeight) && header.m_height != 1)
+			{
+				return setError(error, "is a 1D texture with a height");
+			}
+			description.m_dimension = D3D11_RESOURCE_DIMENSION_TEXTURE1D;
+			description.m_height = 1;
+			break;
+
+		case D3D11_RESOURCE_DIMENSION_TEXTURE2D:
+			if (headerDx10.m_miscFlags & Dx10MiscTextureCube)
+			{
+				description.m_isCubeMap = true;
+				description.m_arraySize *= 6;
+			}
+			break;
+
+		case D3D11_RESOURCE_DIMENSION_TEXTURE3D:
+			if (!(header.m_flags & HeaderFlagDepth) || description.m_arraySize != 1)
+			{
+				return setError(error, "is a volume texture without a depth or with an array size");
+			}
+			description.m_dimension = D3D11_RESOURCE_DIMENSION_TEXTURE3D;
+			description.m_depth = header.m_depth;
+			break;
+
+		default:
+			return setError(error, "has the unknown resource dimension " + std::to_string(headerDx10.m_dimension));
+		}
+	}
+	else
+	{
+		description.m_format = getFormat(pixelFormat);
+		if (description.m_format == DXGI_FORMAT_UNKNOWN)
+		{
+			return setError(error, "has a pixel format without a DXGI equivalent");
+		}
+
+		if (header.m_caps2 & Caps2Volume)
+		{
+			description.m_dimension = D3D11_RESOURCE_DIMENSION_TEXTURE3D;
+			description.m_depth = header.m_depth;
+		}
+		else if (header.m_caps2 & Caps2CubeMap)
+		{
+			if ((header.m_caps2 & Caps2CubeMapAllFaces) != Caps2CubeMapAllFaces)
+			{
+				return setError(error, "is a cube map without all six faces");
+			}
+			description.m_isCubeMap = true;
+			description.m_arraySize = 6;
+		}
+	}
+
+	const UINT maxSize = description.m_dimension == D3D11_RESOURCE_DIMENSION_TEXTURE3D ? MaxVolumeSize : MaxTextureSize;
+	if (description.m_width == 0 || description.m_height == 0 || description.m_depth == 0)
+	{
+		return setError(error, "has no texels");
+	}
+	if (description.m_width > maxSize || description.m_height > maxSize || description.m_depth > maxSize ||
+		description.m_arraySize > MaxArraySize * (description.m_isCubeMap ? 6 : 1))
+	{
+		return setError(error, "exceeds the Direct3D 11 resource limits");
+	}
+	if (description.m_isCubeMap && description.m_width != description.m_height)
+	{
+		return setError(error, "is a cube map with faces that are not square");
+	}
+
+	UINT maxMipCount = 1;
+	for (UINT extent = std::max(std::max(description.m_width, description.m_height), description.m_depth); extent > 1; extent >>= 1)
+	{
+		++maxMipCount;
+	}
+	if (description.m_mipCount > maxMipCount)
+	{
+		return setError(error, "has more mips than its size allows");
+	}
+
+	subresources.clear();
+	subresources.reserve((size_t)description.m_arraySize * description.m_mipCount);
+
+	for (UINT slice = 0; slice < description.m_arraySize; ++slice)
+	{
+		for (UINT mip = 0; mip < description.m_mipCount; ++mip)
+		{
+			const UINT width = std::max(description.m_width >> mip, 1u);
+			const UINT height = std::max(description.m_height >> mip, 1u);
+			const UINT depth = std::max(description.m_depth >> mip, 1u);
+
+			UINT rowPitch = 0;
+			UINT rowCount = 0;
+			if (!getSurfaceLayout(description.m_format, width, height, rowPitch, rowCount))
+			{
+				return setError(error, "has the unsupported format " + std::to_string((int)description.m_format));
+			}
+
+			const size_t slicePitch = (size_t)rowPitch * rowCount;
+			if (size - offset < slicePitch * depth)
+			{
+				return setError(error, "is truncated");
+			}
+
+			D3D11_SUBRESOURCE_DATA subresource;
+			subresource.pSysMem = data + offset;
+			subresource.SysMemPitch = rowPitch;
+			subresource.SysMemSlicePitch = (UINT)slicePitch;
+			subresources.push_back(subresource);
+
+			offset += slicePitch * depth;
+		}
+	}
+
+	return true;
+}
+
+bool DdsFile::write(
+	const std::string& path,
+	DXGI_FORMAT format,
+	UINT width,
+	UINT height,
+	UINT mipCount,
+	const void* data,
+	size_t size,
+	std::string* error)
+{
+	UINT rowPitch = 0;
+	UINT rowCount = 0;
+	if (!getSurfaceLayout(format, width, height, rowPitch, rowCount))
+	{
+		return setError(error, path + ": unsupported DDS format " + std::to_string((int)format));
+	}
+
+	size_t expectedSize = 0;
+	for (UINT mip = 0; mip < mipCount; ++mip)
+	{
+		UINT mipPitch = 0;
+		UINT mipRows = 0;
+		getSurfaceLayout(format, std::max(width >> mip, 1u), std::max(height >> mip, 1u), mipPitch, mipRows);
+		expectedSize += (size_t)mipPitch * mipRows;
+	}
+
+	if (width == 0 || height == 0 || mipCount == 0 || size != expectedSize)
+	{
+		return setError(error, path + ": DDS data does not match its size and mip count");
+	}
+
+	SHeader header;
+	std::memset(&header, 0, sizeof(header));
+	header.m_size = sizeof(header);
+	header.m_flags = HeaderFlagCaps | HeaderFlagHeight | HeaderFlagWidth | HeaderFlagPixelFormat;
+	header.m_height = height;
+	header.m_width = width;
+	header.m_caps = CapsTexture;
+
+	if (getBlockSize(format) != 0)
+	{
+		header.m_flags |= HeaderFlagLinearSize;
+		header.m_pitchOrLinearSize = rowPitch * rowCount;
+	}
+	else
+	{
+		header.m_flags |= HeaderFlagPitch;
+		header.m_pitchOrLinearSize = rowPitch;
+	}
+
+	if (mipCount > 1)
+	{
+		header.m_flags |= HeaderFlagMipCount;
+		header.m_mipCount = mipCount;
+		header.m_caps |= CapsComplex | CapsMipmap;
+	}
+
+	SHeaderDx10 headerDx10;
+	std::memset(&headerDx10, 0, sizeof(headerDx10));
+	const bool hasDx10Header = !getLegacyPixelFormat(format, header.m_pixelFormat);
+	if (hasDx10Header)
+	{
+		header.m_pixelFormat.m_flags = PixelFormatFlagFourCC;
+		header.m_pixelFormat.m_fourCC = FourCCDx10;
+
+		headerDx10.m_format = format;
+		headerDx10.m_dimension = D3D11_RESOURCE_DIMENSION_TEXTURE2D;
+		headerDx10.m_arraySize = 1;
+	}
+
+	std::vector<char> image(sizeof(Magic) + sizeof(header) + (hasDx10Header ? sizeof(headerDx10) : 0) + size);
+	char* p = image.data();
+	std::memcpy(p, &Magic, sizeof(Magic));
+	p += sizeof(Magic);
+	std::memcpy(p, &header, sizeof(header));
+	p += sizeof(header);
+	if (hasDx10Header)
+	{
+		std::memcpy(p, &headerDx10, sizeof(headerDx10));
+		p += sizeof(headerDx10);
+	}
+	std::memcpy(p, data, size);
+
+	return FileUtil::writeFile(path, image.data(), image.size(), error);
+}
@@ -0,0 +1,178 @@
+﻿#pragma once
+
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <d3d11.h>
+#else
+// The values of the Windows SDK for the formats this module knows.
+typedef unsigned int UINT;
+
+enum DXGI_FORMAT
+{
+	DXGI_FORMAT_UNKNOWN = 0,
+	DXGI_FORMAT_R32G32B32A32_FLOAT = 2,
+	DXGI_FORMAT_R32G32B32A32_UINT = 3,
+	DXGI_FORMAT_R16G16B16A16_FLOAT = 10,
+	DXGI_FORMAT_R16G16B16A16_UNORM = 11,
+	DXGI_FORMAT_R16G16B16A16_SNORM = 13,
+	DXGI_FORMAT_R32G32_FLOAT = 16,
+	DXGI_FORMAT_R10G10B10A2_UNORM = 24,
+	DXGI_FORMAT_R8G8B8A8_UNORM = 28,
+	DXGI_FORMAT_R8G8B8A8_UNORM_SRGB = 29,
+	DXGI_FORMAT_R8G8B8A8_SNORM = 31,
+	DXGI_FORMAT_R16G16_FLOAT = 34,
+	DXGI_FORMAT_R16G16_UNORM = 35,
+	DXGI_FORMAT_R16G16_SNORM = 37,
+	DXGI_FORMAT_R32_FLOAT = 41,
+	DXGI_FORMAT_R32_UINT = 42,
+	DXGI_FORMAT_R8G8_UNORM = 49,
+	DXGI_FORMAT_R8G8_SNORM = 51,
+	DXGI_FORMAT_R16_FLOAT = 54,
+	DXGI_FORMAT_R16_UNORM = 56,
+	DXGI_FORMAT_R8_UNORM = 61,
+	DXGI_FORMAT_A8_UNORM = 65,
+	DXGI_FORMAT_BC1_UNORM = 71,
+	DXGI_FORMAT_BC1_UNORM_SRGB = 72,
+	DXGI_FORMAT_BC2_UNORM = 74,
+	DXGI_FORMAT_BC2_UNORM_SRGB = 75,
+	DXGI_FORMAT_BC3_UNORM = 77,
+	DXGI_FORMAT_BC3_UNORM_SRGB = 78,
+	DXGI_FORMAT_BC4_UNORM = 80,
+	DXGI_FORMAT_BC4_SNORM = 81,
+	DXGI_FORMAT_BC5_UNORM = 83,
+	DXGI_FORMAT_BC5_SNORM = 84,
+	DXGI_FORMAT_B5G6R5_UNORM = 85,
+	DXGI_FORMAT_B5G5R5A1_UNORM = 86,
+	DXGI_FORMAT_B8G8R8A8_UNORM = 87,
+	DXGI_FORMAT_B8G8R8X8_UNORM = 88,
+	DXGI_FORMAT_B8G8R8A8_UNORM_SRGB = 91,
+	DXGI_FORMAT_BC6H_UF16 = 95,
+	DXGI_FORMAT_BC6H_SF16 = 96,
+	DXGI_FORMAT_BC7_UNORM = 98,
+	DXGI_FORMAT_BC7_UNORM_SRGB = 99,
+	DXGI_FORMAT_B4G4R4A4_UNORM = 115
+};
+
+enum D3D11_RESOURCE_DIMENSION
+{
+	D3D11_RESOURCE_DIMENSION_UNKNOWN = 0,
+	D3D11_RESOURCE_DIMENSION_BUFFER = 1,
+	D3D11_RESOURCE_DIMENSION_TEXTURE1D = 2,
+	D3D11_RESOURCE_DIMENSION_TEXTURE2D = 3,
+	D3D11_RESOURCE_DIMENSION_TEXTURE3D = 4
+};
+
+struct D3D11_SUBRESOURCE_DATA
+{
+	const void* pSysMem;
+	UINT SysMemPitch;
+	UINT SysMemSlicePitch;
+};
+#endif
+
+// DirectDraw Surface files, the container of the demos' textures:
+//
+//   Magic | SHeader | [SHeaderDx10] | subresources
+//
+// Subresources follow each other without padding: the mips of the first
+// array slice or cube face, largest first, then those of the next. The
+// legacy header describes the common formats by a FourCC or channel masks;
+// any other DXGI format needs the DX10 extension header.
+//
+// Parsing and writing need nothing of Direct3D but its format and
+// subresource types, which other platforms get from the declarations
+// below, so the container is checked by the tests on any platform;
+// CDdsFile in ddsfile.h maps the files and creates their textures.
+namespace DdsFile
+{
+	// "DDS "
+	const UINT Magic = 0x20534444;
+
+	struct SPixelFormat
+	{
+		UINT m_size;
+		UINT m_flags;
+		UINT m_fourCC;
+		UINT m_rgbBitCount;
+		UINT m_redMask;
+		UINT m_greenMask;
+		UINT m_blueMask;
+		UINT m_alphaMask;
+	};
+
+	struct SHeader
+	{
+		UINT m_size;
+		UINT m_flags;
+		UINT m_height;
+		UINT m_width;
+		UINT m_pitchOrLinearSize;
+		UINT m_depth;
+		UINT m_mipCount;
+		UINT m_reserved1[11];
+		SPixelFormat m_pixelFormat;
+		UINT m_caps;
+		UINT m_caps2;
+		UINT m_caps3;
+		UINT m_caps4;
+		UINT m_reserved2;
+	};
+
+	struct SHeaderDx10
+	{
+		DXGI_FORMAT m_format;
+		UINT m_dimension;
+		UINT m_miscFlags;
+		UINT m_arraySize;
+		UINT m_miscFlags2;
+	};
+
+	struct SDescription
+	{
+		DXGI_FORMAT m_format;
+		D3D11_RESOURCE_DIMENSION m_dimension;
+		UINT m_width;
+		UINT m_height;
+		UINT m_depth;
+		UINT m_mipCount;
+
+		// Six slices per cube for cube maps.
+		UINT m_arraySize;
+		bool m_isCubeMap;
+	};
+
+	// Bytes per 4x4 block of the block-compressed formats, 0 for the others.
+	UINT getBlockSize(DXGI_FORMAT format);
+
+	// Bytes per row, or per row of 4x4 blocks, and the number of such rows
+	// of a width x height surface; false for formats this module does not
+	// know.
+	bool getSurfaceLayout(DXGI_FORMAT format, UINT width, UINT height, UINT& rowPitch, UINT& rowCount);
+
+	// Validates the headers and checks that data holds every subresource,
+	// which are returned in D3D11 subresource order, mip + slice * mip
+	// count, pointing into data.
+	bool parse(
+		const unsigned char* data,
+		size_t size,
+		SDescription& description,
+		std::vector<D3D11_SUBRESOURCE_DATA>& subresources,
+		std::string* error = nullptr
+	);
+
+	// Writes a 2D texture whose mips, largest first, are packed one after
+	// another in data. The file is written under a temporary name and renamed
+	// when complete.
+	bool write(
+		const std::string& path,
+		DXGI_FORMAT format,
+		UINT width,
+		UINT height,
+		UINT mipCount,
+		const void* data,
+		size_t size,
+		std::string* error = nullptr
+	);
+}
@@ -0,0 +1,74 @@
+﻿#include "fileutil.h"
+
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace
+{
+	std::atomic<unsigned int> g_temporaryCounter(0);
+
+	unsigned long getProcessId()
+	{
+#ifdef _WIN32
+		return GetCurrentProcessId();
+#else
+		return (unsigned long)getpid();
+#endif
+	}
+
+	bool replaceFile(const std::string& source, const std::string& destination)
+	{
+#ifdef _WIN32
+		return MoveFileExA(source.c_str(), destination.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+		return std::rename(source.c_str(), destination.c_str()) == 0;
+#endif
+	}
+}
+
+bool FileUtil::setError(std::string* error, const std::string& message)
+{
+	if (error)
+	{
+		*error = message;
+	}
+	return false;
+}
+
+bool FileUtil::writeFile(const std::string& path, const void* data, size_t size, std::string* error)
+{
+	// Unique per process and call, so no two writers of the same path, in
+	// one process or several, share a temporary file.
+	const std::string temporaryPath =
+		path + "." + std::to_string(getProcessId()) + "." + std::to_string(g_temporaryCounter++) + ".tmp";
+	{
+		// Closed before the check, so data still buffered that fails to
+		// reach the disk fails the write too.
+		std::ofstream fout(temporaryPath, std::ios::binary | std::ios::trunc);
+		if (fout)
+		{
+			fout.write(static_cast<const char*>(data), size);
+			fout.close();
+		}
+		if (!fout)
+		{
+			std::remove(temporaryPath.c_str());
+			return setError(error, temporaryPath + " could not be written");
+		}
+	}
+
+	if (!replaceFile(temporaryPath, path))
+	{
+		std::remove(temporaryPath.c_str());
+		return setError(error, path + " could not be written");
+	}
+
+	return true;
+}
@@ -0,0 +1,18 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Helpers shared by the loaders and converters, which report failures as
+// false plus an optional message rather than by throwing.
+namespace FileUtil
+{
+	// Stores message in error when it is given; always false, so failures
+	// read "return setError(error, ...);".
+	bool setError(std::string* error, const std::string& message);
+
+	// Writes a whole file under a temporary name and moves it over path, so
+	// readers never see a partially written file under the final name and
+	// concurrent writers of the same path leave one complete file.
+	bool writeFile(const std::string& path, const void* data, size_t size, std::string* error = nullptr);
+}
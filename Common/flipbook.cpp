@@ -0,0 +1,599 @@
+﻿#include "flipbook.h"
+
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+
+#include "bmpdecoder.h"
+#include "fileutil.h"
+#include "framecodec.h"
+#include "pixelformat.h"
+#include "threadpool.h"
+
+using FileUtil::setError;
+
+namespace
+{
+	std::string getFramePath(const std::string& directory, const std::string& pattern, UINT number)
+	{
+		const size_t first = pattern.find('#');
+		if (first == std::string::npos)
+		{
+			return directory + pattern;
+		}
+
+		size_t last = first;
+		while (last < pattern.size() && pattern[last] == '#')
+		{
+			++last;
+		}
+
+		std::string digits = std::to_string(number);
+		if (digits.size() < last - first)
+		{
+			digits.insert(0, last - first - digits.size(), '0');
+		}
+
+		return directory + pattern.substr(0, first) + digits + pattern.substr(last);
+	}
+
+	struct SManifest
+	{
+		float m_framesPerSecond = 0.0f;
+		UINT m_frameCount = 0;
+		UINT m_firstFrame = 0;
+		UINT m_maxError = 0;
+		std::string m_pattern;
+	};
+
+	bool parseManifest(
+		const std::string& sourcePath,
+		const char* text,
+		size_t size,
+		SManifest& manifest,
+		std::string* error)
+	{
+		std::istringstream stream(std::string(text, size));
+		std::string line;
+		while (std::getline(stream, line))
+		{
+			std::istringstream lineStream(line);
+			std::string key;
+			lineStream >> key;
+
+			if (key == "FramesPerSecond:")
+			{
+				lineStream >> manifest.m_framesPerSecond;
+			}
+			else if (key == "FrameCount:")
+			{
+				lineStream >> manifest.m_frameCount;
+			}
+			else if (key == "FirstFrame:")
+			{
+				lineStream >> manifest.m_firstFrame;
+			}
+			else if (key == "Frames:")
+			{
+				lineStream >> manifest.m_pattern;
+			}
+			else if (key == "MaxError:")
+			{
+				lineStream >> manifest.m_maxError;
+			}
+			else if (!key.empty() && key[0] != '#')
+			{
+				return setError(error, sourcePath + ": unknown key " + key);
+			}
+		}
+
+		if (manifest.m_frameCount == 0 || manifest.m_pattern.empty())
+		{
+			return setError(error, sourcePath + ": FrameCount and Frames are required");
+		}
+
+		return true;
+	}
+
+	// Frame images are named relative to the manifest.
+	void listFramePaths(const std::string& sourcePath, const SManifest& manifest, std::vector<std::string>& paths)
+	{
+		const size_t slash = sourcePath.find_last_of("/\\");
+		const std::string directory = slash == std::string::npos ? std::string() : sourcePath.substr(0, slash + 1);
+
+		paths.resize(manifest.m_frameCount);
+		for (UINT i = 0; i < manifest.m_frameCount; ++i)
+		{
+			paths[i] = getFramePath(directory, manifest.m_pattern, manifest.m_firstFrame + i);
+		}
+	}
+
+	void encodeRgb8(const UINT* pixels, UINT pixelCount, std::vector<unsigned char>& encoded)
+	{
+		encoded.resize((size_t)pixelCount * 3);
+		const unsigned char* source = reinterpret_cast<const unsigned char*>(pixels);
+		for (UINT i = 0; i < pixelCount; ++i)
+		{
+			encoded[i * 3 + 0] = source[i * 4 + 0];
+			encoded[i * 3 + 1] = source[i * 4 + 1];
+			encoded[i * 3 + 2] = source[i * 4 + 2];
+		}
+	}
+
+	UINT getRgb8FrameSize(const Flipbook::SHeader& header)
+	{
+		return header.m_width * header.m_height * 3;
+	}
+}
+
+bool Flipbook::write(
+	const std::string& path,
+	UINT width,
+	UINT height,
+	float framesPerSecond,
+	const std::vector<const UINT*>& frames,
+	std::string* error,
+	UINT maxError)
+{
+	if (width == 0 || height == 0 || frames.empty() || !(framesPerSecond > 0.0f))
+	{
+		return setError(error, path + ": a flipbook needs frames, a size and a frame rate");
+	}
+
+	SHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.m_magic, Magic, sizeof(Magic));
+	header.m_version = Version;
+	header.m_headerSize = sizeof(SHeader);
+	header.m_codec = width % FrameCodec::TileSize == 0 && height % FrameCodec::TileSize == 0 ?
+		ECodec::TileDelta :
+		ECodec::Rgb8;
+	header.m_width = width;
+	header.m_height = height;
+	header.m_frameCount = (UINT)frames.size();
+	header.m_framesPerSecond = framesPerSecond;
+	header.m_keyframeInterval = header.m_codec == ECodec::TileDelta ? DefaultKeyframeInterval : 1;
+
+	const size_t tableSize = frames.size() * sizeof(SFrame);
+	std::vector<SFrame> table(frames.size());
+	std::vector<char> image(sizeof(SHeader) + tableSize);
+
+	// Delta frames are coded against the previous frame as the player will
+	// have decoded it, so quantization errors do not pile up.
+	std::vector<UINT> decoded;
+	if (header.m_codec == ECodec::TileDelta)
+	{
+		decoded.resize((size_t)width * height);
+	}
+
+	std::vector<unsigned char> encoded;
+	for (size_t i = 0; i < frames.size(); ++i)
+	{
+		if (header.m_codec == ECodec::TileDelta)
+		{
+			const bool isKeyframe = i % header.m_keyframeInterval == 0;
+			FrameCodec::encodeFrame(frames[i], isKeyframe ? nullptr : decoded.data(), width, height, maxError, encoded);
+			FrameCodec::decodeFrame(decoded.data(), decoded.data(), width, height, encoded.data(), encoded.size());
+		}
+		else
+		{
+			encodeRgb8(frames[i], width * height, encoded);
+		}
+
+		if (image.size() + encoded.size() > 0xFFFFFFFFull)
+		{
+			return setError(error, path + ": flipbook exceeds 4 GB");
+		}
+
+		table[i].m_offset = (UINT)image.size();
+		table[i].m_size = (UINT)encoded.size();
+		image.insert(image.end(), encoded.begin(), encoded.end());
+	}
+
+	std::memcpy(image.data(), &header, sizeof(header));
+	std::memcpy(image.data() + sizeof(SHeader), table.data(), tableSize);
+
+	return FileUtil::writeFile(path, image.data(), image.size(), error);
+}
+
+bool Flipbook::getFramePaths(
+	const std::string& sourcePath,
+	const char* text,
+	size_t size,
+	std::vector<std::string>& paths,
+	std::string* error)
+{
+	SManifest manifest;
+	if (!parseManifest(sourcePath, text, size, manifest, error))
+	{
+		return false;
+	}
+
+	listFramePaths(sourcePath, manifest, paths);
+	return true;
+}
+
+bool Flipbook::convertManifest(
+	const std::string& sourcePath,
+	const char* text,
+	size_t size,
+	const std::string& path,
+	std::string* error)
+{
+	SManifest manifest;
+	if (!parseManifest(sourcePath, text, size, manifest, error))
+	{
+		return false;
+	}
+
+	std::vector<std::string> paths;
+	listFramePaths(sourcePath, manifest, paths);
+
+	const UINT frameCount = manifest.m_frameCount;
+	std::vector<BmpDecoder::SImage> images(frameCount);
+	std::vector<std::string> errors(frameCount);
+	CThreadPool::getShared().parallelFor(0, frameCount, 1, [&](UINT begin, UINT end)
+	{
+		for (UINT i = begin; i < end; ++i)
+		{
+			BmpDecoder::load(paths[i], images[i], &errors[i]);
+		}
+	});
+
+	std::vector<const UINT*> frames(frameCount);
+	for (UINT i = 0; i < frameCount; ++i)
+	{
+		if (!errors[i].empty())
+		{
+			return setError(error, errors[i]);
+		}
+
+		if (images[i].m_width != images[0].m_width || images[i].m_height != images[0].m_height)
+		{
+			return setError(error, sourcePath + ": frame " + std::to_string(manifest.m_firstFrame + i) +
+				" differs in size from the first frame");
+		}
+
+		frames[i] = images[i].m_pixels.data();
+	}
+
+	return write(
+		path,
+		images[0].m_width,
+		images[0].m_height,
+		manifest.m_framesPerSecond,
+		frames,
+		error,
+		manifest.m_maxError
+	);
+}
+
+CFlipbook::CFlipbook() :
+	m_header(nullptr),
+	m_frames(nullptr),
+	m_currentFrame(0),
+	m_isDecoding(false),
+	m_isClosing(false),
+	m_referenceFrame(UINT_MAX),
+	m_decodedFrameCount(0),
+	m_lateFrameCount(0)
+{
+
+}
+
+CFlipbook::~CFlipbook()
+{
+	close();
+}
+
+bool CFlipbook::open(const std::string& path, UINT residentFrameCount, std::string* error)
+{
+	close();
+
+	if (!m_file.open(path))
+	{
+		return setError(error, path + " not found");
+	}
+
+	const Flipbook::SHeader* header = reinterpret_cast<const Flipbook::SHeader*>(m_file.getData());
+	const size_t fileSize = m_file.getSize();
+
+	if (fileSize < sizeof(Flipbook::SHeader) ||
+		std::memcmp(header->m_magic, Flipbook::Magic, sizeof(Flipbook::Magic)) != 0)
+	{
+		close();
+		return setError(error, path + " is not a flipbook");
+	}
+
+	if (header->m_version != Flipbook::Version || header->m_headerSize != sizeof(Flipbook::SHeader))
+	{
+		close();
+		return setError(error, path + " has version " + std::to_string(header->m_version) +
+			", expected " + std::to_string(Flipbook::Version));
+	}
+
+	const Flipbook::SFrame* frames = reinterpret_cast<const Flipbook::SFrame*>(m_file.getData() + sizeof(Flipbook::SHeader));
+	const unsigned long long tableEnd = sizeof(Flipbook::SHeader) +
+		(unsigned long long)header->m_frameCount * sizeof(Flipbook::SFrame);
+
+	bool isValid =
+		(header->m_codec == Flipbook::ECodec::Rgb8 || header->m_codec == Flipbook::ECodec::TileDelta) &&
+		header->m_keyframeInterval > 0 &&
+		header->m_width > 0 && header->m_height > 0 &&
+		(unsigned long long)header->m_width * header->m_height <= 0x10000000ull &&
+		header->m_frameCount > 0 &&
+		header->m_framesPerSecond > 0.0f &&
+		tableEnd <= fileSize;
+
+	for (UINT i = 0; isValid && i < header->m_frameCount; ++i)
+	{
+		isValid =
+			frames[i].m_offset >= tableEnd &&
+			(unsigned long long)frames[i].m_offset + frames[i].m_size <= fileSize;
+
+		if (isValid && header->m_codec == Flipbook::ECodec::Rgb8)
+		{
+			isValid = frames[i].m_size == getRgb8FrameSize(*header);
+		}
+		else if (isValid)
+		{
+			isValid = FrameCodec::validateFrame(
+				header->m_width,
+				header->m_height,
+				i % header->m_keyframeInterval == 0,
+				m_file.getData() + frames[i].m_offset,
+				frames[i].m_size
+			);
+		}
+	}
+
+	if (!isValid)
+	{
+		close();
+		return setError(error, path + " has an inconsistent header");
+	}
+
+	m_header = header;
+	m_frames = frames;
+
+	if (residentFrameCount < 1)
+	{
+		residentFrameCount = 1;
+	}
+	if (residentFrameCount > header->m_frameCount)
+	{
+		residentFrameCount = header->m_frameCount;
+	}
+
+	m_slots.resize(residentFrameCount);
+	for (SSlot& slot : m_slots)
+	{
+		slot.m_frame = UINT_MAX;
+		slot.m_isReady = false;
+		slot.m_pixels.resize((size_t)header->m_width * header->m_height);
+	}
+
+	if (header->m_codec == Flipbook::ECodec::TileDelta)
+	{
+		m_reference.resize((size_t)header->m_width * header->m_height);
+	}
+
+	return true;
+}
+
+void CFlipbook::close()
+{
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_isClosing = true;
+		m_condition.wait(lock, [this]()
+		{
+			return !m_isDecoding;
+		});
+		m_isClosing = false;
+
+		m_slots.clear();
+		m_slots.shrink_to_fit();
+		m_reference.clear();
+		m_reference.shrink_to_fit();
+		m_referenceFrame = UINT_MAX;
+		m_currentFrame = 0;
+		m_decodedFrameCount = 0;
+		m_lateFrameCount = 0;
+	}
+
+	m_header = nullptr;
+	m_frames = nullptr;
+	m_file.close();
+}
+
+const Flipbook::SHeader& CFlipbook::getHeader() const
+{
+	return *m_header;
+}
+
+UINT CFlipbook::getFrameAt(float time) const
+{
+	const float frame = std::floor(time * m_header->m_framesPerSecond);
+	const float frameCount = (float)m_header->m_frameCount;
+	const float wrapped = frame - std::floor(frame / frameCount) * frameCount;
+
+	// Rounding can land on frameCount itself.
+	return (UINT)wrapped % m_header->m_frameCount;
+}
+
+const UINT* CFlipbook::acquireFrame(UINT frame, bool wait)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_currentFrame = frame % m_header->m_frameCount;
+
+	SSlot* slot = findSlot(m_currentFrame);
+	if (!slot)
+	{
+		++m_lateFrameCount;
+	}
+
+	if (!m_isDecoding)
+	{
+		m_isDecoding = true;
+		CThreadPool::getShared().submit([this]()
+		{
+			decodeAhead();
+		});
+	}
+
+	if (!slot && wait)
+	{
+		m_condition.wait(lock, [this, &slot]()
+		{
+			slot = findSlot(m_currentFrame);
+			return slot != nullptr;
+		});
+	}
+
+	return slot ? slot->m_pixels.data() : nullptr;
+}
+
+UINT CFlipbook::getResidentFrameCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return (UINT)m_slots.size();
+}
+
+size_t CFlipbook::getResidentByteCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	size_t byteCount = 0;
+	for (const SSlot& slot : m_slots)
+	{
+		byteCount += slot.m_pixels.size() * sizeof(UINT);
+	}
+	return byteCount + m_reference.size() * sizeof(UINT);
+}
+
+UINT CFlipbook::getDecodedFrameCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_decodedFrameCount;
+}
+
+UINT CFlipbook::getLateFrameCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_lateFrameCount;
+}
+
+void CFlipbook::decodeAhead()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	for (;;)
+	{
+		// The first frame of the window that no slot holds, and a slot whose
+		// frame has left the window to decode it into. The window and the
+		// ring are the same size, so one is free whenever a frame is missing.
+		UINT frame = UINT_MAX;
+		SSlot* freeSlot = nullptr;
+
+		const UINT frameCount = m_header->m_frameCount;
+		for (UINT i = 0; !m_isClosing && i < (UINT)m_slots.size(); ++i)
+		{
+			const UINT candidate = (m_currentFrame + i) % frameCount;
+
+			bool isHeld = false;
+			for (const SSlot& slot : m_slots)
+			{
+				isHeld = isHeld || slot.m_frame == candidate;
+			}
+
+			if (!isHeld)
+			{
+				frame = candidate;
+				break;
+			}
+		}
+
+		for (UINT i = 0; frame != UINT_MAX && !freeSlot; ++i)
+		{
+			if (m_slots[i].m_frame == UINT_MAX || !isInWindow(m_slots[i].m_frame))
+			{
+				freeSlot = &m_slots[i];
+			}
+		}
+
+		if (!freeSlot)
+		{
+			// Notified under the lock, as close() may return right after.
+			m_isDecoding = false;
+			m_condition.notify_all();
+			return;
+		}
+
+		freeSlot->m_frame = frame;
+		freeSlot->m_isReady = false;
+
+		// Only this thread touches a slot that is not ready, so the frame is
+		// decoded without the lock while the owner keeps playing.
+		lock.unlock();
+		decodeFrame(frame, freeSlot->m_pixels.data());
+		lock.lock();
+
+		freeSlot->m_isReady = true;
+		++m_decodedFrameCount;
+		m_condition.notify_all();
+	}
+}
+
+void CFlipbook::decodeFrame(UINT frame, UINT* pixels)
+{
+	const UINT pixelCount = m_header->m_width * m_header->m_height;
+
+	if (m_header->m_codec == Flipbook::ECodec::Rgb8)
+	{
+		PixelFormat::convertToRgba8(PixelFormat::EFormat::Rgb8, m_file.getData() + m_frames[frame].m_offset, pixels, pixelCount);
+		return;
+	}
+
+	// In play order this decodes just the frame on top of its predecessor;
+	// after a jump it catches up from the keyframe.
+	const UINT keyframe = frame - frame % m_header->m_keyframeInterval;
+	UINT next = keyframe;
+	if (m_referenceFrame != UINT_MAX && m_referenceFrame >= keyframe && m_referenceFrame <= frame)
+	{
+		next = m_referenceFrame + 1;
+	}
+
+	for (; next <= frame; ++next)
+	{
+		// The frames were checked by open(), so this cannot fail.
+		FrameCodec::decodeFrame(
+			m_reference.data(),
+			next == keyframe ? nullptr : m_reference.data(),
+			m_header->m_width,
+			m_header->m_height,
+			m_file.getData() + m_frames[next].m_offset,
+			m_frames[next].m_size
+		);
+	}
+	m_referenceFrame = frame;
+
+	std::memcpy(pixels, m_reference.data(), pixelCount * sizeof(UINT));
+}
+
+bool CFlipbook::isInWindow(UINT frame) const
+{
+	const UINT frameCount = m_header->m_frameCount;
+	return (frame + frameCount - m_currentFrame) % frameCount < (UINT)m_slots.size();
+}
+
+CFlipbook::SSlot* CFlipbook::findSlot(UINT frame)
+{
+	for (SSlot& slot : m_slots)
+	{
+		if (slot.m_frame == frame && slot.m_isReady)
+		{
+			return &slot;
+		}
+	}
+	return nullptr;
+}
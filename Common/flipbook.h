@@ -0,0 +1,179 @@
+﻿#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "d3dutil.h"
+#include "mappedfile.h"
+
+// Packed flipbook animation: every frame of a sequence in one file, so a
+// player opens and maps a single file instead of one image per frame.
+//
+//   SHeader | SFrame table | frame blobs
+//
+// Frames are all of the header's size and decode to R8G8B8A8 rows, top row
+// first. Sizes that are multiples of FrameCodec::TileSize are stored with
+// FrameCodec as a keyframe every m_keyframeInterval frames followed by
+// frames coded against their predecessor. Files are little-endian.
+//
+// Packs are built from a text manifest next to the frame images, e.g.
+//
+//   # Fire animation.
+//   FramesPerSecond: 30
+//   FrameCount: 120
+//   FirstFrame: 1
+//   Frames: Fire###.bmp
+//
+// where the run of '#' is replaced by the zero-padded frame number. Frames
+// are stored losslessly unless a manifest opts in with "MaxError: n", the
+// FrameCodec error bound, for a sequence whose smaller file is worth colors
+// off by up to n levels. The asset cache converts ".flipbook" manifests
+// into ".flip" packs, with the frame images in the cache key, so an edited
+// frame is converted again.
+namespace Flipbook
+{
+	const char Magic[4] = { 'F', 'L', 'I', 'P' };
+	const UINT Version = 2;
+	const UINT DefaultKeyframeInterval = 30;
+
+	enum class ECodec : UINT
+	{
+		// R8G8B8 rows without padding.
+		Rgb8 = 0,
+
+		// FrameCodec frames.
+		TileDelta = 1
+	};
+
+	struct SHeader
+	{
+		char m_magic[4];
+		UINT m_version;
+		UINT m_headerSize;
+		ECodec m_codec;
+
+		UINT m_width;
+		UINT m_height;
+		UINT m_frameCount;
+		float m_framesPerSecond;
+		UINT m_keyframeInterval;
+	};
+
+	struct SFrame
+	{
+		UINT m_offset;
+		UINT m_size;
+	};
+
+	// Packs frames of width x height R8G8B8A8 pixels, with FrameCodec and
+	// maxError where the size allows. The file is written under a temporary
+	// name and renamed when complete.
+	bool write(
+		const std::string& path,
+		UINT width,
+		UINT height,
+		float framesPerSecond,
+		const std::vector<const UINT*>& frames,
+		std::string* error = nullptr,
+		UINT maxError = 0
+	);
+
+	// Frame images named by a manifest, relative to the current directory.
+	bool getFramePaths(
+		const std::string& sourcePath,
+		const char* text,
+		size_t size,
+		std::vector<std::string>& paths,
+		std::string* error = nullptr
+	);
+
+	// Decodes the BMP frames named by a manifest and packs them.
+	bool convertManifest(
+		const std::string& sourcePath,
+		const char* text,
+		size_t size,
+		const std::string& path,
+		std::string* error = nullptr
+	);
+}
+
+// Plays a flipbook file while keeping only a window of frames in memory.
+//
+// The file is mapped; the decoded frames live in a ring of
+// residentFrameCount slots that holds the frame last asked for and the ones
+// after it, looping at the end. Asking for a frame moves the window and
+// wakes a decoder on the shared thread pool that fills the slots in play
+// order, so at the animation rate frames are ready before they are needed
+// and resident memory stays at residentFrameCount decoded frames, plus the
+// decoder's reference frame, whatever the length of the animation. After a
+// jump the decoder restarts at the keyframe before the frame.
+class CFlipbook
+{
+public:
+	CFlipbook();
+
+	// Waits for the decoder.
+	~CFlipbook();
+
+	CFlipbook(const CFlipbook&) = delete;
+	CFlipbook& operator=(const CFlipbook&) = delete;
+
+	// residentFrameCount is clamped to [1, frame count].
+	bool open(const std::string& path, UINT residentFrameCount, std::string* error = nullptr);
+	void close();
+
+	const Flipbook::SHeader& getHeader() const;
+
+	// Frame shown time seconds into the looping animation.
+	UINT getFrameAt(float time) const;
+
+	// R8G8B8A8 pixels of the frame, width * 4 bytes per row, valid until the
+	// next call. Returns nullptr if the frame is not decoded yet unless wait
+	// is set, in which case it blocks until it is. One thread at a time.
+	const UINT* acquireFrame(UINT frame, bool wait = false);
+
+	UINT getResidentFrameCount() const;
+	size_t getResidentByteCount() const;
+
+	UINT getDecodedFrameCount() const;
+
+	// Frames asked for before they were decoded.
+	UINT getLateFrameCount() const;
+
+private:
+	struct SSlot
+	{
+		UINT m_frame;
+		bool m_isReady;
+		std::vector<UINT> m_pixels;
+	};
+
+	// Decodes the missing frames of the window in play order, until the
+	// window is complete. Runs on the thread pool.
+	void decodeAhead();
+	void decodeFrame(UINT frame, UINT* pixels);
+
+	bool isInWindow(UINT frame) const;
+	SSlot* findSlot(UINT frame);
+
+	CMappedFile m_file;
+	const Flipbook::SHeader* m_header;
+	const Flipbook::SFrame* m_frames;
+
+	mutable std::mutex m_mutex;
+	std::condition_variable m_condition;
+	std::vector<SSlot> m_slots;
+	UINT m_currentFrame;
+	bool m_isDecoding;
+	bool m_isClosing;
+
+	// The frame last decoded, which the next delta frame is decoded on top
+	// of. Only the decoder touches it.
+	std::vector<UINT> m_reference;
+	UINT m_referenceFrame;
+
+	UINT m_decodedFrameCount;
+	UINT m_lateFrameCount;
+};
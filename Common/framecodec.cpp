@@ -0,0 +1,548 @@
+﻿#include "framecodec.h"
+
+#include <cstring>
+
+namespace
+{
+	const UINT GroupSize = 16;
+	const UINT TileGroupCount = FrameCodec::TileSize * FrameCodec::TileSize * 4 / GroupSize;
+	const UINT TileHeaderSize = TileGroupCount * 2 / 8;
+
+	// A frame starts with the quantization shift, then two bits per tile,
+	// four tiles to a byte.
+	const UINT MaxShift = 7;
+
+	const UINT SkipTile = 0;
+	const UINT InterTile = 1;
+	const UINT IntraTile = 2;
+
+	// Prediction of the first pixel of an intra tile: opaque black, so
+	// opaque frames spend no bits on alpha.
+	const UINT IntraBase = 0xFF000000;
+
+	// Bits per byte, and bytes of data, for each of the four group modes.
+	const UINT ModeBits[4] = { 0, 2, 4, 8 };
+	const UINT ModeDataSize[4] = { 0, 4, 8, 16 };
+
+	inline unsigned char zigzag(unsigned char delta)
+	{
+		return (unsigned char)((delta << 1) ^ (unsigned char)((signed char)delta >> 7));
+	}
+
+	inline unsigned char unzigzag(unsigned char value)
+	{
+		return (unsigned char)((value >> 1) ^ (unsigned char)(0 - (value & 1)));
+	}
+
+	inline UINT getMode(const unsigned char* modes, UINT i)
+	{
+		return (modes[i / 4] >> (6 - i % 4 * 2)) & 3;
+	}
+
+	inline void setMode(unsigned char* modes, UINT i, UINT mode)
+	{
+		modes[i / 4] |= (unsigned char)(mode << (6 - i % 4 * 2));
+	}
+
+	// Codes of a tile are stored by channel: group 4 * (y / 2) + c holds
+	// channel c of rows y and y + 1, so a channel that does not change, like
+	// the alpha of an opaque animation, costs no bits.
+	inline UINT getCodeIndex(UINT x, UINT y, UINT c)
+	{
+		return ((y / 2) * 4 + c) * GroupSize + (y % 2) * FrameCodec::TileSize + x;
+	}
+
+	// Data bytes following the header of a coded tile.
+	UINT getTileDataSize(const unsigned char* header)
+	{
+		UINT size = 0;
+		for (UINT g = 0; g < TileGroupCount; ++g)
+		{
+			size += ModeDataSize[getMode(header, g)];
+		}
+		return size;
+	}
+
+	// Quantized differences of a tile to its prediction, and the tile as
+	// the decoder will see it, in rows of R8G8B8A8 pixels. Intra tiles predict from decoded
+	// pixels, like the decoder does.
+	void quantizeTile(
+		const UINT* pixels,
+		const UINT* reference,
+		UINT width,
+		UINT mode,
+		UINT shift,
+		unsigned char codes[TileGroupCount * GroupSize],
+		unsigned char decoded[TileGroupCount * GroupSize])
+	{
+		const int step = 1 << shift;
+
+		for (UINT y = 0; y < FrameCodec::TileSize; ++y)
+		{
+			for (UINT x = 0; x < FrameCodec::TileSize; ++x)
+			{
+				for (UINT c = 0; c < 4; ++c)
+				{
+					const UINT i = (y * FrameCodec::TileSize + x) * 4 + c;
+
+					int prediction;
+					if (mode == InterTile)
+					{
+						prediction = (reference[y * width + x] >> (c * 8)) & 0xFF;
+					}
+					else if (x > 0)
+					{
+						prediction = decoded[i - 4];
+					}
+					else if (y > 0)
+					{
+						prediction = decoded[i - FrameCodec::TileSize * 4];
+					}
+					else
+					{
+						prediction = (IntraBase >> (c * 8)) & 0xFF;
+					}
+
+					// Rounded to the nearest step, then pulled back into range
+					// so the decoded value does not wrap around.
+					const int value = (pixels[y * width + x] >> (c * 8)) & 0xFF;
+					int code = (value - prediction + step / 2 + 512) / step - 512 / step;
+					while (prediction + code * step > 255)
+					{
+						--code;
+					}
+					while (prediction + code * step < 0)
+					{
+						++code;
+					}
+
+					codes[getCodeIndex(x, y, c)] = (unsigned char)code;
+					decoded[i] = (unsigned char)(prediction + code * step);
+				}
+			}
+		}
+	}
+
+	bool isTileClose(const UINT* pixels, const UINT* reference, UINT width, UINT maxError)
+	{
+		for (UINT y = 0; y < FrameCodec::TileSize; ++y)
+		{
+			const unsigned char* row = reinterpret_cast<const unsigned char*>(pixels + y * width);
+			const unsigned char* referenceRow = reinterpret_cast<const unsigned char*>(reference + y * width);
+			for (UINT i = 0; i < FrameCodec::TileSize * 4; ++i)
+			{
+				const int difference = (int)row[i] - (int)referenceRow[i];
+				if (difference > (int)maxError || difference < -(int)maxError)
+				{
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	// Groups whose differences need all 8 bits are stored as the bytes
+	// themselves, which decode with a plain load.
+	void encodeTile(const unsigned char* codes, std::vector<unsigned char>& data)
+	{
+		const size_t headerOffset = data.size();
+		data.resize(data.size() + TileHeaderSize, 0);
+
+		for (UINT g = 0; g < TileGroupCount; ++g)
+		{
+			const unsigned char* bytes = codes + g * GroupSize;
+
+			unsigned char values[GroupSize];
+			unsigned char maxValue = 0;
+			for (UINT i = 0; i < GroupSize; ++i)
+			{
+				values[i] = zigzag(bytes[i]);
+				maxValue |= values[i];
+			}
+
+			const UINT mode = maxValue == 0 ? 0 : maxValue < 4 ? 1 : maxValue < 16 ? 2 : 3;
+			setMode(&data[headerOffset], g, mode);
+
+			const UINT bits = ModeBits[mode];
+			if (bits == 8)
+			{
+				data.insert(data.end(), bytes, bytes + GroupSize);
+			}
+			else if (bits != 0)
+			{
+				// Earlier values go to the higher bits of a byte.
+				const UINT valuesPerByte = 8 / bits;
+				for (UINT i = 0; i < GroupSize; i += valuesPerByte)
+				{
+					unsigned char byte = 0;
+					for (UINT j = 0; j < valuesPerByte; ++j)
+					{
+						byte = (unsigned char)((byte << bits) | values[i + j]);
+					}
+					data.push_back(byte);
+				}
+			}
+		}
+	}
+
+#if defined(_XM_SSE_INTRINSICS_)
+	// Unpacks one group of quantized differences.
+	inline __m128i decodeGroup(const unsigned char* data, UINT mode)
+	{
+		const __m128i lowNibbles = _mm_set1_epi8(0x0F);
+		const __m128i lowPairs = _mm_set1_epi8(0x03);
+
+		__m128i values;
+		switch (mode)
+		{
+		case 0:
+			return _mm_setzero_si128();
+		case 1:
+		{
+			int packed;
+			std::memcpy(&packed, data, sizeof(packed));
+			const __m128i x = _mm_cvtsi32_si128(packed);
+			const __m128i a = _mm_and_si128(_mm_srli_epi16(x, 6), lowPairs);
+			const __m128i b = _mm_and_si128(_mm_srli_epi16(x, 4), lowPairs);
+			const __m128i c = _mm_and_si128(_mm_srli_epi16(x, 2), lowPairs);
+			const __m128i d = _mm_and_si128(x, lowPairs);
+			values = _mm_unpacklo_epi16(_mm_unpacklo_epi8(a, b), _mm_unpacklo_epi8(c, d));
+			break;
+		}
+		case 2:
+		{
+			const __m128i x = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(data));
+			const __m128i high = _mm_and_si128(_mm_srli_epi16(x, 4), lowNibbles);
+			const __m128i low = _mm_and_si128(x, lowNibbles);
+			values = _mm_unpacklo_epi8(high, low);
+			break;
+		}
+		default:
+			return _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+		}
+
+		const __m128i sign = _mm_sub_epi8(_mm_setzero_si128(), _mm_and_si128(values, _mm_set1_epi8(1)));
+		const __m128i half = _mm_and_si128(_mm_srli_epi16(values, 1), _mm_set1_epi8(0x7F));
+		return _mm_xor_si128(half, sign);
+	}
+
+	// Two rows of a tile at a time: the four channel groups are scaled back
+	// up by the step and interleaved into pixels, then intra rows are summed
+	// up pixel by pixel from the first pixel of the row above and inter rows
+	// are added to the reference.
+	void decodeTile(
+		UINT* pixels,
+		const UINT* reference,
+		UINT width,
+		UINT tileMode,
+		UINT shift,
+		const unsigned char* header,
+		const unsigned char* data)
+	{
+		const __m128i shiftCount = _mm_cvtsi32_si128((int)shift);
+		const __m128i shiftMask = _mm_set1_epi8((char)(0xFF << shift));
+		__m128i first = _mm_cvtsi32_si128((int)IntraBase);
+
+		for (UINT y = 0; y < FrameCodec::TileSize; y += 2)
+		{
+			__m128i channels[4];
+			for (UINT c = 0; c < 4; ++c)
+			{
+				const UINT mode = getMode(header, y * 2 + c);
+				channels[c] = decodeGroup(data, mode);
+				data += ModeDataSize[mode];
+
+				if (shift != 0)
+				{
+					channels[c] = _mm_and_si128(_mm_sll_epi16(channels[c], shiftCount), shiftMask);
+				}
+			}
+
+			const __m128i redGreenTop = _mm_unpacklo_epi8(channels[0], channels[1]);
+			const __m128i blueAlphaTop = _mm_unpacklo_epi8(channels[2], channels[3]);
+			const __m128i redGreenBottom = _mm_unpackhi_epi8(channels[0], channels[1]);
+			const __m128i blueAlphaBottom = _mm_unpackhi_epi8(channels[2], channels[3]);
+
+			__m128i halves[4] =
+			{
+				_mm_unpacklo_epi16(redGreenTop, blueAlphaTop),
+				_mm_unpackhi_epi16(redGreenTop, blueAlphaTop),
+				_mm_unpacklo_epi16(redGreenBottom, blueAlphaBottom),
+				_mm_unpackhi_epi16(redGreenBottom, blueAlphaBottom)
+			};
+
+			for (UINT r = 0; r < 2; ++r)
+			{
+				__m128i low = halves[r * 2];
+				__m128i high = halves[r * 2 + 1];
+
+				__m128i* row = reinterpret_cast<__m128i*>(pixels + (y + r) * width);
+				if (tileMode == InterTile)
+				{
+					const __m128i* referenceRow = reinterpret_cast<const __m128i*>(reference + (y + r) * width);
+					low = _mm_add_epi8(low, _mm_loadu_si128(referenceRow));
+					high = _mm_add_epi8(high, _mm_loadu_si128(referenceRow + 1));
+				}
+				else
+				{
+					low = _mm_add_epi8(low, first);
+					low = _mm_add_epi8(low, _mm_slli_si128(low, 4));
+					low = _mm_add_epi8(low, _mm_slli_si128(low, 8));
+					high = _mm_add_epi8(high, _mm_slli_si128(high, 4));
+					high = _mm_add_epi8(high, _mm_slli_si128(high, 8));
+					high = _mm_add_epi8(high, _mm_shuffle_epi32(low, _MM_SHUFFLE(3, 3, 3, 3)));
+					first = _mm_cvtsi32_si128(_mm_cvtsi128_si32(low));
+				}
+
+				_mm_storeu_si128(row, low);
+				_mm_storeu_si128(row + 1, high);
+			}
+		}
+	}
+#else
+	void decodeGroup(const unsigned char* data, UINT mode, unsigned char* output)
+	{
+		if (mode == 3)
+		{
+			std::memcpy(output, data, GroupSize);
+			return;
+		}
+
+		const UINT bits = ModeBits[mode];
+		for (UINT i = 0; i < GroupSize; ++i)
+		{
+			unsigned char value = 0;
+			if (bits != 0)
+			{
+				const UINT valuesPerByte = 8 / bits;
+				const UINT shift = (valuesPerByte - 1 - i % valuesPerByte) * bits;
+				value = (unsigned char)((data[i / valuesPerByte] >> shift) & ((1 << bits) - 1));
+			}
+			output[i] = unzigzag(value);
+		}
+	}
+
+	void decodeTile(
+		UINT* pixels,
+		const UINT* reference,
+		UINT width,
+		UINT tileMode,
+		UINT shift,
+		const unsigned char* header,
+		const unsigned char* data)
+	{
+		unsigned char residuals[TileGroupCount * GroupSize];
+		for (UINT g = 0; g < TileGroupCount; ++g)
+		{
+			const UINT mode = getMode(header, g);
+			decodeGroup(data, mode, residuals + g * GroupSize);
+			data += ModeDataSize[mode];
+		}
+
+		for (UINT y = 0; y < FrameCodec::TileSize; ++y)
+		{
+			unsigned char* row = reinterpret_cast<unsigned char*>(pixels + y * width);
+			const unsigned char* referenceRow = reinterpret_cast<const unsigned char*>(reference + y * width);
+			for (UINT i = 0; i < FrameCodec::TileSize * 4; ++i)
+			{
+				const unsigned char residual = residuals[getCodeIndex(i / 4, y, i % 4)];
+
+				unsigned char prediction;
+				if (tileMode == InterTile)
+				{
+					prediction = referenceRow[i];
+				}
+				else if (i >= 4)
+				{
+					prediction = row[i - 4];
+				}
+				else if (y > 0)
+				{
+					prediction = (row - width * 4)[i];
+				}
+				else
+				{
+					prediction = (unsigned char)(IntraBase >> (i * 8));
+				}
+				row[i] = (unsigned char)(prediction + (residual << shift));
+			}
+		}
+	}
+#endif
+}
+
+void FrameCodec::encodeFrame(
+	const UINT* pixels,
+	const UINT* reference,
+	UINT width,
+	UINT height,
+	UINT maxError,
+	std::vector<unsigned char>& encoded)
+{
+	const UINT tilesX = width / TileSize;
+	const UINT tileCount = tilesX * (height / TileSize);
+
+	UINT shift = 0;
+	while (shift < MaxShift && (2u << shift) <= 2 * maxError)
+	{
+		++shift;
+	}
+
+	encoded.assign(1 + (tileCount + 3) / 4, 0);
+	encoded[0] = (unsigned char)shift;
+
+	unsigned char codes[TileGroupCount * GroupSize];
+	unsigned char decoded[TileGroupCount * GroupSize];
+	std::vector<unsigned char> intra;
+	std::vector<unsigned char> inter;
+
+	for (UINT t = 0; t < tileCount; ++t)
+	{
+		const size_t tileOffset = (size_t)(t / tilesX) * TileSize * width + (t % tilesX) * TileSize;
+		const UINT* tilePixels = pixels + tileOffset;
+		const UINT* tileReference = reference ? reference + tileOffset : nullptr;
+
+		if (tileReference && isTileClose(tilePixels, tileReference, width, maxError))
+		{
+			setMode(encoded.data() + 1, t, SkipTile);
+			continue;
+		}
+
+		intra.clear();
+		quantizeTile(tilePixels, tileReference, width, IntraTile, shift, codes, decoded);
+		encodeTile(codes, intra);
+
+		inter.clear();
+		if (tileReference)
+		{
+			quantizeTile(tilePixels, tileReference, width, InterTile, shift, codes, decoded);
+			encodeTile(codes, inter);
+		}
+
+		const bool isInter = tileReference && inter.size() < intra.size();
+		const std::vector<unsigned char>& tile = isInter ? inter : intra;
+
+		setMode(encoded.data() + 1, t, isInter ? InterTile : IntraTile);
+		encoded.insert(encoded.end(), tile.begin(), tile.end());
+	}
+}
+
+bool FrameCodec::validateFrame(UINT width, UINT height, bool isKeyframe, const unsigned char* encoded, size_t encodedSize)
+{
+	if (width % TileSize != 0 || height % TileSize != 0)
+	{
+		return false;
+	}
+
+	const UINT tileCount = width / TileSize * (height / TileSize);
+	const size_t headerSize = 1 + (tileCount + 3) / 4;
+	if (encodedSize < headerSize || encoded[0] > MaxShift)
+	{
+		return false;
+	}
+
+	const unsigned char* modes = encoded + 1;
+	const unsigned char* p = encoded + headerSize;
+	const unsigned char* end = encoded + encodedSize;
+
+	for (UINT t = 0; t < tileCount; ++t)
+	{
+		const UINT mode = getMode(modes, t);
+		if (isKeyframe && mode != IntraTile)
+		{
+			return false;
+		}
+
+		if (mode == SkipTile)
+		{
+			continue;
+		}
+
+		if (mode != InterTile && mode != IntraTile)
+		{
+			return false;
+		}
+
+		if ((size_t)(end - p) < TileHeaderSize || (size_t)(end - p) - TileHeaderSize < getTileDataSize(p))
+		{
+			return false;
+		}
+		p += TileHeaderSize + getTileDataSize(p);
+	}
+
+	return p == end;
+}
+
+bool FrameCodec::decodeFrame(
+	UINT* pixels,
+	const UINT* reference,
+	UINT width,
+	UINT height,
+	const unsigned char* encoded,
+	size_t encodedSize)
+{
+	if (width % TileSize != 0 || height % TileSize != 0)
+	{
+		return false;
+	}
+
+	const UINT tilesX = width / TileSize;
+	const UINT tileCount = tilesX * (height / TileSize);
+	const size_t headerSize = 1 + (tileCount + 3) / 4;
+	if (encodedSize < headerSize || encoded[0] > MaxShift)
+	{
+		return false;
+	}
+
+	const UINT shift = encoded[0];
+	const unsigned char* modes = encoded + 1;
+	const unsigned char* p = encoded + headerSize;
+	const unsigned char* end = encoded + encodedSize;
+
+	for (UINT t = 0; t < tileCount; ++t)
+	{
+		const size_t tileOffset = (size_t)(t / tilesX) * TileSize * width + (t % tilesX) * TileSize;
+		UINT* tilePixels = pixels + tileOffset;
+		const UINT* tileReference = reference ? reference + tileOffset : nullptr;
+
+		const UINT mode = getMode(modes, t);
+		if (mode == SkipTile)
+		{
+			if (!tileReference)
+			{
+				return false;
+			}
+
+			if (tileReference != tilePixels)
+			{
+				for (UINT y = 0; y < TileSize; ++y)
+				{
+					std::memcpy(tilePixels + y * width, tileReference + y * width, TileSize * sizeof(UINT));
+				}
+			}
+			continue;
+		}
+
+		if ((mode != InterTile && mode != IntraTile) || (mode == InterTile && !tileReference))
+		{
+			return false;
+		}
+
+		if ((size_t)(end - p) < TileHeaderSize)
+		{
+			return false;
+		}
+
+		const unsigned char* header = p;
+		const UINT dataSize = getTileDataSize(header);
+		if ((size_t)(end - p) - TileHeaderSize < dataSize)
+		{
+			return false;
+		}
+
+		decodeTile(tilePixels, tileReference, width, mode, shift, header, header + TileHeaderSize);
+		p += TileHeaderSize + dataSize;
+	}
+
+	return p == end;
+}
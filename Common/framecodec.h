@@ -0,0 +1,58 @@
+﻿#pragma once
+
+#include <vector>
+
+#include "d3dutil.h"
+
+// Codec for frames of R8G8B8A8 animations, built for flipbooks whose
+// consecutive frames differ in only part of the picture.
+//
+// A frame is cut into 8x8 pixel tiles. Each tile is skipped (copied from
+// the reference frame, normally the previous one), coded against the same
+// tile of the reference, or coded on its own as the difference of every
+// pixel to the one left of it, whichever is smaller; keyframes use only the
+// last mode. The byte differences go in groups of 16, four pixels, stored
+// with 0, 2 or 4 bits per byte as zigzag values or as the bytes themselves.
+// Decoding is a few SSE2 operations per group and writes each tile once.
+//
+// With a maxError above zero the differences are quantized to a power of
+// two step of at most 2 * maxError, and tiles within maxError of the
+// reference are skipped, so sensor noise and dithering stop costing bits;
+// every channel of every pixel decodes to within maxError of the source,
+// or within step - 1 next to the ends of the 0..255 range. The encoder
+// predicts from decoded values, so errors do not add up from frame to
+// frame as long as the reference is the decoded previous frame.
+//
+// Width and height must be multiples of TileSize.
+namespace FrameCodec
+{
+	const UINT TileSize = 8;
+
+	// reference is the decoded frame to code against, or nullptr for a
+	// keyframe.
+	void encodeFrame(
+		const UINT* pixels,
+		const UINT* reference,
+		UINT width,
+		UINT height,
+		UINT maxError,
+		std::vector<unsigned char>& encoded
+	);
+
+	// Checks that the tile and group headers of a frame account for exactly
+	// encodedSize bytes, and that a keyframe refers to no reference;
+	// decodeFrame() cannot fail on the frame after it.
+	bool validateFrame(UINT width, UINT height, bool isKeyframe, const unsigned char* encoded, size_t encodedSize);
+
+	// Decodes into pixels, rows of width * 4 bytes. reference must hold the
+	// frame the encoder coded against unless the frame is a keyframe, and
+	// may be pixels itself.
+	bool decodeFrame(
+		UINT* pixels,
+		const UINT* reference,
+		UINT width,
+		UINT height,
+		const unsigned char* encoded,
+		size_t encodedSize
+	);
+}
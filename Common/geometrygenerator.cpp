@@ -1,6 +1,7 @@
 ﻿#include "geometrygenerator.h"
 
 #include "mathhelper.h"
+#include "primitivetables.h"
 using namespace GeometryGenerator;
 
 GeometryGenerator::SVertex::SVertex()
@@ -232,81 +233,23 @@ void GeometryGenerator::createCylinder(float bottomRadius, float topRadius, floa
 
 void GeometryGenerator::createBox(float width, float height, float depth, SMeshData& meshData)
 {
-	SVertex v[24];
-
-	float w2 = 0.5f * width;
-	float h2 = 0.5f * height;
-	float d2 = 0.5f * depth;
-
-	// Fill in the front face vertex data.
-	v[0] = SVertex(-w2, -h2, -d2, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f);
-	v[1] = SVertex(-w2, +h2, -d2, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f);
-	v[2] = SVertex(+w2, +h2, -d2, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f);
-	v[3] = SVertex(+w2, -h2, -d2, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f);
-
-	// Fill in the back face vertex data.
-	v[4] = SVertex(-w2, -h2, +d2, 0.0f, 0.0f, 1.0f, -1.0f, 0.0f, 0.0f, 1.0f, 1.0f);
-	v[5] = SVertex(+w2, -h2, +d2, 0.0f, 0.0f, 1.0f, -1.0f, 0.0f, 0.0f, 0.0f, 1.0f);
-	v[6] = SVertex(+w2, +h2, +d2, 0.0f, 0.0f, 1.0f, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f);
-	v[7] = SVertex(-w2, +h2, +d2, 0.0f, 0.0f, 1.0f, -1.0f, 0.0f, 0.0f, 1.0f, 0.0f);
-
-	// Fill in the top face vertex data.
-	v[8] = SVertex(-w2, +h2, -d2, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f);
-	v[9] = SVertex(-w2, +h2, +d2, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f);
-	v[10] = SVertex(+w2, +h2, +d2, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f);
-	v[11] = SVertex(+w2, +h2, -d2, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f);
-
-	// Fill in the bottom face vertex data.
-	v[12] = SVertex(-w2, -h2, -d2, 0.0f, -1.0f, 0.0f, -1.0f, 0.0f, 0.0f, 1.0f, 1.0f);
-	v[13] = SVertex(+w2, -h2, -d2, 0.0f, -1.0f, 0.0f, -1.0f, 0.0f, 0.0f, 0.0f, 1.0f);
-	v[14] = SVertex(+w2, -h2, +d2, 0.0f, -1.0f, 0.0f, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f);
-	v[15] = SVertex(-w2, -h2, +d2, 0.0f, -1.0f, 0.0f, -1.0f, 0.0f, 0.0f, 1.0f, 0.0f);
-
-	// Fill in the left face vertex data.
-	v[16] = SVertex(-w2, -h2, +d2, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f);
-	v[17] = SVertex(-w2, +h2, +d2, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 0.0f, 0.0f);
-	v[18] = SVertex(-w2, +h2, -d2, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f);
-	v[19] = SVertex(-w2, -h2, -d2, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 1.0f, 1.0f);
-
-	// Fill in the right face vertex data.
-	v[20] = SVertex(+w2, -h2, -d2, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f);
-	v[21] = SVertex(+w2, +h2, -d2, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f);
-	v[22] = SVertex(+w2, +h2, +d2, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f);
-	v[23] = SVertex(+w2, -h2, +d2, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f);
-
-	meshData.m_vertices.assign(&v[0], &v[24]);
-
-	//
-	// Create the indices.
-	//
-
-	UINT i[36];
-
-	// Fill in the front face index data
-	i[0] = 0; i[1] = 1; i[2] = 2;
-	i[3] = 0; i[4] = 2; i[5] = 3;
-
-	// Fill in the back face index data
-	i[6] = 4; i[7] = 5; i[8] = 6;
-	i[9] = 4; i[10] = 6; i[11] = 7;
-
-	// Fill in the top face index data
-	i[12] = 8; i[13] = 9; i[14] = 10;
-	i[15] = 8; i[16] = 10; i[17] = 11;
-
-	// Fill in the bottom face index data
-	i[18] = 12; i[19] = 13; i[20] = 14;
-	i[21] = 12; i[22] = 14; i[23] = 15;
-
-	// Fill in the left face index data
-	i[24] = 16; i[25] = 17; i[26] = 18;
-	i[27] = 16; i[28] = 18; i[29] = 19;
-
-	// Fill in the right face index data
-	i[30] = 20; i[31] = 21; i[32] = 22;
-	i[33] = 20; i[34] = 22; i[35] = 23;
-
-	meshData.m_indices.assign(&i[0], &i[36]);
+	const auto& vertices = PrimitiveTables::BoxVertices;
+	const auto& indices = PrimitiveTables::BoxIndices;
+
+	meshData.m_vertices.resize(vertices.size());
+	for (size_t i = 0; i < vertices.size(); ++i)
+	{
+		const PrimitiveTables::STableVertex& v = vertices[i];
+
+		meshData.m_vertices[i] = SVertex(
+			XMFLOAT3(v.m_position.x * width, v.m_position.y * height, v.m_position.z * depth),
+			v.m_normal,
+			v.m_tangentU,
+			v.m_texC
+		);
+	}
+
+	meshData.m_indices.assign(indices.begin(), indices.end());
 }
 
 void GeometryGenerator::createSphere(float radius, UINT sliceCount, UINT stackCount, SMeshData& meshData)
@@ -457,42 +400,44 @@ void subdivide(SMeshData& meshData)
 	}
 }
 
-void GeometryGenerator::createGeosphere(float radius, UINT numSubdivisions, SMeshData& meshData)
+template<UINT Level>
+void loadGeosphereTable(SMeshData& meshData)
 {
-	numSubdivisions = MathHelper::min(numSubdivisions, 5u);
+	const auto& topology = PrimitiveTables::SGeosphereTable<Level>::Topology;
 
-	const float X = 0.525731f;
-	const float Z = 0.850651f;
-
-	XMFLOAT3 pos[12] = {
-		XMFLOAT3(-X, 0.0f, Z), XMFLOAT3(X, 0.0f, Z),
-		XMFLOAT3(-X, 0.0f, -Z), XMFLOAT3(X, 0.0f, -Z),
-		XMFLOAT3(0.0f, Z, X), XMFLOAT3(0.0f, Z, -X),
-		XMFLOAT3(0.0f, -Z, X), XMFLOAT3(0.0f, -Z, -X),
-		XMFLOAT3(Z, X, 0.0f), XMFLOAT3(-Z, X, 0.0f),
-		XMFLOAT3(Z, -X, 0.0f), XMFLOAT3(-Z, -X, 0.0f),
-	};
-
-	DWORD k[60] = {
-		1,4,0, 4,9,0, 4,5,9, 8,5,4, 1,8,4,
-		1,10,8, 10,3,8, 8,3,5, 3,2,5, 3,7,2,
-		3,10,7, 10,6,7, 6,11,7, 6,0,11, 6,1,0,
-		10,1,6, 11,0,9, 2,11,9, 5,2,9, 11,2,7,
-	};
-
-	meshData.m_vertices.resize(12);
-	meshData.m_indices.resize(60);
-
-	for (size_t i = 0; i < 12; ++i)
+	meshData.m_vertices.resize(topology.m_positions.size());
+	for (size_t i = 0; i < topology.m_positions.size(); ++i)
 	{
-		meshData.m_vertices[i].m_position = pos[i];
+		meshData.m_vertices[i].m_position = topology.m_positions[i];
 	}
-	for (size_t i = 0; i < 60; ++i)
+
+	meshData.m_indices.assign(topology.m_indices.begin(), topology.m_indices.end());
+}
+
+void GeometryGenerator::createGeosphere(float radius, UINT numSubdivisions, SMeshData& meshData)
+{
+	numSubdivisions = MathHelper::min(numSubdivisions, 5u);
+
+	// Levels up to MaxGeosphereLevel come straight from the compile time
+	// tables; deeper ones continue subdividing from the last table.
+	const UINT tableLevel = MathHelper::min(numSubdivisions, PrimitiveTables::MaxGeosphereLevel);
+	switch (tableLevel)
 	{
-		meshData.m_indices[i] = k[i];
+	case 0:
+		loadGeosphereTable<0>(meshData);
+		break;
+	case 1:
+		loadGeosphereTable<1>(meshData);
+		break;
+	case 2:
+		loadGeosphereTable<2>(meshData);
+		break;
+	default:
+		loadGeosphereTable<3>(meshData);
+		break;
 	}
 
-	for (size_t i = 0; i < numSubdivisions; ++i)
+	for (size_t i = tableLevel; i < numSubdivisions; ++i)
 	{
 		subdivide(meshData);
 	}
@@ -0,0 +1,166 @@
+﻿#include "mappedfile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+CMappedFile::CMappedFile() :
+	m_file(INVALID_HANDLE_VALUE),
+	m_mapping(nullptr),
+	m_data(nullptr),
+	m_size(0)
+{
+
+}
+
+#else
+
+CMappedFile::CMappedFile() :
+	m_file(-1),
+	m_data(nullptr),
+	m_size(0)
+{
+
+}
+
+#endif
+
+CMappedFile::~CMappedFile()
+{
+	close();
+}
+
+bool CMappedFile::isOpen() const
+{
+	return m_data != nullptr;
+}
+
+const unsigned char* CMappedFile::getData() const
+{
+	return m_data;
+}
+
+size_t CMappedFile::getSize() const
+{
+	return m_size;
+}
+
+#ifdef _WIN32
+
+bool CMappedFile::open(const std::string& path)
+{
+	close();
+
+	m_file = CreateFileA(
+		path.c_str(),
+		GENERIC_READ,
+		FILE_SHARE_READ,
+		nullptr,
+		OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+		nullptr
+	);
+	if (m_file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(m_file, &size) || size.QuadPart == 0)
+	{
+		close();
+		return false;
+	}
+
+	m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!m_mapping)
+	{
+		close();
+		return false;
+	}
+
+	m_data = static_cast<const unsigned char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+	if (!m_data)
+	{
+		close();
+		return false;
+	}
+
+	m_size = (size_t)size.QuadPart;
+	return true;
+}
+
+void CMappedFile::close()
+{
+	if (m_data)
+	{
+		UnmapViewOfFile(m_data);
+		m_data = nullptr;
+	}
+	if (m_mapping)
+	{
+		CloseHandle(m_mapping);
+		m_mapping = nullptr;
+	}
+	if (m_file != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_file);
+		m_file = INVALID_HANDLE_VALUE;
+	}
+	m_size = 0;
+}
+
+#else
+
+bool CMappedFile::open(const std::string& path)
+{
+	close();
+
+	m_file = ::open(path.c_str(), O_RDONLY);
+	if (m_file < 0)
+	{
+		return false;
+	}
+
+	struct stat info;
+	if (fstat(m_file, &info) != 0 || info.st_size == 0)
+	{
+		close();
+		return false;
+	}
+
+	void* data = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, m_file, 0);
+	if (data == MAP_FAILED)
+	{
+		close();
+		return false;
+	}
+
+	m_data = static_cast<const unsigned char*>(data);
+	m_size = (size_t)info.st_size;
+	return true;
+}
+
+void CMappedFile::close()
+{
+	if (m_data)
+	{
+		munmap(const_cast<unsigned char*>(m_data), m_size);
+		m_data = nullptr;
+	}
+	if (m_file >= 0)
+	{
+		::close(m_file);
+		m_file = -1;
+	}
+	m_size = 0;
+}
+
+#endif
@@ -0,0 +1,35 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Read-only mapping of a whole file into memory. The pages are loaded on
+// first access and shared with the file cache, so nothing is copied until
+// the data is read; the pointer stays valid until close() or destruction.
+class CMappedFile
+{
+public:
+	CMappedFile();
+	~CMappedFile();
+
+	CMappedFile(const CMappedFile&) = delete;
+	CMappedFile& operator=(const CMappedFile&) = delete;
+
+	// Fails for missing or empty files.
+	bool open(const std::string& path);
+	void close();
+
+	bool isOpen() const;
+	const unsigned char* getData() const;
+	size_t getSize() const;
+
+private:
+#ifdef _WIN32
+	void* m_file;
+	void* m_mapping;
+#else
+	int m_file;
+#endif
+	const unsigned char* m_data;
+	size_t m_size;
+};
@@ -0,0 +1,300 @@
+﻿#include "meshcache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include "fileutil.h"
+
+namespace
+{
+	const char DiskMagic[4] = { 'M', 'S', 'H', 'C' };
+
+	// Bump when a generator changes its output so stale files are ignored.
+	const UINT GeneratorVersion = 1;
+
+	struct SDiskHeader
+	{
+		char m_magic[4];
+		UINT m_version;
+		UINT m_vertexSize;
+		UINT m_vertexCount;
+		UINT m_indexCount;
+	};
+
+	// Keys use the exact bit patterns of the float parameters, so two
+	// requests share a mesh only if they would generate identical data.
+	void appendParam(std::string& key, float value)
+	{
+		UINT bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+
+		char buffer[16];
+		std::snprintf(buffer, sizeof(buffer), "_%08x", bits);
+		key += buffer;
+	}
+
+	void appendParam(std::string& key, UINT value)
+	{
+		char buffer[16];
+		std::snprintf(buffer, sizeof(buffer), "_%u", value);
+		key += buffer;
+	}
+}
+
+CMeshCache::CMeshCache() :
+	m_hitCount(0),
+	m_diskHitCount(0),
+	m_missCount(0)
+{
+
+}
+
+CMeshCache& CMeshCache::getShared()
+{
+	static CMeshCache cache;
+	return cache;
+}
+
+void CMeshCache::setDiskCacheDirectory(const std::string& directory)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_diskCacheDirectory = directory;
+}
+
+CMeshCache::MeshPtr CMeshCache::getGrid(float width, float depth, UINT m, UINT n)
+{
+	std::string key = "grid";
+	appendParam(key, width);
+	appendParam(key, depth);
+	appendParam(key, m);
+	appendParam(key, n);
+
+	return getOrCreate(key, [=](GeometryGenerator::SMeshData& meshData)
+	{
+		GeometryGenerator::createGrid(width, depth, m, n, meshData);
+	});
+}
+
+CMeshCache::MeshPtr CMeshCache::getCylinder(float bottomRadius, float topRadius, float height, UINT sliceCount, UINT stackCount)
+{
+	std::string key = "cylinder";
+	appendParam(key, bottomRadius);
+	appendParam(key, topRadius);
+	appendParam(key, height);
+	appendParam(key, sliceCount);
+	appendParam(key, stackCount);
+
+	return getOrCreate(key, [=](GeometryGenerator::SMeshData& meshData)
+	{
+		GeometryGenerator::createCylinder(bottomRadius, topRadius, height, sliceCount, stackCount, meshData);
+	});
+}
+
+CMeshCache::MeshPtr CMeshCache::getBox(float width, float height, float depth)
+{
+	std::string key = "box";
+	appendParam(key, width);
+	appendParam(key, height);
+	appendParam(key, depth);
+
+	return getOrCreate(key, [=](GeometryGenerator::SMeshData& meshData)
+	{
+		GeometryGenerator::createBox(width, height, depth, meshData);
+	});
+}
+
+CMeshCache::MeshPtr CMeshCache::getSphere(float radius, UINT sliceCount, UINT stackCount)
+{
+	std::string key = "sphere";
+	appendParam(key, radius);
+	appendParam(key, sliceCount);
+	appendParam(key, stackCount);
+
+	return getOrCreate(key, [=](GeometryGenerator::SMeshData& meshData)
+	{
+		GeometryGenerator::createSphere(radius, sliceCount, stackCount, meshData);
+	});
+}
+
+CMeshCache::MeshPtr CMeshCache::getGeosphere(float radius, UINT numSubdivisions)
+{
+	std::string key = "geosphere";
+	appendParam(key, radius);
+	appendParam(key, numSubdivisions);
+
+	return getOrCreate(key, [=](GeometryGenerator::SMeshData& meshData)
+	{
+		GeometryGenerator::createGeosphere(radius, numSubdivisions, meshData);
+	});
+}
+
+void CMeshCache::clear()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_meshes.clear();
+}
+
+UINT CMeshCache::getHitCount() const
+{
+	return m_hitCount;
+}
+
+UINT CMeshCache::getDiskHitCount() const
+{
+	return m_diskHitCount;
+}
+
+UINT CMeshCache::getMissCount() const
+{
+	return m_missCount;
+}
+
+CMeshCache::MeshPtr CMeshCache::getOrCreate(const std::string& key, const Generator& generate)
+{
+	std::promise<MeshPtr> promise;
+	std::shared_future<MeshPtr> pending;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		auto it = m_meshes.find(key);
+		if (it != m_meshes.end())
+		{
+			pending = it->second;
+		}
+		else
+		{
+			m_meshes.emplace(key, promise.get_future().share());
+		}
+	}
+
+	// Wait without the lock; the generating thread needs it.
+	if (pending.valid())
+	{
+		++m_hitCount;
+		return pending.get();
+	}
+
+	// Generate outside the lock so other keys are not held up.
+	try
+	{
+		auto meshData = std::make_shared<GeometryGenerator::SMeshData>();
+		if (loadFromDisk(key, *meshData))
+		{
+			++m_diskHitCount;
+		}
+		else
+		{
+			++m_missCount;
+			generate(*meshData);
+			saveToDisk(key, *meshData);
+		}
+
+		MeshPtr mesh = meshData;
+		promise.set_value(mesh);
+		return mesh;
+	}
+	catch (...)
+	{
+		promise.set_exception(std::current_exception());
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_meshes.erase(key);
+		throw;
+	}
+}
+
+bool CMeshCache::loadFromDisk(const std::string& key, GeometryGenerator::SMeshData& meshData) const
+{
+	std::string path = getDiskPath(key);
+	if (path.empty())
+	{
+		return false;
+	}
+
+	std::ifstream fin(path, std::ios::binary | std::ios::ate);
+	if (!fin)
+	{
+		return false;
+	}
+	const unsigned long long fileSize = (unsigned long long)fin.tellg();
+	fin.seekg(0);
+
+	SDiskHeader header;
+	if (!fin.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+		std::memcmp(header.m_magic, DiskMagic, sizeof(DiskMagic)) != 0 ||
+		header.m_version != GeneratorVersion ||
+		header.m_vertexSize != sizeof(GeometryGenerator::SVertex))
+	{
+		return false;
+	}
+
+	// The counts are checked against the file before anything is allocated,
+	// so a damaged or foreign file falls back to generating the mesh.
+	const unsigned long long vertexBytes = (unsigned long long)header.m_vertexCount * sizeof(GeometryGenerator::SVertex);
+	const unsigned long long indexBytes = (unsigned long long)header.m_indexCount * sizeof(UINT);
+	if (sizeof(header) + vertexBytes + indexBytes != fileSize)
+	{
+		return false;
+	}
+
+	meshData.m_vertices.resize(header.m_vertexCount);
+	meshData.m_indices.resize(header.m_indexCount);
+
+	fin.read(reinterpret_cast<char*>(meshData.m_vertices.data()), (std::streamsize)vertexBytes);
+	fin.read(reinterpret_cast<char*>(meshData.m_indices.data()), (std::streamsize)indexBytes);
+
+	if (!fin)
+	{
+		meshData.m_vertices.clear();
+		meshData.m_indices.clear();
+		return false;
+	}
+
+	return true;
+}
+
+void CMeshCache::saveToDisk(const std::string& key, const GeometryGenerator::SMeshData& meshData) const
+{
+	std::string path = getDiskPath(key);
+	if (path.empty())
+	{
+		return;
+	}
+
+	SDiskHeader header;
+	std::memcpy(header.m_magic, DiskMagic, sizeof(DiskMagic));
+	header.m_version = GeneratorVersion;
+	header.m_vertexSize = sizeof(GeometryGenerator::SVertex);
+	header.m_vertexCount = (UINT)meshData.m_vertices.size();
+	header.m_indexCount = (UINT)meshData.m_indices.size();
+
+	const size_t vertexSize = sizeof(GeometryGenerator::SVertex) * header.m_vertexCount;
+	const size_t indexSize = sizeof(UINT) * header.m_indexCount;
+	std::vector<char> image(sizeof(header) + vertexSize + indexSize);
+	std::memcpy(image.data(), &header, sizeof(header));
+	if (vertexSize != 0)
+	{
+		std::memcpy(image.data() + sizeof(header), meshData.m_vertices.data(), vertexSize);
+	}
+	if (indexSize != 0)
+	{
+		std::memcpy(image.data() + sizeof(header) + vertexSize, meshData.m_indices.data(), indexSize);
+	}
+
+	// Failing to write only costs a regeneration next time; another process
+	// reading the cache never sees a partially written file.
+	FileUtil::writeFile(path, image.data(), image.size());
+}
+
+std::string CMeshCache::getDiskPath(const std::string& key) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_diskCacheDirectory.empty())
+	{
+		return std::string();
+	}
+
+	return m_diskCacheDirectory + "/" + key + ".mesh";
+}
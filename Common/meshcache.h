@@ -0,0 +1,62 @@
+﻿#pragma once
+
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "geometrygenerator.h"
+
+// Hands out generated primitives keyed by generator and parameters. Meshes
+// are immutable once created and shared between all callers, so scenes that
+// ask for the same primitive get the same data without regenerating it.
+// All methods may be called from any thread; concurrent requests for a mesh
+// that is still being generated wait for the first one instead of
+// generating it again.
+class CMeshCache
+{
+public:
+	typedef std::shared_ptr<const GeometryGenerator::SMeshData> MeshPtr;
+
+	CMeshCache();
+
+	// Process wide cache shared by all scenes.
+	static CMeshCache& getShared();
+
+	// Meshes missing from memory are looked up in, and after generation
+	// written to, this directory. An empty path disables the disk cache.
+	void setDiskCacheDirectory(const std::string& directory);
+
+	MeshPtr getGrid(float width, float depth, UINT m, UINT n);
+	MeshPtr getCylinder(float bottomRadius, float topRadius, float height, UINT sliceCount, UINT stackCount);
+	MeshPtr getBox(float width, float height, float depth);
+	MeshPtr getSphere(float radius, UINT sliceCount, UINT stackCount);
+	MeshPtr getGeosphere(float radius, UINT numSubdivisions);
+
+	// Drops the in-memory meshes; callers still holding one keep it alive.
+	void clear();
+
+	UINT getHitCount() const;
+	UINT getDiskHitCount() const;
+	UINT getMissCount() const;
+
+private:
+	typedef std::function<void(GeometryGenerator::SMeshData&)> Generator;
+
+	MeshPtr getOrCreate(const std::string& key, const Generator& generate);
+
+	bool loadFromDisk(const std::string& key, GeometryGenerator::SMeshData& meshData) const;
+	void saveToDisk(const std::string& key, const GeometryGenerator::SMeshData& meshData) const;
+	std::string getDiskPath(const std::string& key) const;
+
+	mutable std::mutex m_mutex;
+	std::unordered_map<std::string, std::shared_future<MeshPtr>> m_meshes;
+	std::string m_diskCacheDirectory;
+
+	std::atomic<UINT> m_hitCount;
+	std::atomic<UINT> m_diskHitCount;
+	std::atomic<UINT> m_missCount;
+};
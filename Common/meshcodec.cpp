@@ -0,0 +1,753 @@
+﻿#include "meshcodec.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	const unsigned char VertexCodecTag = 0xA1;
+	const unsigned char IndexCodecTag = 0xE1;
+
+	const UINT GroupSize = 16;
+	const UINT MaxBlockVertexCount = 256;
+
+	// Planes of a block are decoded into a scratch buffer of at most this
+	// size before they are interleaved, so it stays in the L1 cache.
+	const UINT MaxBlockPlaneSize = 8192;
+
+	// Edges and vertices searched when coding a triangle; the edge index and
+	// the vertex index each fit in a nibble of the code byte.
+	const UINT FifoSize = 16;
+	const UINT EdgeSearchCount = 15;
+	const UINT VertexSearchCount = 13;
+
+	// Low nibble of an edge code, and first value of a vertex reference, for
+	// a vertex given as a delta to the last explicit one.
+	const unsigned char ExplicitVertex = 15;
+	const UINT ExplicitReference = 14;
+
+	// High nibble of a triangle that shares no edge with the FIFO.
+	const unsigned char FreeTriangle = 0xF0;
+
+	UINT getBlockVertexCount(UINT vertexSize)
+	{
+		const UINT count = (MaxBlockPlaneSize / vertexSize) & ~(GroupSize - 1);
+		return std::min(std::max(count, GroupSize), MaxBlockVertexCount);
+	}
+
+	inline unsigned char zigzag(unsigned char delta)
+	{
+		return (unsigned char)((delta << 1) ^ (unsigned char)((signed char)delta >> 7));
+	}
+
+	inline unsigned char unzigzag(unsigned char value)
+	{
+		return (unsigned char)((value >> 1) ^ (unsigned char)(0 - (value & 1)));
+	}
+
+	// Bits per byte for each of the four group modes.
+	const UINT ModeBits[4] = { 0, 2, 4, 8 };
+
+	// Groups whose deltas need all 8 bits are stored as the bytes themselves,
+	// which decode with a plain copy.
+	void encodeGroup(const unsigned char* bytes, const unsigned char* values, std::vector<unsigned char>& data, UINT& mode)
+	{
+		unsigned char maxValue = 0;
+		for (UINT i = 0; i < GroupSize; ++i)
+		{
+			maxValue |= values[i];
+		}
+
+		mode = maxValue == 0 ? 0 : maxValue < 4 ? 1 : maxValue < 16 ? 2 : 3;
+
+		const UINT bits = ModeBits[mode];
+		if (bits == 8)
+		{
+			data.insert(data.end(), bytes, bytes + GroupSize);
+		}
+		else if (bits != 0)
+		{
+			// Earlier values go to the higher bits of a byte.
+			const UINT valuesPerByte = 8 / bits;
+			for (UINT i = 0; i < GroupSize; i += valuesPerByte)
+			{
+				unsigned char byte = 0;
+				for (UINT j = 0; j < valuesPerByte; ++j)
+				{
+					byte = (unsigned char)((byte << bits) | values[i + j]);
+				}
+				data.push_back(byte);
+			}
+		}
+	}
+
+#if defined(_XM_SSE_INTRINSICS_)
+	// Unpacks one group of zigzag deltas, undoes the zigzag and sums the
+	// deltas up onto previous. Returns the last value of the group.
+	inline unsigned char decodeGroup(const unsigned char* data, UINT mode, unsigned char previous, unsigned char* output)
+	{
+		const __m128i lowNibbles = _mm_set1_epi8(0x0F);
+		const __m128i lowPairs = _mm_set1_epi8(0x03);
+
+		if (mode == 3)
+		{
+			std::memcpy(output, data, GroupSize);
+			return data[GroupSize - 1];
+		}
+
+		__m128i values;
+		switch (mode)
+		{
+		case 0:
+			values = _mm_setzero_si128();
+			break;
+		case 1:
+		{
+			int packed;
+			std::memcpy(&packed, data, sizeof(packed));
+			const __m128i x = _mm_cvtsi32_si128(packed);
+			const __m128i a = _mm_and_si128(_mm_srli_epi16(x, 6), lowPairs);
+			const __m128i b = _mm_and_si128(_mm_srli_epi16(x, 4), lowPairs);
+			const __m128i c = _mm_and_si128(_mm_srli_epi16(x, 2), lowPairs);
+			const __m128i d = _mm_and_si128(x, lowPairs);
+			values = _mm_unpacklo_epi16(_mm_unpacklo_epi8(a, b), _mm_unpacklo_epi8(c, d));
+			break;
+		}
+		default:
+		{
+			const __m128i x = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(data));
+			const __m128i high = _mm_and_si128(_mm_srli_epi16(x, 4), lowNibbles);
+			const __m128i low = _mm_and_si128(x, lowNibbles);
+			values = _mm_unpacklo_epi8(high, low);
+			break;
+		}
+		}
+
+		const __m128i sign = _mm_sub_epi8(_mm_setzero_si128(), _mm_and_si128(values, _mm_set1_epi8(1)));
+		const __m128i half = _mm_and_si128(_mm_srli_epi16(values, 1), _mm_set1_epi8(0x7F));
+		__m128i deltas = _mm_xor_si128(half, sign);
+
+		// Inclusive prefix sum in four shifted adds.
+		deltas = _mm_add_epi8(deltas, _mm_slli_si128(deltas, 1));
+		deltas = _mm_add_epi8(deltas, _mm_slli_si128(deltas, 2));
+		deltas = _mm_add_epi8(deltas, _mm_slli_si128(deltas, 4));
+		deltas = _mm_add_epi8(deltas, _mm_slli_si128(deltas, 8));
+		deltas = _mm_add_epi8(deltas, _mm_set1_epi8((char)previous));
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(output), deltas);
+		return (unsigned char)(_mm_extract_epi16(deltas, 7) >> 8);
+	}
+#else
+	inline unsigned char decodeGroup(const unsigned char* data, UINT mode, unsigned char previous, unsigned char* output)
+	{
+		if (mode == 3)
+		{
+			std::memcpy(output, data, GroupSize);
+			return data[GroupSize - 1];
+		}
+
+		const UINT bits = ModeBits[mode];
+		for (UINT i = 0; i < GroupSize; ++i)
+		{
+			unsigned char value = 0;
+			if (bits != 0)
+			{
+				const UINT valuesPerByte = 8 / bits;
+				const UINT shift = (valuesPerByte - 1 - i % valuesPerByte) * bits;
+				value = (unsigned char)((data[i / valuesPerByte] >> shift) & ((1 << bits) - 1));
+			}
+
+			previous = (unsigned char)(previous + unzigzag(value));
+			output[i] = previous;
+		}
+		return previous;
+	}
+#endif
+
+#if defined(_XM_SSE_INTRINSICS_)
+	// Gathers the 4-byte word starting at byte k of sixteen vertices from
+	// four planes; quads[q] holds the word of vertices 4q to 4q + 3.
+	inline void loadWordQuads(const unsigned char* planes, UINT planeStride, UINT k, __m128i quads[4])
+	{
+		const __m128i p0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes + (k + 0) * planeStride));
+		const __m128i p1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes + (k + 1) * planeStride));
+		const __m128i p2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes + (k + 2) * planeStride));
+		const __m128i p3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes + (k + 3) * planeStride));
+
+		const __m128i p01Low = _mm_unpacklo_epi8(p0, p1);
+		const __m128i p23Low = _mm_unpacklo_epi8(p2, p3);
+		const __m128i p01High = _mm_unpackhi_epi8(p0, p1);
+		const __m128i p23High = _mm_unpackhi_epi8(p2, p3);
+
+		quads[0] = _mm_unpacklo_epi16(p01Low, p23Low);
+		quads[1] = _mm_unpackhi_epi16(p01Low, p23Low);
+		quads[2] = _mm_unpacklo_epi16(p01High, p23High);
+		quads[3] = _mm_unpackhi_epi16(p01High, p23High);
+	}
+#endif
+
+	// Writes vertex v of the block from byte k of plane k.
+	void interleaveBlock(
+		const unsigned char* planes,
+		UINT planeStride,
+		UINT blockVertexCount,
+		UINT vertexSize,
+		unsigned char* vertices)
+	{
+		UINT begin = 0;
+
+#if defined(_XM_SSE_INTRINSICS_)
+		// Sixteen vertices at a time. Four words of four vertices are
+		// transposed into 16 bytes of each vertex; the words left over at
+		// the end of a vertex are stored one by one.
+		if (vertexSize % 4 == 0)
+		{
+			for (; begin + GroupSize <= blockVertexCount; begin += GroupSize)
+			{
+				const unsigned char* blockPlanes = planes + begin;
+				unsigned char* output = vertices + begin * vertexSize;
+
+				UINT k = 0;
+				for (; k + 16 <= vertexSize; k += 16)
+				{
+					__m128i words[4][4];
+					for (UINT w = 0; w < 4; ++w)
+					{
+						loadWordQuads(blockPlanes, planeStride, k + w * 4, words[w]);
+					}
+
+					for (UINT q = 0; q < 4; ++q)
+					{
+						const __m128i t0 = _mm_unpacklo_epi32(words[0][q], words[1][q]);
+						const __m128i t1 = _mm_unpacklo_epi32(words[2][q], words[3][q]);
+						const __m128i t2 = _mm_unpackhi_epi32(words[0][q], words[1][q]);
+						const __m128i t3 = _mm_unpackhi_epi32(words[2][q], words[3][q]);
+
+						unsigned char* row = output + q * 4 * vertexSize + k;
+						_mm_storeu_si128(reinterpret_cast<__m128i*>(row), _mm_unpacklo_epi64(t0, t1));
+						_mm_storeu_si128(reinterpret_cast<__m128i*>(row + vertexSize), _mm_unpackhi_epi64(t0, t1));
+						_mm_storeu_si128(reinterpret_cast<__m128i*>(row + 2 * vertexSize), _mm_unpacklo_epi64(t2, t3));
+						_mm_storeu_si128(reinterpret_cast<__m128i*>(row + 3 * vertexSize), _mm_unpackhi_epi64(t2, t3));
+					}
+				}
+
+				for (; k < vertexSize; k += 4)
+				{
+					__m128i quads[4];
+					loadWordQuads(blockPlanes, planeStride, k, quads);
+
+					unsigned char* row = output + k;
+					for (UINT q = 0; q < 4; ++q)
+					{
+						__m128i quad = quads[q];
+						for (UINT j = 0; j < 4; ++j)
+						{
+							const int word = _mm_cvtsi128_si32(quad);
+							std::memcpy(row, &word, sizeof(word));
+							row += vertexSize;
+							quad = _mm_srli_si128(quad, 4);
+						}
+					}
+				}
+			}
+		}
+#endif
+
+		for (UINT v = begin; v < blockVertexCount; ++v)
+		{
+			for (UINT k = 0; k < vertexSize; ++k)
+			{
+				vertices[v * vertexSize + k] = planes[k * planeStride + v];
+			}
+		}
+	}
+
+	void writeVarint(std::vector<unsigned char>& data, UINT value)
+	{
+		while (value >= 0x80)
+		{
+			data.push_back((unsigned char)(value | 0x80));
+			value >>= 7;
+		}
+		data.push_back((unsigned char)value);
+	}
+
+	inline bool readVarint(const unsigned char*& p, const unsigned char* end, UINT& value)
+	{
+		value = 0;
+		for (UINT shift = 0; shift < 35; shift += 7)
+		{
+			if (p == end)
+			{
+				return false;
+			}
+
+			const unsigned char byte = *p++;
+			value |= (UINT)(byte & 0x7F) << shift;
+			if (byte < 0x80)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	inline UINT zigzag32(int value)
+	{
+		return ((UINT)value << 1) ^ (UINT)(value >> 31);
+	}
+
+	inline int unzigzag32(UINT value)
+	{
+		return (int)(value >> 1) ^ -(int)(value & 1);
+	}
+
+	// Encoder and decoder walk the triangles with the same state, so every
+	// push and lookup below has to happen in the same order on both sides.
+	struct SIndexState
+	{
+		UINT m_edges[FifoSize][2];
+		UINT m_edgeOffset;
+		UINT m_vertices[FifoSize];
+		UINT m_vertexOffset;
+		UINT m_next;
+		UINT m_last;
+
+		SIndexState() :
+			m_edgeOffset(0),
+			m_vertexOffset(0),
+			m_next(0),
+			m_last(0)
+		{
+			// Never matched by a lookup, as no triangle repeats a vertex in
+			// an edge and no reference can reach past the pushed entries.
+			std::memset(m_edges, 0xFF, sizeof(m_edges));
+			std::memset(m_vertices, 0xFF, sizeof(m_vertices));
+		}
+
+		int findEdge(UINT a, UINT b) const
+		{
+			for (UINT i = 0; i < EdgeSearchCount; ++i)
+			{
+				const UINT slot = (m_edgeOffset - 1 - i) & (FifoSize - 1);
+				if (m_edges[slot][0] == a && m_edges[slot][1] == b)
+				{
+					return (int)i;
+				}
+			}
+			return -1;
+		}
+
+		int findVertex(UINT v) const
+		{
+			for (UINT i = 0; i < VertexSearchCount; ++i)
+			{
+				if (m_vertices[(m_vertexOffset - 1 - i) & (FifoSize - 1)] == v)
+				{
+					return (int)i;
+				}
+			}
+			return -1;
+		}
+
+		void pushEdge(UINT a, UINT b)
+		{
+			m_edges[m_edgeOffset][0] = a;
+			m_edges[m_edgeOffset][1] = b;
+			m_edgeOffset = (m_edgeOffset + 1) & (FifoSize - 1);
+		}
+
+		void pushVertex(UINT v)
+		{
+			m_vertices[m_vertexOffset] = v;
+			m_vertexOffset = (m_vertexOffset + 1) & (FifoSize - 1);
+		}
+	};
+
+	// A vertex of a free triangle: 0 for the next new vertex, 1 + i for
+	// entry i of the vertex FIFO, ExplicitReference + zigzag delta otherwise.
+	// decodeTriangles() reads them back.
+	void encodeReference(SIndexState& state, UINT v, std::vector<unsigned char>& data)
+	{
+		if (v == state.m_next)
+		{
+			++state.m_next;
+			state.pushVertex(v);
+			writeVarint(data, 0);
+			return;
+		}
+
+		const int fifoIndex = state.findVertex(v);
+		if (fifoIndex >= 0)
+		{
+			writeVarint(data, 1 + (UINT)fifoIndex);
+			return;
+		}
+
+		writeVarint(data, ExplicitReference + zigzag32((int)(v - state.m_last)));
+		state.m_last = v;
+		state.pushVertex(v);
+	}
+
+	// Mirrors SIndexState with the offsets and counters in locals, so they
+	// stay in registers; only the FIFOs themselves live in memory.
+	template<class TIndex>
+	bool decodeTriangles(
+		TIndex* indices,
+		UINT triangleCount,
+		UINT vertexCount,
+		const unsigned char* codes,
+		const unsigned char* p,
+		const unsigned char* end)
+	{
+		UINT edgeA[FifoSize];
+		UINT edgeB[FifoSize];
+		UINT vertices[FifoSize];
+		std::memset(edgeA, 0xFF, sizeof(edgeA));
+		std::memset(edgeB, 0xFF, sizeof(edgeB));
+		std::memset(vertices, 0xFF, sizeof(vertices));
+
+		UINT edgeOffset = 0;
+		UINT vertexOffset = 0;
+		UINT next = 0;
+		UINT last = 0;
+
+		for (UINT t = 0; t < triangleCount; ++t)
+		{
+			const unsigned char code = codes[t];
+			UINT a;
+			UINT b;
+			UINT c;
+
+			if ((code & 0xF0) != FreeTriangle)
+			{
+				const UINT edge = (edgeOffset - 1 - (code >> 4)) & (FifoSize - 1);
+				a = edgeA[edge];
+				b = edgeB[edge];
+
+				const UINT vertexCode = code & 0x0F;
+				if (vertexCode == ExplicitVertex)
+				{
+					UINT delta;
+					if (!readVarint(p, end, delta))
+					{
+						return false;
+					}
+					c = last + (UINT)unzigzag32(delta);
+					last = c;
+					vertices[vertexOffset] = c;
+					vertexOffset = (vertexOffset + 1) & (FifoSize - 1);
+				}
+				else if (vertexCode <= VertexSearchCount)
+				{
+					// The next new vertex and FIFO hits come in no particular
+					// order, so they are told apart without a branch. The
+					// slot written for a hit is the oldest one, which no
+					// reference reaches.
+					const UINT isNew = vertexCode == 0;
+					const UINT newMask = 0 - isNew;
+					const UINT hit = vertices[(vertexOffset - vertexCode) & (FifoSize - 1)];
+					c = (next & newMask) | (hit & ~newMask);
+					next += isNew;
+					vertices[vertexOffset] = c;
+					vertexOffset = (vertexOffset + isNew) & (FifoSize - 1);
+				}
+				else
+				{
+					return false;
+				}
+
+				edgeA[edgeOffset] = c;
+				edgeB[edgeOffset] = b;
+				edgeA[(edgeOffset + 1) & (FifoSize - 1)] = a;
+				edgeB[(edgeOffset + 1) & (FifoSize - 1)] = c;
+				edgeOffset = (edgeOffset + 2) & (FifoSize - 1);
+			}
+			else
+			{
+				UINT triangle[3];
+				for (UINT j = 0; j < 3; ++j)
+				{
+					UINT reference;
+					if (!readVarint(p, end, reference))
+					{
+						return false;
+					}
+
+					if (reference == 0)
+					{
+						triangle[j] = next++;
+					}
+					else if (reference < ExplicitReference)
+					{
+						triangle[j] = vertices[(vertexOffset - reference) & (FifoSize - 1)];
+						continue;
+					}
+					else
+					{
+						triangle[j] = last + (UINT)unzigzag32(reference - ExplicitReference);
+						last = triangle[j];
+					}
+
+					vertices[vertexOffset] = triangle[j];
+					vertexOffset = (vertexOffset + 1) & (FifoSize - 1);
+				}
+
+				a = triangle[0];
+				b = triangle[1];
+				c = triangle[2];
+
+				const UINT pushedA[3] = { b, c, a };
+				const UINT pushedB[3] = { a, b, c };
+				for (UINT j = 0; j < 3; ++j)
+				{
+					edgeA[edgeOffset] = pushedA[j];
+					edgeB[edgeOffset] = pushedB[j];
+					edgeOffset = (edgeOffset + 1) & (FifoSize - 1);
+				}
+			}
+
+			// Also catches FIFO slots never written, and indices too large
+			// for TIndex, as vertexCount fits it.
+			if (a >= vertexCount || b >= vertexCount || c >= vertexCount)
+			{
+				return false;
+			}
+
+			indices[t * 3 + 0] = (TIndex)a;
+			indices[t * 3 + 1] = (TIndex)b;
+			indices[t * 3 + 2] = (TIndex)c;
+		}
+
+		return p == end;
+	}
+}
+
+void MeshCodec::encodeVertexBuffer(
+	const void* vertices,
+	UINT vertexCount,
+	UINT vertexSize,
+	std::vector<unsigned char>& encoded)
+{
+	const unsigned char* source = static_cast<const unsigned char*>(vertices);
+	const UINT blockVertexCount = getBlockVertexCount(vertexSize);
+
+	encoded.clear();
+	encoded.push_back(VertexCodecTag);
+
+	std::vector<unsigned char> previous(vertexSize, 0);
+	std::vector<unsigned char> bytes(MaxBlockVertexCount);
+	std::vector<unsigned char> values(MaxBlockVertexCount);
+	std::vector<unsigned char> headers;
+	std::vector<unsigned char> data;
+
+	for (UINT blockBegin = 0; blockBegin < vertexCount; blockBegin += blockVertexCount)
+	{
+		const UINT count = std::min(blockVertexCount, vertexCount - blockBegin);
+		const UINT groupCount = (count + GroupSize - 1) / GroupSize;
+
+		for (UINT k = 0; k < vertexSize; ++k)
+		{
+			// Padding repeats the last byte, so its deltas are zero.
+			unsigned char last = previous[k];
+			for (UINT i = 0; i < groupCount * GroupSize; ++i)
+			{
+				const unsigned char byte = i < count ? source[(blockBegin + i) * vertexSize + k] : last;
+				bytes[i] = byte;
+				values[i] = zigzag((unsigned char)(byte - last));
+				last = byte;
+			}
+			previous[k] = last;
+
+			headers.assign((groupCount + 3) / 4, 0);
+			data.clear();
+			for (UINT g = 0; g < groupCount; ++g)
+			{
+				UINT mode;
+				encodeGroup(&bytes[g * GroupSize], &values[g * GroupSize], data, mode);
+				headers[g / 4] |= (unsigned char)(mode << (g % 4 * 2));
+			}
+
+			encoded.insert(encoded.end(), headers.begin(), headers.end());
+			encoded.insert(encoded.end(), data.begin(), data.end());
+		}
+	}
+}
+
+bool MeshCodec::decodeVertexBuffer(
+	void* vertices,
+	UINT vertexCount,
+	UINT vertexSize,
+	const unsigned char* encoded,
+	size_t encodedSize)
+{
+	const unsigned char* p = encoded;
+	const unsigned char* end = encoded + encodedSize;
+	if (p == end || *p++ != VertexCodecTag || vertexSize == 0)
+	{
+		return false;
+	}
+
+	unsigned char* output = static_cast<unsigned char*>(vertices);
+	const UINT blockVertexCount = getBlockVertexCount(vertexSize);
+
+	std::vector<unsigned char> previous(vertexSize, 0);
+	std::vector<unsigned char> planes(vertexSize * MaxBlockVertexCount);
+
+	for (UINT blockBegin = 0; blockBegin < vertexCount; blockBegin += blockVertexCount)
+	{
+		const UINT count = std::min(blockVertexCount, vertexCount - blockBegin);
+		const UINT groupCount = (count + GroupSize - 1) / GroupSize;
+		const UINT planeStride = groupCount * GroupSize;
+
+		for (UINT k = 0; k < vertexSize; ++k)
+		{
+			const UINT headerSize = (groupCount + 3) / 4;
+			if ((size_t)(end - p) < headerSize)
+			{
+				return false;
+			}
+
+			const unsigned char* headers = p;
+			p += headerSize;
+
+			unsigned char last = previous[k];
+			unsigned char* plane = &planes[k * planeStride];
+			for (UINT g = 0; g < groupCount; ++g)
+			{
+				const UINT mode = (headers[g / 4] >> (g % 4 * 2)) & 3;
+				const UINT size = ModeBits[mode] * GroupSize / 8;
+
+				if ((size_t)(end - p) < size)
+				{
+					return false;
+				}
+
+				last = decodeGroup(p, mode, last, plane + g * GroupSize);
+				p += size;
+			}
+
+			// Padding decodes to repeats of the last real byte.
+			previous[k] = plane[count - 1];
+		}
+
+		interleaveBlock(planes.data(), planeStride, count, vertexSize, output + (size_t)blockBegin * vertexSize);
+	}
+
+	return p == end;
+}
+
+void MeshCodec::encodeIndexBuffer(const UINT* indices, UINT indexCount, std::vector<unsigned char>& encoded)
+{
+	const UINT triangleCount = indexCount / 3;
+
+	std::vector<unsigned char> codes;
+	std::vector<unsigned char> data;
+	codes.reserve(triangleCount);
+
+	SIndexState state;
+
+	for (UINT t = 0; t < triangleCount; ++t)
+	{
+		const UINT* triangle = &indices[t * 3];
+
+		// Rotate the triangle so that its first edge is in the FIFO.
+		int edge = -1;
+		UINT rotation = 0;
+		for (; rotation < 3; ++rotation)
+		{
+			edge = state.findEdge(triangle[rotation], triangle[(rotation + 1) % 3]);
+			if (edge >= 0)
+			{
+				break;
+			}
+		}
+
+		if (edge >= 0)
+		{
+			const UINT a = triangle[rotation];
+			const UINT b = triangle[(rotation + 1) % 3];
+			const UINT c = triangle[(rotation + 2) % 3];
+
+			unsigned char vertexCode;
+			const int fifoIndex = state.findVertex(c);
+			if (c == state.m_next)
+			{
+				vertexCode = 0;
+				++state.m_next;
+				state.pushVertex(c);
+			}
+			else if (fifoIndex >= 0)
+			{
+				vertexCode = (unsigned char)(1 + fifoIndex);
+			}
+			else
+			{
+				vertexCode = ExplicitVertex;
+				writeVarint(data, zigzag32((int)(c - state.m_last)));
+				state.m_last = c;
+				state.pushVertex(c);
+			}
+
+			codes.push_back((unsigned char)((edge << 4) | vertexCode));
+
+			state.pushEdge(c, b);
+			state.pushEdge(a, c);
+		}
+		else
+		{
+			const UINT a = triangle[0];
+			const UINT b = triangle[1];
+			const UINT c = triangle[2];
+
+			codes.push_back(FreeTriangle);
+			encodeReference(state, a, data);
+			encodeReference(state, b, data);
+			encodeReference(state, c, data);
+
+			state.pushEdge(b, a);
+			state.pushEdge(c, b);
+			state.pushEdge(a, c);
+		}
+	}
+
+	encoded.clear();
+	encoded.reserve(1 + codes.size() + data.size());
+	encoded.push_back(IndexCodecTag);
+	encoded.insert(encoded.end(), codes.begin(), codes.end());
+	encoded.insert(encoded.end(), data.begin(), data.end());
+}
+
+bool MeshCodec::decodeIndexBuffer(
+	void* indices,
+	UINT indexCount,
+	UINT indexSize,
+	UINT vertexCount,
+	const unsigned char* encoded,
+	size_t encodedSize)
+{
+	const UINT triangleCount = indexCount / 3;
+	if (indexCount % 3 != 0 || encodedSize < 1 + (size_t)triangleCount || encoded[0] != IndexCodecTag)
+	{
+		return false;
+	}
+
+	if (indexSize == sizeof(USHORT) && vertexCount > 0x10000)
+	{
+		return false;
+	}
+
+	const unsigned char* codes = encoded + 1;
+	const unsigned char* data = codes + triangleCount;
+	const unsigned char* end = encoded + encodedSize;
+
+	if (indexSize == sizeof(USHORT))
+	{
+		return decodeTriangles(static_cast<USHORT*>(indices), triangleCount, vertexCount, codes, data, end);
+	}
+	if (indexSize == sizeof(UINT))
+	{
+		return decodeTriangles(static_cast<UINT*>(indices), triangleCount, vertexCount, codes, data, end);
+	}
+	return false;
+}
@@ -0,0 +1,59 @@
+﻿#pragma once
+
+#include <vector>
+
+#include "d3dutil.h"
+
+// Lossless codecs for vertex and index blobs stored on disk.
+//
+// Vertices are coded in blocks of up to 256 vertices. Inside a block every
+// byte position of the vertex forms a plane; each plane holds the zigzag
+// coded difference of the byte to the same byte of the previous vertex, in
+// groups of 16 that are stored with 0, 2 or 4 bits per byte, or as the bytes
+// themselves when the differences need all 8. Smoothly varying attributes
+// leave the high bytes of floats nearly constant, so their planes shrink to
+// a few bits per vertex while the noisy low mantissa bytes are copied. The
+// planes also compress well with a general purpose compressor on top.
+//
+// Triangles are coded one code byte each against a FIFO of recent edges and
+// one of recent vertices, with vertex indices that are neither next in
+// first-use order nor in the FIFO given as varint deltas. The order of the
+// triangles and their winding are kept; a triangle may come back rotated,
+// starting at the vertex that follows the shared edge.
+//
+// Decoders check every read against the end of the input and return false
+// on truncated or malformed data.
+namespace MeshCodec
+{
+	void encodeVertexBuffer(
+		const void* vertices,
+		UINT vertexCount,
+		UINT vertexSize,
+		std::vector<unsigned char>& encoded
+	);
+	bool decodeVertexBuffer(
+		void* vertices,
+		UINT vertexCount,
+		UINT vertexSize,
+		const unsigned char* encoded,
+		size_t encodedSize
+	);
+
+	// indexCount must be a multiple of 3.
+	void encodeIndexBuffer(
+		const UINT* indices,
+		UINT indexCount,
+		std::vector<unsigned char>& encoded
+	);
+
+	// Writes indexSize (2 or 4) byte indices; fails on any index of
+	// vertexCount or more, so decoded indices are safe to draw with.
+	bool decodeIndexBuffer(
+		void* indices,
+		UINT indexCount,
+		UINT indexSize,
+		UINT vertexCount,
+		const unsigned char* encoded,
+		size_t encodedSize
+	);
+}
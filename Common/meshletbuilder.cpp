@@ -0,0 +1,399 @@
+﻿#include "meshletbuilder.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <numeric>
+
+#include "mathhelper.h"
+using namespace MeshletBuilder;
+
+namespace
+{
+	const XMFLOAT3& positionAt(const XMFLOAT3* positions, UINT stride, UINT i)
+	{
+		return *reinterpret_cast<const XMFLOAT3*>(
+			reinterpret_cast<const BYTE*>(positions) + (size_t)i * stride);
+	}
+
+	// Trades meshlet compactness for narrower normal cones, which is what
+	// makes back-face cone culling effective.
+	const float ConeWeight = 4.0f;
+
+	XMVECTOR triangleNormal(const XMFLOAT3* positions, UINT stride, const UINT* tri)
+	{
+		// Clockwise front faces in a left handed system: the outward normal
+		// is (p1 - p0) x (p2 - p0).
+		XMVECTOR p0 = XMLoadFloat3(&positionAt(positions, stride, tri[0]));
+		XMVECTOR p1 = XMLoadFloat3(&positionAt(positions, stride, tri[1]));
+		XMVECTOR p2 = XMLoadFloat3(&positionAt(positions, stride, tri[2]));
+
+		return XMVector3Cross(p1 - p0, p2 - p0);
+	}
+
+	struct SAdjacency
+	{
+		std::vector<UINT> m_offsets;
+		std::vector<UINT> m_triangles;
+	};
+
+	void buildAdjacency(const std::vector<UINT>& indices, UINT vertexCount, SAdjacency& adjacency)
+	{
+		adjacency.m_offsets.assign(vertexCount + 1, 0);
+		for (UINT index : indices)
+		{
+			++adjacency.m_offsets[index + 1];
+		}
+		for (UINT i = 0; i < vertexCount; ++i)
+		{
+			adjacency.m_offsets[i + 1] += adjacency.m_offsets[i];
+		}
+
+		std::vector<UINT> fill(adjacency.m_offsets.begin(), adjacency.m_offsets.end() - 1);
+		adjacency.m_triangles.resize(indices.size());
+		for (size_t i = 0; i < indices.size(); ++i)
+		{
+			adjacency.m_triangles[fill[indices[i]]++] = (UINT)(i / 3);
+		}
+	}
+
+	void computeBounds(
+		SMeshlet& meshlet,
+		const SMeshletData& meshletData,
+		const std::vector<UINT>& indices,
+		const XMFLOAT3* positions,
+		UINT stride)
+	{
+		XMVECTOR vMin = XMVectorReplicate(FLT_MAX);
+		XMVECTOR vMax = XMVectorReplicate(-FLT_MAX);
+		for (UINT i = 0; i < meshlet.m_vertexCount; ++i)
+		{
+			XMVECTOR p = XMLoadFloat3(&positionAt(
+				positions, stride, meshletData.m_vertices[meshlet.m_vertexOffset + i]));
+			vMin = XMVectorMin(vMin, p);
+			vMax = XMVectorMax(vMax, p);
+		}
+
+		XMVECTOR center = 0.5f * (vMin + vMax);
+		float radiusSq = 0.0f;
+		for (UINT i = 0; i < meshlet.m_vertexCount; ++i)
+		{
+			XMVECTOR p = XMLoadFloat3(&positionAt(
+				positions, stride, meshletData.m_vertices[meshlet.m_vertexOffset + i]));
+			radiusSq = MathHelper::max(radiusSq, XMVectorGetX(XMVector3LengthSq(p - center)));
+		}
+
+		XMStoreFloat3(&meshlet.m_center, center);
+		meshlet.m_radius = sqrtf(radiusSq);
+
+		std::vector<XMFLOAT3> normals;
+		normals.reserve(meshlet.m_triangleCount);
+
+		XMVECTOR axis = XMVectorZero();
+		for (UINT t = 0; t < meshlet.m_triangleCount; ++t)
+		{
+			XMVECTOR n = triangleNormal(positions, stride, &indices[meshlet.m_indexOffset + t * 3]);
+			if (XMVectorGetX(XMVector3LengthSq(n)) <= 0.0f)
+			{
+				continue;
+			}
+
+			n = XMVector3Normalize(n);
+			axis += n;
+
+			normals.push_back(XMFLOAT3());
+			XMStoreFloat3(&normals.back(), n);
+		}
+
+		axis = XMVector3Normalize(axis);
+
+		float minDot = 1.0f;
+		for (const XMFLOAT3& n : normals)
+		{
+			minDot = MathHelper::min(minDot, XMVectorGetX(XMVector3Dot(axis, XMLoadFloat3(&n))));
+		}
+
+		XMStoreFloat3(&meshlet.m_coneAxis, axis);
+
+		// A cone wider than a hemisphere can never be entirely back facing;
+		// a cutoff of one disables the test.
+		meshlet.m_coneCutoff = normals.empty() || minDot <= 0.0f ?
+			1.0f : sqrtf(1.0f - minDot * minDot);
+	}
+
+	// Moves the meshlets and their data into ascending order of keys.
+	void reorderMeshlets(const std::vector<float>& keys, SMeshletData& meshletData)
+	{
+		std::vector<UINT> order(meshletData.m_meshlets.size());
+		std::iota(order.begin(), order.end(), 0);
+		std::stable_sort(order.begin(), order.end(), [&](UINT a, UINT b) { return keys[a] < keys[b]; });
+
+		SMeshletData sorted;
+		sorted.m_meshlets.reserve(meshletData.m_meshlets.size());
+		sorted.m_vertices.reserve(meshletData.m_vertices.size());
+		sorted.m_primitives.reserve(meshletData.m_primitives.size());
+		sorted.m_indices.reserve(meshletData.m_indices.size());
+
+		for (UINT i : order)
+		{
+			SMeshlet meshlet = meshletData.m_meshlets[i];
+
+			sorted.m_vertices.insert(sorted.m_vertices.end(),
+				meshletData.m_vertices.begin() + meshlet.m_vertexOffset,
+				meshletData.m_vertices.begin() + meshlet.m_vertexOffset + meshlet.m_vertexCount);
+			sorted.m_primitives.insert(sorted.m_primitives.end(),
+				meshletData.m_primitives.begin() + meshlet.m_primitiveOffset,
+				meshletData.m_primitives.begin() + meshlet.m_primitiveOffset + meshlet.m_triangleCount * 3);
+			sorted.m_indices.insert(sorted.m_indices.end(),
+				meshletData.m_indices.begin() + meshlet.m_indexOffset,
+				meshletData.m_indices.begin() + meshlet.m_indexOffset + meshlet.m_indexCount);
+
+			meshlet.m_vertexOffset = (UINT)sorted.m_vertices.size() - meshlet.m_vertexCount;
+			meshlet.m_primitiveOffset = (UINT)sorted.m_primitives.size() - meshlet.m_triangleCount * 3;
+			meshlet.m_indexOffset = (UINT)sorted.m_indices.size() - meshlet.m_indexCount;
+			sorted.m_meshlets.push_back(meshlet);
+		}
+
+		meshletData = std::move(sorted);
+	}
+}
+
+void MeshletBuilder::buildMeshlets(const std::vector<UINT>& indices, const XMFLOAT3* positions, UINT vertexCount, UINT positionStride, SMeshletData& meshletData, UINT maxVertices, UINT maxTriangles, bool followInputOrder)
+{
+	assert(maxVertices >= 3 && maxVertices <= 256);
+	assert(maxTriangles >= 1);
+
+	meshletData.m_meshlets.clear();
+	meshletData.m_vertices.clear();
+	meshletData.m_primitives.clear();
+	meshletData.m_indices.clear();
+	meshletData.m_indices.reserve(indices.size());
+
+	const UINT triangleCount = (UINT)indices.size() / 3;
+
+	SAdjacency adjacency;
+	buildAdjacency(indices, vertexCount, adjacency);
+
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<int> localIndex(vertexCount, -1);
+
+	UINT seedCursor = 0;
+	UINT seed = 0;
+
+	// Mean position in indices of the triangles of each meshlet.
+	std::vector<float> inputOrder;
+
+	while (true)
+	{
+		while (seedCursor < triangleCount && emitted[seedCursor])
+		{
+			++seedCursor;
+		}
+		if (seedCursor == triangleCount)
+		{
+			break;
+		}
+		if (emitted[seed])
+		{
+			seed = seedCursor;
+		}
+
+		SMeshlet meshlet = {};
+		meshlet.m_vertexOffset = (UINT)meshletData.m_vertices.size();
+		meshlet.m_primitiveOffset = (UINT)meshletData.m_primitives.size();
+		meshlet.m_indexOffset = (UINT)meshletData.m_indices.size();
+
+		XMVECTOR centroidSum = XMVectorZero();
+		XMVECTOR normalSum = XMVectorZero();
+		double triangleSum = 0.0;
+
+		UINT next = seed;
+		while (true)
+		{
+			const UINT* tri = &indices[next * 3];
+			for (UINT k = 0; k < 3; ++k)
+			{
+				if (localIndex[tri[k]] < 0)
+				{
+					localIndex[tri[k]] = (int)meshlet.m_vertexCount++;
+					meshletData.m_vertices.push_back(tri[k]);
+					centroidSum += XMLoadFloat3(&positionAt(positions, positionStride, tri[k]));
+				}
+
+				meshletData.m_primitives.push_back((BYTE)localIndex[tri[k]]);
+				meshletData.m_indices.push_back(tri[k]);
+			}
+
+			normalSum += triangleNormal(positions, positionStride, tri);
+
+			emitted[next] = true;
+			triangleSum += next;
+			++meshlet.m_triangleCount;
+
+			if (meshlet.m_triangleCount == maxTriangles)
+			{
+				break;
+			}
+
+			// Grow through triangles touching the meshlet, preferring those
+			// that add the fewest vertices, then those that keep the normal
+			// cone narrow and the meshlet compact.
+			XMVECTOR centroid = centroidSum / (float)meshlet.m_vertexCount;
+			XMVECTOR axis = XMVector3Normalize(normalSum);
+
+			float radiusSq = 0.0f;
+			for (UINT v = 0; v < meshlet.m_vertexCount; ++v)
+			{
+				XMVECTOR p = XMLoadFloat3(&positionAt(
+					positions, positionStride, meshletData.m_vertices[meshlet.m_vertexOffset + v]));
+				radiusSq = MathHelper::max(radiusSq, XMVectorGetX(XMVector3LengthSq(p - centroid)));
+			}
+			const float invRadiusSq = radiusSq > 0.0f ? 1.0f / radiusSq : 1.0f;
+
+			float bestScore = FLT_MAX;
+			UINT best = triangleCount;
+
+			for (UINT v = 0; v < meshlet.m_vertexCount; ++v)
+			{
+				const UINT vertex = meshletData.m_vertices[meshlet.m_vertexOffset + v];
+				for (UINT a = adjacency.m_offsets[vertex]; a < adjacency.m_offsets[vertex + 1]; ++a)
+				{
+					const UINT candidate = adjacency.m_triangles[a];
+					if (emitted[candidate])
+					{
+						continue;
+					}
+
+					const UINT* ctri = &indices[candidate * 3];
+					UINT newVertices = 0;
+					XMVECTOR triCenter = XMVectorZero();
+					for (UINT k = 0; k < 3; ++k)
+					{
+						newVertices += localIndex[ctri[k]] < 0 ? 1 : 0;
+						triCenter += XMLoadFloat3(&positionAt(positions, positionStride, ctri[k]));
+					}
+
+					if (meshlet.m_vertexCount + newVertices > maxVertices)
+					{
+						continue;
+					}
+
+					const float distanceSq = XMVectorGetX(XMVector3LengthSq(
+						triCenter * (1.0f / 3.0f) - centroid));
+					const float spread = 1.0f - XMVectorGetX(XMVector3Dot(
+						axis, XMVector3Normalize(triangleNormal(positions, positionStride, ctri))));
+					const float score = newVertices * 16.0f + ConeWeight * spread + distanceSq * invRadiusSq;
+
+					if (score < bestScore)
+					{
+						bestScore = score;
+						best = candidate;
+					}
+				}
+			}
+
+			if (best == triangleCount)
+			{
+				break;
+			}
+
+			next = best;
+		}
+
+		meshlet.m_indexCount = meshlet.m_triangleCount * 3;
+		computeBounds(meshlet, meshletData, meshletData.m_indices, positions, positionStride);
+
+		// Continue next to this meshlet so consecutive meshlets stay close,
+		// which keeps merged draw ranges long after culling.
+		seed = triangleCount;
+		for (UINT v = 0; v < meshlet.m_vertexCount && seed == triangleCount; ++v)
+		{
+			const UINT vertex = meshletData.m_vertices[meshlet.m_vertexOffset + v];
+			for (UINT a = adjacency.m_offsets[vertex]; a < adjacency.m_offsets[vertex + 1]; ++a)
+			{
+				if (!emitted[adjacency.m_triangles[a]])
+				{
+					seed = adjacency.m_triangles[a];
+					break;
+				}
+			}
+		}
+		if (seed == triangleCount)
+		{
+			seed = seedCursor;
+		}
+
+		for (UINT v = 0; v < meshlet.m_vertexCount; ++v)
+		{
+			localIndex[meshletData.m_vertices[meshlet.m_vertexOffset + v]] = -1;
+		}
+
+		meshletData.m_meshlets.push_back(meshlet);
+		inputOrder.push_back((float)(triangleSum / meshlet.m_triangleCount));
+	}
+
+	if (followInputOrder)
+	{
+		reorderMeshlets(inputOrder, meshletData);
+	}
+}
+
+UINT MeshletBuilder::cullMeshlets(const SMeshletData& meshletData, CXMMATRIX world, CXMMATRIX viewProj, const XMFLOAT3& eyePosW, std::vector<SDrawRange>& drawRanges)
+{
+	// Work in object space: frustum planes from the combined matrix and the
+	// eye moved by the inverse world transform.
+	XMMATRIX M = XMMatrixTranspose(XMMatrixMultiply(world, viewProj));
+
+	XMVECTOR planes[6] = {
+		XMPlaneNormalize(M.r[3] + M.r[0]),
+		XMPlaneNormalize(M.r[3] - M.r[0]),
+		XMPlaneNormalize(M.r[3] + M.r[1]),
+		XMPlaneNormalize(M.r[3] - M.r[1]),
+		XMPlaneNormalize(M.r[2]),
+		XMPlaneNormalize(M.r[3] - M.r[2]),
+	};
+
+	XMVECTOR det = XMMatrixDeterminant(world);
+	XMVECTOR eye = XMVector3TransformCoord(
+		XMLoadFloat3(&eyePosW), XMMatrixInverse(&det, world));
+
+	UINT visibleCount = 0;
+	for (const SMeshlet& meshlet : meshletData.m_meshlets)
+	{
+		XMVECTOR center = XMLoadFloat3(&meshlet.m_center);
+
+		bool isVisible = true;
+		for (UINT p = 0; p < 6 && isVisible; ++p)
+		{
+			isVisible = XMVectorGetX(XMPlaneDotCoord(planes[p], center)) >= -meshlet.m_radius;
+		}
+
+		if (isVisible)
+		{
+			XMVECTOR toCenter = center - eye;
+			const float distance = XMVectorGetX(XMVector3Length(toCenter));
+			const float along = XMVectorGetX(XMVector3Dot(toCenter, XMLoadFloat3(&meshlet.m_coneAxis)));
+
+			isVisible = along < meshlet.m_coneCutoff * distance + meshlet.m_radius;
+		}
+
+		if (!isVisible)
+		{
+			continue;
+		}
+
+		++visibleCount;
+
+		if (!drawRanges.empty() &&
+			drawRanges.back().m_indexOffset + drawRanges.back().m_indexCount == meshlet.m_indexOffset)
+		{
+			drawRanges.back().m_indexCount += meshlet.m_indexCount;
+		}
+		else
+		{
+			drawRanges.push_back({ meshlet.m_indexOffset, meshlet.m_indexCount });
+		}
+	}
+
+	return visibleCount;
+}
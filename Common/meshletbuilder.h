@@ -0,0 +1,79 @@
+﻿#pragma once
+
+#include <vector>
+#include <DirectXMath.h>
+#include <windows.h>
+using namespace DirectX;
+
+namespace MeshletBuilder
+{
+	const UINT MaxMeshletVertices = 64;
+	const UINT MaxMeshletTriangles = 124;
+
+	struct SMeshlet
+	{
+		// Range in SMeshletData::m_vertices and SMeshletData::m_primitives.
+		UINT m_vertexOffset;
+		UINT m_vertexCount;
+		UINT m_primitiveOffset;
+		UINT m_triangleCount;
+
+		// Range in SMeshletData::m_indices, usable with DrawIndexed.
+		UINT m_indexOffset;
+		UINT m_indexCount;
+
+		XMFLOAT3 m_center;
+		float m_radius;
+
+		// Back-face cone: every triangle faces away from a viewer looking
+		// down the axis closer than asin(m_coneCutoff) to it.
+		XMFLOAT3 m_coneAxis;
+		float m_coneCutoff;
+	};
+
+	struct SMeshletData
+	{
+		std::vector<SMeshlet> m_meshlets;
+
+		// Meshlet-local vertex to mesh vertex.
+		std::vector<UINT> m_vertices;
+		// Three meshlet-local vertex indices per triangle.
+		std::vector<BYTE> m_primitives;
+
+		// The mesh index buffer reordered meshlet by meshlet.
+		std::vector<UINT> m_indices;
+	};
+
+	struct SDrawRange
+	{
+		UINT m_indexOffset;
+		UINT m_indexCount;
+	};
+
+	// Meshlets grow from a seed next to the previous meshlet, so neighbours
+	// follow each other and culled draw ranges merge well. With
+	// followInputOrder they are emitted in the order of the mean position of
+	// their triangles in indices instead, so an index order from
+	// MeshOptimizer::optimizeOverdraw() carries over to m_indices.
+	void buildMeshlets(
+		const std::vector<UINT>& indices,
+		const XMFLOAT3* positions,
+		UINT vertexCount,
+		UINT positionStride,
+		SMeshletData& meshletData,
+		UINT maxVertices = MaxMeshletVertices,
+		UINT maxTriangles = MaxMeshletTriangles,
+		bool followInputOrder = false
+	);
+
+	// Tests every meshlet against the view frustum and its back-face cone and
+	// appends the index ranges of the visible ones, merging adjacent ranges.
+	// Returns the number of visible meshlets.
+	UINT cullMeshlets(
+		const SMeshletData& meshletData,
+		CXMMATRIX world,
+		CXMMATRIX viewProj,
+		const XMFLOAT3& eyePosW,
+		std::vector<SDrawRange>& drawRanges
+	);
+}
@@ -0,0 +1,432 @@
+﻿#include "meshoptimizer.h"
+
+#include <algorithm>
+#include <cfloat>
+
+#include "mathhelper.h"
+using namespace MeshOptimizer;
+
+namespace
+{
+	const XMFLOAT3& positionAt(const XMFLOAT3* positions, UINT stride, UINT i)
+	{
+		return *reinterpret_cast<const XMFLOAT3*>(
+			reinterpret_cast<const BYTE*>(positions) + (size_t)i * stride);
+	}
+
+	// FIFO post-transform cache as found on most hardware. A vertex is
+	// resident while fewer than cacheSize misses happened since it was loaded.
+	class CCacheSimulator
+	{
+	public:
+		CCacheSimulator(UINT vertexCount, UINT cacheSize) :
+			m_timestamps(vertexCount, 0),
+			m_time(cacheSize + 1),
+			m_cacheSize(cacheSize)
+		{
+
+		}
+
+		void reset()
+		{
+			m_time += m_cacheSize + 1;
+		}
+
+		UINT processTriangle(const UINT* tri)
+		{
+			UINT misses = 0;
+			for (UINT k = 0; k < 3; ++k)
+			{
+				if (m_time - m_timestamps[tri[k]] > m_cacheSize)
+				{
+					m_timestamps[tri[k]] = m_time++;
+					++misses;
+				}
+			}
+
+			return misses;
+		}
+
+	private:
+		std::vector<UINT> m_timestamps;
+		UINT m_time;
+		UINT m_cacheSize;
+	};
+
+	void generateHardBoundaries(
+		const std::vector<UINT>& indices,
+		UINT vertexCount,
+		UINT cacheSize,
+		std::vector<UINT>& boundaries)
+	{
+		CCacheSimulator cache(vertexCount, cacheSize);
+
+		const UINT triangleCount = (UINT)indices.size() / 3;
+		for (UINT i = 0; i < triangleCount; ++i)
+		{
+			// A triangle that misses on every vertex starts from a cold cache,
+			// so nothing in front of it relies on the current order.
+			if (cache.processTriangle(&indices[i * 3]) == 3)
+			{
+				boundaries.push_back(i);
+			}
+		}
+
+		if (boundaries.empty() || boundaries[0] != 0)
+		{
+			boundaries.insert(boundaries.begin(), 0);
+		}
+		boundaries.push_back(triangleCount);
+	}
+
+	void generateSoftBoundaries(
+		const std::vector<UINT>& indices,
+		UINT vertexCount,
+		UINT cacheSize,
+		float threshold,
+		const std::vector<UINT>& hardBoundaries,
+		std::vector<UINT>& boundaries)
+	{
+		CCacheSimulator cache(vertexCount, cacheSize);
+
+		for (size_t c = 0; c + 1 < hardBoundaries.size(); ++c)
+		{
+			const UINT start = hardBoundaries[c];
+			const UINT end = hardBoundaries[c + 1];
+
+			cache.reset();
+			UINT clusterMisses = 0;
+			for (UINT i = start; i < end; ++i)
+			{
+				clusterMisses += cache.processTriangle(&indices[i * 3]);
+			}
+
+			const float targetAcmr = threshold * clusterMisses / (end - start);
+
+			// Every split restarts from a cold cache; only split where the
+			// running ACMR of the piece is already below the target, so the
+			// cluster as a whole stays within the threshold.
+			boundaries.push_back(start);
+			cache.reset();
+
+			UINT pieceStart = start;
+			UINT pieceMisses = 0;
+			for (UINT i = start; i < end; ++i)
+			{
+				pieceMisses += cache.processTriangle(&indices[i * 3]);
+
+				const UINT pieceSize = i + 1 - pieceStart;
+				if (i + 1 < end && (float)pieceMisses / pieceSize <= targetAcmr)
+				{
+					boundaries.push_back(i + 1);
+					cache.reset();
+
+					pieceStart = i + 1;
+					pieceMisses = 0;
+				}
+			}
+		}
+
+		boundaries.push_back((UINT)indices.size() / 3);
+	}
+
+	struct SCluster
+	{
+		UINT m_start;
+		UINT m_end;
+		float m_sortKey;
+	};
+
+	class CRasterizer
+	{
+	public:
+		CRasterizer(UINT resolution) :
+			m_resolution(resolution),
+			m_depth(resolution * resolution, FLT_MAX),
+			m_pixelsShaded(0)
+		{
+
+		}
+
+		// Vertices are in pixel space with y growing downwards, depth in z.
+		void drawTriangle(const XMFLOAT3& v0, const XMFLOAT3& v1, const XMFLOAT3& v2)
+		{
+			// Clockwise on screen is front facing, as in the default
+			// D3D11 rasterizer state.
+			const float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+			if (area <= 0.0f)
+			{
+				return;
+			}
+
+			const int minX = MathHelper::max(0, (int)floorf(MathHelper::min(v0.x, MathHelper::min(v1.x, v2.x))));
+			const int maxX = MathHelper::min((int)m_resolution - 1, (int)ceilf(MathHelper::max(v0.x, MathHelper::max(v1.x, v2.x))));
+			const int minY = MathHelper::max(0, (int)floorf(MathHelper::min(v0.y, MathHelper::min(v1.y, v2.y))));
+			const int maxY = MathHelper::min((int)m_resolution - 1, (int)ceilf(MathHelper::max(v0.y, MathHelper::max(v1.y, v2.y))));
+
+			const bool topLeft0 = isTopLeft(v1, v2);
+			const bool topLeft1 = isTopLeft(v2, v0);
+			const bool topLeft2 = isTopLeft(v0, v1);
+
+			const float invArea = 1.0f / area;
+
+			for (int y = minY; y <= maxY; ++y)
+			{
+				const float py = y + 0.5f;
+				for (int x = minX; x <= maxX; ++x)
+				{
+					const float px = x + 0.5f;
+
+					const float w0 = edge(v1, v2, px, py);
+					const float w1 = edge(v2, v0, px, py);
+					const float w2 = edge(v0, v1, px, py);
+
+					if (!covers(w0, topLeft0) || !covers(w1, topLeft1) || !covers(w2, topLeft2))
+					{
+						continue;
+					}
+
+					const float z = (w0 * v0.z + w1 * v1.z + w2 * v2.z) * invArea;
+
+					float& depth = m_depth[y * m_resolution + x];
+					if (z < depth)
+					{
+						depth = z;
+						++m_pixelsShaded;
+					}
+				}
+			}
+		}
+
+		UINT getPixelsShaded() const
+		{
+			return m_pixelsShaded;
+		}
+
+		UINT getPixelsCovered() const
+		{
+			return (UINT)std::count_if(m_depth.begin(), m_depth.end(),
+				[](float d) { return d != FLT_MAX; });
+		}
+
+	private:
+		static float edge(const XMFLOAT3& a, const XMFLOAT3& b, float px, float py)
+		{
+			return (b.x - a.x) * (py - a.y) - (b.y - a.y) * (px - a.x);
+		}
+
+		static bool isTopLeft(const XMFLOAT3& a, const XMFLOAT3& b)
+		{
+			const float dx = b.x - a.x;
+			const float dy = b.y - a.y;
+			return (dy == 0.0f && dx > 0.0f) || dy < 0.0f;
+		}
+
+		static bool covers(float w, bool topLeft)
+		{
+			return w > 0.0f || (w == 0.0f && topLeft);
+		}
+
+	private:
+		UINT m_resolution;
+		std::vector<float> m_depth;
+		UINT m_pixelsShaded;
+	};
+}
+
+SVertexCacheStats MeshOptimizer::analyzeVertexCache(const std::vector<UINT>& indices, UINT vertexCount, UINT cacheSize)
+{
+	SVertexCacheStats stats;
+
+	CCacheSimulator cache(vertexCount, cacheSize);
+
+	const UINT triangleCount = (UINT)indices.size() / 3;
+	for (UINT i = 0; i < triangleCount; ++i)
+	{
+		stats.m_verticesTransformed += cache.processTriangle(&indices[i * 3]);
+	}
+
+	if (triangleCount > 0)
+	{
+		stats.m_acmr = (float)stats.m_verticesTransformed / triangleCount;
+	}
+	if (vertexCount > 0)
+	{
+		stats.m_atvr = (float)stats.m_verticesTransformed / vertexCount;
+	}
+
+	return stats;
+}
+
+SOverdrawStats MeshOptimizer::analyzeOverdraw(const std::vector<UINT>& indices, const XMFLOAT3* positions, UINT vertexCount, UINT positionStride, UINT resolution)
+{
+	SOverdrawStats stats;
+
+	if (vertexCount == 0 || indices.empty())
+	{
+		return stats;
+	}
+
+	XMVECTOR vMin = XMVectorReplicate(FLT_MAX);
+	XMVECTOR vMax = XMVectorReplicate(-FLT_MAX);
+	for (UINT i = 0; i < vertexCount; ++i)
+	{
+		XMVECTOR p = XMLoadFloat3(&positionAt(positions, positionStride, i));
+		vMin = XMVectorMin(vMin, p);
+		vMax = XMVectorMax(vMax, p);
+	}
+
+	XMVECTOR center = 0.5f * (vMin + vMax);
+	const float radius = MathHelper::max(
+		0.5f * XMVectorGetX(XMVector3Length(vMax - vMin)), 1e-6f);
+
+	// The six axis directions and the eight cube diagonals.
+	const XMFLOAT3 viewDirs[14] = {
+		XMFLOAT3(+1.0f, 0.0f, 0.0f), XMFLOAT3(-1.0f, 0.0f, 0.0f),
+		XMFLOAT3(0.0f, +1.0f, 0.0f), XMFLOAT3(0.0f, -1.0f, 0.0f),
+		XMFLOAT3(0.0f, 0.0f, +1.0f), XMFLOAT3(0.0f, 0.0f, -1.0f),
+		XMFLOAT3(+1.0f, +1.0f, +1.0f), XMFLOAT3(-1.0f, +1.0f, +1.0f),
+		XMFLOAT3(+1.0f, -1.0f, +1.0f), XMFLOAT3(-1.0f, -1.0f, +1.0f),
+		XMFLOAT3(+1.0f, +1.0f, -1.0f), XMFLOAT3(-1.0f, +1.0f, -1.0f),
+		XMFLOAT3(+1.0f, -1.0f, -1.0f), XMFLOAT3(-1.0f, -1.0f, -1.0f),
+	};
+
+	std::vector<XMFLOAT3> screen(vertexCount);
+
+	for (const XMFLOAT3& dir : viewDirs)
+	{
+		XMVECTOR d = XMVector3Normalize(XMLoadFloat3(&dir));
+		XMVECTOR eye = center - 2.0f * radius * d;
+
+		// Avoid a degenerate basis when looking straight up or down.
+		XMVECTOR up = dir.x == 0.0f && dir.z == 0.0f ?
+			XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f) :
+			XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+
+		XMMATRIX view = XMMatrixLookAtLH(eye, center, up);
+		XMMATRIX proj = XMMatrixOrthographicLH(2.0f * radius, 2.0f * radius, radius, 3.0f * radius);
+		XMMATRIX viewProj = XMMatrixMultiply(view, proj);
+
+		const float halfRes = 0.5f * resolution;
+		for (UINT i = 0; i < vertexCount; ++i)
+		{
+			XMVECTOR p = XMVector3TransformCoord(
+				XMLoadFloat3(&positionAt(positions, positionStride, i)), viewProj);
+
+			screen[i].x = (XMVectorGetX(p) + 1.0f) * halfRes;
+			screen[i].y = (1.0f - XMVectorGetY(p)) * halfRes;
+			screen[i].z = XMVectorGetZ(p);
+		}
+
+		CRasterizer rasterizer(resolution);
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			rasterizer.drawTriangle(
+				screen[indices[i + 0]],
+				screen[indices[i + 1]],
+				screen[indices[i + 2]]
+			);
+		}
+
+		stats.m_pixelsCovered += rasterizer.getPixelsCovered();
+		stats.m_pixelsShaded += rasterizer.getPixelsShaded();
+	}
+
+	if (stats.m_pixelsCovered > 0)
+	{
+		stats.m_overdraw = (float)stats.m_pixelsShaded / stats.m_pixelsCovered;
+	}
+
+	return stats;
+}
+
+void MeshOptimizer::optimizeOverdraw(std::vector<UINT>& indices, const XMFLOAT3* positions, UINT vertexCount, UINT positionStride, float threshold, UINT cacheSize)
+{
+	if (indices.size() < 6)
+	{
+		return;
+	}
+
+	std::vector<UINT> hardBoundaries;
+	generateHardBoundaries(indices, vertexCount, cacheSize, hardBoundaries);
+
+	std::vector<UINT> boundaries;
+	generateSoftBoundaries(indices, vertexCount, cacheSize, threshold, hardBoundaries, boundaries);
+
+	// Area weighted mesh centroid, the reference point for the occlusion
+	// potential of each cluster.
+	XMVECTOR meshCentroid = XMVectorZero();
+	float meshArea = 0.0f;
+
+	std::vector<SCluster> clusters;
+	std::vector<XMFLOAT3> clusterCentroids;
+	std::vector<XMFLOAT3> clusterNormals;
+
+	for (size_t c = 0; c + 1 < boundaries.size(); ++c)
+	{
+		if (boundaries[c] == boundaries[c + 1])
+		{
+			continue;
+		}
+
+		XMVECTOR centroid = XMVectorZero();
+		XMVECTOR normal = XMVectorZero();
+		float area = 0.0f;
+
+		for (UINT i = boundaries[c]; i < boundaries[c + 1]; ++i)
+		{
+			XMVECTOR p0 = XMLoadFloat3(&positionAt(positions, positionStride, indices[i * 3 + 0]));
+			XMVECTOR p1 = XMLoadFloat3(&positionAt(positions, positionStride, indices[i * 3 + 1]));
+			XMVECTOR p2 = XMLoadFloat3(&positionAt(positions, positionStride, indices[i * 3 + 2]));
+
+			// Left handed, clockwise front faces.
+			XMVECTOR n = XMVector3Cross(p1 - p0, p2 - p0);
+			const float triArea = 0.5f * XMVectorGetX(XMVector3Length(n));
+
+			centroid += triArea * (p0 + p1 + p2) * (1.0f / 3.0f);
+			normal += n;
+			area += triArea;
+		}
+
+		meshCentroid += centroid;
+		meshArea += area;
+
+		clusters.push_back({ boundaries[c], boundaries[c + 1], 0.0f });
+
+		XMFLOAT3 centroidF;
+		XMStoreFloat3(&centroidF, area > 0.0f ? centroid / area : centroid);
+		clusterCentroids.push_back(centroidF);
+
+		XMFLOAT3 normalF;
+		XMStoreFloat3(&normalF, XMVector3Normalize(normal));
+		clusterNormals.push_back(normalF);
+	}
+
+	if (meshArea > 0.0f)
+	{
+		meshCentroid /= meshArea;
+	}
+
+	// Clusters far out from the centre facing away from it tend to occlude
+	// the rest of the mesh from any viewpoint, so they go first.
+	for (size_t c = 0; c < clusters.size(); ++c)
+	{
+		XMVECTOR toCluster = XMLoadFloat3(&clusterCentroids[c]) - meshCentroid;
+		clusters[c].m_sortKey = XMVectorGetX(XMVector3Dot(
+			toCluster, XMLoadFloat3(&clusterNormals[c])));
+	}
+
+	std::stable_sort(clusters.begin(), clusters.end(),
+		[](const SCluster& a, const SCluster& b) { return a.m_sortKey > b.m_sortKey; });
+
+	std::vector<UINT> result;
+	result.reserve(indices.size());
+	for (const SCluster& cluster : clusters)
+	{
+		result.insert(result.end(),
+			indices.begin() + cluster.m_start * 3,
+			indices.begin() + cluster.m_end * 3);
+	}
+
+	indices.swap(result);
+}
@@ -0,0 +1,63 @@
+﻿#pragma once
+
+#include <vector>
+#include <DirectXMath.h>
+#include <windows.h>
+using namespace DirectX;
+
+namespace MeshOptimizer
+{
+	// Positions are read through a byte stride, so any vertex struct whose
+	// first XMFLOAT3 is the position (Vertex::SPosNormal, Vertex::SBasic32,
+	// GeometryGenerator::SVertex) can be passed directly.
+
+	struct SVertexCacheStats
+	{
+		UINT m_verticesTransformed = 0;
+
+		// Average cache miss ratio: transformed vertices per triangle.
+		float m_acmr = 0.0f;
+		// Average transform to vertex ratio: 1.0 is the ideal.
+		float m_atvr = 0.0f;
+	};
+
+	struct SOverdrawStats
+	{
+		UINT m_pixelsCovered = 0;
+		UINT m_pixelsShaded = 0;
+
+		// Shaded fragments per covered pixel, averaged over all viewpoints.
+		float m_overdraw = 0.0f;
+	};
+
+	SVertexCacheStats analyzeVertexCache(
+		const std::vector<UINT>& indices,
+		UINT vertexCount,
+		UINT cacheSize = 16
+	);
+
+	// Rasterizes the mesh on the CPU from a fixed set of orthographic
+	// viewpoints around its bounds with back-face culling and an early depth
+	// test, counting how many fragments would be shaded.
+	SOverdrawStats analyzeOverdraw(
+		const std::vector<UINT>& indices,
+		const XMFLOAT3* positions,
+		UINT vertexCount,
+		UINT positionStride,
+		UINT resolution = 256
+	);
+
+	// Splits the current triangle order into clusters at vertex cache
+	// boundaries and sorts the clusters so that those likely to occlude the
+	// rest of the mesh are drawn first. The input should already be in vertex
+	// cache friendly order; threshold bounds the allowed ACMR growth
+	// (1.05 keeps it within 5% of the input).
+	void optimizeOverdraw(
+		std::vector<UINT>& indices,
+		const XMFLOAT3* positions,
+		UINT vertexCount,
+		UINT positionStride,
+		float threshold = 1.05f,
+		UINT cacheSize = 16
+	);
+}
@@ -0,0 +1,554 @@
+﻿#include "meshsimplifier.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+#include <unordered_map>
+
+#include "mathhelper.h"
+using namespace MeshSimplifier;
+
+namespace
+{
+	// Scales the normal deviation term of the collapse order relative to the
+	// edge length.
+	const float NormalWeight = 0.5f;
+
+	// Collapses that turn an adjacent triangle by more than this (cosine)
+	// are rejected as folds.
+	const float MaxFoldCosine = 0.2f;
+
+	const XMFLOAT3& elementAt(const XMFLOAT3* base, UINT stride, UINT i)
+	{
+		return *reinterpret_cast<const XMFLOAT3*>(
+			reinterpret_cast<const BYTE*>(base) + (size_t)i * stride);
+	}
+
+	// Symmetric 4x4 plane quadric, area weighted; m_weight keeps the total
+	// area, so collapses are ordered by their RMS distance to the planes.
+	struct SQuadric
+	{
+		double m_a00, m_a11, m_a22;
+		double m_a01, m_a02, m_a12;
+		double m_b0, m_b1, m_b2;
+		double m_c;
+		double m_weight;
+
+		void add(const SQuadric& q)
+		{
+			m_a00 += q.m_a00; m_a11 += q.m_a11; m_a22 += q.m_a22;
+			m_a01 += q.m_a01; m_a02 += q.m_a02; m_a12 += q.m_a12;
+			m_b0 += q.m_b0; m_b1 += q.m_b1; m_b2 += q.m_b2;
+			m_c += q.m_c;
+			m_weight += q.m_weight;
+		}
+
+		double evaluate(const XMFLOAT3& p) const
+		{
+			const double x = p.x;
+			const double y = p.y;
+			const double z = p.z;
+
+			const double rx = m_a00 * x + m_a01 * y + m_a02 * z;
+			const double ry = m_a01 * x + m_a11 * y + m_a12 * z;
+			const double rz = m_a02 * x + m_a12 * y + m_a22 * z;
+
+			const double e = rx * x + ry * y + rz * z +
+				2.0 * (m_b0 * x + m_b1 * y + m_b2 * z) + m_c;
+
+			return MathHelper::max(e, 0.0);
+		}
+	};
+
+	SQuadric planeQuadric(const XMFLOAT3& p0, const XMFLOAT3& p1, const XMFLOAT3& p2)
+	{
+		SQuadric q = {};
+
+		XMVECTOR v0 = XMLoadFloat3(&p0);
+		XMVECTOR n = XMVector3Cross(XMLoadFloat3(&p1) - v0, XMLoadFloat3(&p2) - v0);
+		const float length = XMVectorGetX(XMVector3Length(n));
+		if (length <= 0.0f)
+		{
+			return q;
+		}
+
+		XMFLOAT3 nf;
+		XMStoreFloat3(&nf, n / length);
+
+		const double area = 0.5 * length;
+		const double d = -(nf.x * p0.x + nf.y * p0.y + nf.z * p0.z);
+
+		q.m_a00 = area * nf.x * nf.x;
+		q.m_a11 = area * nf.y * nf.y;
+		q.m_a22 = area * nf.z * nf.z;
+		q.m_a01 = area * nf.x * nf.y;
+		q.m_a02 = area * nf.x * nf.z;
+		q.m_a12 = area * nf.y * nf.z;
+		q.m_b0 = area * nf.x * d;
+		q.m_b1 = area * nf.y * d;
+		q.m_b2 = area * nf.z * d;
+		q.m_c = area * d * d;
+		q.m_weight = area;
+
+		return q;
+	}
+
+	struct SCollapse
+	{
+		UINT m_from;
+		UINT m_to;
+		float m_score;
+	};
+
+	// Planes (normal, offset) of the original triangles around each point,
+	// by representative vertex. A collapse hands those of the point it
+	// removes to the one it lands on, so a vertex's distance to its planes
+	// is its distance to every original triangle it stands in for.
+	typedef std::vector<std::vector<XMFLOAT4>> PlaneSets;
+
+	void buildPlaneSets(
+		const std::vector<UINT>& indices,
+		const XMFLOAT3* positions,
+		UINT stride,
+		const std::vector<UINT>& remap,
+		PlaneSets& planes)
+	{
+		planes.assign(remap.size(), std::vector<XMFLOAT4>());
+		for (size_t t = 0; t + 2 < indices.size(); t += 3)
+		{
+			const XMVECTOR p0 = XMLoadFloat3(&elementAt(positions, stride, indices[t + 0]));
+			const XMVECTOR n = XMVector3Cross(
+				XMLoadFloat3(&elementAt(positions, stride, indices[t + 1])) - p0,
+				XMLoadFloat3(&elementAt(positions, stride, indices[t + 2])) - p0);
+			const float length = XMVectorGetX(XMVector3Length(n));
+			if (length <= 0.0f)
+			{
+				continue;
+			}
+
+			XMFLOAT4 plane;
+			XMStoreFloat4(&plane, XMVectorSetW(n / length, -XMVectorGetX(XMVector3Dot(n / length, p0))));
+			for (UINT k = 0; k < 3; ++k)
+			{
+				planes[remap[indices[t + k]]].push_back(plane);
+			}
+		}
+	}
+
+	float getPlaneDistance(const std::vector<XMFLOAT4>& planes, const XMFLOAT3& p)
+	{
+		float distance = 0.0f;
+		for (const XMFLOAT4& plane : planes)
+		{
+			distance = MathHelper::max(distance, fabsf(plane.x * p.x + plane.y * p.y + plane.z * p.z + plane.w));
+		}
+		return distance;
+	}
+
+	// Vertices with bit-identical positions are one point of the surface;
+	// their first occurrence represents them.
+	void buildPositionRemap(const XMFLOAT3* positions, UINT stride, UINT vertexCount, std::vector<UINT>& remap)
+	{
+		struct SHash
+		{
+			size_t operator()(const XMFLOAT3& p) const
+			{
+				UINT bits[3];
+				memcpy(bits, &p, sizeof(bits));
+				return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+			}
+		};
+		struct SEqual
+		{
+			bool operator()(const XMFLOAT3& a, const XMFLOAT3& b) const
+			{
+				return memcmp(&a, &b, sizeof(XMFLOAT3)) == 0;
+			}
+		};
+
+		std::unordered_map<XMFLOAT3, UINT, SHash, SEqual> firstIndex;
+		firstIndex.reserve(vertexCount);
+
+		remap.resize(vertexCount);
+		for (UINT i = 0; i < vertexCount; ++i)
+		{
+			remap[i] = firstIndex.emplace(elementAt(positions, stride, i), i).first->second;
+		}
+	}
+
+	// Border and non-manifold points keep the silhouette and holes intact;
+	// attribute seams (one point, several vertices) keep attributes intact.
+	void findLockedVertices(const std::vector<UINT>& indices, const std::vector<UINT>& remap, std::vector<bool>& locked)
+	{
+		const UINT vertexCount = (UINT)remap.size();
+		locked.assign(vertexCount, false);
+
+		for (UINT i = 0; i < vertexCount; ++i)
+		{
+			if (remap[i] != i)
+			{
+				locked[i] = true;
+				locked[remap[i]] = true;
+			}
+		}
+
+		std::unordered_map<unsigned long long, int> edgeUse;
+		edgeUse.reserve(indices.size());
+		for (size_t t = 0; t + 2 < indices.size(); t += 3)
+		{
+			for (UINT k = 0; k < 3; ++k)
+			{
+				UINT a = remap[indices[t + k]];
+				UINT b = remap[indices[t + (k + 1) % 3]];
+				if (a > b)
+				{
+					std::swap(a, b);
+				}
+
+				++edgeUse[((unsigned long long)a << 32) | b];
+			}
+		}
+
+		for (const auto& edge : edgeUse)
+		{
+			if (edge.second != 2)
+			{
+				locked[(UINT)(edge.first >> 32)] = true;
+				locked[(UINT)(edge.first & 0xffffffffu)] = true;
+			}
+		}
+
+		for (UINT i = 0; i < vertexCount; ++i)
+		{
+			locked[i] = locked[i] || locked[remap[i]];
+		}
+	}
+
+	bool isFold(
+		const std::vector<UINT>& indices,
+		const std::vector<UINT>& remap,
+		const std::vector<UINT>& triangles,
+		const XMFLOAT3* positions,
+		UINT stride,
+		UINT from,
+		UINT to)
+	{
+		XMVECTOR target = XMLoadFloat3(&elementAt(positions, stride, to));
+
+		for (UINT t : triangles)
+		{
+			const UINT* tri = &indices[t * 3];
+
+			XMVECTOR p[3];
+			XMVECTOR q[3];
+			bool hasTarget = false;
+			for (UINT k = 0; k < 3; ++k)
+			{
+				hasTarget = hasTarget || remap[tri[k]] == remap[to];
+				p[k] = XMLoadFloat3(&elementAt(positions, stride, tri[k]));
+				q[k] = tri[k] == from ? target : p[k];
+			}
+
+			// Triangles on the collapsed edge disappear.
+			if (hasTarget)
+			{
+				continue;
+			}
+
+			XMVECTOR n0 = XMVector3Cross(p[1] - p[0], p[2] - p[0]);
+			XMVECTOR n1 = XMVector3Cross(q[1] - q[0], q[2] - q[0]);
+
+			const float len0 = XMVectorGetX(XMVector3Length(n0));
+			const float len1 = XMVectorGetX(XMVector3Length(n1));
+			if (len1 <= 0.0f)
+			{
+				return true;
+			}
+			if (len0 > 0.0f && XMVectorGetX(XMVector3Dot(n0, n1)) < MaxFoldCosine * len0 * len1)
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void compactIndices(std::vector<UINT>& indices, const std::vector<UINT>& collapseTo, const std::vector<UINT>& remap)
+	{
+		size_t write = 0;
+		for (size_t t = 0; t + 2 < indices.size(); t += 3)
+		{
+			const UINT a = collapseTo[indices[t + 0]];
+			const UINT b = collapseTo[indices[t + 1]];
+			const UINT c = collapseTo[indices[t + 2]];
+
+			if (remap[a] == remap[b] || remap[b] == remap[c] || remap[a] == remap[c])
+			{
+				continue;
+			}
+
+			indices[write++] = a;
+			indices[write++] = b;
+			indices[write++] = c;
+		}
+
+		indices.resize(write);
+	}
+}
+
+namespace
+{
+	// simplify() with the plane sets kept by the caller, built from indices
+	// when empty, so a chain of levels measures against the original.
+	float simplifyLevel(
+		const std::vector<UINT>& indices,
+		const XMFLOAT3* positions,
+		const XMFLOAT3* normals,
+		UINT vertexCount,
+		UINT vertexStride,
+		UINT targetIndexCount,
+		std::vector<UINT>& result,
+		PlaneSets& planes)
+	{
+		result = indices;
+
+		std::vector<UINT> remap;
+		buildPositionRemap(positions, vertexStride, vertexCount, remap);
+
+		if (planes.empty())
+		{
+			buildPlaneSets(indices, positions, vertexStride, remap, planes);
+		}
+
+		std::vector<bool> locked;
+		findLockedVertices(indices, remap, locked);
+
+		std::vector<SQuadric> quadrics(vertexCount, SQuadric());
+		for (size_t t = 0; t + 2 < indices.size(); t += 3)
+		{
+			SQuadric q = planeQuadric(
+				elementAt(positions, vertexStride, indices[t + 0]),
+				elementAt(positions, vertexStride, indices[t + 1]),
+				elementAt(positions, vertexStride, indices[t + 2])
+			);
+
+			for (UINT k = 0; k < 3; ++k)
+			{
+				quadrics[remap[indices[t + k]]].add(q);
+			}
+		}
+
+		float maxError = 0.0f;
+
+		std::vector<UINT> collapseTo(vertexCount);
+		std::vector<bool> touched(vertexCount);
+		std::vector<UINT> offsets;
+		std::vector<UINT> adjacency;
+		std::vector<SCollapse> collapses;
+		std::vector<UINT> vertexTriangles;
+
+		while (result.size() > targetIndexCount)
+		{
+			const UINT triangleCount = (UINT)result.size() / 3;
+
+			// Vertex to triangle adjacency of the current level.
+			offsets.assign(vertexCount + 1, 0);
+			for (UINT index : result)
+			{
+				++offsets[index + 1];
+			}
+			for (UINT i = 0; i < vertexCount; ++i)
+			{
+				offsets[i + 1] += offsets[i];
+			}
+			adjacency.resize(result.size());
+			{
+				std::vector<UINT> fill(offsets.begin(), offsets.end() - 1);
+				for (size_t i = 0; i < result.size(); ++i)
+				{
+					adjacency[fill[result[i]]++] = (UINT)(i / 3);
+				}
+			}
+
+			// Cheapest collapse of every unlocked vertex onto a neighbour.
+			collapses.clear();
+			for (UINT from = 0; from < vertexCount; ++from)
+			{
+				if (locked[from] || offsets[from] == offsets[from + 1])
+				{
+					continue;
+				}
+
+				SCollapse best = { from, from, FLT_MAX };
+				for (UINT a = offsets[from]; a < offsets[from + 1]; ++a)
+				{
+					const UINT* tri = &result[adjacency[a] * 3];
+					for (UINT k = 0; k < 3; ++k)
+					{
+						const UINT to = tri[k];
+						if (to == from)
+						{
+							continue;
+						}
+
+						SQuadric q = quadrics[remap[from]];
+						q.add(quadrics[remap[to]]);
+
+						const XMFLOAT3& target = elementAt(positions, vertexStride, to);
+						float score = (float)sqrt(q.evaluate(target) / MathHelper::max(q.m_weight, 1e-12));
+						if (normals)
+						{
+							const float edgeLength = XMVectorGetX(XMVector3Length(
+								XMLoadFloat3(&target) - XMLoadFloat3(&elementAt(positions, vertexStride, from))));
+							const float deviation = 1.0f - XMVectorGetX(XMVector3Dot(
+								XMLoadFloat3(&elementAt(normals, vertexStride, from)),
+								XMLoadFloat3(&elementAt(normals, vertexStride, to))));
+							score += NormalWeight * deviation * edgeLength;
+						}
+
+						if (score < best.m_score)
+						{
+							best = { from, to, score };
+						}
+					}
+				}
+
+				if (best.m_to != from)
+				{
+					collapses.push_back(best);
+				}
+			}
+
+			if (collapses.empty())
+			{
+				break;
+			}
+
+			std::sort(collapses.begin(), collapses.end(),
+				[](const SCollapse& a, const SCollapse& b) { return a.m_score < b.m_score; });
+
+			// An interior collapse removes two triangles; only consider as many
+			// of the cheapest collapses as needed to reach the target, and leave
+			// the rest for the next pass with fresh costs.
+			const UINT needed = (triangleCount - targetIndexCount / 3);
+			const size_t considered = MathHelper::min(collapses.size(), (size_t)needed / 2 + 1);
+
+			for (UINT i = 0; i < vertexCount; ++i)
+			{
+				collapseTo[i] = i;
+			}
+			touched.assign(vertexCount, false);
+
+			UINT removed = 0;
+			UINT applied = 0;
+			for (size_t c = 0; c < considered && removed < needed; ++c)
+			{
+				const SCollapse& collapse = collapses[c];
+				if (touched[collapse.m_from] || touched[collapse.m_to])
+				{
+					continue;
+				}
+
+				vertexTriangles.assign(
+					adjacency.begin() + offsets[collapse.m_from],
+					adjacency.begin() + offsets[collapse.m_from + 1]);
+
+				if (isFold(result, remap, vertexTriangles, positions, vertexStride, collapse.m_from, collapse.m_to))
+				{
+					continue;
+				}
+
+				// Freeze the whole one-ring so later fold checks in this pass
+				// still see up to date geometry.
+				for (UINT t : vertexTriangles)
+				{
+					const UINT* tri = &result[t * 3];
+					for (UINT k = 0; k < 3; ++k)
+					{
+						touched[tri[k]] = true;
+						removed += remap[tri[k]] == remap[collapse.m_to] ? 1 : 0;
+					}
+				}
+
+				collapseTo[collapse.m_from] = collapse.m_to;
+				quadrics[remap[collapse.m_to]].add(quadrics[remap[collapse.m_from]]);
+
+				// The planes already at the target were measured where it stands.
+				std::vector<XMFLOAT4>& fromPlanes = planes[remap[collapse.m_from]];
+				std::vector<XMFLOAT4>& toPlanes = planes[remap[collapse.m_to]];
+				maxError = MathHelper::max(maxError, getPlaneDistance(fromPlanes, elementAt(positions, vertexStride, collapse.m_to)));
+				toPlanes.insert(toPlanes.end(), fromPlanes.begin(), fromPlanes.end());
+				std::vector<XMFLOAT4>().swap(fromPlanes);
+
+				++applied;
+			}
+
+			if (applied == 0)
+			{
+				break;
+			}
+
+			compactIndices(result, collapseTo, remap);
+		}
+
+		return maxError;
+	}
+}
+
+float MeshSimplifier::simplify(const std::vector<UINT>& indices, const XMFLOAT3* positions, const XMFLOAT3* normals, UINT vertexCount, UINT vertexStride, UINT targetIndexCount, std::vector<UINT>& result)
+{
+	PlaneSets planes;
+	return simplifyLevel(indices, positions, normals, vertexCount, vertexStride, targetIndexCount, result, planes);
+}
+
+void MeshSimplifier::buildLodChain(const std::vector<UINT>& indices, const XMFLOAT3* positions, const XMFLOAT3* normals, UINT vertexCount, UINT vertexStride, const std::vector<float>& triangleRatios, std::vector<SLod>& lods)
+{
+	lods.clear();
+	lods.resize(1 + triangleRatios.size());
+
+	lods[0].m_indices = indices;
+	lods[0].m_error = 0.0f;
+
+	// Each level starts from the previous one, whose quadrics are rebuilt
+	// to order the collapses, but the plane sets carry over, so every error
+	// is measured against the original triangles.
+	PlaneSets planes;
+
+	const UINT triangleCount = (UINT)indices.size() / 3;
+	for (size_t i = 0; i < triangleRatios.size(); ++i)
+	{
+		const UINT targetIndexCount = 3 * (UINT)(triangleCount * triangleRatios[i]);
+
+		const float error = simplifyLevel(
+			lods[i].m_indices,
+			positions,
+			normals,
+			vertexCount,
+			vertexStride,
+			targetIndexCount,
+			lods[i + 1].m_indices,
+			planes
+		);
+
+		lods[i + 1].m_error = MathHelper::max(lods[i].m_error, error);
+	}
+}
+
+UINT MeshSimplifier::selectLod(const std::vector<float>& lodErrors, float scale, float distance, float fovY, float viewportHeight, float pixelTolerance)
+{
+	// World units per pixel at the given distance.
+	const float pixelSize = 2.0f * MathHelper::max(distance, 1e-3f) * tanf(0.5f * fovY) / viewportHeight;
+
+	UINT selected = 0;
+	for (UINT i = 1; i < (UINT)lodErrors.size(); ++i)
+	{
+		if (lodErrors[i] * scale > pixelTolerance * pixelSize)
+		{
+			break;
+		}
+
+		selected = i;
+	}
+
+	return selected;
+}
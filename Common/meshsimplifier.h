@@ -0,0 +1,63 @@
+﻿#pragma once
+
+#include <vector>
+#include <DirectXMath.h>
+#include <windows.h>
+using namespace DirectX;
+
+namespace MeshSimplifier
+{
+	// Simplification only rewrites the index buffer by collapsing vertices
+	// onto their neighbours, so every level shares the original vertex buffer
+	// and keeps the original vertex attributes.
+
+	struct SLod
+	{
+		std::vector<UINT> m_indices;
+
+		// Largest distance, in mesh units, from a vertex of the level to the
+		// plane of an original triangle it stands in for, i.e. one touching
+		// it or a vertex collapsed onto it.
+		float m_error = 0.0f;
+	};
+
+	// Vertices are read through a byte stride from the position and the
+	// optional normal pointers, matching the loaders' position+normal layout.
+	// Normals only steer the collapse order; pass nullptr to ignore them.
+	// Returns the error of the result.
+	float simplify(
+		const std::vector<UINT>& indices,
+		const XMFLOAT3* positions,
+		const XMFLOAT3* normals,
+		UINT vertexCount,
+		UINT vertexStride,
+		UINT targetIndexCount,
+		std::vector<UINT>& result
+	);
+
+	// Level 0 is the input itself; every requested ratio of the original
+	// triangle count adds one level, each simplified from the previous one.
+	// Errors are measured against the planes of the input triangles, so no
+	// level's error is below the one before it.
+	void buildLodChain(
+		const std::vector<UINT>& indices,
+		const XMFLOAT3* positions,
+		const XMFLOAT3* normals,
+		UINT vertexCount,
+		UINT vertexStride,
+		const std::vector<float>& triangleRatios,
+		std::vector<SLod>& lods
+	);
+
+	// Picks the coarsest level whose error, given per level in mesh units and
+	// scaled to world units, projects to at most pixelTolerance pixels at the
+	// given view distance.
+	UINT selectLod(
+		const std::vector<float>& lodErrors,
+		float scale,
+		float distance,
+		float fovY,
+		float viewportHeight,
+		float pixelTolerance = 1.0f
+	);
+}
@@ -0,0 +1,203 @@
+﻿#include "meshstreams.h"
+
+#include <cfloat>
+
+#include "mathhelper.h"
+
+using namespace MeshStreams;
+
+UINT MeshStreams::SMeshStreams::getVertexCount() const
+{
+	return (UINT)m_positions.size();
+}
+
+void MeshStreams::fromMeshData(const GeometryGenerator::SMeshData& meshData, SMeshStreams& streams)
+{
+	const size_t count = meshData.m_vertices.size();
+
+	streams.m_positions.resize(count);
+	streams.m_normals.resize(count);
+	streams.m_tangentsU.resize(count);
+	streams.m_texCs.resize(count);
+	streams.m_colors.clear();
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		const GeometryGenerator::SVertex& vertex = meshData.m_vertices[i];
+		streams.m_positions[i] = vertex.m_position;
+		streams.m_normals[i] = vertex.m_normal;
+		streams.m_tangentsU[i] = vertex.m_tangentU;
+		streams.m_texCs[i] = vertex.m_texC;
+	}
+
+	streams.m_indices = meshData.m_indices;
+}
+
+void MeshStreams::toMeshData(const SMeshStreams& streams, GeometryGenerator::SMeshData& meshData)
+{
+	const UINT count = streams.getVertexCount();
+	const XMFLOAT3 zero(0.0f, 0.0f, 0.0f);
+
+	// Streams missing from the source are written out as zeros.
+	const bool hasNormals = streams.m_normals.size() == count;
+	const bool hasTangents = streams.m_tangentsU.size() == count;
+	const bool hasTexCs = streams.m_texCs.size() == count;
+
+	meshData.m_vertices.resize(count);
+	for (UINT i = 0; i < count; ++i)
+	{
+		GeometryGenerator::SVertex& vertex = meshData.m_vertices[i];
+		vertex.m_position = streams.m_positions[i];
+		vertex.m_normal = hasNormals ? streams.m_normals[i] : zero;
+		vertex.m_tangentU = hasTangents ? streams.m_tangentsU[i] : zero;
+		vertex.m_texC = hasTexCs ? streams.m_texCs[i] : XMFLOAT2(0.0f, 0.0f);
+	}
+
+	meshData.m_indices = streams.m_indices;
+}
+
+void MeshStreams::computeBounds(const std::vector<XMFLOAT3>& positions, XMFLOAT3& vMin, XMFLOAT3& vMax)
+{
+	if (positions.empty())
+	{
+		vMin = vMax = XMFLOAT3(0.0f, 0.0f, 0.0f);
+		return;
+	}
+
+	// Two independent accumulators per bound hide the latency of min/max.
+	XMVECTOR min0 = XMVectorReplicate(FLT_MAX);
+	XMVECTOR min1 = min0;
+	XMVECTOR max0 = XMVectorReplicate(-FLT_MAX);
+	XMVECTOR max1 = max0;
+
+	const size_t count = positions.size();
+	size_t i = 0;
+	for (; i + 1 < count; i += 2)
+	{
+		XMVECTOR p0 = XMLoadFloat3(&positions[i]);
+		XMVECTOR p1 = XMLoadFloat3(&positions[i + 1]);
+		min0 = XMVectorMin(min0, p0);
+		max0 = XMVectorMax(max0, p0);
+		min1 = XMVectorMin(min1, p1);
+		max1 = XMVectorMax(max1, p1);
+	}
+	if (i < count)
+	{
+		XMVECTOR p = XMLoadFloat3(&positions[i]);
+		min0 = XMVectorMin(min0, p);
+		max0 = XMVectorMax(max0, p);
+	}
+
+	XMStoreFloat3(&vMin, XMVectorMin(min0, min1));
+	XMStoreFloat3(&vMax, XMVectorMax(max0, max1));
+}
+
+void MeshStreams::transformPositions(std::vector<XMFLOAT3>& positions, CXMMATRIX transform)
+{
+	if (positions.empty())
+	{
+		return;
+	}
+
+	XMVector3TransformCoordStream(
+		positions.data(), sizeof(XMFLOAT3),
+		positions.data(), sizeof(XMFLOAT3),
+		positions.size(), transform);
+}
+
+void MeshStreams::transformDirections(std::vector<XMFLOAT3>& directions, CXMMATRIX transform)
+{
+	if (directions.empty())
+	{
+		return;
+	}
+
+	XMMATRIX inverseTranspose = MathHelper::inverseTranspose(transform);
+	XMVector3TransformNormalStream(
+		directions.data(), sizeof(XMFLOAT3),
+		directions.data(), sizeof(XMFLOAT3),
+		directions.size(), inverseTranspose);
+
+	for (size_t i = 0; i < directions.size(); ++i)
+	{
+		XMStoreFloat3(&directions[i], XMVector3Normalize(XMLoadFloat3(&directions[i])));
+	}
+}
+
+void MeshStreams::computeNormals(const std::vector<XMFLOAT3>& positions, const std::vector<UINT>& indices, std::vector<XMFLOAT3>& normals)
+{
+	normals.assign(positions.size(), XMFLOAT3(0.0f, 0.0f, 0.0f));
+
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		const UINT i0 = indices[i];
+		const UINT i1 = indices[i + 1];
+		const UINT i2 = indices[i + 2];
+
+		XMVECTOR p0 = XMLoadFloat3(&positions[i0]);
+		XMVECTOR e0 = XMVectorSubtract(XMLoadFloat3(&positions[i1]), p0);
+		XMVECTOR e1 = XMVectorSubtract(XMLoadFloat3(&positions[i2]), p0);
+
+		// The unnormalized cross product weights each face by its area.
+		XMVECTOR faceNormal = XMVector3Cross(e0, e1);
+
+		XMStoreFloat3(&normals[i0], XMVectorAdd(XMLoadFloat3(&normals[i0]), faceNormal));
+		XMStoreFloat3(&normals[i1], XMVectorAdd(XMLoadFloat3(&normals[i1]), faceNormal));
+		XMStoreFloat3(&normals[i2], XMVectorAdd(XMLoadFloat3(&normals[i2]), faceNormal));
+	}
+
+	for (size_t i = 0; i < normals.size(); ++i)
+	{
+		XMStoreFloat3(&normals[i], XMVector3Normalize(XMLoadFloat3(&normals[i])));
+	}
+}
+
+void MeshStreams::computeTangents(const std::vector<XMFLOAT3>& positions, const std::vector<XMFLOAT3>& normals, const std::vector<XMFLOAT2>& texCs, const std::vector<UINT>& indices, std::vector<XMFLOAT3>& tangentsU)
+{
+	tangentsU.assign(positions.size(), XMFLOAT3(0.0f, 0.0f, 0.0f));
+
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		const UINT i0 = indices[i];
+		const UINT i1 = indices[i + 1];
+		const UINT i2 = indices[i + 2];
+
+		XMVECTOR p0 = XMLoadFloat3(&positions[i0]);
+		XMVECTOR e0 = XMVectorSubtract(XMLoadFloat3(&positions[i1]), p0);
+		XMVECTOR e1 = XMVectorSubtract(XMLoadFloat3(&positions[i2]), p0);
+
+		const float du0 = texCs[i1].x - texCs[i0].x;
+		const float dv0 = texCs[i1].y - texCs[i0].y;
+		const float du1 = texCs[i2].x - texCs[i0].x;
+		const float dv1 = texCs[i2].y - texCs[i0].y;
+
+		const float det = du0 * dv1 - du1 * dv0;
+		if (det == 0.0f)
+		{
+			continue;
+		}
+
+		// Solve e0 = du0 * T + dv0 * B, e1 = du1 * T + dv1 * B for T. The
+		// determinant's magnitude is dropped so that faces with a larger
+		// texture area do not dominate.
+		XMVECTOR tangent = XMVectorSubtract(XMVectorScale(e0, dv1), XMVectorScale(e1, dv0));
+		if (det < 0.0f)
+		{
+			tangent = XMVectorNegate(tangent);
+		}
+
+		XMStoreFloat3(&tangentsU[i0], XMVectorAdd(XMLoadFloat3(&tangentsU[i0]), tangent));
+		XMStoreFloat3(&tangentsU[i1], XMVectorAdd(XMLoadFloat3(&tangentsU[i1]), tangent));
+		XMStoreFloat3(&tangentsU[i2], XMVectorAdd(XMLoadFloat3(&tangentsU[i2]), tangent));
+	}
+
+	for (size_t i = 0; i < tangentsU.size(); ++i)
+	{
+		XMVECTOR n = XMLoadFloat3(&normals[i]);
+		XMVECTOR t = XMLoadFloat3(&tangentsU[i]);
+
+		// Gram-Schmidt against the normal.
+		t = XMVectorSubtract(t, XMVectorMultiply(n, XMVector3Dot(n, t)));
+		XMStoreFloat3(&tangentsU[i], XMVector3Normalize(t));
+	}
+}
@@ -0,0 +1,83 @@
+﻿#pragma once
+
+#include <vector>
+#include <DirectXMath.h>
+#include <windows.h>
+
+#include "geometrygenerator.h"
+using namespace DirectX;
+
+namespace MeshStreams
+{
+	// Structure-of-arrays mesh: every attribute lives in its own tightly
+	// packed stream, so passes that only read positions do not pull the
+	// other attributes through the cache. Streams a mesh does not have are
+	// left empty; the ones present all hold getVertexCount() elements.
+	struct SMeshStreams
+	{
+		std::vector<XMFLOAT3> m_positions;
+		std::vector<XMFLOAT3> m_normals;
+		std::vector<XMFLOAT3> m_tangentsU;
+		std::vector<XMFLOAT2> m_texCs;
+		std::vector<XMFLOAT4> m_colors;
+		std::vector<UINT> m_indices;
+
+		UINT getVertexCount() const;
+	};
+
+	void fromMeshData(const GeometryGenerator::SMeshData& meshData, SMeshStreams& streams);
+	void toMeshData(const SMeshStreams& streams, GeometryGenerator::SMeshData& meshData);
+
+	// Conversions to and from the demos' own vertex structs, one attribute at
+	// a time through a pointer to the member, e.g.
+	//   MeshStreams::scatter(streams.m_positions, &Vertex::SBasic32::m_pos, vertices);
+	//   MeshStreams::scatter(streams.m_normals, &Vertex::SBasic32::m_normal, vertices);
+	// scatter() grows the vertex array when the stream is longer.
+	template<class TVertex, class TElement>
+	void gather(const std::vector<TVertex>& vertices, TElement TVertex::* member, std::vector<TElement>& stream)
+	{
+		stream.resize(vertices.size());
+		for (size_t i = 0; i < vertices.size(); ++i)
+		{
+			stream[i] = vertices[i].*member;
+		}
+	}
+
+	template<class TVertex, class TElement>
+	void scatter(const std::vector<TElement>& stream, TElement TVertex::* member, std::vector<TVertex>& vertices)
+	{
+		if (vertices.size() < stream.size())
+		{
+			vertices.resize(stream.size());
+		}
+		for (size_t i = 0; i < stream.size(); ++i)
+		{
+			vertices[i].*member = stream[i];
+		}
+	}
+
+	// Algorithms working directly on single streams.
+
+	void computeBounds(const std::vector<XMFLOAT3>& positions, XMFLOAT3& vMin, XMFLOAT3& vMax);
+
+	void transformPositions(std::vector<XMFLOAT3>& positions, CXMMATRIX transform);
+
+	// Uses the inverse transpose of the transform and renormalizes.
+	void transformDirections(std::vector<XMFLOAT3>& directions, CXMMATRIX transform);
+
+	// Area weighted vertex normals from the triangle list.
+	void computeNormals(
+		const std::vector<XMFLOAT3>& positions,
+		const std::vector<UINT>& indices,
+		std::vector<XMFLOAT3>& normals
+	);
+
+	// Tangents along increasing u, orthogonalized against the normals.
+	void computeTangents(
+		const std::vector<XMFLOAT3>& positions,
+		const std::vector<XMFLOAT3>& normals,
+		const std::vector<XMFLOAT2>& texCs,
+		const std::vector<UINT>& indices,
+		std::vector<XMFLOAT3>& tangentsU
+	);
+}
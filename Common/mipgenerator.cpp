@@ -0,0 +1,458 @@
+﻿#include "mipgenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+
+#include "threadpool.h"
+
+using namespace DirectX;
+
+namespace
+{
+	const float KaiserRadius = 3.0f;
+	const float KaiserBeta = 4.0f;
+	const float LanczosRadius = 3.0f;
+
+	// Steps of the linear to sRGB table; fine enough to stay within a fifth
+	// of a level at the steep dark end of the curve.
+	const UINT LinearToSrgbTableSize = 16384;
+
+	struct STap
+	{
+		UINT m_index;
+		float m_weight;
+	};
+
+	// Taps of every destination texel along one axis: texel i reads
+	// m_taps[m_first[i]] up to m_taps[m_first[i + 1]].
+	struct SAxisFilter
+	{
+		std::vector<UINT> m_first;
+		std::vector<STap> m_taps;
+	};
+
+	struct SColorTables
+	{
+		SColorTables()
+		{
+			for (UINT i = 0; i < 256; ++i)
+			{
+				const float value = i / 255.0f;
+				m_srgbToLinear[i] = value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+			}
+
+			for (UINT i = 0; i < LinearToSrgbTableSize; ++i)
+			{
+				const float value = i / (float)(LinearToSrgbTableSize - 1);
+				const float srgb = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+				m_linearToSrgb[i] = (unsigned char)std::min(255.0f, srgb * 255.0f + 0.5f);
+			}
+		}
+
+		float m_srgbToLinear[256];
+		unsigned char m_linearToSrgb[LinearToSrgbTableSize];
+	};
+
+	const SColorTables& getColorTables()
+	{
+		static const SColorTables tables;
+		return tables;
+	}
+
+	float sinc(float x)
+	{
+		if (std::fabs(x) < 1.0e-5f)
+		{
+			return 1.0f;
+		}
+		x *= XM_PI;
+		return std::sin(x) / x;
+	}
+
+	// Modified Bessel function of the first kind, order 0, by its series.
+	float besselI0(float x)
+	{
+		float sum = 1.0f;
+		float term = 1.0f;
+		for (UINT k = 1; term > sum * 1.0e-7f; ++k)
+		{
+			const float factor = x / (2.0f * k);
+			term *= factor * factor;
+			sum += term;
+		}
+		return sum;
+	}
+
+	float getFilterRadius(MipGenerator::EFilter filter)
+	{
+		switch (filter)
+		{
+		case MipGenerator::EFilter::Box:
+			return 0.5f;
+		case MipGenerator::EFilter::Kaiser:
+			return KaiserRadius;
+		default:
+			return LanczosRadius;
+		}
+	}
+
+	// Weight of a texel x destination texels from the center of the one
+	// being filtered.
+	float evaluateFilter(MipGenerator::EFilter filter, float x)
+	{
+		const float distance = std::fabs(x);
+
+		switch (filter)
+		{
+		case MipGenerator::EFilter::Box:
+			// Texels on the edge are shared with the neighbour.
+			return distance < 0.5f ? 1.0f : (distance == 0.5f ? 0.5f : 0.0f);
+
+		case MipGenerator::EFilter::Kaiser:
+		{
+			if (distance >= KaiserRadius)
+			{
+				return 0.0f;
+			}
+			const float t = distance / KaiserRadius;
+			return sinc(distance) * besselI0(KaiserBeta * std::sqrt(1.0f - t * t)) / besselI0(KaiserBeta);
+		}
+
+		default:
+			return distance < LanczosRadius ? sinc(distance) * sinc(distance / LanczosRadius) : 0.0f;
+		}
+	}
+
+	UINT addressTexel(int index, UINT size, MipGenerator::EAddressMode addressMode)
+	{
+		if (addressMode == MipGenerator::EAddressMode::Wrap)
+		{
+			const int wrapped = index % (int)size;
+			return (UINT)(wrapped < 0 ? wrapped + (int)size : wrapped);
+		}
+		return (UINT)std::min(std::max(index, 0), (int)size - 1);
+	}
+
+	// The filter is stretched over as many source texels as a destination
+	// texel covers, so it removes the detail the destination cannot hold.
+	void buildAxisFilter(
+		const MipGenerator::SOptions& options,
+		UINT sourceSize,
+		UINT destinationSize,
+		SAxisFilter& axisFilter)
+	{
+		const float scale = (float)sourceSize / destinationSize;
+		const float radius = getFilterRadius(options.m_filter) * scale;
+
+		axisFilter.m_first.resize(destinationSize + 1);
+		axisFilter.m_taps.clear();
+
+		for (UINT i = 0; i < destinationSize; ++i)
+		{
+			const size_t first = axisFilter.m_taps.size();
+			axisFilter.m_first[i] = (UINT)first;
+
+			const float center = (i + 0.5f) * scale - 0.5f;
+			const int begin = (int)std::ceil(center - radius);
+			const int end = (int)std::floor(center + radius);
+
+			float weightSum = 0.0f;
+			for (int j = begin; j <= end; ++j)
+			{
+				const float weight = evaluateFilter(options.m_filter, (j - center) / scale);
+				if (weight != 0.0f)
+				{
+					STap tap;
+					tap.m_index = addressTexel(j, sourceSize, options.m_addressMode);
+					tap.m_weight = weight;
+					axisFilter.m_taps.push_back(tap);
+					weightSum += weight;
+				}
+			}
+
+			if (std::fabs(weightSum) < 1.0e-6f)
+			{
+				axisFilter.m_taps.resize(first);
+				STap tap;
+				tap.m_index = addressTexel((int)std::floor(center + 0.5f), sourceSize, options.m_addressMode);
+				tap.m_weight = 1.0f;
+				axisFilter.m_taps.push_back(tap);
+				continue;
+			}
+
+			for (size_t t = first; t < axisFilter.m_taps.size(); ++t)
+			{
+				axisFilter.m_taps[t].m_weight /= weightSum;
+			}
+		}
+
+		axisFilter.m_first[destinationSize] = (UINT)axisFilter.m_taps.size();
+	}
+
+	// Top level in linear light with premultiplied alpha.
+	void convertToLinear(const MipGenerator::SSource& source, bool isSrgb, std::vector<XMFLOAT4A>& pixels)
+	{
+		const SColorTables& tables = getColorTables();
+
+		pixels.resize((size_t)source.m_width * source.m_height);
+		for (UINT y = 0; y < source.m_height; ++y)
+		{
+			const UINT* row = reinterpret_cast<const UINT*>(reinterpret_cast<const unsigned char*>(source.m_pixels) + (size_t)y * source.m_rowPitch);
+			for (UINT x = 0; x < source.m_width; ++x)
+			{
+				const UINT pixel = row[x];
+				const float alpha = (pixel >> 24) / 255.0f;
+
+				XMFLOAT4A& destination = pixels[(size_t)y * source.m_width + x];
+				for (UINT c = 0; c < 3; ++c)
+				{
+					const UINT value = (pixel >> (c * 8)) & 0xFF;
+					(&destination.x)[c] = (isSrgb ? tables.m_srgbToLinear[value] : value / 255.0f) * alpha;
+				}
+				destination.w = alpha;
+			}
+		}
+	}
+
+	// Resamples the top level to a level's size, rows first.
+	void filterLevel(
+		const std::vector<XMFLOAT4A>& top,
+		UINT width,
+		UINT height,
+		UINT levelWidth,
+		UINT levelHeight,
+		const MipGenerator::SOptions& options,
+		std::vector<XMFLOAT4A>& level)
+	{
+		SAxisFilter axisFilter;
+		buildAxisFilter(options, width, levelWidth, axisFilter);
+
+		std::vector<XMFLOAT4A> rows((size_t)levelWidth * height);
+		for (UINT y = 0; y < height; ++y)
+		{
+			const XMFLOAT4A* source = &top[(size_t)y * width];
+			XMFLOAT4A* destination = &rows[(size_t)y * levelWidth];
+
+			for (UINT x = 0; x < levelWidth; ++x)
+			{
+				XMVECTOR sum = XMVectorZero();
+				for (UINT t = axisFilter.m_first[x]; t < axisFilter.m_first[x + 1]; ++t)
+				{
+					const STap& tap = axisFilter.m_taps[t];
+					sum = XMVectorMultiplyAdd(XMLoadFloat4A(&source[tap.m_index]), XMVectorReplicate(tap.m_weight), sum);
+				}
+				XMStoreFloat4A(&destination[x], sum);
+			}
+		}
+
+		buildAxisFilter(options, height, levelHeight, axisFilter);
+
+		level.resize((size_t)levelWidth * levelHeight);
+		for (UINT y = 0; y < levelHeight; ++y)
+		{
+			XMFLOAT4A* destination = &level[(size_t)y * levelWidth];
+			std::memset(destination, 0, levelWidth * sizeof(XMFLOAT4A));
+
+			// Whole rows at a time, so the reads stay sequential.
+			for (UINT t = axisFilter.m_first[y]; t < axisFilter.m_first[y + 1]; ++t)
+			{
+				const STap& tap = axisFilter.m_taps[t];
+				const XMVECTOR weight = XMVectorReplicate(tap.m_weight);
+				const XMFLOAT4A* source = &rows[(size_t)tap.m_index * levelWidth];
+
+				for (UINT x = 0; x < levelWidth; ++x)
+				{
+					XMStoreFloat4A(&destination[x], XMVectorMultiplyAdd(XMLoadFloat4A(&source[x]), weight, XMLoadFloat4A(&destination[x])));
+				}
+			}
+		}
+	}
+
+	// Factor for the alpha of a level that makes coverage of its texels
+	// pass an alpha test against reference.
+	float getAlphaScale(const std::vector<XMFLOAT4A>& level, float coverage, float reference)
+	{
+		const size_t passCount = (size_t)(coverage * level.size() + 0.5f);
+		if (passCount == 0 || passCount > level.size())
+		{
+			return 1.0f;
+		}
+
+		std::vector<float> alphas(level.size());
+		for (size_t i = 0; i < level.size(); ++i)
+		{
+			alphas[i] = level[i].w;
+		}
+
+		// The passCount-th largest alpha has to reach the reference, the
+		// next one has to stay below it.
+		std::nth_element(alphas.begin(), alphas.begin() + (passCount - 1), alphas.end(), std::greater<float>());
+		const float lowestPassing = alphas[passCount - 1];
+		if (lowestPassing <= 0.0f)
+		{
+			return 1.0f;
+		}
+
+		float highestFailing = 0.0f;
+		if (passCount < alphas.size())
+		{
+			highestFailing = *std::max_element(alphas.begin() + passCount, alphas.end());
+		}
+
+		const float threshold = highestFailing < lowestPassing ? 0.5f * (lowestPassing + highestFailing) : lowestPassing;
+		return reference / threshold;
+	}
+
+	void convertFromLinear(const std::vector<XMFLOAT4A>& level, bool isSrgb, float alphaScale, std::vector<UINT>& pixels)
+	{
+		const SColorTables& tables = getColorTables();
+
+		pixels.resize(level.size());
+		for (size_t i = 0; i < level.size(); ++i)
+		{
+			const XMVECTOR premultiplied = XMLoadFloat4A(&level[i]);
+			const float alpha = XMVectorGetW(premultiplied);
+
+			XMFLOAT4A color;
+			XMStoreFloat4A(&color, XMVectorSaturate(alpha > 0.0f ? XMVectorScale(premultiplied, 1.0f / alpha) : premultiplied));
+
+			UINT pixel = 0;
+			for (UINT c = 0; c < 3; ++c)
+			{
+				const float value = (&color.x)[c];
+				const UINT byte = isSrgb ?
+					tables.m_linearToSrgb[(UINT)(value * (LinearToSrgbTableSize - 1) + 0.5f)] :
+					(UINT)(value * 255.0f + 0.5f);
+				pixel |= byte << (c * 8);
+			}
+
+			const float scaledAlpha = std::min(std::max(alpha * alphaScale, 0.0f), 1.0f);
+			pixels[i] = pixel | ((UINT)(scaledAlpha * 255.0f + 0.5f) << 24);
+		}
+	}
+
+	float getAlphaCoverage(const MipGenerator::SSource& source, float reference)
+	{
+		const UINT threshold = (UINT)std::ceil(reference * 255.0f);
+
+		size_t passCount = 0;
+		for (UINT y = 0; y < source.m_height; ++y)
+		{
+			const UINT* row = reinterpret_cast<const UINT*>(reinterpret_cast<const unsigned char*>(source.m_pixels) + (size_t)y * source.m_rowPitch);
+			for (UINT x = 0; x < source.m_width; ++x)
+			{
+				passCount += (row[x] >> 24) >= threshold;
+			}
+		}
+		return (float)passCount / ((size_t)source.m_width * source.m_height);
+	}
+}
+
+UINT MipGenerator::getMipCount(UINT width, UINT height)
+{
+	UINT count = 1;
+	for (UINT size = std::max(width, height); size > 1; size >>= 1)
+	{
+		++count;
+	}
+	return count;
+}
+
+void MipGenerator::generate(const SSource& source, const SOptions& options, std::vector<SMip>& mips, UINT mipCount)
+{
+	std::vector<std::vector<SMip>> results;
+	generate(std::vector<SSource>(1, source), options, results, mipCount);
+	mips.swap(results[0]);
+}
+
+void MipGenerator::generate(
+	const std::vector<SSource>& sources,
+	const SOptions& options,
+	std::vector<std::vector<SMip>>& mips,
+	UINT mipCount)
+{
+	const UINT imageCount = (UINT)sources.size();
+	CThreadPool& threadPool = CThreadPool::getShared();
+
+	mips.assign(imageCount, std::vector<SMip>());
+	std::vector<std::vector<XMFLOAT4A>> tops(imageCount);
+	std::vector<float> coverages(imageCount, 0.0f);
+
+	struct STask
+	{
+		UINT m_image;
+		UINT m_level;
+	};
+	std::vector<STask> tasks;
+
+	for (UINT image = 0; image < imageCount; ++image)
+	{
+		const SSource& source = sources[image];
+		const UINT fullCount = getMipCount(source.m_width, source.m_height);
+		const UINT levelCount = mipCount == 0 ? fullCount : std::min(mipCount, fullCount);
+
+		mips[image].resize(levelCount);
+		for (UINT level = 0; level < levelCount; ++level)
+		{
+			SMip& mip = mips[image][level];
+			mip.m_width = std::max(source.m_width >> level, 1u);
+			mip.m_height = std::max(source.m_height >> level, 1u);
+
+			if (level > 0)
+			{
+				STask task;
+				task.m_image = image;
+				task.m_level = level;
+				tasks.push_back(task);
+			}
+		}
+	}
+
+	threadPool.parallelFor(0, imageCount, 1, [&](UINT begin, UINT end)
+	{
+		for (UINT image = begin; image < end; ++image)
+		{
+			const SSource& source = sources[image];
+			SMip& top = mips[image][0];
+
+			top.m_pixels.resize((size_t)source.m_width * source.m_height);
+			for (UINT y = 0; y < source.m_height; ++y)
+			{
+				std::memcpy(
+					&top.m_pixels[(size_t)y * source.m_width],
+					reinterpret_cast<const unsigned char*>(source.m_pixels) + (size_t)y * source.m_rowPitch,
+					source.m_width * 4
+				);
+			}
+
+			if (mips[image].size() > 1)
+			{
+				convertToLinear(source, options.m_isSrgb, tops[image]);
+				if (options.m_alphaCoverageReference > 0.0f)
+				{
+					coverages[image] = getAlphaCoverage(source, options.m_alphaCoverageReference);
+				}
+			}
+		}
+	});
+
+	threadPool.parallelFor(0, (UINT)tasks.size(), 1, [&](UINT begin, UINT end)
+	{
+		std::vector<XMFLOAT4A> level;
+		for (UINT t = begin; t < end; ++t)
+		{
+			const SSource& source = sources[tasks[t].m_image];
+			SMip& mip = mips[tasks[t].m_image][tasks[t].m_level];
+
+			filterLevel(tops[tasks[t].m_image], source.m_width, source.m_height, mip.m_width, mip.m_height, options, level);
+
+			const float alphaScale = options.m_alphaCoverageReference > 0.0f ?
+				getAlphaScale(level, coverages[tasks[t].m_image], options.m_alphaCoverageReference) :
+				1.0f;
+
+			convertFromLinear(level, options.m_isSrgb, alphaScale, mip.m_pixels);
+		}
+	});
+}
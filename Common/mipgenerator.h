@@ -0,0 +1,85 @@
+﻿#pragma once
+
+#include <vector>
+#include <DirectXMath.h>
+#include <windows.h>
+
+// Builds mip chains of R8G8B8A8 images on the CPU, for textures whose
+// sources have none, before they go through BlockCompressor and DdsFile.
+//
+// Every level is filtered straight from the top level rather than from
+// the level above, so blur and rounding do not pile up down the chain and
+// the levels do not depend on each other: the levels of all images being
+// processed run side by side on the shared thread pool. Each level costs
+// about the same, a separable pass per axis with four channels at a time.
+//
+// Filtering happens in linear light on premultiplied colors, so mips of
+// sRGB images keep their brightness and transparent texels do not bleed
+// their color into their neighbours.
+namespace MipGenerator
+{
+	enum class EFilter
+	{
+		// Average of the texels a mip texel covers; cheap and soft.
+		Box,
+
+		// Sinc windowed with a Kaiser window of radius 3; sharper, with
+		// little ringing.
+		Kaiser,
+
+		// Lanczos with three lobes; sharpest, with some ringing.
+		Lanczos
+	};
+
+	enum class EAddressMode
+	{
+		// For tiling textures: the filter wraps around the edges.
+		Wrap,
+		Clamp
+	};
+
+	struct SOptions
+	{
+		EFilter m_filter = EFilter::Kaiser;
+		EAddressMode m_addressMode = EAddressMode::Wrap;
+
+		// Treat the color channels as sRGB; alpha is always linear.
+		bool m_isSrgb = true;
+
+		// Alpha-test reference in 0..1, e.g. 0.5 for clip(alpha - 0.5). When
+		// above zero, the alpha of each mip is scaled so the share of texels
+		// that pass the test stays that of the top level, which keeps
+		// alpha-tested foliage and fences from thinning out in the distance.
+		float m_alphaCoverageReference = 0.0f;
+	};
+
+	struct SMip
+	{
+		UINT m_width;
+		UINT m_height;
+		std::vector<UINT> m_pixels;
+	};
+
+	struct SSource
+	{
+		const UINT* m_pixels;
+		UINT m_width;
+		UINT m_height;
+		UINT m_rowPitch;
+	};
+
+	// Levels down to 1x1.
+	UINT getMipCount(UINT width, UINT height);
+
+	// Fills mips with levels 0 to mipCount - 1, level 0 being a copy of the
+	// source; zero means the whole chain.
+	void generate(const SSource& source, const SOptions& options, std::vector<SMip>& mips, UINT mipCount = 0);
+
+	// The same for several images, e.g. the frames of an animation.
+	void generate(
+		const std::vector<SSource>& sources,
+		const SOptions& options,
+		std::vector<std::vector<SMip>>& mips,
+		UINT mipCount = 0
+	);
+}
@@ -0,0 +1,265 @@
+﻿#include "modelloader.h"
+
+#include <charconv>
+#include <cstring>
+#include <fstream>
+
+#include "fileutil.h"
+#include "threadpool.h"
+
+using FileUtil::setError;
+
+namespace
+{
+	// Text handed to a worker at a time.
+	const size_t BytesPerChunk = 64 * 1024;
+
+	inline bool isSpace(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+	}
+
+	const char* skipSpace(const char* p, const char* end)
+	{
+		while (p < end && isSpace(*p))
+		{
+			++p;
+		}
+		return p;
+	}
+
+	// Reads "<label> <count>", e.g. "VertexCount: 31076".
+	bool parseCount(const char*& p, const char* end, const char* label, UINT& count)
+	{
+		const size_t labelLength = std::strlen(label);
+
+		p = skipSpace(p, end);
+		if ((size_t)(end - p) < labelLength || std::memcmp(p, label, labelLength) != 0)
+		{
+			return false;
+		}
+
+		p = skipSpace(p + labelLength, end);
+		std::from_chars_result result = std::from_chars(p, end, count);
+		if (result.ec != std::errc())
+		{
+			return false;
+		}
+
+		p = result.ptr;
+		return true;
+	}
+
+	// Finds the body of "<label> ... { body }" and leaves p after the '}'.
+	bool findList(const char*& p, const char* end, const char* label, const char*& bodyBegin, const char*& bodyEnd)
+	{
+		const size_t labelLength = std::strlen(label);
+
+		p = skipSpace(p, end);
+		if ((size_t)(end - p) < labelLength || std::memcmp(p, label, labelLength) != 0)
+		{
+			return false;
+		}
+
+		const char* open = static_cast<const char*>(std::memchr(p, '{', end - p));
+		if (!open)
+		{
+			return false;
+		}
+
+		const char* close = static_cast<const char*>(std::memchr(open, '}', end - open));
+		if (!close)
+		{
+			return false;
+		}
+
+		bodyBegin = open + 1;
+		bodyEnd = close;
+		p = close + 1;
+		return true;
+	}
+
+	template<class T>
+	bool parseValues(const char* p, const char* end, std::vector<T>& values)
+	{
+		values.reserve((end - p) / 8);
+
+		for (;;)
+		{
+			p = skipSpace(p, end);
+			if (p == end)
+			{
+				return true;
+			}
+
+			T value;
+			std::from_chars_result result = std::from_chars(p, end, value);
+			if (result.ec != std::errc() || (result.ptr != end && !isSpace(*result.ptr)))
+			{
+				return false;
+			}
+
+			values.push_back(value);
+			p = result.ptr;
+		}
+	}
+
+	// Parses the whitespace separated numbers of [begin, end) into values,
+	// in order. Chunks are cut at whitespace, so no number is split.
+	template<class T>
+	bool parseList(const char* begin, const char* end, std::vector<T>& values, CThreadPool& threadPool)
+	{
+		std::vector<const char*> bounds(1, begin);
+		for (;;)
+		{
+			if ((size_t)(end - bounds.back()) <= BytesPerChunk)
+			{
+				break;
+			}
+
+			const char* cut = bounds.back() + BytesPerChunk;
+			while (cut < end && !isSpace(*cut))
+			{
+				++cut;
+			}
+			bounds.push_back(cut);
+		}
+		bounds.push_back(end);
+
+		const UINT chunkCount = (UINT)bounds.size() - 1;
+		std::vector<std::vector<T>> chunkValues(chunkCount);
+		std::vector<char> chunkValid(chunkCount, 0);
+
+		threadPool.parallelFor(0, chunkCount, 1, [&](UINT chunkBegin, UINT chunkEnd)
+		{
+			for (UINT chunk = chunkBegin; chunk < chunkEnd; ++chunk)
+			{
+				chunkValid[chunk] = parseValues(bounds[chunk], bounds[chunk + 1], chunkValues[chunk]);
+			}
+		});
+
+		size_t totalCount = 0;
+		for (UINT chunk = 0; chunk < chunkCount; ++chunk)
+		{
+			if (!chunkValid[chunk])
+			{
+				return false;
+			}
+			totalCount += chunkValues[chunk].size();
+		}
+
+		values.clear();
+		values.reserve(totalCount);
+		for (const std::vector<T>& chunk : chunkValues)
+		{
+			values.insert(values.end(), chunk.begin(), chunk.end());
+		}
+
+		return true;
+	}
+}
+
+bool ModelLoader::loadTextModel(const std::string& path, MeshStreams::SMeshStreams& model, std::string* error, CThreadPool& threadPool)
+{
+	std::ifstream fin(path, std::ios::binary);
+	if (!fin)
+	{
+		return setError(error, path + " not found");
+	}
+
+	fin.seekg(0, std::ios::end);
+	const std::streamoff size = fin.tellg();
+	fin.seekg(0, std::ios::beg);
+
+	std::vector<char> text((size_t)size);
+	if (!fin.read(text.data(), size))
+	{
+		return setError(error, path + " could not be read");
+	}
+
+	if (!parseTextModel(text.data(), text.size(), model, error, threadPool))
+	{
+		if (error)
+		{
+			*error = path + ": " + *error;
+		}
+		return false;
+	}
+
+	return true;
+}
+
+bool ModelLoader::loadTextModel(const std::string& path, MeshStreams::SMeshStreams& model, std::string* error)
+{
+	return loadTextModel(path, model, error, CThreadPool::getShared());
+}
+
+bool ModelLoader::parseTextModel(const char* text, size_t size, MeshStreams::SMeshStreams& model, std::string* error, CThreadPool& threadPool)
+{
+	const char* p = text;
+	const char* end = text + size;
+
+	UINT vertexCount = 0;
+	UINT triangleCount = 0;
+	if (!parseCount(p, end, "VertexCount:", vertexCount) ||
+		!parseCount(p, end, "TriangleCount:", triangleCount))
+	{
+		return setError(error, "missing VertexCount or TriangleCount");
+	}
+
+	const char* vertexBegin;
+	const char* vertexEnd;
+	const char* triangleBegin;
+	const char* triangleEnd;
+	if (!findList(p, end, "VertexList", vertexBegin, vertexEnd) ||
+		!findList(p, end, "TriangleList", triangleBegin, triangleEnd))
+	{
+		return setError(error, "missing VertexList or TriangleList");
+	}
+
+	std::vector<float> vertexValues;
+	if (!parseList(vertexBegin, vertexEnd, vertexValues, threadPool))
+	{
+		return setError(error, "malformed number in VertexList");
+	}
+
+	if (vertexValues.size() != (size_t)vertexCount * 6)
+	{
+		return setError(error, "VertexList holds " + std::to_string(vertexValues.size()) +
+			" values, VertexCount " + std::to_string(vertexCount) + " needs " +
+			std::to_string((size_t)vertexCount * 6));
+	}
+
+	std::vector<UINT> indices;
+	if (!parseList(triangleBegin, triangleEnd, indices, threadPool))
+	{
+		return setError(error, "malformed index in TriangleList");
+	}
+
+	if (indices.size() != (size_t)triangleCount * 3)
+	{
+		return setError(error, "TriangleList holds " + std::to_string(indices.size()) +
+			" indices, TriangleCount " + std::to_string(triangleCount) + " needs " +
+			std::to_string((size_t)triangleCount * 3));
+	}
+
+	for (UINT index : indices)
+	{
+		if (index >= vertexCount)
+		{
+			return setError(error, "index " + std::to_string(index) + " out of range");
+		}
+	}
+
+	model.m_positions.resize(vertexCount);
+	model.m_normals.resize(vertexCount);
+	for (UINT i = 0; i < vertexCount; ++i)
+	{
+		const float* v = &vertexValues[(size_t)i * 6];
+		model.m_positions[i] = XMFLOAT3(v[0], v[1], v[2]);
+		model.m_normals[i] = XMFLOAT3(v[3], v[4], v[5]);
+	}
+	model.m_indices = std::move(indices);
+
+	return true;
+}
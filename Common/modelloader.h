@@ -0,0 +1,51 @@
+﻿#pragma once
+
+#include <string>
+
+#include "meshstreams.h"
+
+class CThreadPool;
+
+// Reader for the demos' text models (Models/skull.txt, Models/car.txt):
+//
+//   VertexCount: 31076
+//   TriangleCount: 60339
+//   VertexList (pos, normal)
+//   {
+//   	px py pz nx ny nz
+//   	...
+//   }
+//   TriangleList
+//   {
+//   	i0 i1 i2
+//   	...
+//   }
+//
+// The file is read in one go and the two lists are cut into chunks that are
+// parsed with std::from_chars on the thread pool. Fills m_positions,
+// m_normals and m_indices of the streams. On a missing file, a list whose
+// length does not match the declared count or an index out of range it
+// returns false and describes the problem in error, when given.
+namespace ModelLoader
+{
+	bool loadTextModel(
+		const std::string& path,
+		MeshStreams::SMeshStreams& model,
+		std::string* error,
+		CThreadPool& threadPool
+	);
+	bool loadTextModel(
+		const std::string& path,
+		MeshStreams::SMeshStreams& model,
+		std::string* error = nullptr
+	);
+
+	// Same on text already in memory.
+	bool parseTextModel(
+		const char* text,
+		size_t size,
+		MeshStreams::SMeshStreams& model,
+		std::string* error,
+		CThreadPool& threadPool
+	);
+}
@@ -0,0 +1,561 @@
+﻿#include "noise.h"
+
+#include "threadpool.h"
+
+namespace
+{
+	// Rows handed to a worker at a time; roughly 16k samples per chunk.
+	const UINT SamplesPerChunk = 16384;
+
+	// Bring the sum of corner contributions to about [-1, 1].
+	const float SimplexScale2 = 99.2f;
+	const float SimplexScale3 = 40.0f;
+
+	// Per-seed lattice offsets and first hash offset, all in [0, 289).
+	struct SSeed
+	{
+		XMVECTOR m_x;
+		XMVECTOR m_y;
+		XMVECTOR m_z;
+		XMVECTOR m_hash;
+	};
+
+	UINT mixBits(UINT v)
+	{
+		v ^= v >> 16;
+		v *= 0x7feb352d;
+		v ^= v >> 15;
+		v *= 0x846ca68b;
+		v ^= v >> 16;
+		return v;
+	}
+
+	SSeed makeSeed(UINT seed)
+	{
+		UINT bits = mixBits(seed);
+
+		SSeed result;
+		result.m_x = XMVectorReplicate((float)(bits % 289));
+		bits = mixBits(bits);
+		result.m_y = XMVectorReplicate((float)(bits % 289));
+		bits = mixBits(bits);
+		result.m_z = XMVectorReplicate((float)(bits % 289));
+		bits = mixBits(bits);
+		result.m_hash = XMVectorReplicate((float)(bits % 289));
+		return result;
+	}
+
+	// Octaves get unrelated seeds so their lattices do not line up.
+	UINT getOctaveSeed(UINT seed, UINT octave)
+	{
+		return seed + octave * 0x9e3779b9u;
+	}
+
+	inline XMVECTOR XM_CALLCONV fract(FXMVECTOR x)
+	{
+		return XMVectorSubtract(x, XMVectorFloor(x));
+	}
+
+	inline XMVECTOR XM_CALLCONV mod289(FXMVECTOR x)
+	{
+		const XMVECTOR modulus = XMVectorReplicate(289.0f);
+		const XMVECTOR invModulus = XMVectorReplicate(1.0f / 289.0f);
+		return XMVectorNegativeMultiplySubtract(XMVectorFloor(XMVectorMultiply(x, invModulus)), modulus, x);
+	}
+
+	// (34x^2 + x) mod 289. Every product stays below 2^24 for x < 580, so
+	// the float math is exact.
+	inline XMVECTOR XM_CALLCONV permute(FXMVECTOR x)
+	{
+		const XMVECTOR scale = XMVectorReplicate(34.0f);
+		return mod289(XMVectorMultiply(XMVectorMultiplyAdd(x, scale, XMVectorSplatOne()), x));
+	}
+
+	// Unit gradient on a circle, 41 directions.
+	inline void XM_CALLCONV getGradient2(FXMVECTOR hash, XMVECTOR& gx, XMVECTOR& gy)
+	{
+		const XMVECTOR half = XMVectorReplicate(0.5f);
+
+		XMVECTOR x = XMVectorMultiplyAdd(fract(XMVectorMultiply(hash, XMVectorReplicate(1.0f / 41.0f))),
+			XMVectorReplicate(2.0f), XMVectorReplicate(-1.0f));
+
+		gy = XMVectorSubtract(XMVectorAbs(x), half);
+		gx = XMVectorSubtract(x, XMVectorFloor(XMVectorAdd(x, half)));
+
+		XMVECTOR invLength = XMVectorReciprocalSqrt(XMVectorMultiplyAdd(gx, gx, XMVectorMultiply(gy, gy)));
+		gx = XMVectorMultiply(gx, invLength);
+		gy = XMVectorMultiply(gy, invLength);
+	}
+
+	// Unit gradient on an octahedron folded onto the sphere, 49 directions.
+	inline void XM_CALLCONV getGradient3(FXMVECTOR hash, XMVECTOR& gx, XMVECTOR& gy, XMVECTOR& gz)
+	{
+		const XMVECTOR one = XMVectorSplatOne();
+		const XMVECTOR seventh = XMVectorReplicate(1.0f / 7.0f);
+		const XMVECTOR two = XMVectorReplicate(2.0f);
+		const XMVECTOR bias = XMVectorReplicate(1.0f / 7.0f - 1.0f);
+
+		XMVECTOR a = fract(XMVectorMultiply(hash, seventh));
+		XMVECTOR b = fract(XMVectorMultiply(XMVectorFloor(XMVectorMultiply(hash, seventh)), seventh));
+
+		gx = XMVectorMultiplyAdd(a, two, bias);
+		gy = XMVectorMultiplyAdd(b, two, bias);
+		gz = XMVectorSubtract(XMVectorSubtract(one, XMVectorAbs(gx)), XMVectorAbs(gy));
+
+		// Lower half: fold the triangles back over the edges.
+		XMVECTOR isLower = XMVectorLess(gz, XMVectorZero());
+		XMVECTOR signX = XMVectorSelect(XMVectorNegate(one), one, XMVectorGreaterOrEqual(gx, XMVectorZero()));
+		XMVECTOR signY = XMVectorSelect(XMVectorNegate(one), one, XMVectorGreaterOrEqual(gy, XMVectorZero()));
+		XMVECTOR foldedX = XMVectorMultiply(XMVectorSubtract(one, XMVectorAbs(gy)), signX);
+		XMVECTOR foldedY = XMVectorMultiply(XMVectorSubtract(one, XMVectorAbs(gx)), signY);
+		gx = XMVectorSelect(gx, foldedX, isLower);
+		gy = XMVectorSelect(gy, foldedY, isLower);
+
+		XMVECTOR invLength = XMVectorReciprocalSqrt(
+			XMVectorMultiplyAdd(gx, gx, XMVectorMultiplyAdd(gy, gy, XMVectorMultiply(gz, gz))));
+		gx = XMVectorMultiply(gx, invLength);
+		gy = XMVectorMultiply(gy, invLength);
+		gz = XMVectorMultiply(gz, invLength);
+	}
+
+	// Value in [-1, 1] for a hash in [0, 289].
+	inline XMVECTOR XM_CALLCONV getLatticeValue(FXMVECTOR hash)
+	{
+		return XMVectorMultiplyAdd(hash, XMVectorReplicate(2.0f / 289.0f), XMVectorReplicate(-1.0f));
+	}
+
+	// 6t^5 - 15t^4 + 10t^3 and its derivative 30t^2 (t - 1)^2.
+	inline XMVECTOR XM_CALLCONV fade(FXMVECTOR t, XMVECTOR& derivative)
+	{
+		XMVECTOR t2 = XMVectorMultiply(t, t);
+		XMVECTOR tMinusOne = XMVectorSubtract(t, XMVectorSplatOne());
+		derivative = XMVectorMultiply(XMVectorMultiply(XMVectorReplicate(30.0f), t2),
+			XMVectorMultiply(tMinusOne, tMinusOne));
+
+		XMVECTOR inner = XMVectorMultiplyAdd(t, XMVectorReplicate(6.0f), XMVectorReplicate(-15.0f));
+		inner = XMVectorMultiplyAdd(t, inner, XMVectorReplicate(10.0f));
+		return XMVectorMultiply(XMVectorMultiply(t2, t), inner);
+	}
+
+	// Adds t^4 (g . d) with t = radius - |d|^2 and its gradient.
+	inline void XM_CALLCONV addSimplexCorner2(
+		FXMVECTOR hash,
+		FXMVECTOR dx,
+		FXMVECTOR dy,
+		XMVECTOR& n,
+		XMVECTOR& dndx,
+		XMVECTOR& dndy)
+	{
+		XMVECTOR gx, gy;
+		getGradient2(hash, gx, gy);
+
+		XMVECTOR t = XMVectorSubtract(XMVectorReplicate(0.5f), XMVectorMultiplyAdd(dx, dx, XMVectorMultiply(dy, dy)));
+		t = XMVectorMax(t, XMVectorZero());
+		XMVECTOR t2 = XMVectorMultiply(t, t);
+		XMVECTOR t4 = XMVectorMultiply(t2, t2);
+		XMVECTOR gd = XMVectorMultiplyAdd(gx, dx, XMVectorMultiply(gy, dy));
+
+		// d(t^4 gd) = t^4 g - 8 t^3 gd d
+		XMVECTOR k = XMVectorMultiply(XMVectorReplicate(-8.0f), XMVectorMultiply(XMVectorMultiply(t2, t), gd));
+
+		n = XMVectorMultiplyAdd(t4, gd, n);
+		dndx = XMVectorAdd(dndx, XMVectorMultiplyAdd(t4, gx, XMVectorMultiply(k, dx)));
+		dndy = XMVectorAdd(dndy, XMVectorMultiplyAdd(t4, gy, XMVectorMultiply(k, dy)));
+	}
+
+	inline XMVECTOR XM_CALLCONV addSimplexCorner3(FXMVECTOR hash, FXMVECTOR dx, FXMVECTOR dy, GXMVECTOR dz, HXMVECTOR n)
+	{
+		XMVECTOR gx, gy, gz;
+		getGradient3(hash, gx, gy, gz);
+
+		XMVECTOR lengthSq = XMVectorMultiplyAdd(dx, dx, XMVectorMultiplyAdd(dy, dy, XMVectorMultiply(dz, dz)));
+		XMVECTOR t = XMVectorMax(XMVectorSubtract(XMVectorReplicate(0.6f), lengthSq), XMVectorZero());
+		XMVECTOR t2 = XMVectorMultiply(t, t);
+		XMVECTOR gd = XMVectorMultiplyAdd(gx, dx, XMVectorMultiplyAdd(gy, dy, XMVectorMultiply(gz, dz)));
+
+		return XMVectorMultiplyAdd(XMVectorMultiply(t2, t2), gd, n);
+	}
+
+	XMVECTOR XM_CALLCONV simplex2(FXMVECTOR x, FXMVECTOR y, const SSeed& seed, XMVECTOR* dndx, XMVECTOR* dndy)
+	{
+		const XMVECTOR F2 = XMVectorReplicate(0.366025403784f);
+		const XMVECTOR G2 = XMVectorReplicate(0.211324865405f);
+		const XMVECTOR one = XMVectorSplatOne();
+
+		// Skew to the square lattice to find the cell, then back.
+		XMVECTOR s = XMVectorMultiply(XMVectorAdd(x, y), F2);
+		XMVECTOR i = XMVectorFloor(XMVectorAdd(x, s));
+		XMVECTOR j = XMVectorFloor(XMVectorAdd(y, s));
+		XMVECTOR t = XMVectorMultiply(XMVectorAdd(i, j), G2);
+		XMVECTOR x0 = XMVectorAdd(XMVectorSubtract(x, i), t);
+		XMVECTOR y0 = XMVectorAdd(XMVectorSubtract(y, j), t);
+
+		// Middle corner of the triangle: (1, 0) below the diagonal, (0, 1)
+		// above it.
+		XMVECTOR i1 = XMVectorSelect(XMVectorZero(), one, XMVectorGreater(x0, y0));
+		XMVECTOR j1 = XMVectorSubtract(one, i1);
+
+		XMVECTOR x1 = XMVectorAdd(XMVectorSubtract(x0, i1), G2);
+		XMVECTOR y1 = XMVectorAdd(XMVectorSubtract(y0, j1), G2);
+		XMVECTOR x2 = XMVectorAdd(XMVectorSubtract(x0, one), XMVectorAdd(G2, G2));
+		XMVECTOR y2 = XMVectorAdd(XMVectorSubtract(y0, one), XMVectorAdd(G2, G2));
+
+		XMVECTOR px = XMVectorAdd(mod289(XMVectorAdd(i, seed.m_x)), seed.m_hash);
+		XMVECTOR py = mod289(XMVectorAdd(j, seed.m_y));
+
+		XMVECTOR h0 = permute(XMVectorAdd(permute(px), py));
+		XMVECTOR h1 = permute(XMVectorAdd(permute(XMVectorAdd(px, i1)), XMVectorAdd(py, j1)));
+		XMVECTOR h2 = permute(XMVectorAdd(permute(XMVectorAdd(px, one)), XMVectorAdd(py, one)));
+
+		XMVECTOR n = XMVectorZero();
+		XMVECTOR nx = XMVectorZero();
+		XMVECTOR ny = XMVectorZero();
+		addSimplexCorner2(h0, x0, y0, n, nx, ny);
+		addSimplexCorner2(h1, x1, y1, n, nx, ny);
+		addSimplexCorner2(h2, x2, y2, n, nx, ny);
+
+		const XMVECTOR scale = XMVectorReplicate(SimplexScale2);
+		if (dndx)
+		{
+			*dndx = XMVectorMultiply(nx, scale);
+			*dndy = XMVectorMultiply(ny, scale);
+		}
+
+		return XMVectorMultiply(n, scale);
+	}
+
+	XMVECTOR XM_CALLCONV simplex3(FXMVECTOR x, FXMVECTOR y, FXMVECTOR z, const SSeed& seed)
+	{
+		const XMVECTOR F3 = XMVectorReplicate(1.0f / 3.0f);
+		const XMVECTOR G3 = XMVectorReplicate(1.0f / 6.0f);
+		const XMVECTOR one = XMVectorSplatOne();
+		const XMVECTOR zero = XMVectorZero();
+
+		XMVECTOR s = XMVectorMultiply(XMVectorAdd(XMVectorAdd(x, y), z), F3);
+		XMVECTOR i = XMVectorFloor(XMVectorAdd(x, s));
+		XMVECTOR j = XMVectorFloor(XMVectorAdd(y, s));
+		XMVECTOR k = XMVectorFloor(XMVectorAdd(z, s));
+		XMVECTOR t = XMVectorMultiply(XMVectorAdd(XMVectorAdd(i, j), k), G3);
+		XMVECTOR x0 = XMVectorAdd(XMVectorSubtract(x, i), t);
+		XMVECTOR y0 = XMVectorAdd(XMVectorSubtract(y, j), t);
+		XMVECTOR z0 = XMVectorAdd(XMVectorSubtract(z, k), t);
+
+		// The second and third corners step along the largest, then the two
+		// largest offset axes.
+		XMVECTOR gx = XMVectorSelect(zero, one, XMVectorGreaterOrEqual(x0, y0));
+		XMVECTOR gy = XMVectorSelect(zero, one, XMVectorGreaterOrEqual(y0, z0));
+		XMVECTOR gz = XMVectorSelect(zero, one, XMVectorGreaterOrEqual(z0, x0));
+		XMVECTOR lx = XMVectorSubtract(one, gx);
+		XMVECTOR ly = XMVectorSubtract(one, gy);
+		XMVECTOR lz = XMVectorSubtract(one, gz);
+
+		XMVECTOR i1 = XMVectorMin(gx, lz);
+		XMVECTOR j1 = XMVectorMin(gy, lx);
+		XMVECTOR k1 = XMVectorMin(gz, ly);
+		XMVECTOR i2 = XMVectorMax(gx, lz);
+		XMVECTOR j2 = XMVectorMax(gy, lx);
+		XMVECTOR k2 = XMVectorMax(gz, ly);
+
+		XMVECTOR x1 = XMVectorAdd(XMVectorSubtract(x0, i1), G3);
+		XMVECTOR y1 = XMVectorAdd(XMVectorSubtract(y0, j1), G3);
+		XMVECTOR z1 = XMVectorAdd(XMVectorSubtract(z0, k1), G3);
+		XMVECTOR x2 = XMVectorAdd(XMVectorSubtract(x0, i2), XMVectorAdd(G3, G3));
+		XMVECTOR y2 = XMVectorAdd(XMVectorSubtract(y0, j2), XMVectorAdd(G3, G3));
+		XMVECTOR z2 = XMVectorAdd(XMVectorSubtract(z0, k2), XMVectorAdd(G3, G3));
+		XMVECTOR half = XMVectorReplicate(0.5f);
+		XMVECTOR x3 = XMVectorSubtract(x0, half);
+		XMVECTOR y3 = XMVectorSubtract(y0, half);
+		XMVECTOR z3 = XMVectorSubtract(z0, half);
+
+		XMVECTOR pz = XMVectorAdd(mod289(XMVectorAdd(k, seed.m_z)), seed.m_hash);
+		XMVECTOR py = mod289(XMVectorAdd(j, seed.m_y));
+		XMVECTOR px = mod289(XMVectorAdd(i, seed.m_x));
+
+		XMVECTOR h0 = permute(XMVectorAdd(permute(XMVectorAdd(permute(pz), py)), px));
+		XMVECTOR h1 = permute(XMVectorAdd(permute(XMVectorAdd(permute(XMVectorAdd(pz, k1)), XMVectorAdd(py, j1))), XMVectorAdd(px, i1)));
+		XMVECTOR h2 = permute(XMVectorAdd(permute(XMVectorAdd(permute(XMVectorAdd(pz, k2)), XMVectorAdd(py, j2))), XMVectorAdd(px, i2)));
+		XMVECTOR h3 = permute(XMVectorAdd(permute(XMVectorAdd(permute(XMVectorAdd(pz, one)), XMVectorAdd(py, one))), XMVectorAdd(px, one)));
+
+		XMVECTOR n = XMVectorZero();
+		n = addSimplexCorner3(h0, x0, y0, z0, n);
+		n = addSimplexCorner3(h1, x1, y1, z1, n);
+		n = addSimplexCorner3(h2, x2, y2, z2, n);
+		n = addSimplexCorner3(h3, x3, y3, z3, n);
+
+		return XMVectorMultiply(n, XMVectorReplicate(SimplexScale3));
+	}
+
+	XMVECTOR XM_CALLCONV value2(FXMVECTOR x, FXMVECTOR y, const SSeed& seed, XMVECTOR* dndx, XMVECTOR* dndy)
+	{
+		const XMVECTOR one = XMVectorSplatOne();
+
+		XMVECTOR i = XMVectorFloor(x);
+		XMVECTOR j = XMVectorFloor(y);
+
+		XMVECTOR du, dv;
+		XMVECTOR u = fade(XMVectorSubtract(x, i), du);
+		XMVECTOR v = fade(XMVectorSubtract(y, j), dv);
+
+		XMVECTOR px = XMVectorAdd(mod289(XMVectorAdd(i, seed.m_x)), seed.m_hash);
+		XMVECTOR py = mod289(XMVectorAdd(j, seed.m_y));
+		XMVECTOR row0 = permute(px);
+		XMVECTOR row1 = permute(XMVectorAdd(px, one));
+
+		XMVECTOR a = getLatticeValue(permute(XMVectorAdd(row0, py)));
+		XMVECTOR b = getLatticeValue(permute(XMVectorAdd(row1, py)));
+		XMVECTOR c = getLatticeValue(permute(XMVectorAdd(row0, XMVectorAdd(py, one))));
+		XMVECTOR d = getLatticeValue(permute(XMVectorAdd(row1, XMVectorAdd(py, one))));
+
+		// n = a + (b - a) u + (c - a) v + (a - b - c + d) u v
+		XMVECTOR ba = XMVectorSubtract(b, a);
+		XMVECTOR ca = XMVectorSubtract(c, a);
+		XMVECTOR abcd = XMVectorSubtract(XMVectorSubtract(XMVectorAdd(a, d), b), c);
+
+		if (dndx)
+		{
+			*dndx = XMVectorMultiply(du, XMVectorMultiplyAdd(abcd, v, ba));
+			*dndy = XMVectorMultiply(dv, XMVectorMultiplyAdd(abcd, u, ca));
+		}
+
+		return XMVectorAdd(a, XMVectorMultiplyAdd(ba, u, XMVectorMultiply(v, XMVectorMultiplyAdd(abcd, u, ca))));
+	}
+
+	XMVECTOR XM_CALLCONV value3(FXMVECTOR x, FXMVECTOR y, FXMVECTOR z, const SSeed& seed)
+	{
+		const XMVECTOR one = XMVectorSplatOne();
+
+		XMVECTOR i = XMVectorFloor(x);
+		XMVECTOR j = XMVectorFloor(y);
+		XMVECTOR k = XMVectorFloor(z);
+
+		XMVECTOR du, dv, dw;
+		XMVECTOR u = fade(XMVectorSubtract(x, i), du);
+		XMVECTOR v = fade(XMVectorSubtract(y, j), dv);
+		XMVECTOR w = fade(XMVectorSubtract(z, k), dw);
+
+		XMVECTOR pz = XMVectorAdd(mod289(XMVectorAdd(k, seed.m_z)), seed.m_hash);
+		XMVECTOR py = mod289(XMVectorAdd(j, seed.m_y));
+		XMVECTOR px = mod289(XMVectorAdd(i, seed.m_x));
+
+		XMVECTOR slices[2] = { permute(pz), permute(XMVectorAdd(pz, one)) };
+		XMVECTOR planes[2];
+		for (UINT dk = 0; dk < 2; ++dk)
+		{
+			XMVECTOR row0 = permute(XMVectorAdd(slices[dk], py));
+			XMVECTOR row1 = permute(XMVectorAdd(slices[dk], XMVectorAdd(py, one)));
+
+			XMVECTOR a = getLatticeValue(permute(XMVectorAdd(row0, px)));
+			XMVECTOR b = getLatticeValue(permute(XMVectorAdd(row0, XMVectorAdd(px, one))));
+			XMVECTOR c = getLatticeValue(permute(XMVectorAdd(row1, px)));
+			XMVECTOR d = getLatticeValue(permute(XMVectorAdd(row1, XMVectorAdd(px, one))));
+
+			XMVECTOR bottom = XMVectorLerpV(a, b, u);
+			XMVECTOR top = XMVectorLerpV(c, d, u);
+			planes[dk] = XMVectorLerpV(bottom, top, v);
+		}
+
+		return XMVectorLerpV(planes[0], planes[1], w);
+	}
+
+	XMVECTOR XM_CALLCONV fbm2(FXMVECTOR x, FXMVECTOR y, UINT seed, const Noise::SFbmDesc& desc, XMVECTOR* dndx, XMVECTOR* dndy)
+	{
+		XMVECTOR sum = XMVectorZero();
+		XMVECTOR sumX = XMVectorZero();
+		XMVECTOR sumY = XMVectorZero();
+
+		float frequency = desc.m_frequency;
+		float amplitude = desc.m_amplitude;
+		for (UINT octave = 0; octave < desc.m_octaveCount; ++octave)
+		{
+			const SSeed octaveSeed = makeSeed(getOctaveSeed(seed, octave));
+			const XMVECTOR vFrequency = XMVectorReplicate(frequency);
+			const XMVECTOR vAmplitude = XMVectorReplicate(amplitude);
+
+			XMVECTOR sx = XMVectorMultiply(x, vFrequency);
+			XMVECTOR sy = XMVectorMultiply(y, vFrequency);
+
+			XMVECTOR nx, ny;
+			XMVECTOR n = desc.m_basis == Noise::EBasis::Simplex
+				? simplex2(sx, sy, octaveSeed, dndx ? &nx : nullptr, &ny)
+				: value2(sx, sy, octaveSeed, dndx ? &nx : nullptr, &ny);
+
+			sum = XMVectorMultiplyAdd(n, vAmplitude, sum);
+			if (dndx)
+			{
+				// Chain rule through the frequency scaling.
+				const XMVECTOR slope = XMVectorReplicate(amplitude * frequency);
+				sumX = XMVectorMultiplyAdd(nx, slope, sumX);
+				sumY = XMVectorMultiplyAdd(ny, slope, sumY);
+			}
+
+			frequency *= desc.m_lacunarity;
+			amplitude *= desc.m_gain;
+		}
+
+		if (dndx)
+		{
+			*dndx = sumX;
+			*dndy = sumY;
+		}
+
+		return sum;
+	}
+
+	void fillRows(
+		float x0,
+		float y0,
+		float dx,
+		float dy,
+		UINT m,
+		UINT n,
+		std::vector<float>& values,
+		CThreadPool& threadPool,
+		const std::function<XMVECTOR(FXMVECTOR x, FXMVECTOR y)>& function)
+	{
+		values.resize((size_t)m * n);
+		if (m == 0 || n == 0)
+		{
+			return;
+		}
+
+		const UINT rowsPerChunk = n < SamplesPerChunk ? SamplesPerChunk / n : 1;
+
+		threadPool.parallelFor(0, m, rowsPerChunk, [&](UINT rowBegin, UINT rowEnd)
+		{
+			const XMVECTOR laneOffsets = XMVectorSet(0.0f, 1.0f, 2.0f, 3.0f);
+			const XMVECTOR vDx = XMVectorReplicate(dx);
+			const XMVECTOR vX0 = XMVectorReplicate(x0);
+
+			XMFLOAT4A lanes;
+
+			for (UINT i = rowBegin; i < rowEnd; ++i)
+			{
+				const XMVECTOR y = XMVectorReplicate(y0 + i * dy);
+				float* row = &values[(size_t)i * n];
+
+				for (UINT j = 0; j < n; j += 4)
+				{
+					XMVECTOR column = XMVectorAdd(XMVectorReplicate((float)j), laneOffsets);
+					XMVECTOR result = function(XMVectorMultiplyAdd(column, vDx, vX0), y);
+
+					if (n - j >= 4)
+					{
+						XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(row + j), result);
+					}
+					else
+					{
+						XMStoreFloat4A(&lanes, result);
+						for (UINT k = 0; k < n - j; ++k)
+						{
+							row[j + k] = (&lanes.x)[k];
+						}
+					}
+				}
+			}
+		});
+	}
+}
+
+XMVECTOR XM_CALLCONV Noise::simplex(FXMVECTOR x, FXMVECTOR y, UINT seed)
+{
+	return simplex2(x, y, makeSeed(seed), nullptr, nullptr);
+}
+
+XMVECTOR XM_CALLCONV Noise::simplex(FXMVECTOR x, FXMVECTOR y, UINT seed, XMVECTOR& dndx, XMVECTOR& dndy)
+{
+	return simplex2(x, y, makeSeed(seed), &dndx, &dndy);
+}
+
+XMVECTOR XM_CALLCONV Noise::simplex(FXMVECTOR x, FXMVECTOR y, FXMVECTOR z, UINT seed)
+{
+	return simplex3(x, y, z, makeSeed(seed));
+}
+
+XMVECTOR XM_CALLCONV Noise::value(FXMVECTOR x, FXMVECTOR y, UINT seed)
+{
+	return value2(x, y, makeSeed(seed), nullptr, nullptr);
+}
+
+XMVECTOR XM_CALLCONV Noise::value(FXMVECTOR x, FXMVECTOR y, UINT seed, XMVECTOR& dndx, XMVECTOR& dndy)
+{
+	return value2(x, y, makeSeed(seed), &dndx, &dndy);
+}
+
+XMVECTOR XM_CALLCONV Noise::value(FXMVECTOR x, FXMVECTOR y, FXMVECTOR z, UINT seed)
+{
+	return value3(x, y, z, makeSeed(seed));
+}
+
+XMVECTOR XM_CALLCONV Noise::fbm(FXMVECTOR x, FXMVECTOR y, UINT seed, const SFbmDesc& desc)
+{
+	return fbm2(x, y, seed, desc, nullptr, nullptr);
+}
+
+XMVECTOR XM_CALLCONV Noise::fbm(FXMVECTOR x, FXMVECTOR y, UINT seed, const SFbmDesc& desc, XMVECTOR& dndx, XMVECTOR& dndy)
+{
+	return fbm2(x, y, seed, desc, &dndx, &dndy);
+}
+
+XMVECTOR XM_CALLCONV Noise::fbm(FXMVECTOR x, FXMVECTOR y, FXMVECTOR z, UINT seed, const SFbmDesc& desc)
+{
+	XMVECTOR sum = XMVectorZero();
+
+	float frequency = desc.m_frequency;
+	float amplitude = desc.m_amplitude;
+	for (UINT octave = 0; octave < desc.m_octaveCount; ++octave)
+	{
+		const SSeed octaveSeed = makeSeed(getOctaveSeed(seed, octave));
+		const XMVECTOR vFrequency = XMVectorReplicate(frequency);
+
+		XMVECTOR sx = XMVectorMultiply(x, vFrequency);
+		XMVECTOR sy = XMVectorMultiply(y, vFrequency);
+		XMVECTOR sz = XMVectorMultiply(z, vFrequency);
+
+		XMVECTOR n = desc.m_basis == EBasis::Simplex
+			? simplex3(sx, sy, sz, octaveSeed)
+			: value3(sx, sy, sz, octaveSeed);
+
+		sum = XMVectorMultiplyAdd(n, XMVectorReplicate(amplitude), sum);
+
+		frequency *= desc.m_lacunarity;
+		amplitude *= desc.m_gain;
+	}
+
+	return sum;
+}
+
+Terrain::HeightGradientFunction Noise::createHeightFunction(UINT seed, const SFbmDesc& desc)
+{
+	return [seed, desc](FXMVECTOR x, FXMVECTOR z, XMVECTOR& dhdx, XMVECTOR& dhdz)
+	{
+		return fbm2(x, z, seed, desc, &dhdx, &dhdz);
+	};
+}
+
+void Noise::fillGrid(float x0, float y0, float dx, float dy, UINT m, UINT n, UINT seed, const SFbmDesc& desc, std::vector<float>& values, CThreadPool& threadPool)
+{
+	fillRows(x0, y0, dx, dy, m, n, values, threadPool, [&](FXMVECTOR x, FXMVECTOR y)
+	{
+		return fbm2(x, y, seed, desc, nullptr, nullptr);
+	});
+}
+
+void Noise::fillGrid(float x0, float y0, float dx, float dy, UINT m, UINT n, UINT seed, const SFbmDesc& desc, std::vector<float>& values)
+{
+	fillGrid(x0, y0, dx, dy, m, n, seed, desc, values, CThreadPool::getShared());
+}
+
+void Noise::fillSlice(float x0, float y0, float z, float dx, float dy, UINT m, UINT n, UINT seed, const SFbmDesc& desc, std::vector<float>& values, CThreadPool& threadPool)
+{
+	const XMVECTOR vZ = XMVectorReplicate(z);
+
+	fillRows(x0, y0, dx, dy, m, n, values, threadPool, [&](FXMVECTOR x, FXMVECTOR y)
+	{
+		return fbm(x, y, vZ, seed, desc);
+	});
+}
+
+void Noise::fillSlice(float x0, float y0, float z, float dx, float dy, UINT m, UINT n, UINT seed, const SFbmDesc& desc, std::vector<float>& values)
+{
+	fillSlice(x0, y0, z, dx, dy, m, n, seed, desc, values, CThreadPool::getShared());
+}
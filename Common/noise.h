@@ -0,0 +1,112 @@
+﻿#pragma once
+
+#include <vector>
+#include <DirectXMath.h>
+#include <windows.h>
+
+#include "terrain.h"
+
+using namespace DirectX;
+
+class CThreadPool;
+
+// Gradient (simplex) and value noise evaluated four samples at a time.
+//
+// Lattice hashing uses the permutation polynomial (34x^2 + x) mod 289 on
+// floats, which stays exact and needs no integer vector math, so results
+// are the same on every thread and run for a given seed. The pattern
+// repeats every 289 lattice cells. Noise values are roughly in [-1, 1].
+namespace Noise
+{
+	enum class EBasis
+	{
+		Simplex = 0,
+		Value = 1
+	};
+
+	struct SFbmDesc
+	{
+		EBasis m_basis = EBasis::Simplex;
+		UINT m_octaveCount = 6;
+
+		// Of the first octave, in cycles per unit.
+		float m_frequency = 0.01f;
+		float m_amplitude = 1.0f;
+
+		// Frequency and amplitude factors between consecutive octaves.
+		float m_lacunarity = 2.0f;
+		float m_gain = 0.5f;
+	};
+
+	XMVECTOR XM_CALLCONV simplex(FXMVECTOR x, FXMVECTOR y, UINT seed);
+	XMVECTOR XM_CALLCONV simplex(FXMVECTOR x, FXMVECTOR y, UINT seed, XMVECTOR& dndx, XMVECTOR& dndy);
+	XMVECTOR XM_CALLCONV simplex(FXMVECTOR x, FXMVECTOR y, FXMVECTOR z, UINT seed);
+
+	XMVECTOR XM_CALLCONV value(FXMVECTOR x, FXMVECTOR y, UINT seed);
+	XMVECTOR XM_CALLCONV value(FXMVECTOR x, FXMVECTOR y, UINT seed, XMVECTOR& dndx, XMVECTOR& dndy);
+	XMVECTOR XM_CALLCONV value(FXMVECTOR x, FXMVECTOR y, FXMVECTOR z, UINT seed);
+
+	// Sum of desc.m_octaveCount octaves of the basis; each octave uses its
+	// own seed derived from seed.
+	XMVECTOR XM_CALLCONV fbm(FXMVECTOR x, FXMVECTOR y, UINT seed, const SFbmDesc& desc);
+	XMVECTOR XM_CALLCONV fbm(FXMVECTOR x, FXMVECTOR y, UINT seed, const SFbmDesc& desc, XMVECTOR& dndx, XMVECTOR& dndy);
+	XMVECTOR XM_CALLCONV fbm(FXMVECTOR x, FXMVECTOR y, FXMVECTOR z, UINT seed, const SFbmDesc& desc);
+
+	// fBm as a terrain height, h(x, z) = fbm(x, z), with exact gradients.
+	Terrain::HeightGradientFunction createHeightFunction(UINT seed, const SFbmDesc& desc);
+
+	// Fills values with an m x n row-major grid of fbm samples, row i at
+	// y0 + i * dy and column j at x0 + j * dx, spreading the rows over the
+	// thread pool. The result does not depend on the thread count.
+	void fillGrid(
+		float x0,
+		float y0,
+		float dx,
+		float dy,
+		UINT m,
+		UINT n,
+		UINT seed,
+		const SFbmDesc& desc,
+		std::vector<float>& values,
+		CThreadPool& threadPool
+	);
+	void fillGrid(
+		float x0,
+		float y0,
+		float dx,
+		float dy,
+		UINT m,
+		UINT n,
+		UINT seed,
+		const SFbmDesc& desc,
+		std::vector<float>& values
+	);
+
+	// Same for the slice of the 3D fbm at z, e.g. an animated pattern with
+	// time as z.
+	void fillSlice(
+		float x0,
+		float y0,
+		float z,
+		float dx,
+		float dy,
+		UINT m,
+		UINT n,
+		UINT seed,
+		const SFbmDesc& desc,
+		std::vector<float>& values,
+		CThreadPool& threadPool
+	);
+	void fillSlice(
+		float x0,
+		float y0,
+		float z,
+		float dx,
+		float dy,
+		UINT m,
+		UINT n,
+		UINT seed,
+		const SFbmDesc& desc,
+		std::vector<float>& values
+	);
+}
@@ -0,0 +1,204 @@
+﻿#include "pixelformat.h"
+
+#include <cstring>
+#include <DirectXMath.h>
+
+#include "cpufeatures.h"
+
+#if defined(_XM_SSE_INTRINSICS_)
+#include <tmmintrin.h>
+#if defined(_MSC_VER)
+#define TARGET_SSSE3
+#else
+#define TARGET_SSSE3 __attribute__((target("ssse3")))
+#endif
+#endif
+
+namespace
+{
+	const UINT OpaqueAlpha = 0xFF000000;
+
+	// Channel i of each result pixel is byte order[i] of the source pixel;
+	// alpha is 0xFF instead for opaque formats.
+	void convertScalar(
+		const unsigned char* source,
+		unsigned char* destination,
+		size_t pixelCount,
+		UINT bytesPerPixel,
+		const UINT order[4],
+		bool isOpaque)
+	{
+		for (size_t i = 0; i < pixelCount; ++i)
+		{
+			const unsigned char* pixel = source + i * bytesPerPixel;
+			unsigned char converted[4] =
+			{
+				pixel[order[0]],
+				pixel[order[1]],
+				pixel[order[2]],
+				isOpaque ? (unsigned char)0xFF : pixel[order[3]]
+			};
+			std::memcpy(destination + i * 4, converted, sizeof(converted));
+		}
+	}
+
+#if defined(_XM_SSE_INTRINSICS_)
+	const bool HasSsse3 = CpuFeatures::hasSsse3();
+
+	// Bytes of four packed 3-byte pixels to the R, G, B positions of four
+	// 4-byte ones; the alpha bytes come out zero.
+	TARGET_SSSE3 __m128i getExpandMask(bool isSwapped)
+	{
+		return isSwapped ?
+			_mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1) :
+			_mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+	}
+
+	// Sixteen pixels from three loads: the 48 source bytes are realigned so
+	// each shuffle sees four whole pixels at its start.
+	TARGET_SSSE3 size_t expandSsse3(const unsigned char* source, unsigned char* destination, size_t pixelCount, bool isSwapped)
+	{
+		const __m128i mask = getExpandMask(isSwapped);
+		const __m128i alpha = _mm_set1_epi32((int)OpaqueAlpha);
+
+		size_t i = 0;
+		for (; i + 16 <= pixelCount; i += 16)
+		{
+			const __m128i* input = reinterpret_cast<const __m128i*>(source + i * 3);
+			const __m128i a = _mm_loadu_si128(input);
+			const __m128i b = _mm_loadu_si128(input + 1);
+			const __m128i c = _mm_loadu_si128(input + 2);
+
+			__m128i* output = reinterpret_cast<__m128i*>(destination + i * 4);
+			_mm_storeu_si128(output, _mm_or_si128(_mm_shuffle_epi8(a, mask), alpha));
+			_mm_storeu_si128(output + 1, _mm_or_si128(_mm_shuffle_epi8(_mm_alignr_epi8(b, a, 12), mask), alpha));
+			_mm_storeu_si128(output + 2, _mm_or_si128(_mm_shuffle_epi8(_mm_alignr_epi8(c, b, 8), mask), alpha));
+			_mm_storeu_si128(output + 3, _mm_or_si128(_mm_shuffle_epi8(_mm_srli_si128(c, 4), mask), alpha));
+		}
+		return i;
+	}
+
+	TARGET_SSSE3 size_t swizzleSsse3(const unsigned char* source, unsigned char* destination, size_t pixelCount, bool isOpaque)
+	{
+		const __m128i mask = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+		const __m128i alpha = _mm_set1_epi32(isOpaque ? (int)OpaqueAlpha : 0);
+
+		size_t i = 0;
+		for (; i + 4 <= pixelCount; i += 4)
+		{
+			const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 4));
+			_mm_storeu_si128(
+				reinterpret_cast<__m128i*>(destination + i * 4),
+				_mm_or_si128(_mm_shuffle_epi8(pixels, mask), alpha)
+			);
+		}
+		return i;
+	}
+
+	// Swaps bytes 0 and 2 of every 32-bit lane with shifts, the SSE2 stand-in
+	// for a byte shuffle.
+	inline __m128i swapRedBlue(__m128i pixels)
+	{
+		const __m128i redBlue = _mm_and_si128(pixels, _mm_set1_epi32(0x00FF00FF));
+		const __m128i greenAlpha = _mm_and_si128(pixels, _mm_set1_epi32((int)0xFF00FF00));
+		return _mm_or_si128(greenAlpha, _mm_or_si128(_mm_slli_epi32(redBlue, 16), _mm_srli_epi32(redBlue, 16)));
+	}
+
+	size_t swizzleSse2(const unsigned char* source, unsigned char* destination, size_t pixelCount, bool isOpaque)
+	{
+		const __m128i alpha = _mm_set1_epi32(isOpaque ? (int)OpaqueAlpha : 0);
+
+		size_t i = 0;
+		for (; i + 4 <= pixelCount; i += 4)
+		{
+			const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 4));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i * 4), _mm_or_si128(swapRedBlue(pixels), alpha));
+		}
+		return i;
+	}
+
+	// Four pixels are read as 32-bit words at 3-byte steps, which takes one
+	// byte past the last of them, so the loop stops a pixel short of the end.
+	size_t expandSse2(const unsigned char* source, unsigned char* destination, size_t pixelCount, bool isSwapped)
+	{
+		const __m128i rgb = _mm_set1_epi32(0x00FFFFFF);
+		const __m128i alpha = _mm_set1_epi32((int)OpaqueAlpha);
+
+		size_t i = 0;
+		for (; i + 5 <= pixelCount; i += 4)
+		{
+			int words[4];
+			std::memcpy(&words[0], source + i * 3, sizeof(int));
+			std::memcpy(&words[1], source + i * 3 + 3, sizeof(int));
+			std::memcpy(&words[2], source + i * 3 + 6, sizeof(int));
+			std::memcpy(&words[3], source + i * 3 + 9, sizeof(int));
+
+			__m128i pixels = _mm_and_si128(_mm_setr_epi32(words[0], words[1], words[2], words[3]), rgb);
+			if (isSwapped)
+			{
+				pixels = swapRedBlue(pixels);
+			}
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i * 4), _mm_or_si128(pixels, alpha));
+		}
+		return i;
+	}
+#endif
+}
+
+UINT PixelFormat::getBytesPerPixel(EFormat format)
+{
+	return format == EFormat::Rgb8 || format == EFormat::Bgr8 ? 3 : 4;
+}
+
+void PixelFormat::convertToRgba8(EFormat sourceFormat, const void* source, void* destination, size_t pixelCount)
+{
+	static const UINT RgbOrder[4] = { 0, 1, 2, 3 };
+	static const UINT BgrOrder[4] = { 2, 1, 0, 3 };
+
+	const unsigned char* input = static_cast<const unsigned char*>(source);
+	unsigned char* output = static_cast<unsigned char*>(destination);
+
+	const UINT bytesPerPixel = getBytesPerPixel(sourceFormat);
+	const bool isSwapped = sourceFormat == EFormat::Bgr8 || sourceFormat == EFormat::Bgra8 || sourceFormat == EFormat::Bgrx8;
+	const bool isOpaque = sourceFormat != EFormat::Rgba8 && sourceFormat != EFormat::Bgra8;
+
+	if (sourceFormat == EFormat::Rgba8)
+	{
+		if (input != output)
+		{
+			std::memmove(output, input, pixelCount * 4);
+		}
+		return;
+	}
+
+	size_t done = 0;
+
+#if defined(_XM_SSE_INTRINSICS_)
+	if (bytesPerPixel == 3)
+	{
+		done = HasSsse3 ?
+			expandSsse3(input, output, pixelCount, isSwapped) :
+			expandSse2(input, output, pixelCount, isSwapped);
+	}
+	else if (isSwapped)
+	{
+		done = HasSsse3 ?
+			swizzleSsse3(input, output, pixelCount, isOpaque) :
+			swizzleSse2(input, output, pixelCount, isOpaque);
+	}
+#endif
+
+	convertScalar(
+		input + done * bytesPerPixel,
+		output + done * 4,
+		pixelCount - done,
+		bytesPerPixel,
+		isSwapped ? BgrOrder : RgbOrder,
+		isOpaque
+	);
+}
+
+void PixelFormat::argbToAbgr(const UINT* source, UINT* destination, size_t pixelCount)
+{
+	convertToRgba8(EFormat::Bgra8, source, destination, pixelCount);
+}
@@ -0,0 +1,33 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <windows.h>
+
+// Conversion of pixel rows into R8G8B8A8, the layout the demos upload.
+// Each call converts a whole row or image, so the per-pixel work is a
+// byte shuffle on 16 pixels at a time: SSSE3 where the CPU has it, SSE2
+// shifts and masks otherwise, and a scalar loop for the rest of the row.
+// Source and destination may not overlap, except for in-place conversions
+// between 32-bit formats.
+namespace PixelFormat
+{
+	enum class EFormat
+	{
+		// Byte order in memory.
+		Rgb8,
+		Bgr8,
+		Rgba8,
+		Bgra8,
+
+		// 32-bit BGR whose fourth byte is unused; converts to opaque.
+		Bgrx8
+	};
+
+	UINT getBytesPerPixel(EFormat format);
+
+	void convertToRgba8(EFormat sourceFormat, const void* source, void* destination, size_t pixelCount);
+
+	// A8R8G8B8 words (B8G8R8A8 in memory) to A8B8G8R8 words (R8G8B8A8 in
+	// memory), and back, as the swap is its own inverse.
+	void argbToAbgr(const UINT* source, UINT* destination, size_t pixelCount);
+}
@@ -0,0 +1,164 @@
+﻿#pragma once
+
+#include <array>
+#include <DirectXMath.h>
+#include <windows.h>
+using namespace DirectX;
+
+// Fixed-topology primitives evaluated at compile time, so their vertex and
+// index data are emitted as read-only constants instead of being built on
+// every call. The tables follow the runtime generators step by step and
+// produce bit-identical data.
+namespace PrimitiveTables
+{
+	// Same layout as GeometryGenerator::SVertex, but a literal type.
+	struct STableVertex
+	{
+		XMFLOAT3 m_position;
+		XMFLOAT3 m_normal;
+		XMFLOAT3 m_tangentU;
+		XMFLOAT2 m_texC;
+	};
+
+	// Box of unit size centered at the origin; createBox() scales the
+	// positions by the requested dimensions.
+	constexpr std::array<STableVertex, 24> BoxVertices =
+	{{
+		// Front face.
+		{ { -0.5f, -0.5f, -0.5f }, { 0.0f, 0.0f, -1.0f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f } },
+		{ { -0.5f, +0.5f, -0.5f }, { 0.0f, 0.0f, -1.0f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f } },
+		{ { +0.5f, +0.5f, -0.5f }, { 0.0f, 0.0f, -1.0f }, { 1.0f, 0.0f, 0.0f }, { 1.0f, 0.0f } },
+		{ { +0.5f, -0.5f, -0.5f }, { 0.0f, 0.0f, -1.0f }, { 1.0f, 0.0f, 0.0f }, { 1.0f, 1.0f } },
+
+		// Back face.
+		{ { -0.5f, -0.5f, +0.5f }, { 0.0f, 0.0f, 1.0f }, { -1.0f, 0.0f, 0.0f }, { 1.0f, 1.0f } },
+		{ { +0.5f, -0.5f, +0.5f }, { 0.0f, 0.0f, 1.0f }, { -1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f } },
+		{ { +0.5f, +0.5f, +0.5f }, { 0.0f, 0.0f, 1.0f }, { -1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f } },
+		{ { -0.5f, +0.5f, +0.5f }, { 0.0f, 0.0f, 1.0f }, { -1.0f, 0.0f, 0.0f }, { 1.0f, 0.0f } },
+
+		// Top face.
+		{ { -0.5f, +0.5f, -0.5f }, { 0.0f, 1.0f, 0.0f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f } },
+		{ { -0.5f, +0.5f, +0.5f }, { 0.0f, 1.0f, 0.0f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f } },
+		{ { +0.5f, +0.5f, +0.5f }, { 0.0f, 1.0f, 0.0f }, { 1.0f, 0.0f, 0.0f }, { 1.0f, 0.0f } },
+		{ { +0.5f, +0.5f, -0.5f }, { 0.0f, 1.0f, 0.0f }, { 1.0f, 0.0f, 0.0f }, { 1.0f, 1.0f } },
+
+		// Bottom face.
+		{ { -0.5f, -0.5f, -0.5f }, { 0.0f, -1.0f, 0.0f }, { -1.0f, 0.0f, 0.0f }, { 1.0f, 1.0f } },
+		{ { +0.5f, -0.5f, -0.5f }, { 0.0f, -1.0f, 0.0f }, { -1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f } },
+		{ { +0.5f, -0.5f, +0.5f }, { 0.0f, -1.0f, 0.0f }, { -1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f } },
+		{ { -0.5f, -0.5f, +0.5f }, { 0.0f, -1.0f, 0.0f }, { -1.0f, 0.0f, 0.0f }, { 1.0f, 0.0f } },
+
+		// Left face.
+		{ { -0.5f, -0.5f, +0.5f }, { -1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, -1.0f }, { 0.0f, 1.0f } },
+		{ { -0.5f, +0.5f, +0.5f }, { -1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, -1.0f }, { 0.0f, 0.0f } },
+		{ { -0.5f, +0.5f, -0.5f }, { -1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, -1.0f }, { 1.0f, 0.0f } },
+		{ { -0.5f, -0.5f, -0.5f }, { -1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, -1.0f }, { 1.0f, 1.0f } },
+
+		// Right face.
+		{ { +0.5f, -0.5f, -0.5f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 0.0f, 1.0f } },
+		{ { +0.5f, +0.5f, -0.5f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f } },
+		{ { +0.5f, +0.5f, +0.5f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 1.0f, 0.0f } },
+		{ { +0.5f, -0.5f, +0.5f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 1.0f, 1.0f } }
+	}};
+
+	constexpr std::array<UINT, 36> BoxIndices =
+	{{
+		0, 1, 2, 0, 2, 3,
+		4, 5, 6, 4, 6, 7,
+		8, 9, 10, 8, 10, 11,
+		12, 13, 14, 12, 14, 15,
+		16, 17, 18, 16, 18, 19,
+		20, 21, 22, 20, 22, 23
+	}};
+
+	template<UINT VertexCount, UINT IndexCount>
+	struct STopology
+	{
+		std::array<XMFLOAT3, VertexCount> m_positions;
+		std::array<UINT, IndexCount> m_indices;
+	};
+
+	// One step of the geosphere subdivision: every triangle is split at its
+	// edge midpoints into four, with six fresh vertices per input triangle.
+	template<UINT VertexCount, UINT IndexCount>
+	constexpr STopology<IndexCount * 2, IndexCount * 4> subdivide(const STopology<VertexCount, IndexCount>& input)
+	{
+		STopology<IndexCount * 2, IndexCount * 4> output = {};
+
+		for (UINT i = 0; i < IndexCount / 3; ++i)
+		{
+			const XMFLOAT3 v0 = input.m_positions[input.m_indices[i * 3 + 0]];
+			const XMFLOAT3 v1 = input.m_positions[input.m_indices[i * 3 + 1]];
+			const XMFLOAT3 v2 = input.m_positions[input.m_indices[i * 3 + 2]];
+
+			output.m_positions[i * 6 + 0] = v0;
+			output.m_positions[i * 6 + 1] = v1;
+			output.m_positions[i * 6 + 2] = v2;
+			output.m_positions[i * 6 + 3] = XMFLOAT3(
+				0.5f * (v0.x + v1.x), 0.5f * (v0.y + v1.y), 0.5f * (v0.z + v1.z));
+			output.m_positions[i * 6 + 4] = XMFLOAT3(
+				0.5f * (v1.x + v2.x), 0.5f * (v1.y + v2.y), 0.5f * (v1.z + v2.z));
+			output.m_positions[i * 6 + 5] = XMFLOAT3(
+				0.5f * (v0.x + v2.x), 0.5f * (v0.y + v2.y), 0.5f * (v0.z + v2.z));
+
+			const UINT triangles[12] =
+			{
+				0, 3, 5,
+				3, 4, 5,
+				5, 4, 2,
+				3, 1, 4
+			};
+			for (UINT j = 0; j < 12; ++j)
+			{
+				output.m_indices[i * 12 + j] = i * 6 + triangles[j];
+			}
+		}
+
+		return output;
+	}
+
+	// Unit icosahedron subdivided Level times, before the positions are
+	// projected onto the sphere. Levels above MaxGeosphereLevel are left to
+	// the runtime generator to keep compile times down.
+	constexpr UINT MaxGeosphereLevel = 3;
+
+	template<UINT Level>
+	struct SGeosphereTable
+	{
+		static_assert(Level <= MaxGeosphereLevel, "Geosphere level is not tabulated.");
+
+		static constexpr UINT VertexCount = SGeosphereTable<Level - 1>::IndexCount * 2;
+		static constexpr UINT IndexCount = SGeosphereTable<Level - 1>::IndexCount * 4;
+
+		static constexpr STopology<VertexCount, IndexCount> Topology =
+			subdivide(SGeosphereTable<Level - 1>::Topology);
+	};
+
+	template<>
+	struct SGeosphereTable<0>
+	{
+		static constexpr UINT VertexCount = 12;
+		static constexpr UINT IndexCount = 60;
+
+		static constexpr float X = 0.525731f;
+		static constexpr float Z = 0.850651f;
+
+		static constexpr STopology<VertexCount, IndexCount> Topology =
+		{
+			{{
+				{ -X, 0.0f, Z }, { X, 0.0f, Z },
+				{ -X, 0.0f, -Z }, { X, 0.0f, -Z },
+				{ 0.0f, Z, X }, { 0.0f, Z, -X },
+				{ 0.0f, -Z, X }, { 0.0f, -Z, -X },
+				{ Z, X, 0.0f }, { -Z, X, 0.0f },
+				{ Z, -X, 0.0f }, { -Z, -X, 0.0f }
+			}},
+			{{
+				1,4,0, 4,9,0, 4,5,9, 8,5,4, 1,8,4,
+				1,10,8, 10,3,8, 8,3,5, 3,2,5, 3,7,2,
+				3,10,7, 10,6,7, 6,11,7, 6,0,11, 6,1,0,
+				10,1,6, 11,0,9, 2,11,9, 5,2,9, 11,2,7
+			}}
+		};
+	};
+}
@@ -0,0 +1,181 @@
+﻿#include "terrain.h"
+
+#include "threadpool.h"
+
+namespace
+{
+	// Rows handed to a worker at a time; roughly 16k samples per chunk.
+	const UINT SamplesPerChunk = 16384;
+
+	void evaluateRows(
+		float width,
+		float depth,
+		UINT m,
+		UINT n,
+		const Terrain::HeightGradientFunction& function,
+		std::vector<XMFLOAT3>& positions,
+		std::vector<XMFLOAT3>* normals,
+		CThreadPool& threadPool)
+	{
+		positions.resize((size_t)m * n);
+		if (normals)
+		{
+			normals->resize((size_t)m * n);
+		}
+
+		if (m < 2 || n < 2)
+		{
+			return;
+		}
+
+		// Same vertex placement as GeometryGenerator::createGrid.
+		const float halfWidth = 0.5f * width;
+		const float halfDepth = 0.5f * depth;
+		const float dx = width / (n - 1);
+		const float dz = depth / (m - 1);
+
+		const UINT rowsPerChunk = n < SamplesPerChunk ? SamplesPerChunk / n : 1;
+
+		threadPool.parallelFor(0, m, rowsPerChunk, [&](UINT rowBegin, UINT rowEnd)
+		{
+			const XMVECTOR laneOffsets = XMVectorSet(0.0f, 1.0f, 2.0f, 3.0f);
+			const XMVECTOR vDx = XMVectorReplicate(dx);
+			const XMVECTOR vLeft = XMVectorReplicate(-halfWidth);
+
+			XMFLOAT4A xs, heights, normalXs, normalYs, normalZs;
+
+			for (UINT i = rowBegin; i < rowEnd; ++i)
+			{
+				const float z = halfDepth - i * dz;
+				const XMVECTOR vZ = XMVectorReplicate(z);
+
+				XMFLOAT3* rowPositions = &positions[(size_t)i * n];
+				XMFLOAT3* rowNormals = normals ? &(*normals)[(size_t)i * n] : nullptr;
+
+				for (UINT j = 0; j < n; j += 4)
+				{
+					XMVECTOR column = XMVectorAdd(XMVectorReplicate((float)j), laneOffsets);
+					XMVECTOR x = XMVectorMultiplyAdd(column, vDx, vLeft);
+
+					XMVECTOR dhdx, dhdz;
+					XMVECTOR h = function(x, vZ, dhdx, dhdz);
+
+					XMStoreFloat4A(&xs, x);
+					XMStoreFloat4A(&heights, h);
+
+					// n = (-dh/dx, 1, -dh/dz) / |(-dh/dx, 1, -dh/dz)|
+					if (rowNormals)
+					{
+						XMVECTOR lengthSq = XMVectorMultiplyAdd(dhdx, dhdx,
+							XMVectorMultiplyAdd(dhdz, dhdz, XMVectorSplatOne()));
+						XMVECTOR invLength = XMVectorReciprocalSqrt(lengthSq);
+
+						XMStoreFloat4A(&normalXs, XMVectorNegate(XMVectorMultiply(dhdx, invLength)));
+						XMStoreFloat4A(&normalYs, invLength);
+						XMStoreFloat4A(&normalZs, XMVectorNegate(XMVectorMultiply(dhdz, invLength)));
+					}
+
+					const float* xLanes = &xs.x;
+					const float* hLanes = &heights.x;
+					const UINT laneCount = n - j < 4 ? n - j : 4;
+					for (UINT k = 0; k < laneCount; ++k)
+					{
+						rowPositions[j + k] = XMFLOAT3(xLanes[k], hLanes[k], z);
+					}
+
+					if (rowNormals)
+					{
+						for (UINT k = 0; k < laneCount; ++k)
+						{
+							rowNormals[j + k] = XMFLOAT3((&normalXs.x)[k], (&normalYs.x)[k], (&normalZs.x)[k]);
+						}
+					}
+				}
+			}
+		});
+	}
+}
+
+XMVECTOR XM_CALLCONV Terrain::hills(FXMVECTOR x, FXMVECTOR z, XMVECTOR& dhdx, XMVECTOR& dhdz)
+{
+	const XMVECTOR frequency = XMVectorReplicate(0.1f);
+	const XMVECTOR amplitude = XMVectorReplicate(0.3f);
+
+	XMVECTOR sinX, cosX, sinZ, cosZ;
+	XMVectorSinCos(&sinX, &cosX, XMVectorMultiply(x, frequency));
+	XMVectorSinCos(&sinZ, &cosZ, XMVectorMultiply(z, frequency));
+
+	// dh/dx = 0.3 * (0.1 * z * cos(0.1 * x) + cos(0.1 * z))
+	// dh/dz = 0.3 * (sin(0.1 * x) - 0.1 * x * sin(0.1 * z))
+	dhdx = XMVectorMultiply(amplitude,
+		XMVectorMultiplyAdd(XMVectorMultiply(frequency, z), cosX, cosZ));
+	dhdz = XMVectorMultiply(amplitude,
+		XMVectorNegativeMultiplySubtract(XMVectorMultiply(frequency, x), sinZ, sinX));
+
+	return XMVectorMultiply(amplitude,
+		XMVectorMultiplyAdd(z, sinX, XMVectorMultiply(x, cosZ)));
+}
+
+float Terrain::getHillHeight(float x, float z)
+{
+	return 0.3f * (z * sinf(0.1f * x) + x * cosf(0.1f * z));
+}
+
+XMFLOAT3 Terrain::getHillNormal(float x, float z)
+{
+	XMFLOAT3 n(
+		-0.03f * z * cosf(0.1f * x) - 0.3f * cosf(0.1f * z),
+		1.0f,
+		-0.3f * sinf(0.1f * x) + 0.03f * x * sinf(0.1f * z)
+	);
+
+	XMVECTOR unitNormal = XMVector3Normalize(XMLoadFloat3(&n));
+	XMStoreFloat3(&n, unitNormal);
+
+	return n;
+}
+
+void Terrain::evaluateGrid(float width, float depth, UINT m, UINT n, const HeightGradientFunction& function, std::vector<XMFLOAT3>& positions, std::vector<XMFLOAT3>* normals, CThreadPool& threadPool)
+{
+	evaluateRows(width, depth, m, n, function, positions, normals, threadPool);
+}
+
+void Terrain::evaluateGrid(float width, float depth, UINT m, UINT n, const HeightFunction& function, std::vector<XMFLOAT3>& positions, std::vector<XMFLOAT3>* normals, CThreadPool& threadPool)
+{
+	// Central differences over one grid spacing.
+	const XMVECTOR stepX = XMVectorReplicate(n > 1 ? width / (n - 1) : 1.0f);
+	const XMVECTOR stepZ = XMVectorReplicate(m > 1 ? depth / (m - 1) : 1.0f);
+	const bool hasNormals = normals != nullptr;
+
+	auto gradientFunction = [&](FXMVECTOR x, FXMVECTOR z, XMVECTOR& dhdx, XMVECTOR& dhdz)
+	{
+		if (hasNormals)
+		{
+			XMVECTOR right = function(XMVectorAdd(x, stepX), z);
+			XMVECTOR left = function(XMVectorSubtract(x, stepX), z);
+			XMVECTOR front = function(x, XMVectorAdd(z, stepZ));
+			XMVECTOR back = function(x, XMVectorSubtract(z, stepZ));
+
+			dhdx = XMVectorDivide(XMVectorSubtract(right, left), XMVectorAdd(stepX, stepX));
+			dhdz = XMVectorDivide(XMVectorSubtract(front, back), XMVectorAdd(stepZ, stepZ));
+		}
+		else
+		{
+			dhdx = dhdz = XMVectorZero();
+		}
+
+		return function(x, z);
+	};
+
+	evaluateRows(width, depth, m, n, gradientFunction, positions, normals, threadPool);
+}
+
+void Terrain::evaluateGrid(float width, float depth, UINT m, UINT n, const HeightGradientFunction& function, std::vector<XMFLOAT3>& positions, std::vector<XMFLOAT3>* normals)
+{
+	evaluateRows(width, depth, m, n, function, positions, normals, CThreadPool::getShared());
+}
+
+void Terrain::evaluateGrid(float width, float depth, UINT m, UINT n, const HeightFunction& function, std::vector<XMFLOAT3>& positions, std::vector<XMFLOAT3>* normals)
+{
+	evaluateGrid(width, depth, m, n, function, positions, normals, CThreadPool::getShared());
+}
@@ -0,0 +1,69 @@
+﻿#pragma once
+
+#include <functional>
+#include <vector>
+#include <DirectXMath.h>
+#include <windows.h>
+using namespace DirectX;
+
+class CThreadPool;
+
+namespace Terrain
+{
+	// Height functions take four (x, z) samples at once. The gradient form
+	// also returns the partial derivatives, which gives exact normals in the
+	// same pass; height-only functions get central differences instead.
+	typedef std::function<XMVECTOR(FXMVECTOR x, FXMVECTOR z)> HeightFunction;
+	typedef std::function<XMVECTOR(FXMVECTOR x, FXMVECTOR z, XMVECTOR& dhdx, XMVECTOR& dhdz)> HeightGradientFunction;
+
+	// The rolling hills shared by the demos,
+	//   h(x, z) = 0.3 * (z * sin(0.1 * x) + x * cos(0.1 * z)).
+	XMVECTOR XM_CALLCONV hills(FXMVECTOR x, FXMVECTOR z, XMVECTOR& dhdx, XMVECTOR& dhdz);
+
+	float getHillHeight(float x, float z);
+	XMFLOAT3 getHillNormal(float x, float z);
+
+	// Evaluates the function on the vertices of
+	// GeometryGenerator::createGrid(width, depth, m, n), in the same order,
+	// spreading the rows over the thread pool. normals may be nullptr.
+	void evaluateGrid(
+		float width,
+		float depth,
+		UINT m,
+		UINT n,
+		const HeightGradientFunction& function,
+		std::vector<XMFLOAT3>& positions,
+		std::vector<XMFLOAT3>* normals,
+		CThreadPool& threadPool
+	);
+	void evaluateGrid(
+		float width,
+		float depth,
+		UINT m,
+		UINT n,
+		const HeightFunction& function,
+		std::vector<XMFLOAT3>& positions,
+		std::vector<XMFLOAT3>* normals,
+		CThreadPool& threadPool
+	);
+
+	// Same on the shared thread pool.
+	void evaluateGrid(
+		float width,
+		float depth,
+		UINT m,
+		UINT n,
+		const HeightGradientFunction& function,
+		std::vector<XMFLOAT3>& positions,
+		std::vector<XMFLOAT3>* normals
+	);
+	void evaluateGrid(
+		float width,
+		float depth,
+		UINT m,
+		UINT n,
+		const HeightFunction& function,
+		std::vector<XMFLOAT3>& positions,
+		std::vector<XMFLOAT3>* normals
+	);
+}
@@ -0,0 +1,757 @@
+﻿#include "textureatlas.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <numeric>
+#include <sstream>
+
+#include "blockcompressor.h"
+#include "bmpdecoder.h"
+#include "ddsfile.h"
+#include "fileutil.h"
+#include "mappedfile.h"
+#include "threadpool.h"
+
+using FileUtil::setError;
+
+namespace
+{
+	bool endsWith(const std::string& text, const std::string& suffix)
+	{
+		return text.size() >= suffix.size() &&
+			text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+	}
+
+	UINT alignUp(UINT value, UINT alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	bool intersects(const TextureAtlas::SRect& a, const TextureAtlas::SRect& b)
+	{
+		return a.m_x < b.m_x + b.m_width && b.m_x < a.m_x + a.m_width &&
+			a.m_y < b.m_y + b.m_height && b.m_y < a.m_y + a.m_height;
+	}
+
+	bool contains(const TextureAtlas::SRect& outer, const TextureAtlas::SRect& inner)
+	{
+		return inner.m_x >= outer.m_x && inner.m_x + inner.m_width <= outer.m_x + outer.m_width &&
+			inner.m_y >= outer.m_y && inner.m_y + inner.m_height <= outer.m_y + outer.m_height;
+	}
+
+	// Cuts the placed rect out of the free rects, keeping each remainder
+	// as the largest rects that fit around it, then drops the free rects
+	// lying inside others.
+	void splitFreeRects(std::vector<TextureAtlas::SRect>& freeRects, const TextureAtlas::SRect& used)
+	{
+		std::vector<TextureAtlas::SRect> split;
+		for (const TextureAtlas::SRect& rect : freeRects)
+		{
+			if (!intersects(rect, used))
+			{
+				split.push_back(rect);
+				continue;
+			}
+
+			const UINT right = rect.m_x + rect.m_width;
+			const UINT bottom = rect.m_y + rect.m_height;
+			const UINT usedRight = used.m_x + used.m_width;
+			const UINT usedBottom = used.m_y + used.m_height;
+
+			if (used.m_x > rect.m_x)
+			{
+				split.push_back({ rect.m_x, rect.m_y, used.m_x - rect.m_x, rect.m_height });
+			}
+			if (usedRight < right)
+			{
+				split.push_back({ usedRight, rect.m_y, right - usedRight, rect.m_height });
+			}
+			if (used.m_y > rect.m_y)
+			{
+				split.push_back({ rect.m_x, rect.m_y, rect.m_width, used.m_y - rect.m_y });
+			}
+			if (usedBottom < bottom)
+			{
+				split.push_back({ rect.m_x, usedBottom, rect.m_width, bottom - usedBottom });
+			}
+		}
+
+		freeRects.clear();
+		for (size_t i = 0; i < split.size(); ++i)
+		{
+			bool isRedundant = false;
+			for (size_t j = 0; j < split.size() && !isRedundant; ++j)
+			{
+				// Of two equal rects, the first one stays.
+				isRedundant = j != i && contains(split[j], split[i]) && (j < i || !contains(split[i], split[j]));
+			}
+
+			if (!isRedundant)
+			{
+				freeRects.push_back(split[i]);
+			}
+		}
+	}
+
+	// Places the cells in order into a strip width texels wide; height is
+	// the part of the strip used.
+	bool packStrip(
+		std::vector<TextureAtlas::SRect>& cells,
+		const std::vector<size_t>& order,
+		UINT width,
+		UINT maxHeight,
+		UINT& height)
+	{
+		std::vector<TextureAtlas::SRect> freeRects = { { 0, 0, width, maxHeight } };
+		height = 0;
+
+		for (size_t index : order)
+		{
+			TextureAtlas::SRect& cell = cells[index];
+
+			// Bottom-left rule: the lowest top edge, then the leftmost.
+			const TextureAtlas::SRect* best = nullptr;
+			for (const TextureAtlas::SRect& rect : freeRects)
+			{
+				if (rect.m_width >= cell.m_width && rect.m_height >= cell.m_height &&
+					(!best || rect.m_y < best->m_y || (rect.m_y == best->m_y && rect.m_x < best->m_x)))
+				{
+					best = &rect;
+				}
+			}
+
+			if (!best)
+			{
+				return false;
+			}
+
+			cell.m_x = best->m_x;
+			cell.m_y = best->m_y;
+			height = std::max(height, cell.m_y + cell.m_height);
+			splitFreeRects(freeRects, cell);
+		}
+
+		return true;
+	}
+
+	int address(int i, int size, MipGenerator::EAddressMode addressMode)
+	{
+		if (addressMode == MipGenerator::EAddressMode::Wrap)
+		{
+			return (i % size + size) % size;
+		}
+		return std::min(std::max(i, 0), size - 1);
+	}
+
+	// Copies a mip of an image to (x, y) of the atlas mip and fills the
+	// padding around it from the image as the sampler would address it.
+	void copyPadded(
+		const MipGenerator::SMip& source,
+		UINT x,
+		UINT y,
+		UINT padding,
+		MipGenerator::EAddressMode addressMode,
+		MipGenerator::SMip& atlas)
+	{
+		const int width = (int)source.m_width;
+		const int height = (int)source.m_height;
+		const int pad = (int)padding;
+
+		for (int row = -pad; row < height + pad; ++row)
+		{
+			const UINT* sourceRow = source.m_pixels.data() + (size_t)address(row, height, addressMode) * width;
+			UINT* atlasRow = atlas.m_pixels.data() + (size_t)((int)y + row) * atlas.m_width + x;
+
+			for (int column = -pad; column < 0; ++column)
+			{
+				atlasRow[column] = sourceRow[address(column, width, addressMode)];
+			}
+
+			std::memcpy(atlasRow, sourceRow, width * sizeof(UINT));
+
+			for (int column = width; column < width + pad; ++column)
+			{
+				atlasRow[column] = sourceRow[address(column, width, addressMode)];
+			}
+		}
+	}
+
+	bool getBlockFormat(DXGI_FORMAT dxgiFormat, BlockCompressor::EFormat& format)
+	{
+		switch (dxgiFormat)
+		{
+		case DXGI_FORMAT_BC1_UNORM:
+		case DXGI_FORMAT_BC1_UNORM_SRGB:
+			format = BlockCompressor::EFormat::Bc1;
+			return true;
+		case DXGI_FORMAT_BC3_UNORM:
+		case DXGI_FORMAT_BC3_UNORM_SRGB:
+			format = BlockCompressor::EFormat::Bc3;
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	// Copies the blocks of an image whose DDS file is already in the atlas
+	// format over the ones compressed from its decoded texels, in each mip
+	// the file has where the image lands on whole blocks, so the image is
+	// not compressed a second time. Wrapped padding is whole blocks of the
+	// image as well; clamped padding keeps the compressed edge texels, and
+	// clamped images take only the top from the file, as their padding at
+	// the lower mips comes from mips generated from the top.
+	void copySourceBlocks(
+		const std::string& path,
+		MipGenerator::EAddressMode addressMode,
+		BlockCompressor::EFormat format,
+		const TextureAtlas::SRect& rect,
+		UINT padding,
+		const std::vector<MipGenerator::SMip>& mips,
+		const std::vector<size_t>& mipOffsets,
+		std::vector<unsigned char>& blocks)
+	{
+		CDdsFile file;
+		BlockCompressor::EFormat sourceFormat;
+		if (!endsWith(path, ".dds") || !file.open(path) ||
+			!getBlockFormat(file.getDescription().m_format, sourceFormat) || sourceFormat != format)
+		{
+			return;
+		}
+
+		const bool isWrapped = addressMode == MipGenerator::EAddressMode::Wrap;
+		const UINT blockSize = BlockCompressor::getBlockSize(format);
+		const UINT mipCount = std::min((UINT)mips.size(), isWrapped ? file.getDescription().m_mipCount : 1u);
+		for (UINT mip = 0; mip < mipCount; ++mip)
+		{
+			const UINT x = rect.m_x >> mip;
+			const UINT y = rect.m_y >> mip;
+			const UINT width = rect.m_width >> mip;
+			const UINT height = rect.m_height >> mip;
+			const UINT pad = padding >> mip;
+			if (width == 0 || height == 0 || ((x | y | width | height | pad) & (BlockCompressor::BlockDimension - 1)) != 0)
+			{
+				return;
+			}
+
+			const int columns = (int)(width / BlockCompressor::BlockDimension);
+			const int rows = (int)(height / BlockCompressor::BlockDimension);
+			const int padBlocks = isWrapped ? (int)(pad / BlockCompressor::BlockDimension) : 0;
+			const int firstColumn = (int)(x / BlockCompressor::BlockDimension);
+			const int firstRow = (int)(y / BlockCompressor::BlockDimension);
+
+			const D3D11_SUBRESOURCE_DATA& source = file.getSubresource(mip);
+			const size_t atlasPitch = (size_t)(mips[mip].m_width + BlockCompressor::BlockDimension - 1) /
+				BlockCompressor::BlockDimension * blockSize;
+			for (int row = -padBlocks; row < rows + padBlocks; ++row)
+			{
+				const unsigned char* sourceRow = static_cast<const unsigned char*>(source.pSysMem) +
+					(size_t)address(row, rows, addressMode) * source.SysMemPitch;
+				unsigned char* atlasRow = blocks.data() + mipOffsets[mip] + (size_t)(firstRow + row) * atlasPitch;
+				for (int column = -padBlocks; column < columns + padBlocks; ++column)
+				{
+					std::memcpy(
+						atlasRow + (size_t)(firstColumn + column) * blockSize,
+						sourceRow + (size_t)address(column, columns, addressMode) * blockSize,
+						blockSize
+					);
+				}
+			}
+		}
+	}
+
+	bool readImageSize(const std::string& path, UINT& width, UINT& height, std::string* error)
+	{
+		if (endsWith(path, ".dds"))
+		{
+			CDdsFile file;
+			if (!file.open(path, error))
+			{
+				return false;
+			}
+
+			width = file.getDescription().m_width;
+			height = file.getDescription().m_height;
+			return true;
+		}
+
+		CMappedFile file;
+		if (!file.open(path))
+		{
+			return setError(error, path + " not found");
+		}
+
+		BmpDecoder::SInfo info;
+		if (!BmpDecoder::readInfo(file.getData(), file.getSize(), info, error))
+		{
+			if (error)
+			{
+				*error = path + ": " + *error;
+			}
+			return false;
+		}
+
+		width = info.m_width;
+		height = info.m_height;
+		return true;
+	}
+
+	// Top level of a DDS file or a BMP as R8G8B8A8.
+	bool loadImage(const std::string& path, BmpDecoder::SImage& image, std::string* error)
+	{
+		if (!endsWith(path, ".dds"))
+		{
+			return BmpDecoder::load(path, image, error);
+		}
+
+		CDdsFile file;
+		if (!file.open(path, error))
+		{
+			return false;
+		}
+
+		const DdsFile::SDescription& description = file.getDescription();
+		const D3D11_SUBRESOURCE_DATA& top = file.getSubresource(0);
+
+		image.m_width = description.m_width;
+		image.m_height = description.m_height;
+		image.m_pixels.resize((size_t)image.m_width * image.m_height);
+
+		switch (description.m_format)
+		{
+		case DXGI_FORMAT_BC1_UNORM:
+		case DXGI_FORMAT_BC1_UNORM_SRGB:
+			BlockCompressor::decompress(BlockCompressor::EFormat::Bc1, top.pSysMem,
+				image.m_width, image.m_height, image.m_pixels.data(), image.m_width * 4);
+			return true;
+		case DXGI_FORMAT_BC3_UNORM:
+		case DXGI_FORMAT_BC3_UNORM_SRGB:
+			BlockCompressor::decompress(BlockCompressor::EFormat::Bc3, top.pSysMem,
+				image.m_width, image.m_height, image.m_pixels.data(), image.m_width * 4);
+			return true;
+		case DXGI_FORMAT_R8G8B8A8_UNORM:
+		case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+			for (UINT y = 0; y < image.m_height; ++y)
+			{
+				std::memcpy(
+					image.m_pixels.data() + (size_t)y * image.m_width,
+					static_cast<const unsigned char*>(top.pSysMem) + (size_t)y * top.SysMemPitch,
+					image.m_width * 4
+				);
+			}
+			return true;
+		default:
+			return setError(error, path + ": format " + std::to_string(description.m_format) +
+				" cannot go into an atlas");
+		}
+	}
+}
+
+bool TextureAtlas::pack(const SOptions& options, SLayout& layout, std::string* error)
+{
+	const UINT alignment = options.m_alignment;
+	if (alignment < BlockCompressor::BlockDimension || (alignment & (alignment - 1)) != 0)
+	{
+		return setError(error, "atlas alignment " + std::to_string(alignment) + " is not a power of two of at least 4");
+	}
+
+	std::vector<SRect> cells(layout.m_rects.size());
+	UINT minWidth = alignment;
+	UINT rowWidth = 0;
+	for (size_t i = 0; i < cells.size(); ++i)
+	{
+		cells[i].m_width = alignUp(layout.m_rects[i].m_width + 2 * options.m_padding, alignment);
+		cells[i].m_height = alignUp(layout.m_rects[i].m_height + 2 * options.m_padding, alignment);
+		minWidth = std::max(minWidth, cells[i].m_width);
+		rowWidth += cells[i].m_width;
+	}
+
+	// Largest first; the small ones fill the gaps the large ones leave.
+	std::vector<size_t> order(cells.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b)
+	{
+		const UINT longA = std::max(cells[a].m_width, cells[a].m_height);
+		const UINT longB = std::max(cells[b].m_width, cells[b].m_height);
+		if (longA != longB)
+		{
+			return longA > longB;
+		}
+		return std::min(cells[a].m_width, cells[a].m_height) > std::min(cells[b].m_width, cells[b].m_height);
+	});
+
+	std::vector<SRect> bestCells;
+	UINT bestWidth = 0;
+	UINT bestHeight = 0;
+	unsigned long long bestArea = ULLONG_MAX;
+
+	// Past the width of all cells in one row, wider strips pack the same.
+	const UINT maxWidth = std::min(options.m_maxSize, std::max(rowWidth, minWidth));
+	for (UINT width = minWidth; width <= maxWidth; width += alignment)
+	{
+		UINT height = 0;
+		if (!packStrip(cells, order, width, options.m_maxSize, height))
+		{
+			continue;
+		}
+
+		// Of equal areas, the squarer atlas.
+		const unsigned long long area = (unsigned long long)width * height;
+		if (area < bestArea || (area == bestArea && std::max(width, height) < std::max(bestWidth, bestHeight)))
+		{
+			bestCells = cells;
+			bestWidth = width;
+			bestHeight = height;
+			bestArea = area;
+		}
+	}
+
+	if (bestCells.empty() && !cells.empty())
+	{
+		return setError(error, "images do not fit a " + std::to_string(options.m_maxSize) + " x " +
+			std::to_string(options.m_maxSize) + " atlas");
+	}
+
+	layout.m_width = std::max(bestWidth, alignment);
+	layout.m_height = std::max(bestHeight, alignment);
+	for (size_t i = 0; i < cells.size(); ++i)
+	{
+		layout.m_rects[i].m_x = bestCells[i].m_x + options.m_padding;
+		layout.m_rects[i].m_y = bestCells[i].m_y + options.m_padding;
+	}
+
+	return true;
+}
+
+UINT TextureAtlas::getMipCount(const SOptions& options, const SLayout& layout)
+{
+	if (options.m_padding == 0)
+	{
+		return 1;
+	}
+
+	// Mip k needs every image corner and size, and the padding, to be a
+	// multiple of 2^k, i.e. bit k - 1 and those below clear in all of them.
+	UINT bits = options.m_padding | options.m_alignment;
+	for (const SRect& rect : layout.m_rects)
+	{
+		bits |= rect.m_width | rect.m_height;
+	}
+
+	UINT mipCount = 1;
+	while ((bits & (1u << (mipCount - 1))) == 0)
+	{
+		++mipCount;
+	}
+	return mipCount;
+}
+
+float TextureAtlas::getEfficiency(const SLayout& layout)
+{
+	unsigned long long imageTexels = 0;
+	for (const SRect& rect : layout.m_rects)
+	{
+		imageTexels += (unsigned long long)rect.m_width * rect.m_height;
+	}
+
+	const unsigned long long atlasTexels = (unsigned long long)layout.m_width * layout.m_height;
+	return atlasTexels > 0 ? (float)imageTexels / atlasTexels : 0.0f;
+}
+
+bool TextureAtlas::build(
+	const std::vector<SImage>& images,
+	const SOptions& options,
+	SLayout& layout,
+	std::vector<MipGenerator::SMip>& mips,
+	std::string* error)
+{
+	layout = SLayout();
+	for (const SImage& image : images)
+	{
+		layout.m_rects.push_back({ 0, 0, image.m_width, image.m_height });
+	}
+
+	if (!pack(options, layout, error))
+	{
+		return false;
+	}
+
+	const UINT mipCount = getMipCount(options, layout);
+
+	std::vector<std::vector<MipGenerator::SMip>> imageMips(images.size());
+	for (size_t i = 0; i < images.size(); ++i)
+	{
+		MipGenerator::SOptions mipOptions = options.m_mipOptions;
+		mipOptions.m_addressMode = images[i].m_addressMode;
+
+		MipGenerator::SSource source;
+		source.m_pixels = images[i].m_pixels;
+		source.m_width = images[i].m_width;
+		source.m_height = images[i].m_height;
+		source.m_rowPitch = images[i].m_rowPitch;
+
+		MipGenerator::generate(source, mipOptions, imageMips[i], mipCount);
+	}
+
+	mips.resize(mipCount);
+	for (UINT mip = 0; mip < mipCount; ++mip)
+	{
+		mips[mip].m_width = layout.m_width >> mip;
+		mips[mip].m_height = layout.m_height >> mip;
+		// Opaque black between the cells, so they cost BC1 nothing.
+		mips[mip].m_pixels.assign((size_t)mips[mip].m_width * mips[mip].m_height, 0xFF000000);
+
+		for (size_t i = 0; i < images.size(); ++i)
+		{
+			copyPadded(
+				imageMips[i][mip],
+				layout.m_rects[i].m_x >> mip,
+				layout.m_rects[i].m_y >> mip,
+				options.m_padding >> mip,
+				images[i].m_addressMode,
+				mips[mip]
+			);
+		}
+	}
+
+	return true;
+}
+
+XMFLOAT4 TextureAtlas::getTexRect(const SLayout& layout, UINT image)
+{
+	const SRect& rect = layout.m_rects[image];
+	return XMFLOAT4(
+		(float)rect.m_width / layout.m_width,
+		(float)rect.m_height / layout.m_height,
+		(float)rect.m_x / layout.m_width,
+		(float)rect.m_y / layout.m_height
+	);
+}
+
+XMMATRIX TextureAtlas::getTexTransform(const SLayout& layout, UINT image)
+{
+	const XMFLOAT4 rect = getTexRect(layout, image);
+	return XMMatrixScaling(rect.x, rect.y, 1.0f) * XMMatrixTranslation(rect.z, rect.w, 0.0f);
+}
+
+void TextureAtlas::remapTexCoords(
+	const XMFLOAT4& texRect,
+	void* vertices,
+	size_t vertexCount,
+	size_t stride,
+	size_t texCoordOffset)
+{
+	unsigned char* vertex = static_cast<unsigned char*>(vertices) + texCoordOffset;
+	for (size_t i = 0; i < vertexCount; ++i, vertex += stride)
+	{
+		XMFLOAT2* texCoord = reinterpret_cast<XMFLOAT2*>(vertex);
+		texCoord->x = texCoord->x * texRect.x + texRect.z;
+		texCoord->y = texCoord->y * texRect.y + texRect.w;
+	}
+}
+
+bool TextureAtlas::parseManifest(
+	const std::string& sourcePath,
+	const char* text,
+	size_t size,
+	SManifest& manifest,
+	std::string* error)
+{
+	manifest = SManifest();
+
+	// Images are named relative to the manifest.
+	const size_t slash = sourcePath.find_last_of("/\\");
+	const std::string directory = slash == std::string::npos ? std::string() : sourcePath.substr(0, slash + 1);
+
+	std::istringstream stream(std::string(text, size));
+	std::string line;
+	while (std::getline(stream, line))
+	{
+		std::istringstream lineStream(line);
+		std::string key;
+		lineStream >> key;
+
+		if (key == "Padding:")
+		{
+			lineStream >> manifest.m_options.m_padding;
+		}
+		else if (key == "Alignment:")
+		{
+			lineStream >> manifest.m_options.m_alignment;
+		}
+		else if (key == "MaxSize:")
+		{
+			lineStream >> manifest.m_options.m_maxSize;
+		}
+		else if (key == "Image:")
+		{
+			std::string path;
+			std::string addressMode = "Wrap";
+			lineStream >> path >> addressMode;
+
+			if (addressMode != "Wrap" && addressMode != "Clamp")
+			{
+				return setError(error, sourcePath + ": unknown address mode " + addressMode);
+			}
+
+			manifest.m_imagePaths.push_back(directory + path);
+			manifest.m_addressModes.push_back(addressMode == "Wrap" ?
+				MipGenerator::EAddressMode::Wrap : MipGenerator::EAddressMode::Clamp);
+		}
+		else if (!key.empty() && key[0] != '#')
+		{
+			return setError(error, sourcePath + ": unknown key " + key);
+		}
+	}
+
+	if (manifest.m_imagePaths.empty())
+	{
+		return setError(error, sourcePath + ": at least one Image is required");
+	}
+
+	return true;
+}
+
+bool TextureAtlas::loadLayout(const std::string& sourcePath, SLayout& layout, std::string* error)
+{
+	CMappedFile source;
+	if (!source.open(sourcePath))
+	{
+		return setError(error, sourcePath + " not found");
+	}
+
+	SManifest manifest;
+	if (!parseManifest(
+		sourcePath,
+		reinterpret_cast<const char*>(source.getData()),
+		source.getSize(),
+		manifest,
+		error))
+	{
+		return false;
+	}
+
+	layout = SLayout();
+	for (const std::string& path : manifest.m_imagePaths)
+	{
+		SRect rect = {};
+		if (!readImageSize(path, rect.m_width, rect.m_height, error))
+		{
+			return false;
+		}
+		layout.m_rects.push_back(rect);
+	}
+
+	if (!pack(manifest.m_options, layout, error))
+	{
+		if (error)
+		{
+			*error = sourcePath + ": " + *error;
+		}
+		return false;
+	}
+
+	return true;
+}
+
+bool TextureAtlas::convertManifest(
+	const std::string& sourcePath,
+	const char* text,
+	size_t size,
+	const std::string& path,
+	std::string* error)
+{
+	SManifest manifest;
+	if (!parseManifest(sourcePath, text, size, manifest, error))
+	{
+		return false;
+	}
+
+	const UINT imageCount = (UINT)manifest.m_imagePaths.size();
+	std::vector<BmpDecoder::SImage> decoded(imageCount);
+	std::vector<std::string> errors(imageCount);
+	CThreadPool::getShared().parallelFor(0, imageCount, 1, [&](UINT begin, UINT end)
+	{
+		for (UINT i = begin; i < end; ++i)
+		{
+			loadImage(manifest.m_imagePaths[i], decoded[i], &errors[i]);
+		}
+	});
+
+	std::vector<SImage> images(imageCount);
+	for (UINT i = 0; i < imageCount; ++i)
+	{
+		if (!errors[i].empty())
+		{
+			return setError(error, errors[i]);
+		}
+
+		images[i].m_pixels = decoded[i].m_pixels.data();
+		images[i].m_width = decoded[i].m_width;
+		images[i].m_height = decoded[i].m_height;
+		images[i].m_rowPitch = decoded[i].m_width * 4;
+		images[i].m_addressMode = manifest.m_addressModes[i];
+	}
+
+	SLayout layout;
+	std::vector<MipGenerator::SMip> mips;
+	if (!build(images, manifest.m_options, layout, mips, error))
+	{
+		if (error)
+		{
+			*error = sourcePath + ": " + *error;
+		}
+		return false;
+	}
+
+	const bool hasAlpha = std::any_of(decoded.begin(), decoded.end(), [](const BmpDecoder::SImage& image)
+	{
+		return std::any_of(image.m_pixels.begin(), image.m_pixels.end(), [](UINT pixel)
+		{
+			return (pixel >> 24) != 0xFF;
+		});
+	});
+	const BlockCompressor::EFormat format = hasAlpha ? BlockCompressor::EFormat::Bc3 : BlockCompressor::EFormat::Bc1;
+
+	size_t blocksSize = 0;
+	for (const MipGenerator::SMip& mip : mips)
+	{
+		blocksSize += BlockCompressor::getCompressedSize(format, mip.m_width, mip.m_height);
+	}
+
+	std::vector<unsigned char> blocks(blocksSize);
+	std::vector<size_t> mipOffsets(mips.size());
+	size_t offset = 0;
+	for (size_t mip = 0; mip < mips.size(); ++mip)
+	{
+		mipOffsets[mip] = offset;
+		BlockCompressor::compress(format, BlockCompressor::EQuality::Normal,
+			mips[mip].m_pixels.data(), mips[mip].m_width, mips[mip].m_height, mips[mip].m_width * 4, blocks.data() + offset);
+		offset += BlockCompressor::getCompressedSize(format, mips[mip].m_width, mips[mip].m_height);
+	}
+
+	for (UINT i = 0; i < imageCount; ++i)
+	{
+		copySourceBlocks(
+			manifest.m_imagePaths[i],
+			manifest.m_addressModes[i],
+			format,
+			layout.m_rects[i],
+			manifest.m_options.m_padding,
+			mips,
+			mipOffsets,
+			blocks
+		);
+	}
+
+	return DdsFile::write(
+		path,
+		BlockCompressor::getDxgiFormat(format),
+		layout.m_width,
+		layout.m_height,
+		(UINT)mips.size(),
+		blocks.data(),
+		blocks.size(),
+		error
+	);
+}
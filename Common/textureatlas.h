@@ -0,0 +1,147 @@
+﻿#pragma once
+
+#include <string>
+#include <vector>
+
+#include "d3dutil.h"
+#include "mipgenerator.h"
+
+using namespace DirectX;
+
+// Packs several textures into one, so draws that differ only in their
+// texture can share a bind, or a draw when their meshes are merged.
+//
+// Images are placed by MaxRects with the bottom-left rule, largest first,
+// each with m_padding texels of its own content repeated around it. The
+// atlas keeps the mips whose padding is at least a texel wide and whose
+// images start on whole texels, so filtering at any kept mip never reads
+// a neighbouring image. Widths tried run over the multiples of m_alignment
+// up to m_maxSize; the packing of the smallest area wins.
+//
+// Atlases are built from a text manifest next to the images, e.g.
+//
+//   # Room textures.
+//   Padding: 16
+//   Alignment: 32
+//   Image: checkboard.dds Wrap
+//   Image: ice.dds Clamp
+//
+// listing BC1, BC3 or R8G8B8A8 DDS files or BMPs and the address mode their
+// padding and mips follow. The asset cache converts ".atlas" manifests into
+// block-compressed ".dds" atlases, with the images in the cache key, so an
+// edited or resized image is converted again. loadLayout() packs the same
+// manifest again from the image headers alone, so a program using the
+// converted atlas learns where each image went without decoding any of
+// them; the packing depends on nothing else, so both agree.
+namespace TextureAtlas
+{
+	struct SOptions
+	{
+		UINT m_maxSize = 4096;
+
+		// Texels around each image, and the power of two its padded cell
+		// starts on. Mip k is kept while 2^k divides the padding, the
+		// alignment and every image size, e.g. five mips for the defaults
+		// and images of 512.
+		UINT m_padding = 16;
+		UINT m_alignment = 32;
+
+		// Filter and color space of the mips; the address mode is per image.
+		MipGenerator::SOptions m_mipOptions;
+	};
+
+	struct SRect
+	{
+		UINT m_x;
+		UINT m_y;
+		UINT m_width;
+		UINT m_height;
+	};
+
+	struct SLayout
+	{
+		UINT m_width = 0;
+		UINT m_height = 0;
+
+		// Per image, without the padding.
+		std::vector<SRect> m_rects;
+	};
+
+	struct SImage
+	{
+		const UINT* m_pixels;
+		UINT m_width;
+		UINT m_height;
+		UINT m_rowPitch;
+		MipGenerator::EAddressMode m_addressMode;
+	};
+
+	struct SManifest
+	{
+		SOptions m_options;
+
+		// Relative to the current directory.
+		std::vector<std::string> m_imagePaths;
+		std::vector<MipGenerator::EAddressMode> m_addressModes;
+	};
+
+	// Places the rects of layout, which come in with their sizes; false if
+	// they do not fit m_maxSize x m_maxSize.
+	bool pack(const SOptions& options, SLayout& layout, std::string* error = nullptr);
+
+	UINT getMipCount(const SOptions& options, const SLayout& layout);
+
+	// Image texels over atlas texels.
+	float getEfficiency(const SLayout& layout);
+
+	// Packs the images and fills mips with the R8G8B8A8 levels of the atlas.
+	bool build(
+		const std::vector<SImage>& images,
+		const SOptions& options,
+		SLayout& layout,
+		std::vector<MipGenerator::SMip>& mips,
+		std::string* error = nullptr
+	);
+
+	// (scale u, scale v, offset u, offset v) taking the [0, 1] texture
+	// coordinates of an image to the atlas; for tiling coordinates, apply
+	// it to their fractional part in the pixel shader.
+	XMFLOAT4 getTexRect(const SLayout& layout, UINT image);
+
+	// The same as a texture transform, for coordinates that do not tile.
+	XMMATRIX getTexTransform(const SLayout& layout, UINT image);
+
+	// Bakes a rect into the XMFLOAT2 texture coordinates at texCoordOffset
+	// of each vertex, so meshes of different images can be merged into one
+	// draw.
+	void remapTexCoords(
+		const XMFLOAT4& texRect,
+		void* vertices,
+		size_t vertexCount,
+		size_t stride,
+		size_t texCoordOffset
+	);
+
+	bool parseManifest(
+		const std::string& sourcePath,
+		const char* text,
+		size_t size,
+		SManifest& manifest,
+		std::string* error = nullptr
+	);
+
+	bool loadLayout(const std::string& sourcePath, SLayout& layout, std::string* error = nullptr);
+
+	// Builds the atlas of a manifest into a DDS file, BC1 for opaque images
+	// and BC3 for ones with alpha; the asset cache converter for ".atlas".
+	// Images that are DDS files of the same format keep their own blocks
+	// wherever they land on whole blocks, so only the mips generated for
+	// them, and clamped padding, are compressed.
+	bool convertManifest(
+		const std::string& sourcePath,
+		const char* text,
+		size_t size,
+		const std::string& path,
+		std::string* error = nullptr
+	);
+}
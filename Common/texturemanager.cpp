@@ -0,0 +1,283 @@
+﻿#include "texturemanager.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "assetcache.h"
+#include "ddsfile.h"
+#include "fileutil.h"
+
+using FileUtil::setError;
+
+namespace
+{
+	bool isDdsPath(const std::string& path)
+	{
+		const std::string extension = ".dds";
+		return path.size() >= extension.size() &&
+			path.compare(path.size() - extension.size(), extension.size(), extension) == 0;
+	}
+}
+
+CTextureManager::CTextureManager() :
+	m_residentBytes(0),
+	m_frame(0),
+	m_evictionCount(0),
+	m_trimCount(0),
+	m_reloadCount(0),
+	m_reloadTime(0.0f),
+	m_maxReloadTime(0.0f)
+{
+
+}
+
+void CTextureManager::initialize(ID3D11Device* device, const STextureManagerDesc& desc)
+{
+	m_device = device;
+	m_desc = desc;
+}
+
+void CTextureManager::setByteBudget(size_t byteBudget)
+{
+	m_desc.m_byteBudget = byteBudget;
+}
+
+size_t CTextureManager::getByteBudget() const
+{
+	return m_desc.m_byteBudget;
+}
+
+CTextureManager::Handle CTextureManager::add(const std::string& path)
+{
+	auto it = m_handles.find(path);
+	if (it != m_handles.end())
+	{
+		return it->second;
+	}
+
+	STexture texture;
+	texture.m_path = path;
+	m_textures.push_back(texture);
+
+	const Handle handle = (Handle)m_textures.size();
+	m_handles[path] = handle;
+	return handle;
+}
+
+ID3D11ShaderResourceView* CTextureManager::acquire(Handle handle, std::string* error)
+{
+	STexture* texture = findTexture(handle);
+	if (!texture)
+	{
+		setError(error, "invalid texture handle");
+		return nullptr;
+	}
+
+	if (!texture->m_view && !load(*texture, 0, error))
+	{
+		return nullptr;
+	}
+
+	texture->m_lastUsedFrame = m_frame;
+	return texture->m_view.Get();
+}
+
+void CTextureManager::update()
+{
+	evictOverBudget();
+	restoreTrimmed();
+	++m_frame;
+}
+
+bool CTextureManager::isResident(Handle handle) const
+{
+	const STexture* texture = findTexture(handle);
+	return texture && texture->m_view;
+}
+
+UINT CTextureManager::getTopMip(Handle handle) const
+{
+	const STexture* texture = findTexture(handle);
+	return texture ? texture->m_topMip : 0;
+}
+
+size_t CTextureManager::getResidentBytes() const
+{
+	return m_residentBytes;
+}
+
+UINT CTextureManager::getResidentTextureCount() const
+{
+	UINT count = 0;
+	for (const STexture& texture : m_textures)
+	{
+		if (texture.m_view)
+		{
+			++count;
+		}
+	}
+	return count;
+}
+
+UINT CTextureManager::getEvictionCount() const
+{
+	return m_evictionCount;
+}
+
+UINT CTextureManager::getTrimCount() const
+{
+	return m_trimCount;
+}
+
+UINT CTextureManager::getReloadCount() const
+{
+	return m_reloadCount;
+}
+
+float CTextureManager::getAverageReloadTime() const
+{
+	return m_reloadCount > 0 ? m_reloadTime / m_reloadCount : 0.0f;
+}
+
+float CTextureManager::getMaxReloadTime() const
+{
+	return m_maxReloadTime;
+}
+
+CTextureManager::STexture* CTextureManager::findTexture(Handle handle)
+{
+	return handle != InvalidHandle && handle <= m_textures.size() ? &m_textures[handle - 1] : nullptr;
+}
+
+const CTextureManager::STexture* CTextureManager::findTexture(Handle handle) const
+{
+	return handle != InvalidHandle && handle <= m_textures.size() ? &m_textures[handle - 1] : nullptr;
+}
+
+bool CTextureManager::load(STexture& texture, UINT topMip, std::string* error)
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	// The file is only mapped while the texture is created; the driver
+	// keeps its own copy.
+	CDdsFile file;
+	if (isDdsPath(texture.m_path))
+	{
+		if (!file.open(texture.m_path, error))
+		{
+			return false;
+		}
+	}
+	else if (!CAssetCache::getShared().loadTexture(texture.m_path, file, error))
+	{
+		return false;
+	}
+
+	const DdsFile::SDescription& description = file.getDescription();
+	topMip = std::min(topMip, description.m_mipCount - 1);
+
+	ComPtr<ID3D11ShaderResourceView> view;
+	const HRESULT result = file.createShaderResourceView(m_device.Get(), view.GetAddressOf(), topMip);
+	if (FAILED(result))
+	{
+		return setError(error, texture.m_path + ": texture creation failed with error " + std::to_string(result));
+	}
+
+	const bool isReload = texture.m_wasLoaded && (!texture.m_view || topMip < texture.m_topMip);
+
+	m_residentBytes -= texture.m_bytes;
+	texture.m_view = view;
+	texture.m_bytes = file.getByteCount(topMip);
+	texture.m_topMip = topMip;
+	texture.m_wasLoaded = true;
+	texture.m_width = description.m_width;
+	texture.m_height = description.m_height;
+	texture.m_mipCount = description.m_mipCount;
+	texture.m_fullBytes = file.getByteCount();
+	m_residentBytes += texture.m_bytes;
+
+	if (isReload)
+	{
+		const float time = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+		++m_reloadCount;
+		m_reloadTime += time;
+		m_maxReloadTime = std::max(m_maxReloadTime, time);
+	}
+
+	return true;
+}
+
+bool CTextureManager::canTrim(const STexture& texture) const
+{
+	const UINT topMip = texture.m_topMip + 1;
+	return topMip < texture.m_mipCount &&
+		(texture.m_width >> topMip) >= m_desc.m_minTrimmedSize &&
+		(texture.m_height >> topMip) >= m_desc.m_minTrimmedSize;
+}
+
+void CTextureManager::release(STexture& texture)
+{
+	m_residentBytes -= texture.m_bytes;
+	texture.m_view.Reset();
+	texture.m_bytes = 0;
+	texture.m_topMip = 0;
+	++m_evictionCount;
+}
+
+void CTextureManager::evictOverBudget()
+{
+	if (m_residentBytes <= m_desc.m_byteBudget)
+	{
+		return;
+	}
+
+	// Least recently used first; textures used this frame stay.
+	std::vector<std::pair<UINT, size_t>> candidates;
+	for (size_t i = 0; i < m_textures.size(); ++i)
+	{
+		if (m_textures[i].m_view && m_textures[i].m_lastUsedFrame != m_frame)
+		{
+			candidates.emplace_back(m_textures[i].m_lastUsedFrame, i);
+		}
+	}
+	std::sort(candidates.begin(), candidates.end());
+
+	// Textures not used for a while go first, then the recently used ones
+	// give up mips, and only if that is not enough are they released too.
+	for (size_t i = 0; i < candidates.size() && m_residentBytes > m_desc.m_byteBudget; ++i)
+	{
+		STexture& texture = m_textures[candidates[i].second];
+		if (m_frame - texture.m_lastUsedFrame > m_desc.m_trimFrameCount)
+		{
+			release(texture);
+			continue;
+		}
+
+		while (m_residentBytes > m_desc.m_byteBudget && canTrim(texture) && load(texture, texture.m_topMip + 1, nullptr))
+		{
+			++m_trimCount;
+		}
+	}
+
+	for (size_t i = 0; i < candidates.size() && m_residentBytes > m_desc.m_byteBudget; ++i)
+	{
+		STexture& texture = m_textures[candidates[i].second];
+		if (texture.m_view)
+		{
+			release(texture);
+		}
+	}
+}
+
+void CTextureManager::restoreTrimmed()
+{
+	for (STexture& texture : m_textures)
+	{
+		if (texture.m_view && texture.m_topMip > 0 && texture.m_lastUsedFrame == m_frame &&
+			m_residentBytes - texture.m_bytes + texture.m_fullBytes <= m_desc.m_byteBudget)
+		{
+			load(texture, 0, nullptr);
+			return;
+		}
+	}
+}
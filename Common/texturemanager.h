@@ -0,0 +1,122 @@
+﻿#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "d3dutil.h"
+
+using Microsoft::WRL::ComPtr;
+
+struct STextureManagerDesc
+{
+	// Texture memory above which textures not used this frame give way.
+	size_t m_byteBudget = 64 * 1024 * 1024;
+
+	// Textures used within this many frames lose their top mip instead of
+	// being released.
+	UINT m_trimFrameCount = 120;
+
+	// Trimming stops at this width and height, so nothing ever turns into
+	// a blur.
+	UINT m_minTrimmedSize = 64;
+};
+
+// Owns the textures of a scene within a memory budget. Textures are
+// registered by path and referred to by handle; nothing is loaded until a
+// texture is first acquired, and a texture released over budget is loaded
+// again the next time it is acquired.
+//
+// update() brings the resident bytes back under the budget once per frame,
+// least recently used first, and never touches the textures acquired this
+// frame. A texture used in the last m_trimFrameCount frames is recreated
+// without its top mip, three quarters of its memory, and stays drawable
+// at lower resolution; older ones are released entirely. Trimmed textures
+// in use get their mips back, one texture per frame, as the budget allows.
+//
+// Sources are DDS files, which go to the device straight from the mapped
+// file, or anything the asset cache converts to DDS, e.g. BMPs. Owner
+// thread only.
+class CTextureManager
+{
+public:
+	typedef UINT Handle;
+	static const Handle InvalidHandle = 0;
+
+	CTextureManager();
+
+	void initialize(ID3D11Device* device, const STextureManagerDesc& desc);
+
+	void setByteBudget(size_t byteBudget);
+	size_t getByteBudget() const;
+
+	// Registers a texture without loading it; the same path gives the same
+	// handle.
+	Handle add(const std::string& path);
+
+	// View of the texture, loaded first if it is not resident. Null if the
+	// texture cannot be loaded; the view stays valid until the next update().
+	ID3D11ShaderResourceView* acquire(Handle handle, std::string* error = nullptr);
+
+	// Call once per frame, after the frame's acquire() calls.
+	void update();
+
+	bool isResident(Handle handle) const;
+
+	// Most detailed mip resident, zero unless trimmed.
+	UINT getTopMip(Handle handle) const;
+
+	size_t getResidentBytes() const;
+	UINT getResidentTextureCount() const;
+
+	// Textures released, and mips dropped from textures kept.
+	UINT getEvictionCount() const;
+	UINT getTrimCount() const;
+
+	// Loads of textures that were released or trimmed before, and the time
+	// they took in seconds.
+	UINT getReloadCount() const;
+	float getAverageReloadTime() const;
+	float getMaxReloadTime() const;
+
+private:
+	struct STexture
+	{
+		std::string m_path;
+		ComPtr<ID3D11ShaderResourceView> m_view;
+		size_t m_bytes = 0;
+		UINT m_topMip = 0;
+		UINT m_lastUsedFrame = 0;
+
+		// From the first load on.
+		bool m_wasLoaded = false;
+		UINT m_width = 0;
+		UINT m_height = 0;
+		UINT m_mipCount = 0;
+		size_t m_fullBytes = 0;
+	};
+
+	STexture* findTexture(Handle handle);
+	const STexture* findTexture(Handle handle) const;
+
+	bool load(STexture& texture, UINT topMip, std::string* error);
+	bool canTrim(const STexture& texture) const;
+	void release(STexture& texture);
+
+	void evictOverBudget();
+	void restoreTrimmed();
+
+	ComPtr<ID3D11Device> m_device;
+	STextureManagerDesc m_desc;
+
+	std::vector<STexture> m_textures;
+	std::unordered_map<std::string, Handle> m_handles;
+	size_t m_residentBytes;
+	UINT m_frame;
+
+	UINT m_evictionCount;
+	UINT m_trimCount;
+	UINT m_reloadCount;
+	float m_reloadTime;
+	float m_maxReloadTime;
+};
@@ -0,0 +1,781 @@
+﻿#include "texturesampler.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "blockcompressor.h"
+#include "cpufeatures.h"
+#include "fileutil.h"
+#include "pixelformat.h"
+
+#if defined(_XM_SSE_INTRINSICS_)
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#define TARGET_AVX2
+#else
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+using FileUtil::setError;
+using namespace TextureSampler;
+
+namespace
+{
+	const UINT MaxBatchSize = 8;
+	const UINT MaxAnisotropy = 16;
+
+	// What the filtering of each pixel of a batch needs, worked out one
+	// pixel at a time, as it takes a square root and a logarithm.
+	struct alignas(32) SBatch
+	{
+		float m_u[MaxBatchSize];
+		float m_v[MaxBatchSize];
+
+		// Probes are spread evenly along the axis, centered on (u, v).
+		float m_axisU[MaxBatchSize];
+		float m_axisV[MaxBatchSize];
+		float m_probeCount[MaxBatchSize];
+
+		// Level, and the level blended in by the fraction for trilinear
+		// filtering.
+		int m_level[MaxBatchSize];
+		int m_nextLevel[MaxBatchSize];
+		float m_levelFraction[MaxBatchSize];
+
+		// Over the pixels of the batch; the others run their extra probes
+		// with zero weight.
+		UINT m_maxProbeCount;
+	};
+
+	bool isPointFilter(const SSampler& sampler)
+	{
+		return sampler.m_filter == EFilter::Point;
+	}
+
+	bool isMipLinear(const SSampler& sampler)
+	{
+		return sampler.m_filter == EFilter::Trilinear || sampler.m_filter == EFilter::Anisotropic;
+	}
+
+	void setLevel(const STexture& texture, const SSampler& sampler, float lod, SBatch& batch, UINT lane)
+	{
+		lod = std::min(std::max(lod + sampler.m_mipLodBias, sampler.m_minLod), sampler.m_maxLod);
+		lod = std::min(std::max(lod, 0.0f), (float)(texture.m_mipCount - 1));
+
+		int level = 0;
+		float fraction = 0.0f;
+		if (isMipLinear(sampler))
+		{
+			level = (int)std::floor(lod);
+			fraction = lod - (float)level;
+		}
+		else
+		{
+			level = (int)std::floor(lod + 0.5f);
+		}
+
+		batch.m_level[lane] = level;
+		batch.m_nextLevel[lane] = std::min(level + 1, (int)texture.m_mipCount - 1);
+		batch.m_levelFraction[lane] = fraction;
+	}
+
+	void setupLane(
+		const STexture& texture,
+		const SSampler& sampler,
+		const SCoords& coords,
+		UINT index,
+		SBatch& batch,
+		UINT lane)
+	{
+		const float dudx = coords.m_dudx[index];
+		const float dvdx = coords.m_dvdx[index];
+		const float dudy = coords.m_dudy[index];
+		const float dvdy = coords.m_dvdy[index];
+
+		batch.m_u[lane] = coords.m_u[index];
+		batch.m_v[lane] = coords.m_v[index];
+		batch.m_axisU[lane] = 0.0f;
+		batch.m_axisV[lane] = 0.0f;
+		batch.m_probeCount[lane] = 1.0f;
+
+		// Footprint of the pixel in texels of the top level.
+		const float width = (float)texture.m_width;
+		const float height = (float)texture.m_height;
+		const float lengthX = std::sqrt(dudx * width * dudx * width + dvdx * height * dvdx * height);
+		const float lengthY = std::sqrt(dudy * width * dudy * width + dvdy * height * dvdy * height);
+		float footprint = std::max(lengthX, lengthY);
+
+		if (sampler.m_filter == EFilter::Anisotropic)
+		{
+			const float minor = std::min(lengthX, lengthY);
+			const float maxRatio = (float)std::min(std::max(sampler.m_maxAnisotropy, 1u), MaxAnisotropy);
+			float ratio = 1.0f;
+			if (footprint > 0.0f)
+			{
+				ratio = minor > 0.0f ? std::min(footprint / minor, maxRatio) : maxRatio;
+			}
+
+			batch.m_axisU[lane] = lengthX >= lengthY ? dudx : dudy;
+			batch.m_axisV[lane] = lengthX >= lengthY ? dvdx : dvdy;
+			batch.m_probeCount[lane] = std::ceil(ratio);
+			footprint /= ratio;
+		}
+
+		setLevel(texture, sampler, std::log2(footprint), batch, lane);
+		batch.m_maxProbeCount = std::max(batch.m_maxProbeCount, (UINT)batch.m_probeCount[lane]);
+	}
+
+	// Texel coordinate x, a whole number, of a level size texels wide.
+	float address(float x, float size, EAddressMode addressMode)
+	{
+		if (addressMode == EAddressMode::Wrap)
+		{
+			x = x - size * std::floor(x / size);
+		}
+		else if (addressMode == EAddressMode::Mirror)
+		{
+			const float period = size + size;
+			x = x - period * std::floor(x / period);
+			if (x >= size)
+			{
+				x = period - 1.0f - x;
+			}
+		}
+
+		// Also catches rounding at the edges of the other modes.
+		return std::min(std::max(x, 0.0f), size - 1.0f);
+	}
+
+	void fetch(const STexture& texture, const SSampler& sampler, int level, float u, float v, float color[4])
+	{
+		const UINT* texels = texture.m_texels.data() + texture.m_mipOffsets[level];
+		const UINT levelWidth = texture.m_mipWidths[level];
+		const float width = (float)levelWidth;
+		const float height = (float)texture.m_mipHeights[level];
+
+		float x = u * width;
+		float y = v * height;
+		if (!isPointFilter(sampler))
+		{
+			x = x - 0.5f;
+			y = y - 0.5f;
+		}
+
+		const float x0 = std::floor(x);
+		const float y0 = std::floor(y);
+		const int left = (int)address(x0, width, sampler.m_addressU);
+		const int top = (int)address(y0, height, sampler.m_addressV);
+
+		if (isPointFilter(sampler))
+		{
+			const UINT texel = texels[top * levelWidth + left];
+			for (UINT c = 0; c < 4; ++c)
+			{
+				color[c] = (float)((texel >> (8 * c)) & 0xFF);
+			}
+			return;
+		}
+
+		const int right = (int)address(x0 + 1.0f, width, sampler.m_addressU);
+		const int bottom = (int)address(y0 + 1.0f, height, sampler.m_addressV);
+		const float fractionX = x - x0;
+		const float fractionY = y - y0;
+
+		const UINT topLeft = texels[top * levelWidth + left];
+		const UINT topRight = texels[top * levelWidth + right];
+		const UINT bottomLeft = texels[bottom * levelWidth + left];
+		const UINT bottomRight = texels[bottom * levelWidth + right];
+
+		for (UINT c = 0; c < 4; ++c)
+		{
+			const float a = (float)((topLeft >> (8 * c)) & 0xFF);
+			const float b = (float)((topRight >> (8 * c)) & 0xFF);
+			const float d = (float)((bottomLeft >> (8 * c)) & 0xFF);
+			const float e = (float)((bottomRight >> (8 * c)) & 0xFF);
+			const float upper = a + (b - a) * fractionX;
+			const float lower = d + (e - d) * fractionX;
+			color[c] = upper + (lower - upper) * fractionY;
+		}
+	}
+
+	void filterLane(const STexture& texture, const SSampler& sampler, const SBatch& batch, UINT lane, XMFLOAT4& color)
+	{
+		float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		const float count = batch.m_probeCount[lane];
+		const float fraction = batch.m_levelFraction[lane];
+
+		for (UINT probe = 0; probe < batch.m_maxProbeCount; ++probe)
+		{
+			const float offset = ((float)probe + 0.5f) / count - 0.5f;
+			const float weight = (float)probe < count ? 1.0f / count : 0.0f;
+			const float u = batch.m_u[lane] + batch.m_axisU[lane] * offset;
+			const float v = batch.m_v[lane] + batch.m_axisV[lane] * offset;
+
+			float texel[4];
+			fetch(texture, sampler, batch.m_level[lane], u, v, texel);
+			const float levelWeight = weight * (1.0f - fraction);
+			for (UINT c = 0; c < 4; ++c)
+			{
+				sum[c] = sum[c] + texel[c] * levelWeight;
+			}
+
+			if (isMipLinear(sampler))
+			{
+				fetch(texture, sampler, batch.m_nextLevel[lane], u, v, texel);
+				const float nextWeight = weight * fraction;
+				for (UINT c = 0; c < 4; ++c)
+				{
+					sum[c] = sum[c] + texel[c] * nextWeight;
+				}
+			}
+		}
+
+		const float scale = 1.0f / 255.0f;
+		color = XMFLOAT4(sum[0] * scale, sum[1] * scale, sum[2] * scale, sum[3] * scale);
+	}
+
+#if defined(_XM_SSE_INTRINSICS_)
+	const bool HasAvx2 = CpuFeatures::hasAvx2();
+
+	// Floats of 2^23 and above in magnitude have no fraction, and would
+	// overflow the conversion to integers, so they are kept as they are.
+	__m128 floorSse(__m128 x)
+	{
+		const __m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+		const __m128 floored = _mm_sub_ps(truncated, _mm_and_ps(_mm_cmpgt_ps(truncated, x), _mm_set1_ps(1.0f)));
+		const __m128 hasFraction = _mm_cmplt_ps(_mm_andnot_ps(_mm_set1_ps(-0.0f), x), _mm_set1_ps(8388608.0f));
+		return _mm_or_ps(_mm_and_ps(hasFraction, floored), _mm_andnot_ps(hasFraction, x));
+	}
+
+	__m128 addressSse(__m128 x, __m128 size, EAddressMode addressMode)
+	{
+		const __m128 one = _mm_set1_ps(1.0f);
+
+		if (addressMode == EAddressMode::Wrap)
+		{
+			x = _mm_sub_ps(x, _mm_mul_ps(size, floorSse(_mm_div_ps(x, size))));
+		}
+		else if (addressMode == EAddressMode::Mirror)
+		{
+			const __m128 period = _mm_add_ps(size, size);
+			x = _mm_sub_ps(x, _mm_mul_ps(period, floorSse(_mm_div_ps(x, period))));
+			const __m128 isBack = _mm_cmpge_ps(x, size);
+			x = _mm_or_ps(_mm_and_ps(isBack, _mm_sub_ps(_mm_sub_ps(period, one), x)), _mm_andnot_ps(isBack, x));
+		}
+
+		return _mm_min_ps(_mm_max_ps(x, _mm_setzero_ps()), _mm_sub_ps(size, one));
+	}
+
+	// Channels of four texels, one texel per lane.
+	void unpackSse(__m128i texels, __m128 channels[4])
+	{
+		const __m128i mask = _mm_set1_epi32(0xFF);
+		channels[0] = _mm_cvtepi32_ps(_mm_and_si128(texels, mask));
+		channels[1] = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(texels, 8), mask));
+		channels[2] = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(texels, 16), mask));
+		channels[3] = _mm_cvtepi32_ps(_mm_srli_epi32(texels, 24));
+	}
+
+	// fetch() on four pixels; SSE2 has no gather, so the texels are loaded
+	// one at a time.
+	void fetchSse(
+		const STexture& texture,
+		const SSampler& sampler,
+		const int* levels,
+		__m128 u,
+		__m128 v,
+		__m128 color[4])
+	{
+		alignas(16) float widths[4];
+		alignas(16) float heights[4];
+		const UINT* texels[4];
+		UINT levelWidths[4];
+		for (UINT lane = 0; lane < 4; ++lane)
+		{
+			texels[lane] = texture.m_texels.data() + texture.m_mipOffsets[levels[lane]];
+			levelWidths[lane] = texture.m_mipWidths[levels[lane]];
+			widths[lane] = (float)levelWidths[lane];
+			heights[lane] = (float)texture.m_mipHeights[levels[lane]];
+		}
+
+		const __m128 width = _mm_load_ps(widths);
+		const __m128 height = _mm_load_ps(heights);
+		const __m128 one = _mm_set1_ps(1.0f);
+
+		__m128 x = _mm_mul_ps(u, width);
+		__m128 y = _mm_mul_ps(v, height);
+		if (!isPointFilter(sampler))
+		{
+			x = _mm_sub_ps(x, _mm_set1_ps(0.5f));
+			y = _mm_sub_ps(y, _mm_set1_ps(0.5f));
+		}
+
+		const __m128 x0 = floorSse(x);
+		const __m128 y0 = floorSse(y);
+
+		alignas(16) int left[4];
+		alignas(16) int top[4];
+		_mm_store_si128(reinterpret_cast<__m128i*>(left), _mm_cvttps_epi32(addressSse(x0, width, sampler.m_addressU)));
+		_mm_store_si128(reinterpret_cast<__m128i*>(top), _mm_cvttps_epi32(addressSse(y0, height, sampler.m_addressV)));
+
+		const __m128i topLeft = _mm_setr_epi32(
+			(int)texels[0][top[0] * levelWidths[0] + left[0]],
+			(int)texels[1][top[1] * levelWidths[1] + left[1]],
+			(int)texels[2][top[2] * levelWidths[2] + left[2]],
+			(int)texels[3][top[3] * levelWidths[3] + left[3]]
+		);
+
+		if (isPointFilter(sampler))
+		{
+			unpackSse(topLeft, color);
+			return;
+		}
+
+		alignas(16) int right[4];
+		alignas(16) int bottom[4];
+		_mm_store_si128(reinterpret_cast<__m128i*>(right),
+			_mm_cvttps_epi32(addressSse(_mm_add_ps(x0, one), width, sampler.m_addressU)));
+		_mm_store_si128(reinterpret_cast<__m128i*>(bottom),
+			_mm_cvttps_epi32(addressSse(_mm_add_ps(y0, one), height, sampler.m_addressV)));
+
+		__m128i corners[3];
+		alignas(16) int cornerTexels[3][4];
+		for (UINT lane = 0; lane < 4; ++lane)
+		{
+			cornerTexels[0][lane] = (int)texels[lane][top[lane] * levelWidths[lane] + right[lane]];
+			cornerTexels[1][lane] = (int)texels[lane][bottom[lane] * levelWidths[lane] + left[lane]];
+			cornerTexels[2][lane] = (int)texels[lane][bottom[lane] * levelWidths[lane] + right[lane]];
+		}
+		for (UINT i = 0; i < 3; ++i)
+		{
+			corners[i] = _mm_load_si128(reinterpret_cast<const __m128i*>(cornerTexels[i]));
+		}
+
+		__m128 a[4];
+		__m128 b[4];
+		__m128 d[4];
+		__m128 e[4];
+		unpackSse(topLeft, a);
+		unpackSse(corners[0], b);
+		unpackSse(corners[1], d);
+		unpackSse(corners[2], e);
+
+		const __m128 fractionX = _mm_sub_ps(x, x0);
+		const __m128 fractionY = _mm_sub_ps(y, y0);
+		for (UINT c = 0; c < 4; ++c)
+		{
+			const __m128 upper = _mm_add_ps(a[c], _mm_mul_ps(_mm_sub_ps(b[c], a[c]), fractionX));
+			const __m128 lower = _mm_add_ps(d[c], _mm_mul_ps(_mm_sub_ps(e[c], d[c]), fractionX));
+			color[c] = _mm_add_ps(upper, _mm_mul_ps(_mm_sub_ps(lower, upper), fractionY));
+		}
+	}
+
+	// filterLane() on four pixels.
+	void filterSse(const STexture& texture, const SSampler& sampler, const SBatch& batch, XMFLOAT4* colors)
+	{
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 half = _mm_set1_ps(0.5f);
+		const __m128 u = _mm_load_ps(batch.m_u);
+		const __m128 v = _mm_load_ps(batch.m_v);
+		const __m128 axisU = _mm_load_ps(batch.m_axisU);
+		const __m128 axisV = _mm_load_ps(batch.m_axisV);
+		const __m128 count = _mm_load_ps(batch.m_probeCount);
+		const __m128 fraction = _mm_load_ps(batch.m_levelFraction);
+
+		__m128 sum[4] = { _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps() };
+		for (UINT probe = 0; probe < batch.m_maxProbeCount; ++probe)
+		{
+			const __m128 probeIndex = _mm_set1_ps((float)probe);
+			const __m128 offset = _mm_sub_ps(_mm_div_ps(_mm_add_ps(probeIndex, half), count), half);
+			const __m128 weight = _mm_and_ps(_mm_cmplt_ps(probeIndex, count), _mm_div_ps(one, count));
+			const __m128 probeU = _mm_add_ps(u, _mm_mul_ps(axisU, offset));
+			const __m128 probeV = _mm_add_ps(v, _mm_mul_ps(axisV, offset));
+
+			__m128 texel[4];
+			fetchSse(texture, sampler, batch.m_level, probeU, probeV, texel);
+			const __m128 levelWeight = _mm_mul_ps(weight, _mm_sub_ps(one, fraction));
+			for (UINT c = 0; c < 4; ++c)
+			{
+				sum[c] = _mm_add_ps(sum[c], _mm_mul_ps(texel[c], levelWeight));
+			}
+
+			if (isMipLinear(sampler))
+			{
+				fetchSse(texture, sampler, batch.m_nextLevel, probeU, probeV, texel);
+				const __m128 nextWeight = _mm_mul_ps(weight, fraction);
+				for (UINT c = 0; c < 4; ++c)
+				{
+					sum[c] = _mm_add_ps(sum[c], _mm_mul_ps(texel[c], nextWeight));
+				}
+			}
+		}
+
+		const __m128 scale = _mm_set1_ps(1.0f / 255.0f);
+		for (UINT c = 0; c < 4; ++c)
+		{
+			sum[c] = _mm_mul_ps(sum[c], scale);
+		}
+
+		_MM_TRANSPOSE4_PS(sum[0], sum[1], sum[2], sum[3]);
+		for (UINT lane = 0; lane < 4; ++lane)
+		{
+			_mm_storeu_ps(&colors[lane].x, sum[lane]);
+		}
+	}
+
+	TARGET_AVX2 __m256 addressAvx2(__m256 x, __m256 size, EAddressMode addressMode)
+	{
+		const __m256 one = _mm256_set1_ps(1.0f);
+
+		if (addressMode == EAddressMode::Wrap)
+		{
+			x = _mm256_sub_ps(x, _mm256_mul_ps(size, _mm256_floor_ps(_mm256_div_ps(x, size))));
+		}
+		else if (addressMode == EAddressMode::Mirror)
+		{
+			const __m256 period = _mm256_add_ps(size, size);
+			x = _mm256_sub_ps(x, _mm256_mul_ps(period, _mm256_floor_ps(_mm256_div_ps(x, period))));
+			const __m256 isBack = _mm256_cmp_ps(x, size, _CMP_GE_OQ);
+			x = _mm256_blendv_ps(x, _mm256_sub_ps(_mm256_sub_ps(period, one), x), isBack);
+		}
+
+		return _mm256_min_ps(_mm256_max_ps(x, _mm256_setzero_ps()), _mm256_sub_ps(size, one));
+	}
+
+	TARGET_AVX2 void unpackAvx2(__m256i texels, __m256 channels[4])
+	{
+		const __m256i mask = _mm256_set1_epi32(0xFF);
+		channels[0] = _mm256_cvtepi32_ps(_mm256_and_si256(texels, mask));
+		channels[1] = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(texels, 8), mask));
+		channels[2] = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(texels, 16), mask));
+		channels[3] = _mm256_cvtepi32_ps(_mm256_srli_epi32(texels, 24));
+	}
+
+	// fetch() on eight pixels, with gathers for the level sizes and texels.
+	TARGET_AVX2 void fetchAvx2(
+		const STexture& texture,
+		const SSampler& sampler,
+		__m256i levels,
+		__m256 u,
+		__m256 v,
+		__m256 color[4])
+	{
+		const int* texels = reinterpret_cast<const int*>(texture.m_texels.data());
+		const __m256i offsets = _mm256_i32gather_epi32(reinterpret_cast<const int*>(texture.m_mipOffsets.data()), levels, 4);
+		const __m256i levelWidths = _mm256_i32gather_epi32(reinterpret_cast<const int*>(texture.m_mipWidths.data()), levels, 4);
+		const __m256i levelHeights = _mm256_i32gather_epi32(reinterpret_cast<const int*>(texture.m_mipHeights.data()), levels, 4);
+		const __m256 width = _mm256_cvtepi32_ps(levelWidths);
+		const __m256 height = _mm256_cvtepi32_ps(levelHeights);
+		const __m256 one = _mm256_set1_ps(1.0f);
+
+		__m256 x = _mm256_mul_ps(u, width);
+		__m256 y = _mm256_mul_ps(v, height);
+		if (!isPointFilter(sampler))
+		{
+			x = _mm256_sub_ps(x, _mm256_set1_ps(0.5f));
+			y = _mm256_sub_ps(y, _mm256_set1_ps(0.5f));
+		}
+
+		const __m256 x0 = _mm256_floor_ps(x);
+		const __m256 y0 = _mm256_floor_ps(y);
+		const __m256i left = _mm256_cvttps_epi32(addressAvx2(x0, width, sampler.m_addressU));
+		const __m256i top = _mm256_add_epi32(offsets,
+			_mm256_mullo_epi32(_mm256_cvttps_epi32(addressAvx2(y0, height, sampler.m_addressV)), levelWidths));
+
+		const __m256i topLeft = _mm256_i32gather_epi32(texels, _mm256_add_epi32(top, left), 4);
+		if (isPointFilter(sampler))
+		{
+			unpackAvx2(topLeft, color);
+			return;
+		}
+
+		const __m256i right = _mm256_cvttps_epi32(addressAvx2(_mm256_add_ps(x0, one), width, sampler.m_addressU));
+		const __m256i bottom = _mm256_add_epi32(offsets, _mm256_mullo_epi32(
+			_mm256_cvttps_epi32(addressAvx2(_mm256_add_ps(y0, one), height, sampler.m_addressV)), levelWidths));
+
+		__m256 a[4];
+		__m256 b[4];
+		__m256 d[4];
+		__m256 e[4];
+		unpackAvx2(topLeft, a);
+		unpackAvx2(_mm256_i32gather_epi32(texels, _mm256_add_epi32(top, right), 4), b);
+		unpackAvx2(_mm256_i32gather_epi32(texels, _mm256_add_epi32(bottom, left), 4), d);
+		unpackAvx2(_mm256_i32gather_epi32(texels, _mm256_add_epi32(bottom, right), 4), e);
+
+		const __m256 fractionX = _mm256_sub_ps(x, x0);
+		const __m256 fractionY = _mm256_sub_ps(y, y0);
+		for (UINT c = 0; c < 4; ++c)
+		{
+			const __m256 upper = _mm256_add_ps(a[c], _mm256_mul_ps(_mm256_sub_ps(b[c], a[c]), fractionX));
+			const __m256 lower = _mm256_add_ps(d[c], _mm256_mul_ps(_mm256_sub_ps(e[c], d[c]), fractionX));
+			color[c] = _mm256_add_ps(upper, _mm256_mul_ps(_mm256_sub_ps(lower, upper), fractionY));
+		}
+	}
+
+	// filterLane() on eight pixels.
+	TARGET_AVX2 void filterAvx2(const STexture& texture, const SSampler& sampler, const SBatch& batch, XMFLOAT4* colors)
+	{
+		const __m256 one = _mm256_set1_ps(1.0f);
+		const __m256 half = _mm256_set1_ps(0.5f);
+		const __m256 u = _mm256_load_ps(batch.m_u);
+		const __m256 v = _mm256_load_ps(batch.m_v);
+		const __m256 axisU = _mm256_load_ps(batch.m_axisU);
+		const __m256 axisV = _mm256_load_ps(batch.m_axisV);
+		const __m256 count = _mm256_load_ps(batch.m_probeCount);
+		const __m256 fraction = _mm256_load_ps(batch.m_levelFraction);
+		const __m256i level = _mm256_load_si256(reinterpret_cast<const __m256i*>(batch.m_level));
+		const __m256i nextLevel = _mm256_load_si256(reinterpret_cast<const __m256i*>(batch.m_nextLevel));
+
+		__m256 sum[4] = { _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps() };
+		for (UINT probe = 0; probe < batch.m_maxProbeCount; ++probe)
+		{
+			const __m256 probeIndex = _mm256_set1_ps((float)probe);
+			const __m256 offset = _mm256_sub_ps(_mm256_div_ps(_mm256_add_ps(probeIndex, half), count), half);
+			const __m256 weight = _mm256_and_ps(_mm256_cmp_ps(probeIndex, count, _CMP_LT_OQ), _mm256_div_ps(one, count));
+			const __m256 probeU = _mm256_add_ps(u, _mm256_mul_ps(axisU, offset));
+			const __m256 probeV = _mm256_add_ps(v, _mm256_mul_ps(axisV, offset));
+
+			__m256 texel[4];
+			fetchAvx2(texture, sampler, level, probeU, probeV, texel);
+			const __m256 levelWeight = _mm256_mul_ps(weight, _mm256_sub_ps(one, fraction));
+			for (UINT c = 0; c < 4; ++c)
+			{
+				sum[c] = _mm256_add_ps(sum[c], _mm256_mul_ps(texel[c], levelWeight));
+			}
+
+			if (isMipLinear(sampler))
+			{
+				fetchAvx2(texture, sampler, nextLevel, probeU, probeV, texel);
+				const __m256 nextWeight = _mm256_mul_ps(weight, fraction);
+				for (UINT c = 0; c < 4; ++c)
+				{
+					sum[c] = _mm256_add_ps(sum[c], _mm256_mul_ps(texel[c], nextWeight));
+				}
+			}
+		}
+
+		const __m256 scale = _mm256_set1_ps(1.0f / 255.0f);
+		alignas(32) float channels[4][MaxBatchSize];
+		for (UINT c = 0; c < 4; ++c)
+		{
+			_mm256_store_ps(channels[c], _mm256_mul_ps(sum[c], scale));
+		}
+
+		for (UINT lane = 0; lane < MaxBatchSize; ++lane)
+		{
+			colors[lane] = XMFLOAT4(channels[0][lane], channels[1][lane], channels[2][lane], channels[3][lane]);
+		}
+	}
+#endif
+}
+
+void TextureSampler::create(const std::vector<MipGenerator::SMip>& mips, STexture& texture)
+{
+	texture = STexture();
+	if (mips.empty())
+	{
+		return;
+	}
+
+	texture.m_width = mips[0].m_width;
+	texture.m_height = mips[0].m_height;
+	texture.m_mipCount = (UINT)mips.size();
+
+	for (const MipGenerator::SMip& mip : mips)
+	{
+		texture.m_mipOffsets.push_back((UINT)texture.m_texels.size());
+		texture.m_mipWidths.push_back(mip.m_width);
+		texture.m_mipHeights.push_back(mip.m_height);
+		texture.m_texels.insert(texture.m_texels.end(), mip.m_pixels.begin(), mip.m_pixels.end());
+	}
+}
+
+bool TextureSampler::load(
+	const DdsFile::SDescription& description,
+	const D3D11_SUBRESOURCE_DATA* subresources,
+	STexture& texture,
+	std::string* error)
+{
+	if (description.m_dimension != D3D11_RESOURCE_DIMENSION_TEXTURE2D)
+	{
+		return setError(error, "only 2D textures can be sampled");
+	}
+
+	bool isBlockCompressed = true;
+	BlockCompressor::EFormat blockFormat = BlockCompressor::EFormat::Bc1;
+	switch (description.m_format)
+	{
+	case DXGI_FORMAT_BC1_UNORM:
+	case DXGI_FORMAT_BC1_UNORM_SRGB:
+		blockFormat = BlockCompressor::EFormat::Bc1;
+		break;
+	case DXGI_FORMAT_BC3_UNORM:
+	case DXGI_FORMAT_BC3_UNORM_SRGB:
+		blockFormat = BlockCompressor::EFormat::Bc3;
+		break;
+	case DXGI_FORMAT_BC4_UNORM:
+		blockFormat = BlockCompressor::EFormat::Bc4;
+		break;
+	case DXGI_FORMAT_BC5_UNORM:
+		blockFormat = BlockCompressor::EFormat::Bc5;
+		break;
+	case DXGI_FORMAT_R8G8B8A8_UNORM:
+	case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+	case DXGI_FORMAT_B8G8R8A8_UNORM:
+	case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+		isBlockCompressed = false;
+		break;
+	default:
+		return setError(error, "format " + std::to_string(description.m_format) + " cannot be sampled");
+	}
+
+	const bool isBgra = description.m_format == DXGI_FORMAT_B8G8R8A8_UNORM ||
+		description.m_format == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB;
+
+	std::vector<MipGenerator::SMip> mips(description.m_mipCount);
+	for (UINT mip = 0; mip < description.m_mipCount; ++mip)
+	{
+		const D3D11_SUBRESOURCE_DATA& subresource = subresources[mip];
+		const UINT width = std::max(description.m_width >> mip, 1u);
+		const UINT height = std::max(description.m_height >> mip, 1u);
+
+		mips[mip].m_width = width;
+		mips[mip].m_height = height;
+		mips[mip].m_pixels.resize((size_t)width * height);
+
+		if (isBlockCompressed)
+		{
+			BlockCompressor::decompress(blockFormat, subresource.pSysMem, width, height, mips[mip].m_pixels.data(), width * 4);
+			continue;
+		}
+
+		for (UINT y = 0; y < height; ++y)
+		{
+			const UINT* source = reinterpret_cast<const UINT*>(
+				static_cast<const unsigned char*>(subresource.pSysMem) + (size_t)y * subresource.SysMemPitch);
+			UINT* destination = mips[mip].m_pixels.data() + (size_t)y * width;
+
+			if (isBgra)
+			{
+				PixelFormat::argbToAbgr(source, destination, width);
+			}
+			else
+			{
+				std::copy(source, source + width, destination);
+			}
+		}
+	}
+
+	create(mips, texture);
+	return true;
+}
+
+UINT TextureSampler::getMaxBatchSize()
+{
+#if defined(_XM_SSE_INTRINSICS_)
+	return HasAvx2 ? 8 : 4;
+#else
+	return 1;
+#endif
+}
+
+void TextureSampler::sample(
+	const STexture& texture,
+	const SSampler& sampler,
+	const SCoords& coords,
+	UINT count,
+	XMFLOAT4* colors,
+	UINT batchSize)
+{
+	const UINT maxBatchSize = getMaxBatchSize();
+	batchSize = batchSize == 0 ? maxBatchSize : std::min(batchSize, maxBatchSize);
+	batchSize = batchSize >= 8 ? 8 : (batchSize >= 4 ? 4 : 1);
+
+	SBatch batch;
+	UINT first = 0;
+
+#if defined(_XM_SSE_INTRINSICS_)
+	for (; batchSize > 1 && first + batchSize <= count; first += batchSize)
+	{
+		batch.m_maxProbeCount = 0;
+		for (UINT lane = 0; lane < batchSize; ++lane)
+		{
+			setupLane(texture, sampler, coords, first + lane, batch, lane);
+		}
+
+		if (batchSize == 8)
+		{
+			filterAvx2(texture, sampler, batch, colors + first);
+		}
+		else
+		{
+			filterSse(texture, sampler, batch, colors + first);
+		}
+	}
+#endif
+
+	for (; first < count; ++first)
+	{
+		batch.m_maxProbeCount = 0;
+		setupLane(texture, sampler, coords, first, batch, 0);
+		filterLane(texture, sampler, batch, 0, colors[first]);
+	}
+}
+
+XMFLOAT4 TextureSampler::sample(
+	const STexture& texture,
+	const SSampler& sampler,
+	const XMFLOAT2& texCoord,
+	const XMFLOAT2& ddx,
+	const XMFLOAT2& ddy)
+{
+	SCoords coords;
+	coords.m_u = &texCoord.x;
+	coords.m_v = &texCoord.y;
+	coords.m_dudx = &ddx.x;
+	coords.m_dvdx = &ddx.y;
+	coords.m_dudy = &ddy.x;
+	coords.m_dvdy = &ddy.y;
+
+	XMFLOAT4 color;
+	sample(texture, sampler, coords, 1, &color, 1);
+	return color;
+}
+
+XMFLOAT4 TextureSampler::sampleLevel(const STexture& texture, const SSampler& sampler, const XMFLOAT2& texCoord, float lod)
+{
+	SSampler levelSampler = sampler;
+	if (levelSampler.m_filter == EFilter::Anisotropic)
+	{
+		levelSampler.m_filter = EFilter::Trilinear;
+	}
+
+	SBatch batch;
+	batch.m_u[0] = texCoord.x;
+	batch.m_v[0] = texCoord.y;
+	batch.m_axisU[0] = 0.0f;
+	batch.m_axisV[0] = 0.0f;
+	batch.m_probeCount[0] = 1.0f;
+	batch.m_maxProbeCount = 1;
+	setLevel(texture, levelSampler, lod, batch, 0);
+
+	XMFLOAT4 color;
+	filterLane(texture, levelSampler, batch, 0, color);
+	return color;
+}
+
+void TextureSampler::toRgba8(const XMFLOAT4* colors, size_t count, UINT* pixels)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		const float* channels = &colors[i].x;
+		UINT pixel = 0;
+		for (UINT c = 0; c < 4; ++c)
+		{
+			const float value = std::min(std::max(channels[c], 0.0f), 1.0f);
+			pixel |= (UINT)(value * 255.0f + 0.5f) << (8 * c);
+		}
+		pixels[i] = pixel;
+	}
+}
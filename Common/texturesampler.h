@@ -0,0 +1,142 @@
+﻿#pragma once
+
+#include <cfloat>
+#include <string>
+#include <vector>
+#include <DirectXMath.h>
+#include <windows.h>
+
+#include "ddsformat.h"
+#include "mipgenerator.h"
+
+using namespace DirectX;
+
+// Reference texture sampler on the CPU, for checking texturing, address
+// modes and texture transforms without a GPU, e.g. in headless renders
+// compared against reference images.
+//
+// Sampling follows the D3D11 rules for Texture2D.SampleGrad(): the level
+// of detail is the log2 of the larger texel footprint of a pixel, the
+// nearest mip is the one at lod + 0.5, texel centers sit at half-texel
+// offsets, and the anisotropic filter takes up to m_maxAnisotropy
+// trilinear probes along the longer axis of the footprint at the lod of
+// the shorter one. GPUs approximate these rules in their own ways, so
+// comparisons against GPU output need a tolerance of a few levels.
+//
+// Textures are R8G8B8A8 texels, sampled as UNORM; _SRGB formats are
+// filtered without conversion to linear. sample() takes pixels in batches:
+// the level and probes of each pixel are worked out one pixel at a time,
+// then the texel fetches and filtering run on eight pixels at a time with
+// AVX2 when the CPU has it and four with SSE2 otherwise. Each batch gives
+// the results of the scalar path to the last bit. All functions may be
+// called from any thread.
+namespace TextureSampler
+{
+	enum class EFilter
+	{
+		// One texel of the nearest mip.
+		Point,
+
+		// Four texels of the nearest mip.
+		Bilinear,
+
+		// Four texels of each of the two nearest mips.
+		Trilinear,
+
+		// Trilinear probes along the footprint.
+		Anisotropic
+	};
+
+	// D3D11_TEXTURE_ADDRESS_WRAP, _MIRROR and _CLAMP.
+	enum class EAddressMode
+	{
+		Wrap,
+		Mirror,
+		Clamp
+	};
+
+	struct SSampler
+	{
+		EFilter m_filter = EFilter::Trilinear;
+		EAddressMode m_addressU = EAddressMode::Wrap;
+		EAddressMode m_addressV = EAddressMode::Wrap;
+
+		// 1 to 16.
+		UINT m_maxAnisotropy = 16;
+
+		float m_mipLodBias = 0.0f;
+		float m_minLod = 0.0f;
+		float m_maxLod = FLT_MAX;
+	};
+
+	// Mips of R8G8B8A8 texels, largest first, one after another.
+	struct STexture
+	{
+		UINT m_width = 0;
+		UINT m_height = 0;
+		UINT m_mipCount = 0;
+
+		std::vector<UINT> m_texels;
+		std::vector<UINT> m_mipOffsets;
+		std::vector<UINT> m_mipWidths;
+		std::vector<UINT> m_mipHeights;
+	};
+
+	// Texture coordinates of pixels and their derivatives along the screen
+	// x and y axes, as the pixel shader has them, in one array each so
+	// batches load straight into registers.
+	struct SCoords
+	{
+		const float* m_u;
+		const float* m_v;
+		const float* m_dudx;
+		const float* m_dvdx;
+		const float* m_dudy;
+		const float* m_dvdy;
+	};
+
+	// E.g. from MipGenerator.
+	void create(const std::vector<MipGenerator::SMip>& mips, STexture& texture);
+
+	// Decodes every mip of the first array slice of an R8G8B8A8, B8G8R8A8,
+	// BC1, BC3, BC4 or BC5 texture; BC4 and BC5 come out as red and
+	// red-green with opaque alpha, as the GPU returns them. The
+	// subresources are in D3D11 order, as DdsFile::parse() and
+	// CDdsFile::getSubresources() give them.
+	bool load(
+		const DdsFile::SDescription& description,
+		const D3D11_SUBRESOURCE_DATA* subresources,
+		STexture& texture,
+		std::string* error = nullptr
+	);
+
+	// 8 with AVX2, 4 with SSE2, 1 otherwise.
+	UINT getMaxBatchSize();
+
+	// Filters count pixels into colors, in batches of batchSize pixels,
+	// getMaxBatchSize() for zero; 1 runs the scalar path.
+	void sample(
+		const STexture& texture,
+		const SSampler& sampler,
+		const SCoords& coords,
+		UINT count,
+		XMFLOAT4* colors,
+		UINT batchSize = 0
+	);
+
+	// A single pixel, like SampleGrad().
+	XMFLOAT4 sample(
+		const STexture& texture,
+		const SSampler& sampler,
+		const XMFLOAT2& texCoord,
+		const XMFLOAT2& ddx,
+		const XMFLOAT2& ddy
+	);
+
+	// Like SampleLevel(): lod is given, and the anisotropic filter works as
+	// the trilinear one.
+	XMFLOAT4 sampleLevel(const STexture& texture, const SSampler& sampler, const XMFLOAT2& texCoord, float lod);
+
+	// Rounds colors to R8G8B8A8 texels, e.g. for images to compare.
+	void toRgba8(const XMFLOAT4* colors, size_t count, UINT* pixels);
+}
@@ -0,0 +1,163 @@
+﻿#include "threadpool.h"
+
+#include <atomic>
+#include <exception>
+
+CThreadPool::CThreadPool(UINT threadCount) :
+	m_isStopping(false)
+{
+	if (threadCount == 0)
+	{
+		const UINT hardwareThreads = std::thread::hardware_concurrency();
+		threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+
+	m_threads.reserve(threadCount);
+	for (UINT i = 0; i < threadCount; ++i)
+	{
+		m_threads.emplace_back(&CThreadPool::workerLoop, this);
+	}
+}
+
+CThreadPool::~CThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_isStopping = true;
+	}
+	m_condition.notify_all();
+
+	for (std::thread& thread : m_threads)
+	{
+		thread.join();
+	}
+}
+
+CThreadPool& CThreadPool::getShared()
+{
+	static CThreadPool pool;
+	return pool;
+}
+
+UINT CThreadPool::getThreadCount() const
+{
+	return (UINT)m_threads.size();
+}
+
+void CThreadPool::parallelFor(UINT begin, UINT end, UINT grainSize, const std::function<void(UINT, UINT)>& body)
+{
+	if (begin >= end)
+	{
+		return;
+	}
+
+	grainSize = grainSize > 0 ? grainSize : 1;
+	const UINT chunkCount = (end - begin + grainSize - 1) / grainSize;
+
+	if (chunkCount == 1)
+	{
+		body(begin, end);
+		return;
+	}
+
+	// Chunks are claimed from a shared counter, so a slow chunk does not
+	// hold up the ones queued behind it.
+	struct SState
+	{
+		std::atomic<UINT> m_nextChunk{ 0 };
+		std::atomic<UINT> m_doneChunks{ 0 };
+		std::mutex m_mutex;
+		std::condition_variable m_condition;
+		std::exception_ptr m_exception;
+	};
+	auto state = std::make_shared<SState>();
+
+	auto runChunks = [=, &body]()
+	{
+		for (;;)
+		{
+			const UINT chunk = state->m_nextChunk++;
+			if (chunk >= chunkCount)
+			{
+				return;
+			}
+
+			const UINT chunkBegin = begin + chunk * grainSize;
+			const UINT chunkEnd = chunkBegin + grainSize < end ? chunkBegin + grainSize : end;
+
+			try
+			{
+				body(chunkBegin, chunkEnd);
+			}
+			catch (...)
+			{
+				std::lock_guard<std::mutex> lock(state->m_mutex);
+				if (!state->m_exception)
+				{
+					state->m_exception = std::current_exception();
+				}
+			}
+
+			if (++state->m_doneChunks == chunkCount)
+			{
+				std::lock_guard<std::mutex> lock(state->m_mutex);
+				state->m_condition.notify_all();
+			}
+		}
+	};
+
+	// Helpers that start after all chunks are claimed return immediately,
+	// so the reference to body never outlives this call.
+	const UINT helperCount = chunkCount - 1 < getThreadCount() ? chunkCount - 1 : getThreadCount();
+	for (UINT i = 0; i < helperCount; ++i)
+	{
+		enqueue(runChunks);
+	}
+
+	runChunks();
+
+	std::unique_lock<std::mutex> lock(state->m_mutex);
+	state->m_condition.wait(lock, [&]()
+	{
+		return state->m_doneChunks == chunkCount;
+	});
+
+	if (state->m_exception)
+	{
+		std::rethrow_exception(state->m_exception);
+	}
+}
+
+void CThreadPool::enqueue(std::function<void()> task)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_tasks.push_back(std::move(task));
+	}
+	m_condition.notify_one();
+}
+
+void CThreadPool::workerLoop()
+{
+	for (;;)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_condition.wait(lock, [this]()
+			{
+				return m_isStopping || !m_tasks.empty();
+			});
+
+			if (m_isStopping && m_tasks.empty())
+			{
+				return;
+			}
+
+			task = std::move(m_tasks.front());
+			m_tasks.pop_front();
+		}
+
+		task();
+	}
+}
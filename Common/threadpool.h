@@ -0,0 +1,63 @@
+﻿#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <windows.h>
+
+class CThreadPool
+{
+public:
+	// Zero picks one worker per hardware thread, minus the calling thread.
+	explicit CThreadPool(UINT threadCount = 0);
+	~CThreadPool();
+
+	CThreadPool(const CThreadPool&) = delete;
+	CThreadPool& operator=(const CThreadPool&) = delete;
+
+	// Process wide pool shared by the Common modules.
+	static CThreadPool& getShared();
+
+	UINT getThreadCount() const;
+
+	template<class TFunction>
+	auto submit(TFunction&& function) -> std::future<decltype(function())>;
+
+	// Splits [begin, end) into chunks of about grainSize items and runs
+	// body(chunkBegin, chunkEnd) on the workers. The calling thread works
+	// on chunks too and returns once every chunk has finished; the first
+	// exception thrown by the body is rethrown here.
+	void parallelFor(UINT begin, UINT end, UINT grainSize, const std::function<void(UINT, UINT)>& body);
+
+private:
+	void enqueue(std::function<void()> task);
+	void workerLoop();
+
+	std::vector<std::thread> m_threads;
+	std::deque<std::function<void()>> m_tasks;
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	bool m_isStopping;
+};
+
+template<class TFunction>
+auto CThreadPool::submit(TFunction&& function) -> std::future<decltype(function())>
+{
+	typedef decltype(function()) TResult;
+
+	// packaged_task is move-only, std::function needs a copyable target.
+	auto task = std::make_shared<std::packaged_task<TResult()>>(std::forward<TFunction>(function));
+	std::future<TResult> result = task->get_future();
+
+	enqueue([task]()
+	{
+		(*task)();
+	});
+
+	return result;
+}
@@ -0,0 +1,242 @@
+﻿#include "vertexpacking.h"
+
+#include <cfloat>
+
+using namespace VertexPacking;
+
+namespace
+{
+	template<class T>
+	const T& readAt(const T* base, UINT stride, UINT i)
+	{
+		return *reinterpret_cast<const T*>(
+			reinterpret_cast<const BYTE*>(base) + (size_t)i * stride);
+	}
+
+	template<class T>
+	T& writeAt(T* base, UINT stride, UINT i)
+	{
+		return *reinterpret_cast<T*>(
+			reinterpret_cast<BYTE*>(base) + (size_t)i * stride);
+	}
+
+	XMVECTOR octahedralEncode(FXMVECTOR v)
+	{
+		// Project onto the octahedron |x| + |y| + |z| = 1 and fold the
+		// lower half over the diagonals.
+		XMVECTOR l1 = XMVector3Dot(XMVectorAbs(v), XMVectorSplatOne());
+		XMVECTOR p = XMVectorDivide(v, XMVectorMax(l1, XMVectorReplicate(FLT_MIN)));
+
+		XMVECTOR signs = XMVectorSelect(
+			XMVectorReplicate(-1.0f),
+			XMVectorSplatOne(),
+			XMVectorGreaterOrEqual(p, XMVectorZero()));
+
+		XMVECTOR folded = XMVectorMultiply(
+			XMVectorSubtract(XMVectorSplatOne(), XMVectorAbs(XMVectorSwizzle<1, 0, 2, 3>(p))),
+			signs);
+
+		return XMVectorSelect(p, folded, XMVectorLess(XMVectorSplatZ(p), XMVectorZero()));
+	}
+
+	XMVECTOR octahedralDecode(FXMVECTOR e)
+	{
+		XMVECTOR absE = XMVectorAbs(e);
+		XMVECTOR z = XMVectorSubtract(
+			XMVectorSubtract(XMVectorSplatOne(), XMVectorSplatX(absE)), XMVectorSplatY(absE));
+
+		// Unfold: t is how far below the equator the vector was.
+		XMVECTOR t = XMVectorSaturate(XMVectorNegate(z));
+		XMVECTOR xy = XMVectorAdd(e, XMVectorSelect(
+			t,
+			XMVectorNegate(t),
+			XMVectorGreaterOrEqual(e, XMVectorZero())));
+
+		XMVECTOR n = XMVectorSelect(xy, z, XMVectorSelectControl(0, 0, 1, 1));
+		return XMVector3Normalize(n);
+	}
+}
+
+XMMATRIX VertexPacking::SPositionQuantization::getDecodeMatrix() const
+{
+	return XMMatrixMultiply(
+		XMMatrixScaling(m_extent.x, m_extent.y, m_extent.z),
+		XMMatrixTranslation(m_min.x, m_min.y, m_min.z));
+}
+
+SPositionQuantization VertexPacking::computeQuantization(const XMFLOAT3* positions, UINT count, UINT stride)
+{
+	XMVECTOR vMin = XMVectorReplicate(FLT_MAX);
+	XMVECTOR vMax = XMVectorReplicate(-FLT_MAX);
+	for (UINT i = 0; i < count; ++i)
+	{
+		XMVECTOR p = XMLoadFloat3(&readAt(positions, stride, i));
+		vMin = XMVectorMin(vMin, p);
+		vMax = XMVectorMax(vMax, p);
+	}
+
+	SPositionQuantization quantization;
+	if (count == 0)
+	{
+		quantization.m_min = XMFLOAT3(0.0f, 0.0f, 0.0f);
+		quantization.m_extent = XMFLOAT3(1.0f, 1.0f, 1.0f);
+		return quantization;
+	}
+
+	// A flat axis still needs a non-zero extent to divide by.
+	XMVECTOR extent = XMVectorMax(XMVectorSubtract(vMax, vMin), XMVectorReplicate(1e-6f));
+
+	XMStoreFloat3(&quantization.m_min, vMin);
+	XMStoreFloat3(&quantization.m_extent, extent);
+	return quantization;
+}
+
+void VertexPacking::encodePositions(const XMFLOAT3* positions, UINT count, UINT inStride, const SPositionQuantization& quantization, XMUSHORTN4* out, UINT outStride)
+{
+	XMVECTOR offset = XMLoadFloat3(&quantization.m_min);
+	XMVECTOR scale = XMVectorReciprocal(XMLoadFloat3(&quantization.m_extent));
+
+	for (UINT i = 0; i < count; ++i)
+	{
+		XMVECTOR p = XMLoadFloat3(&readAt(positions, inStride, i));
+		p = XMVectorMultiply(XMVectorSubtract(p, offset), scale);
+		p = XMVectorSetW(p, 1.0f);
+
+		XMStoreUShortN4(&writeAt(out, outStride, i), p);
+	}
+}
+
+void VertexPacking::decodePositions(const XMUSHORTN4* packed, UINT count, UINT inStride, const SPositionQuantization& quantization, XMFLOAT3* out, UINT outStride)
+{
+	XMVECTOR offset = XMLoadFloat3(&quantization.m_min);
+	XMVECTOR scale = XMLoadFloat3(&quantization.m_extent);
+
+	for (UINT i = 0; i < count; ++i)
+	{
+		XMVECTOR p = XMLoadUShortN4(&readAt(packed, inStride, i));
+		XMStoreFloat3(&writeAt(out, outStride, i), XMVectorMultiplyAdd(p, scale, offset));
+	}
+}
+
+void VertexPacking::encodeOctahedral(const XMFLOAT3* vectors, UINT count, UINT inStride, XMSHORTN2* out, UINT outStride)
+{
+	for (UINT i = 0; i < count; ++i)
+	{
+		XMVECTOR v = XMLoadFloat3(&readAt(vectors, inStride, i));
+		XMStoreShortN2(&writeAt(out, outStride, i), octahedralEncode(v));
+	}
+}
+
+void VertexPacking::decodeOctahedral(const XMSHORTN2* packed, UINT count, UINT inStride, XMFLOAT3* out, UINT outStride)
+{
+	for (UINT i = 0; i < count; ++i)
+	{
+		XMVECTOR e = XMLoadShortN2(&readAt(packed, inStride, i));
+		XMStoreFloat3(&writeAt(out, outStride, i), octahedralDecode(e));
+	}
+}
+
+void VertexPacking::encodeTexCoords(const XMFLOAT2* texCoords, UINT count, UINT inStride, XMHALF2* out, UINT outStride)
+{
+	// The stream converters use F16C when the build enables it.
+	XMConvertFloatToHalfStream(&out->x, outStride, &texCoords->x, inStride, count);
+	XMConvertFloatToHalfStream(&out->y, outStride, &texCoords->y, inStride, count);
+}
+
+void VertexPacking::decodeTexCoords(const XMHALF2* packed, UINT count, UINT inStride, XMFLOAT2* out, UINT outStride)
+{
+	XMConvertHalfToFloatStream(&out->x, outStride, &packed->x, inStride, count);
+	XMConvertHalfToFloatStream(&out->y, outStride, &packed->y, inStride, count);
+}
+
+void VertexPacking::encodeColors(const XMFLOAT4* colors, UINT count, UINT inStride, XMUBYTEN4* out, UINT outStride)
+{
+	for (UINT i = 0; i < count; ++i)
+	{
+		XMStoreUByteN4(&writeAt(out, outStride, i), XMLoadFloat4(&readAt(colors, inStride, i)));
+	}
+}
+
+void VertexPacking::decodeColors(const XMUBYTEN4* packed, UINT count, UINT inStride, XMFLOAT4* out, UINT outStride)
+{
+	for (UINT i = 0; i < count; ++i)
+	{
+		XMStoreFloat4(&writeAt(out, outStride, i), XMLoadUByteN4(&readAt(packed, inStride, i)));
+	}
+}
+
+void VertexPacking::packBasic(const GeometryGenerator::SMeshData& meshData, const SPositionQuantization& quantization, std::vector<SPackedBasic>& vertices)
+{
+	const UINT count = (UINT)meshData.m_vertices.size();
+	const UINT inStride = sizeof(GeometryGenerator::SVertex);
+	const UINT outStride = sizeof(SPackedBasic);
+
+	vertices.resize(count);
+	if (count == 0)
+	{
+		return;
+	}
+
+	const GeometryGenerator::SVertex& first = meshData.m_vertices[0];
+	encodePositions(&first.m_position, count, inStride, quantization, &vertices[0].m_position, outStride);
+	encodeOctahedral(&first.m_normal, count, inStride, &vertices[0].m_normal, outStride);
+	encodeOctahedral(&first.m_tangentU, count, inStride, &vertices[0].m_tangentU, outStride);
+	encodeTexCoords(&first.m_texC, count, inStride, &vertices[0].m_texC, outStride);
+}
+
+void VertexPacking::packBasic(const GeometryGenerator::SMeshData& meshData, std::vector<SPackedBasicFloatPos>& vertices)
+{
+	const UINT count = (UINT)meshData.m_vertices.size();
+	const UINT inStride = sizeof(GeometryGenerator::SVertex);
+	const UINT outStride = sizeof(SPackedBasicFloatPos);
+
+	vertices.resize(count);
+	if (count == 0)
+	{
+		return;
+	}
+
+	const GeometryGenerator::SVertex& first = meshData.m_vertices[0];
+	for (UINT i = 0; i < count; ++i)
+	{
+		vertices[i].m_position = meshData.m_vertices[i].m_position;
+	}
+	encodeOctahedral(&first.m_normal, count, inStride, &vertices[0].m_normal, outStride);
+	encodeOctahedral(&first.m_tangentU, count, inStride, &vertices[0].m_tangentU, outStride);
+	encodeTexCoords(&first.m_texC, count, inStride, &vertices[0].m_texC, outStride);
+}
+
+const D3D11_INPUT_ELEMENT_DESC CPackedInputLayoutDesc::ms_packedBasic[4] =
+{
+	{"POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
+	{"NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, 8, D3D11_INPUT_PER_VERTEX_DATA, 0},
+	{"TANGENT", 0, DXGI_FORMAT_R16G16_SNORM, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0},
+	{"TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, 16, D3D11_INPUT_PER_VERTEX_DATA, 0}
+};
+
+const D3D11_INPUT_ELEMENT_DESC CPackedInputLayoutDesc::ms_packedBasicFloatPos[4] =
+{
+	{"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
+	{"NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0},
+	{"TANGENT", 0, DXGI_FORMAT_R16G16_SNORM, 0, 16, D3D11_INPUT_PER_VERTEX_DATA, 0},
+	{"TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, 20, D3D11_INPUT_PER_VERTEX_DATA, 0}
+};
+
+const D3D11_INPUT_ELEMENT_DESC CPackedInputLayoutDesc::ms_packedPosNormalTex[3] =
+{
+	{"POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
+	{"NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, 8, D3D11_INPUT_PER_VERTEX_DATA, 0},
+	{"TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0}
+};
+
+const D3D11_INPUT_ELEMENT_DESC CPackedInputLayoutDesc::ms_packedPosNormal[2] =
+{
+	{"POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
+	{"NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, 8, D3D11_INPUT_PER_VERTEX_DATA, 0}
+};
+
+const D3D11_INPUT_ELEMENT_DESC CPackedInputLayoutDesc::ms_packedPosColor[2] =
+{
+	{"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
+	{"COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0}
+};
@@ -0,0 +1,147 @@
+﻿#pragma once
+
+#include <vector>
+#include <d3d11.h>
+#include <DirectXMath.h>
+#include <DirectXPackedVector.h>
+
+#include "geometrygenerator.h"
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+// Compact vertex formats and their SIMD encoders/decoders.
+//
+// Worst case error of each encoding:
+//   positions, 16 bit unorm in mesh bounds: about extent / 131070 per axis
+//   normals and tangents, 2x16 bit octahedral: 0.04 degrees
+//   texture coordinates, half float: 2^-11 relative (2^-12 in [0.5, 1))
+//   colors, 8 bit unorm: 1/510
+//
+// Shaders decode the octahedral vectors with
+//   float3 n = float3(e.x, e.y, 1.0f - abs(e.x) - abs(e.y));
+//   if (n.z < 0.0f) n.xy = (1.0f - abs(n.yx)) * (n.xy >= 0.0f ? 1.0f : -1.0f);
+//   n = normalize(n);
+// and the positions by folding SPositionQuantization::getDecodeMatrix() into
+// the world matrix.
+namespace VertexPacking
+{
+	// Replaces GeometryGenerator::SVertex, 20 bytes instead of 44.
+	struct SPackedBasic
+	{
+		XMUSHORTN4 m_position;
+		XMSHORTN2 m_normal;
+		XMSHORTN2 m_tangentU;
+		XMHALF2 m_texC;
+	};
+
+	// Same with full precision positions for meshes that cannot afford
+	// quantization, 24 bytes instead of 44.
+	struct SPackedBasicFloatPos
+	{
+		XMFLOAT3 m_position;
+		XMSHORTN2 m_normal;
+		XMSHORTN2 m_tangentU;
+		XMHALF2 m_texC;
+	};
+
+	// Replaces the demos' Vertex::SBasic32, 16 bytes instead of 32.
+	struct SPackedPosNormalTex
+	{
+		XMUSHORTN4 m_pos;
+		XMSHORTN2 m_normal;
+		XMHALF2 m_tex;
+	};
+
+	// Replaces the lit demos' Vertex::SPosNormal, 12 bytes instead of 24;
+	// LitSkullDemo draws its skull with it.
+	struct SPackedPosNormal
+	{
+		XMUSHORTN4 m_pos;
+		XMSHORTN2 m_normal;
+	};
+
+	// Replaces the color demos' XMFLOAT3 + XMFLOAT4 vertex, 16 bytes instead
+	// of 28.
+	struct SPackedPosColor
+	{
+		XMFLOAT3 m_pos;
+		XMUBYTEN4 m_color;
+	};
+
+	struct SPositionQuantization
+	{
+		XMFLOAT3 m_min;
+		XMFLOAT3 m_extent;
+
+		// Maps the [0, 1] unorm position back into mesh space; premultiply
+		// it with the world matrix.
+		XMMATRIX getDecodeMatrix() const;
+	};
+
+	// Streams are read and written through byte strides so the functions work
+	// straight on interleaved vertex structs.
+
+	SPositionQuantization computeQuantization(
+		const XMFLOAT3* positions,
+		UINT count,
+		UINT stride
+	);
+
+	void encodePositions(
+		const XMFLOAT3* positions, UINT count, UINT inStride,
+		const SPositionQuantization& quantization,
+		XMUSHORTN4* out, UINT outStride
+	);
+	void decodePositions(
+		const XMUSHORTN4* packed, UINT count, UINT inStride,
+		const SPositionQuantization& quantization,
+		XMFLOAT3* out, UINT outStride
+	);
+
+	void encodeOctahedral(
+		const XMFLOAT3* vectors, UINT count, UINT inStride,
+		XMSHORTN2* out, UINT outStride
+	);
+	void decodeOctahedral(
+		const XMSHORTN2* packed, UINT count, UINT inStride,
+		XMFLOAT3* out, UINT outStride
+	);
+
+	void encodeTexCoords(
+		const XMFLOAT2* texCoords, UINT count, UINT inStride,
+		XMHALF2* out, UINT outStride
+	);
+	void decodeTexCoords(
+		const XMHALF2* packed, UINT count, UINT inStride,
+		XMFLOAT2* out, UINT outStride
+	);
+
+	void encodeColors(
+		const XMFLOAT4* colors, UINT count, UINT inStride,
+		XMUBYTEN4* out, UINT outStride
+	);
+	void decodeColors(
+		const XMUBYTEN4* packed, UINT count, UINT inStride,
+		XMFLOAT4* out, UINT outStride
+	);
+
+	void packBasic(
+		const GeometryGenerator::SMeshData& meshData,
+		const SPositionQuantization& quantization,
+		std::vector<SPackedBasic>& vertices
+	);
+	void packBasic(
+		const GeometryGenerator::SMeshData& meshData,
+		std::vector<SPackedBasicFloatPos>& vertices
+	);
+}
+
+class CPackedInputLayoutDesc
+{
+public:
+	static const D3D11_INPUT_ELEMENT_DESC ms_packedBasic[4];
+	static const D3D11_INPUT_ELEMENT_DESC ms_packedBasicFloatPos[4];
+	static const D3D11_INPUT_ELEMENT_DESC ms_packedPosNormalTex[3];
+	static const D3D11_INPUT_ELEMENT_DESC ms_packedPosNormal[2];
+	static const D3D11_INPUT_ELEMENT_DESC ms_packedPosColor[2];
+};
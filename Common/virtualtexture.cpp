@@ -0,0 +1,516 @@
+﻿#include "virtualtexture.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "fileutil.h"
+#include "threadpool.h"
+
+using FileUtil::setError;
+
+namespace
+{
+	UINT getMipCountFor(UINT virtualSize, UINT tileSize)
+	{
+		UINT mipCount = 1;
+		for (UINT pageCount = virtualSize / tileSize; pageCount > 1; pageCount >>= 1)
+		{
+			++mipCount;
+		}
+		return mipCount;
+	}
+}
+
+UINT VirtualTexture::packPage(UINT mip, UINT x, UINT y)
+{
+	return x | (y << 12) | (mip << 24);
+}
+
+void VirtualTexture::unpackPage(UINT page, UINT& mip, UINT& x, UINT& y)
+{
+	x = page & 0xfff;
+	y = (page >> 12) & 0xfff;
+	mip = page >> 24;
+}
+
+void VirtualTexture::generateFeedback(
+	const SFeedbackDesc& desc,
+	CXMMATRIX viewProj,
+	UINT virtualSize,
+	UINT tileSize,
+	std::vector<UINT>& feedback)
+{
+	feedback.assign((size_t)desc.m_width * desc.m_height, NoPage);
+
+	XMVECTOR determinant;
+	const XMMATRIX invViewProj = XMMatrixInverse(&determinant, viewProj);
+	const UINT mipCount = getMipCountFor(virtualSize, tileSize);
+
+	// Texture coordinates where the ray through each pixel center hits the
+	// plane, with an extra column and row for the differences to the next
+	// pixel; misses are marked with a negative u.
+	const UINT columnCount = desc.m_width + 1;
+	const UINT rowCount = desc.m_height + 1;
+	std::vector<XMFLOAT2> uvs((size_t)columnCount * rowCount);
+
+	for (UINT j = 0; j < rowCount; ++j)
+	{
+		const float ndcY = 1.0f - 2.0f * (j + 0.5f) / desc.m_height;
+		for (UINT i = 0; i < columnCount; ++i)
+		{
+			const float ndcX = 2.0f * (i + 0.5f) / desc.m_width - 1.0f;
+
+			XMVECTOR nearPoint = XMVector3TransformCoord(XMVectorSet(ndcX, ndcY, 0.0f, 1.0f), invViewProj);
+			XMVECTOR farPoint = XMVector3TransformCoord(XMVectorSet(ndcX, ndcY, 1.0f, 1.0f), invViewProj);
+			const float nearY = XMVectorGetY(nearPoint);
+			const float farY = XMVectorGetY(farPoint);
+
+			XMFLOAT2& uv = uvs[j * columnCount + i];
+			if ((nearY > 0.0f) == (farY > 0.0f))
+			{
+				uv = XMFLOAT2(-1.0f, -1.0f);
+				continue;
+			}
+
+			XMFLOAT3 hit;
+			XMStoreFloat3(&hit, XMVectorLerp(nearPoint, farPoint, nearY / (nearY - farY)));
+
+			// As GeometryGenerator lays out grid texture coordinates.
+			uv.x = hit.x / desc.m_worldSize + 0.5f;
+			uv.y = 0.5f - hit.z / desc.m_worldSize;
+		}
+	}
+
+	// One feedback pixel covers this many screen pixels per side.
+	const float scaleX = (float)desc.m_width / desc.m_screenWidth;
+	const float scaleY = (float)desc.m_height / desc.m_screenHeight;
+
+	for (UINT j = 0; j < desc.m_height; ++j)
+	{
+		for (UINT i = 0; i < desc.m_width; ++i)
+		{
+			const XMFLOAT2& uv = uvs[j * columnCount + i];
+			const XMFLOAT2& uvRight = uvs[j * columnCount + i + 1];
+			const XMFLOAT2& uvDown = uvs[(j + 1) * columnCount + i];
+			if (uv.x < 0.0f || uvRight.x < 0.0f || uvDown.x < 0.0f || uv.x >= 1.0f || uv.y < 0.0f || uv.y >= 1.0f)
+			{
+				continue;
+			}
+
+			const float dudx = (uvRight.x - uv.x) * scaleX;
+			const float dvdx = (uvRight.y - uv.y) * scaleX;
+			const float dudy = (uvDown.x - uv.x) * scaleY;
+			const float dvdy = (uvDown.y - uv.y) * scaleY;
+			const float footprint = virtualSize * sqrtf(std::max(dudx * dudx + dvdx * dvdx, dudy * dudy + dvdy * dvdy));
+
+			const float lod = log2f(std::max(footprint, 1e-6f)) + desc.m_lodBias;
+			const UINT mip = (UINT)std::min(std::max(lod, 0.0f), (float)(mipCount - 1));
+
+			const UINT pageCount = (virtualSize / tileSize) >> mip;
+			const UINT x = std::min((UINT)(uv.x * pageCount), pageCount - 1);
+			const UINT y = std::min((UINT)(uv.y * pageCount), pageCount - 1);
+			feedback[j * desc.m_width + i] = packPage(mip, x, y);
+		}
+	}
+}
+
+CVirtualTexture::CVirtualTexture() :
+	m_mipCount(0),
+	m_tilePixelCount(0),
+	m_rootTile(NoTile),
+	m_frame(0),
+	m_hasPageTableChanged(false),
+	m_feedbackPageCount(0),
+	m_requestedPageCount(0),
+	m_missingPageCount(0),
+	m_loadCount(0),
+	m_evictionCount(0),
+	m_droppedLoadCount(0)
+{
+
+}
+
+CVirtualTexture::~CVirtualTexture()
+{
+	// Don't leave loads running against a loader being destroyed.
+	for (auto& pending : m_pendingLoads)
+	{
+		pending.second.wait();
+	}
+}
+
+bool CVirtualTexture::initialize(const SVirtualTextureDesc& desc, std::string* error)
+{
+	if (desc.m_tileSize == 0 || desc.m_size % desc.m_tileSize != 0)
+	{
+		return setError(error, "virtual texture size is not a multiple of the tile size");
+	}
+
+	const UINT pageCount = desc.m_size / desc.m_tileSize;
+	if (pageCount == 0 || (pageCount & (pageCount - 1)) != 0)
+	{
+		return setError(error, "virtual texture size is not a power of two times the tile size");
+	}
+	if (pageCount > 4096)
+	{
+		return setError(error, std::to_string(pageCount) + " pages per side, more than the 4096 a page can address");
+	}
+	if (desc.m_cacheTileCount == 0 || desc.m_cacheTileCount > 256)
+	{
+		return setError(error, std::to_string(desc.m_cacheTileCount) + " cache tiles per side, outside the 1 to 256 a page table entry can address");
+	}
+	if (!desc.m_tileLoader)
+	{
+		return setError(error, "virtual texture has no tile loader");
+	}
+
+	m_desc = desc;
+	m_mipCount = getMipCountFor(desc.m_size, desc.m_tileSize);
+
+	const UINT cacheTileSize = getCacheTileSize();
+	m_tilePixelCount = cacheTileSize * cacheTileSize;
+
+	m_pageTable.resize(m_mipCount);
+	for (UINT mip = 0; mip < m_mipCount; ++mip)
+	{
+		const UINT pageCount = getPageCount(mip);
+		m_pageTable[mip].assign((size_t)pageCount * pageCount, 0);
+	}
+
+	m_cacheTiles.assign(desc.m_cacheTileCount * desc.m_cacheTileCount, SCacheTile());
+
+	STileUpload upload;
+	upload.m_pixels.resize(m_tilePixelCount);
+	m_desc.m_tileLoader(m_mipCount - 1, 0, 0, upload.m_pixels.data());
+
+	m_rootTile = allocateTile();
+	upload.m_cacheX = m_rootTile % desc.m_cacheTileCount;
+	upload.m_cacheY = m_rootTile / desc.m_cacheTileCount;
+	m_uploads.push_back(std::move(upload));
+
+	mapPage(VirtualTexture::packPage(m_mipCount - 1, 0, 0), m_rootTile);
+	++m_loadCount;
+	return true;
+}
+
+void CVirtualTexture::addFeedback(const UINT* feedback, size_t count)
+{
+	// Neighbouring pixels mostly sample the same page, so runs collapse the
+	// buffer to a small fraction before the sort.
+	m_feedbackRuns.clear();
+	for (size_t i = 0; i < count; ++i)
+	{
+		const UINT page = feedback[i];
+		if (page == VirtualTexture::NoPage)
+		{
+			continue;
+		}
+
+		if (!m_feedbackRuns.empty() && m_feedbackRuns.back().first == page)
+		{
+			++m_feedbackRuns.back().second;
+		}
+		else
+		{
+			m_feedbackRuns.emplace_back(page, 1);
+		}
+	}
+	std::sort(m_feedbackRuns.begin(), m_feedbackRuns.end());
+
+	for (size_t i = 0; i < m_feedbackRuns.size();)
+	{
+		const UINT page = m_feedbackRuns[i].first;
+		UINT pixelCount = 0;
+		for (; i < m_feedbackRuns.size() && m_feedbackRuns[i].first == page; ++i)
+		{
+			pixelCount += m_feedbackRuns[i].second;
+		}
+
+		UINT mip, x, y;
+		VirtualTexture::unpackPage(page, mip, x, y);
+		if (mip >= m_mipCount || x >= getPageCount(mip) || y >= getPageCount(mip))
+		{
+			continue;
+		}
+
+		++m_feedbackPageCount;
+		touch(page);
+		if (!isResident(page))
+		{
+			m_requests[page] += pixelCount;
+		}
+	}
+}
+
+void CVirtualTexture::update()
+{
+	collectFinishedLoads();
+	startLoads();
+
+	m_requestedPageCount = m_feedbackPageCount;
+	m_missingPageCount = (UINT)m_requests.size();
+	m_feedbackPageCount = 0;
+	m_requests.clear();
+	++m_frame;
+}
+
+void CVirtualTexture::takeUploads(std::vector<STileUpload>& uploads)
+{
+	uploads.clear();
+	uploads.swap(m_uploads);
+	m_hasPageTableChanged = false;
+}
+
+UINT CVirtualTexture::getMipCount() const
+{
+	return m_mipCount;
+}
+
+UINT CVirtualTexture::getPageCount(UINT mip) const
+{
+	return (m_desc.m_size / m_desc.m_tileSize) >> mip;
+}
+
+UINT CVirtualTexture::getCacheTileSize() const
+{
+	return m_desc.m_tileSize + 2 * m_desc.m_tileBorder;
+}
+
+const std::vector<UINT>& CVirtualTexture::getPageTable(UINT mip) const
+{
+	return m_pageTable[mip];
+}
+
+bool CVirtualTexture::hasPageTableChanged() const
+{
+	return m_hasPageTableChanged;
+}
+
+bool CVirtualTexture::isResident(UINT page) const
+{
+	UINT mip, x, y;
+	VirtualTexture::unpackPage(page, mip, x, y);
+	return ((getEntry(page) >> 16) & 0xff) == mip && (getEntry(page) >> 24) != 0;
+}
+
+UINT CVirtualTexture::getResidentPageCount() const
+{
+	UINT count = 0;
+	for (const SCacheTile& tile : m_cacheTiles)
+	{
+		if (tile.m_page != VirtualTexture::NoPage)
+		{
+			++count;
+		}
+	}
+	return count;
+}
+
+UINT CVirtualTexture::getPendingLoadCount() const
+{
+	return (UINT)m_pendingLoads.size();
+}
+
+UINT CVirtualTexture::getRequestedPageCount() const
+{
+	return m_requestedPageCount;
+}
+
+UINT CVirtualTexture::getMissingPageCount() const
+{
+	return m_missingPageCount;
+}
+
+UINT CVirtualTexture::getLoadCount() const
+{
+	return m_loadCount;
+}
+
+UINT CVirtualTexture::getEvictionCount() const
+{
+	return m_evictionCount;
+}
+
+UINT CVirtualTexture::getDroppedLoadCount() const
+{
+	return m_droppedLoadCount;
+}
+
+UINT CVirtualTexture::makeEntry(UINT tile, UINT mip) const
+{
+	const UINT cacheX = tile % m_desc.m_cacheTileCount;
+	const UINT cacheY = tile / m_desc.m_cacheTileCount;
+	return cacheX | (cacheY << 8) | (mip << 16) | (0xffu << 24);
+}
+
+UINT CVirtualTexture::getEntryTile(UINT entry) const
+{
+	return (entry & 0xff) + ((entry >> 8) & 0xff) * m_desc.m_cacheTileCount;
+}
+
+UINT CVirtualTexture::getEntry(UINT page) const
+{
+	UINT mip, x, y;
+	VirtualTexture::unpackPage(page, mip, x, y);
+	return m_pageTable[mip][y * getPageCount(mip) + x];
+}
+
+void CVirtualTexture::touch(UINT page)
+{
+	// The tile the page is drawn with this frame, its own or an ancestor's.
+	m_cacheTiles[getEntryTile(getEntry(page))].m_lastUsedFrame = m_frame;
+}
+
+void CVirtualTexture::startLoads()
+{
+	// Coarsest first, then the pages most pixels want. Pages whose loads
+	// finished in this update are cached by now.
+	std::vector<std::pair<UINT, UINT>> candidates;
+	for (const std::pair<const UINT, UINT>& request : m_requests)
+	{
+		if (m_pendingLoads.count(request.first) == 0 && !isResident(request.first))
+		{
+			candidates.emplace_back(request.second, request.first);
+		}
+	}
+	std::sort(candidates.begin(), candidates.end(), [](const std::pair<UINT, UINT>& a, const std::pair<UINT, UINT>& b)
+	{
+		const UINT mipA = a.second >> 24;
+		const UINT mipB = b.second >> 24;
+		return mipA != mipB ? mipA > mipB : a.first > b.first;
+	});
+
+	const UINT tilePixelCount = m_tilePixelCount;
+	for (size_t i = 0, started = 0; i < candidates.size() && started < m_desc.m_maxLoadsPerUpdate &&
+		m_pendingLoads.size() < m_desc.m_maxPendingLoads; ++i, ++started)
+	{
+		UINT mip, x, y;
+		VirtualTexture::unpackPage(candidates[i].second, mip, x, y);
+
+		// The task gets its own copy of the loader, so it does not depend
+		// on the texture.
+		VirtualTexture::TileLoader loader = m_desc.m_tileLoader;
+		m_pendingLoads.emplace(candidates[i].second, CThreadPool::getShared().submit([=]()
+		{
+			std::vector<UINT> pixels(tilePixelCount);
+			loader(mip, x, y, pixels.data());
+			return pixels;
+		}));
+	}
+}
+
+void CVirtualTexture::collectFinishedLoads()
+{
+	for (auto it = m_pendingLoads.begin(); it != m_pendingLoads.end();)
+	{
+		if (it->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		{
+			++it;
+			continue;
+		}
+
+		const UINT page = it->first;
+		STileUpload upload;
+		upload.m_pixels = it->second.get();
+		it = m_pendingLoads.erase(it);
+
+		const UINT tile = allocateTile();
+		if (tile == NoTile)
+		{
+			++m_droppedLoadCount;
+			continue;
+		}
+
+		mapPage(page, tile);
+		++m_loadCount;
+
+		upload.m_cacheX = tile % m_desc.m_cacheTileCount;
+		upload.m_cacheY = tile / m_desc.m_cacheTileCount;
+		m_uploads.push_back(std::move(upload));
+	}
+}
+
+UINT CVirtualTexture::allocateTile()
+{
+	// A free tile, else the least recently used one not used this frame.
+	UINT best = NoTile;
+	for (UINT tile = 0; tile < (UINT)m_cacheTiles.size(); ++tile)
+	{
+		const SCacheTile& cacheTile = m_cacheTiles[tile];
+		if (cacheTile.m_page == VirtualTexture::NoPage)
+		{
+			return tile;
+		}
+
+		if (tile != m_rootTile && cacheTile.m_lastUsedFrame != m_frame &&
+			(best == NoTile || cacheTile.m_lastUsedFrame < m_cacheTiles[best].m_lastUsedFrame))
+		{
+			best = tile;
+		}
+	}
+
+	if (best != NoTile)
+	{
+		unmapPage(m_cacheTiles[best].m_page);
+		++m_evictionCount;
+	}
+	return best;
+}
+
+void CVirtualTexture::mapPage(UINT page, UINT tile)
+{
+	UINT mip, x, y;
+	VirtualTexture::unpackPage(page, mip, x, y);
+
+	m_cacheTiles[tile].m_page = page;
+	m_cacheTiles[tile].m_lastUsedFrame = m_frame;
+	fillRegion(page, makeEntry(tile, mip), true);
+}
+
+void CVirtualTexture::unmapPage(UINT page)
+{
+	UINT mip, x, y;
+	VirtualTexture::unpackPage(page, mip, x, y);
+
+	// The root never leaves, so every other page has a parent entry.
+	const UINT parentEntry = m_pageTable[mip + 1][(y >> 1) * getPageCount(mip + 1) + (x >> 1)];
+	const UINT tile = getEntryTile(getEntry(page));
+
+	m_cacheTiles[tile].m_page = VirtualTexture::NoPage;
+	fillRegion(page, parentEntry, false);
+}
+
+void CVirtualTexture::fillRegion(UINT page, UINT entry, bool isMapping)
+{
+	UINT mip, x, y;
+	VirtualTexture::unpackPage(page, mip, x, y);
+	const UINT oldEntry = getEntry(page);
+
+	// Mapping takes over the entries that fall back to something coarser
+	// than the page; unmapping hands back the ones that pointed at it.
+	for (UINT level = 0; level <= mip; ++level)
+	{
+		const UINT shift = mip - level;
+		const UINT pageCount = getPageCount(level);
+		std::vector<UINT>& table = m_pageTable[level];
+
+		for (UINT row = y << shift; row < (y + 1) << shift; ++row)
+		{
+			UINT* entries = &table[(size_t)row * pageCount];
+			for (UINT column = x << shift; column < (x + 1) << shift; ++column)
+			{
+				const UINT current = entries[column];
+				const bool isReplaced = isMapping ?
+					(current >> 24) == 0 || ((current >> 16) & 0xff) > mip :
+					current == oldEntry;
+				if (isReplaced)
+				{
+					entries[column] = entry;
+				}
+			}
+		}
+	}
+
+	m_hasPageTableChanged = true;
+}
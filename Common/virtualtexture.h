@@ -0,0 +1,202 @@
+﻿#pragma once
+
+#include <functional>
+#include <future>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "d3dutil.h"
+
+using namespace DirectX;
+
+// Feedback entries, page table entries and tile loaders of CVirtualTexture.
+//
+// A page is a tile of the virtual texture at one mip, packed as
+// x | y << 12 | mip << 24. A feedback pass writes, per pixel, the page the
+// pixel would sample, or NoPage; it usually runs at a fraction of the
+// screen resolution, which is plenty to find the pages in view.
+namespace VirtualTexture
+{
+	const UINT NoPage = 0xffffffff;
+
+	UINT packPage(UINT mip, UINT x, UINT y);
+	void unpackPage(UINT page, UINT& mip, UINT& x, UINT& y);
+
+	// Fills pixels with the (tile size + 2 * border)^2 R8G8B8A8 texels of
+	// page (mip, x, y), the border repeating the texels of the neighbouring
+	// pages. Called on the thread pool, several pages at a time.
+	typedef std::function<void(UINT mip, UINT x, UINT y, UINT* pixels)> TileLoader;
+
+	struct SFeedbackDesc
+	{
+		// Feedback buffer size and the screen size it stands for.
+		UINT m_width = 160;
+		UINT m_height = 90;
+		UINT m_screenWidth = 1280;
+		UINT m_screenHeight = 720;
+
+		// Side of the square on the plane y = 0, centered on the origin,
+		// that the virtual texture covers once.
+		float m_worldSize = 1024.0f;
+
+		float m_lodBias = 0.0f;
+	};
+
+	// The feedback a GPU pass would write for a camera looking at the
+	// textured plane, so the cache can be driven and measured without a
+	// GPU. The mip of each pixel comes from the texel footprint of a screen
+	// pixel, as the sampler would pick it.
+	void generateFeedback(
+		const SFeedbackDesc& desc,
+		CXMMATRIX viewProj,
+		UINT virtualSize,
+		UINT tileSize,
+		std::vector<UINT>& feedback
+	);
+}
+
+struct SVirtualTextureDesc
+{
+	// Texels per side of mip 0, a power of two times m_tileSize, with at
+	// most 4096 pages per side, the range of the page coordinates.
+	UINT m_size = 32768;
+
+	// Texels per side of a page, and the texels repeated around each page
+	// in the cache so filtering does not reach into the next cache tile.
+	UINT m_tileSize = 128;
+	UINT m_tileBorder = 4;
+
+	// Cache tiles per side of the physical texture, 1 to 256, the range of
+	// the cache coordinates of page table entries.
+	UINT m_cacheTileCount = 16;
+
+	// Tile loads in flight, and loads started per update.
+	UINT m_maxPendingLoads = 32;
+	UINT m_maxLoadsPerUpdate = 8;
+
+	VirtualTexture::TileLoader m_tileLoader;
+};
+
+// CPU side of a virtual texture: a texture too large to keep in memory,
+// of which only the pages in view are kept in a physical cache texture.
+//
+// Every frame the feedback of the frame goes through addFeedback(), which
+// finds the pages in view, marks the cached ones as used and collects the
+// missing ones. update() then moves the tiles decoded since the last frame
+// into the cache, replacing the least recently used tiles, and starts
+// decoding the most wanted missing pages on the thread pool, coarsest mip
+// first, since coarse pages cover the most screen.
+//
+// The page table has one entry per page of every mip, pointing at the
+// cache tile of the page or, while the page is missing, of its closest
+// cached ancestor, so a lookup never misses: the single page of the last
+// mip is loaded in initialize() and stays. Entries are R8G8B8A8_UINT
+// texels, cache x | cache y << 8 | mip << 16 | 0xff << 24, for a page table
+// texture with one mip per virtual mip.
+class CVirtualTexture
+{
+public:
+	struct STileUpload
+	{
+		UINT m_cacheX;
+		UINT m_cacheY;
+		std::vector<UINT> m_pixels;
+	};
+
+	CVirtualTexture();
+
+	// Waits for the tile loads in flight.
+	~CVirtualTexture();
+
+	CVirtualTexture(const CVirtualTexture&) = delete;
+	CVirtualTexture& operator=(const CVirtualTexture&) = delete;
+
+	// Loads the last mip synchronously; false for a desc whose pages or
+	// cache tiles do not fit the page and entry layouts, or without a tile
+	// loader.
+	bool initialize(const SVirtualTextureDesc& desc, std::string* error = nullptr);
+
+	// Any number of times per frame, before update().
+	void addFeedback(const UINT* feedback, size_t count);
+
+	void update();
+
+	// Tiles that entered the cache since the last call, for the physical
+	// texture, e.g. through UpdateSubresource() with a box at
+	// m_cacheX * getCacheTileSize(). The page table goes up with them
+	// whenever hasPageTableChanged().
+	void takeUploads(std::vector<STileUpload>& uploads);
+
+	UINT getMipCount() const;
+	UINT getPageCount(UINT mip) const;
+	UINT getCacheTileSize() const;
+
+	// getPageCount(mip)^2 entries, row by row.
+	const std::vector<UINT>& getPageTable(UINT mip) const;
+
+	// Whether the page table changed since the last takeUploads().
+	bool hasPageTableChanged() const;
+
+	bool isResident(UINT page) const;
+	UINT getResidentPageCount() const;
+	UINT getPendingLoadCount() const;
+
+	// Pages in the last frame's feedback, and those of them not cached.
+	UINT getRequestedPageCount() const;
+	UINT getMissingPageCount() const;
+
+	UINT getLoadCount() const;
+	UINT getEvictionCount() const;
+
+	// Decoded tiles thrown away because every cache tile was in use.
+	UINT getDroppedLoadCount() const;
+
+private:
+	struct SCacheTile
+	{
+		UINT m_page = VirtualTexture::NoPage;
+		UINT m_lastUsedFrame = 0;
+	};
+
+	static const UINT NoTile = 0xffffffff;
+
+	UINT makeEntry(UINT tile, UINT mip) const;
+	UINT getEntryTile(UINT entry) const;
+	UINT getEntry(UINT page) const;
+
+	void touch(UINT page);
+	void startLoads();
+	void collectFinishedLoads();
+	UINT allocateTile();
+
+	// Points the page and, where they fell back to something coarser, its
+	// descendants at the cache tile; unmapPage() points them back at the
+	// page's parent.
+	void mapPage(UINT page, UINT tile);
+	void unmapPage(UINT page);
+	void fillRegion(UINT page, UINT entry, bool isMapping);
+
+	SVirtualTextureDesc m_desc;
+	UINT m_mipCount;
+	UINT m_tilePixelCount;
+
+	std::vector<std::vector<UINT>> m_pageTable;
+	std::vector<SCacheTile> m_cacheTiles;
+	UINT m_rootTile;
+
+	// Missing pages of this frame with the number of pixels wanting them.
+	std::unordered_map<UINT, UINT> m_requests;
+	std::unordered_map<UINT, std::future<std::vector<UINT>>> m_pendingLoads;
+	std::vector<STileUpload> m_uploads;
+	std::vector<std::pair<UINT, UINT>> m_feedbackRuns;
+
+	UINT m_frame;
+	bool m_hasPageTableChanged;
+	UINT m_feedbackPageCount;
+	UINT m_requestedPageCount;
+	UINT m_missingPageCount;
+	UINT m_loadCount;
+	UINT m_evictionCount;
+	UINT m_droppedLoadCount;
+};
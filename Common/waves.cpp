@@ -158,3 +158,17 @@ void CWaves::disturb(UINT i, UINT j, float magnitude)
 	m_currSolution[(i + 1) * m_numCols + j].y += halfMag;
 	m_currSolution[(i - 1) * m_numCols + j].y += halfMag;
 }
+
+void CWaves::disturb(const std::vector<float>& pattern, float magnitude)
+{
+	assert(pattern.size() == m_vertexCount);
+
+	// The boundary stays fixed, as in update.
+	for (UINT i = 1; i < m_numRows - 1; ++i)
+	{
+		for (UINT j = 1; j < m_numCols - 1; ++j)
+		{
+			m_currSolution[i * m_numCols + j].y += magnitude * pattern[i * m_numCols + j];
+		}
+	}
+}
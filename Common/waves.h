@@ -27,6 +27,11 @@ public:
 	void update(float dt);
 	void disturb(UINT i, UINT j, float magnitude);
 
+	// Raises every interior vertex by magnitude times the matching entry of
+	// a row-major getRowCount() x getColumnCount() pattern, e.g. one filled
+	// by Noise::fillSlice.
+	void disturb(const std::vector<float>& pattern, float magnitude);
+
 private:
 	UINT m_numRows;
 	UINT m_numCols;
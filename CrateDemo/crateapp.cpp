@@ -1,23 +1,29 @@
 ﻿#include "crateapp.h"
 
-#include <fstream>
-#include <array>
-#include <sstream>
-#include <iomanip>
 #include <DirectXColors.h>
-#include "DDSTextureLoader.h"
-#include "WICTextureLoader.h"
 
 #include "../Common/mathhelper.h"
 #include "../Common/geometrygenerator.h"
+#include "../Common/meshcache.h"
+#include "../Common/asyncloader.h"
+#include "../Common/assetcache.h"
 #include "effects.h"
 #include "vertex.h"
 
+namespace
+{
+	// Decoded fire frames kept ahead of the one shown, about a quarter
+	// second at 30 frames per second.
+	const UINT FireResidentFrameCount = 8;
+}
+
 CCrateApp::CCrateApp(HINSTANCE hInstance) :
 	CD3DApp(hInstance),
 	m_boxVertexOffset(0),
 	m_boxIndexOffset(0),
 	m_boxIndexCount(0),
+	m_fireFrame(0),
+	m_fireTime(0.0f),
 	m_theta(1.5f * XM_PI),
 	m_phi(0.1f * XM_PI),
 	m_radius(5.0f)
@@ -64,28 +70,43 @@ bool CCrateApp::initialize()
 		return false;
 	}
 
+	// The fire flipbook is opened and its first frame decoded on a worker
+	// while the effects and geometry are set up here; the texture is
+	// created on this thread.
+	CAsyncLoader loader;
+
+	std::string fireError;
+	CAsyncLoader::SHandle<const UINT*> firstFireFrame = loader.submit([this, &fireError]() -> const UINT*
+	{
+		if (!CAssetCache::getShared().loadFlipbook(
+			"FireAnim/Fire.flipbook", m_fireFlipbook, FireResidentFrameCount, &fireError))
+		{
+			return nullptr;
+		}
+		return m_fireFlipbook.acquireFrame(0, true);
+	});
+
+	loader.submitToOwner([this, firstFireFrame]()
+	{
+		if (firstFireFrame.get())
+		{
+			buildFireMap(firstFireFrame.get());
+		}
+	}, { firstFireFrame.m_job });
+
 	CEffects::initAll(m_d3dDevice.Get());
 	CInputLayouts::initAll(m_d3dDevice.Get());
 
-	m_fireMapSRVs.resize(120);
-	for (int i = 1; i <= 120; ++i)
+	buildGeometryBuffers();
+
+	loader.wait();
+
+	if (!fireError.empty())
 	{
-		std::wstringstream ss;
-		ss << std::setw(3) << std::setfill(L'0') << i;
-		std::wstring s = ss.str();
-
-		std::wstring filename = L"FireAnim/Fire" + s + L".bmp";
-
-		ThrowIfFailed(CreateWICTextureFromFile(
-			m_d3dDevice.Get(),
-			filename.c_str(),
-			nullptr,
-			m_fireMapSRVs[i - 1].GetAddressOf()
-		));
+		MessageBox(nullptr, ansiToWString(fireError).c_str(), 0, 0);
+		return false;
 	}
 
-	buildGeometryBuffers();
-
 	return true;
 }
 
@@ -104,19 +125,28 @@ void CCrateApp::update(const CGameTimer& timer)
 	XMMATRIX V = XMMatrixLookAtLH(pos, target, up);
 	XMStoreFloat4x4(&m_view, V);
 
-	const float frameTime = 1.0f / 30.0f;
-	const float totalAnimTime = 4.0f;
+	const Flipbook::SHeader& fireHeader = m_fireFlipbook.getHeader();
+	const float totalAnimTime = fireHeader.m_frameCount / fireHeader.m_framesPerSecond;
 
-	static float currAnimTime = 0.0f;
-	currAnimTime += timer.getDeltaTime();
-	if (currAnimTime > totalAnimTime)
+	m_fireTime += timer.getDeltaTime();
+	if (m_fireTime > totalAnimTime)
 	{
-		currAnimTime -= totalAnimTime;
+		m_fireTime -= totalAnimTime;
 	}
 
-	const int currAnimFrame = currAnimTime / totalAnimTime * 120;
-
-	m_fireMapSRV = m_fireMapSRVs[currAnimFrame];
+	// A frame the decoder has not caught up with keeps the previous one on
+	// screen.
+	const UINT fireFrame = m_fireFlipbook.getFrameAt(m_fireTime);
+	if (fireFrame != m_fireFrame)
+	{
+		const UINT* pixels = m_fireFlipbook.acquireFrame(fireFrame);
+		if (pixels)
+		{
+			m_d3dImmediateContext->UpdateSubresource(
+				m_fireMap.Get(), 0, nullptr, pixels, fireHeader.m_width * sizeof(UINT), 0);
+			m_fireFrame = fireFrame;
+		}
+	}
 }
 
 void CCrateApp::draw(const CGameTimer& timer)
@@ -231,9 +261,8 @@ void CCrateApp::onMouseMove(WPARAM btnState, int x, int y)
 
 void CCrateApp::buildGeometryBuffers()
 {
-	GeometryGenerator::SMeshData box;
-
-	createBox(1.0f, 1.0f, 1.0f, box);
+	CMeshCache::MeshPtr boxMesh = CMeshCache::getShared().getBox(1.0f, 1.0f, 1.0f);
+	const GeometryGenerator::SMeshData& box = *boxMesh;
 
 	m_boxVertexOffset = 0;
 
@@ -290,3 +319,29 @@ void CCrateApp::buildGeometryBuffers()
 		m_boxIB.GetAddressOf()
 	));
 }
+
+void CCrateApp::buildFireMap(const UINT* firstFrame)
+{
+	const Flipbook::SHeader& header = m_fireFlipbook.getHeader();
+
+	D3D11_TEXTURE2D_DESC texDesc;
+	texDesc.Width = header.m_width;
+	texDesc.Height = header.m_height;
+	texDesc.MipLevels = 1;
+	texDesc.ArraySize = 1;
+	texDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	texDesc.SampleDesc.Count = 1;
+	texDesc.SampleDesc.Quality = 0;
+	texDesc.Usage = D3D11_USAGE_DEFAULT;
+	texDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	texDesc.CPUAccessFlags = 0;
+	texDesc.MiscFlags = 0;
+
+	D3D11_SUBRESOURCE_DATA initData;
+	initData.pSysMem = firstFrame;
+	initData.SysMemPitch = header.m_width * sizeof(UINT);
+	initData.SysMemSlicePitch = 0;
+
+	ThrowIfFailed(m_d3dDevice->CreateTexture2D(&texDesc, &initData, m_fireMap.GetAddressOf()));
+	ThrowIfFailed(m_d3dDevice->CreateShaderResourceView(m_fireMap.Get(), nullptr, m_fireMapSRV.GetAddressOf()));
+}
@@ -1,10 +1,9 @@
 ﻿#pragma once
 
 #include "../Common/d3dapp.h"
+#include "../Common/flipbook.h"
 #include "../Common/lighthelper.h"
 
-#include <vector>
-
 using namespace DirectX;
 
 class CCrateApp : public CD3DApp
@@ -26,13 +25,18 @@ protected:
 
 private:
 	void buildGeometryBuffers();
+	void buildFireMap(const UINT* firstFrame);
 
 protected:
 	ComPtr<ID3D11Buffer> m_boxVB;
 	ComPtr<ID3D11Buffer> m_boxIB;
 
-	std::vector<ComPtr<ID3D11ShaderResourceView>> m_fireMapSRVs;
+	// One texture that the current fire frame is copied into.
+	CFlipbook m_fireFlipbook;
+	ComPtr<ID3D11Texture2D> m_fireMap;
 	ComPtr<ID3D11ShaderResourceView> m_fireMapSRV;
+	UINT m_fireFrame;
+	float m_fireTime;
 
 	SDirectionalLight m_dirLights[3];
 	SMaterial m_boxMat;
@@ -0,0 +1,83 @@
+cbuffer cbPerFrame
+{
+	float4x4 gViewProj;
+	float3 gEyePosW;
+	float3 gLightDirW;
+};
+
+cbuffer cbPerChunk
+{
+	// Distances at which the chunk starts and finishes morphing to the
+	// next coarser level.
+	float2 gMorphRange;
+};
+
+struct VertexIn
+{
+	float3 m_posW : POSITION0;
+	float3 m_morphPosW : POSITION1;
+	float3 m_normalW : NORMAL0;
+	float3 m_morphNormalW : NORMAL1;
+};
+
+struct VertexOut
+{
+	float4 m_posH : SV_POSITION;
+	float3 m_normalW : NORMAL;
+	float m_height : HEIGHT;
+};
+
+VertexOut VS(VertexIn vIn)
+{
+	float distance = length(vIn.m_posW - gEyePosW);
+	float k = saturate((distance - gMorphRange.x) / (gMorphRange.y - gMorphRange.x));
+
+	float3 posW = lerp(vIn.m_posW, vIn.m_morphPosW, k);
+
+	VertexOut vOut;
+	vOut.m_posH = mul(float4(posW, 1.0f), gViewProj);
+	vOut.m_normalW = lerp(vIn.m_normalW, vIn.m_morphNormalW, k);
+	vOut.m_height = posW.y;
+
+	return vOut;
+}
+
+float4 PS(VertexOut pIn) : SV_Target
+{
+	float4 color;
+	if (pIn.m_height < -10.0f)
+	{
+		color = float4(1.0f, 0.96f, 0.62f, 1.0f);
+	}
+	else if (pIn.m_height < 5.0f)
+	{
+		color = float4(0.48f, 0.77f, 0.46f, 1.0f);
+	}
+	else if (pIn.m_height < 12.0f)
+	{
+		color = float4(0.1f, 0.48f, 0.19f, 1.0f);
+	}
+	else if (pIn.m_height < 20.0f)
+	{
+		color = float4(0.45f, 0.39f, 0.34f, 1.0f);
+	}
+	else
+	{
+		color = float4(1.0f, 1.0f, 1.0f, 1.0f);
+	}
+
+	float diffuse = saturate(dot(normalize(pIn.m_normalW), -gLightDirW));
+	color.rgb *= 0.4f + 0.6f * diffuse;
+
+	return color;
+}
+
+technique11 TerrainTech
+{
+	pass P0
+	{
+		SetVertexShader(CompileShader(vs_5_0, VS()));
+		SetGeometryShader(NULL);
+		SetPixelShader(CompileShader(ps_5_0, PS()));
+	}
+}
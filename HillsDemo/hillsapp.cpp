@@ -4,21 +4,21 @@
 #include <DirectXColors.h>
 
 #include "../Common/mathhelper.h"
-#include "../Common/geometrygenerator.h"
+#include "../Common/noise.h"
+#include "../Common/terrain.h"
 
 CHillsApp::CHillsApp(HINSTANCE hInstance) :
 	CD3DApp(hInstance),
-	m_gridIndexCount(0),
+	m_eyePosW(0.0f, 0.0f, 0.0f),
 	m_theta(1.5f * XM_PI),
 	m_phi(XM_PIDIV4),
-	m_radius(5.0f)
+	m_radius(200.0f)
 {
 	m_mainWndCaption = L"Box Demo";
 
 	m_lastMousePos = { 0, 0 };
 
 	XMMATRIX I = XMMatrixIdentity();
-	XMStoreFloat4x4(&m_world, I);
 	XMStoreFloat4x4(&m_view, I);
 	XMStoreFloat4x4(&m_proj, I);
 }
@@ -35,7 +35,7 @@ bool CHillsApp::initialize()
 		return false;
 	}
 
-	buildGeometryBuffers();
+	buildTerrain();
 	buildFX();
 	buildVertexLayout();
 
@@ -54,6 +54,11 @@ void CHillsApp::update(const CGameTimer& timer)
 
 	XMMATRIX V = XMMatrixLookAtLH(pos, target, up);
 	XMStoreFloat4x4(&m_view, V);
+
+	m_eyePosW = XMFLOAT3(x, y, z);
+
+	XMMATRIX P = XMLoadFloat4x4(&m_proj);
+	m_terrain.update(pos, V * P);
 }
 
 void CHillsApp::draw(const CGameTimer& timer)
@@ -73,29 +78,39 @@ void CHillsApp::draw(const CGameTimer& timer)
 	m_d3dImmediateContext->IASetPrimitiveTopology(
 		D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST
 	);
-	UINT stride = sizeof(SVertex);
+	UINT stride = sizeof(SCdlodVertex);
 	UINT offset = 0;
-	m_d3dImmediateContext->IASetVertexBuffers(
-		0, 1, m_VB.GetAddressOf(), &stride, &offset
-	);
 	m_d3dImmediateContext->IASetIndexBuffer(
-		m_IB.Get(), DXGI_FORMAT_R32_UINT, 0
+		m_terrain.getIndexBuffer(), DXGI_FORMAT_R32_UINT, 0
 	);
 
-	XMMATRIX world = XMLoadFloat4x4(&m_world);
 	XMMATRIX view = XMLoadFloat4x4(&m_view);
 	XMMATRIX proj = XMLoadFloat4x4(&m_proj);
-	XMMATRIX worldViewProj = world * view * proj;
+	XMMATRIX viewProj = view * proj;
 
-	m_fxWorldViewProj->SetMatrix(reinterpret_cast<float*>(&worldViewProj));
+	XMFLOAT3 lightDirW(0.57735f, -0.57735f, 0.57735f);
+
+	m_fxViewProj->SetMatrix(reinterpret_cast<float*>(&viewProj));
+	m_fxEyePosW->SetRawValue(&m_eyePosW, 0, sizeof(m_eyePosW));
+	m_fxLightDirW->SetRawValue(&lightDirW, 0, sizeof(lightDirW));
 
 	D3DX11_TECHNIQUE_DESC techDesc;
 	m_tech->GetDesc(&techDesc);
 	for (UINT p = 0; p < techDesc.Passes; ++p)
 	{
-		m_tech->GetPassByIndex(p)->Apply(0, m_d3dImmediateContext.Get());
+		for (const SCdlodDrawItem& item : m_terrain.getDrawItems())
+		{
+			m_d3dImmediateContext->IASetVertexBuffers(
+				0, 1, &item.m_vertexBuffer, &stride, &offset
+			);
 
-		m_d3dImmediateContext->DrawIndexed(m_gridIndexCount, 0, 0);
+			XMFLOAT2 morphRange(item.m_morphStart, item.m_morphEnd);
+			m_fxMorphRange->SetRawValue(&morphRange, 0, sizeof(morphRange));
+
+			m_tech->GetPassByIndex(p)->Apply(0, m_d3dImmediateContext.Get());
+
+			m_d3dImmediateContext->DrawIndexed(item.m_indexCount, item.m_indexOffset, 0);
+		}
 	}
 
 	ThrowIfFailed(m_swapChain->Present(0, 0));
@@ -106,7 +121,7 @@ void CHillsApp::onResize()
 	CD3DApp::onResize();
 
 	XMMATRIX P = XMMatrixPerspectiveFovLH(
-		XM_PIDIV4, getAspectRatio(), 1.0f, 1000.0f
+		XM_PIDIV4, getAspectRatio(), 1.0f, 2000.0f
 	);
 	XMStoreFloat4x4(&m_proj, P);
 }
@@ -149,76 +164,30 @@ void CHillsApp::onMouseMove(WPARAM btnState, int x, int y)
 	m_lastMousePos = { x, y };
 }
 
-float CHillsApp::getHeight(float x, float z) const
-{
-	return 0.3f * (z * sinf(0.1f * x) + x * cosf(0.1f * z));
-}
-
-void CHillsApp::buildGeometryBuffers()
+void CHillsApp::buildTerrain()
 {
-	GeometryGenerator::SMeshData grid;
-	GeometryGenerator::createGrid(160.0f, 160.0f, 50, 50, grid);
-
-	m_gridIndexCount = grid.m_indices.size();
-
-	std::vector<SVertex> vertices(grid.m_vertices.size());
-	for (size_t i = 0; i < grid.m_vertices.size(); ++i)
+	SCdlodDesc desc;
+	desc.m_worldSize = 512.0f;
+	desc.m_lodCount = 4;
+	desc.m_chunkQuads = 32;
+
+	// The hills with a few meters of fBm detail on top.
+	Noise::SFbmDesc detailDesc;
+	detailDesc.m_frequency = 0.02f;
+	detailDesc.m_amplitude = 4.0f;
+	Terrain::HeightGradientFunction detail = Noise::createHeightFunction(1, detailDesc);
+
+	desc.m_heightFunction = [detail](FXMVECTOR x, FXMVECTOR z, XMVECTOR& dhdx, XMVECTOR& dhdz)
 	{
-		XMFLOAT3 p = grid.m_vertices[i].m_position;
-
-		p.y = getHeight(p.x, p.z);
-
-		vertices[i].m_pos = p;
-
-		if (p.y < -10.0f)
-		{
-			vertices[i].m_color = XMFLOAT4(1.0f, 0.96f, 0.62f, 1.0f);
-		}
-		else if (p.y < 5.0f)
-		{
-			vertices[i].m_color = XMFLOAT4(0.48f, 0.77f, 0.46f, 1.0f);
-		}
-		else if (p.y < 12.0f)
-		{
-			vertices[i].m_color = XMFLOAT4(0.1f, 0.48f, 0.19f, 1.0f);
-		}
-		else if (p.y < 20.0f)
-		{
-			vertices[i].m_color = XMFLOAT4(0.45f, 0.39f, 0.34f, 1.0f);
-		}
-		else
-		{
-			vertices[i].m_color = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
-		}
-	}
+		XMVECTOR detailDx, detailDz;
+		XMVECTOR h = XMVectorAdd(Terrain::hills(x, z, dhdx, dhdz), detail(x, z, detailDx, detailDz));
 
-	D3D11_BUFFER_DESC vbDesc;
-	vbDesc.Usage = D3D11_USAGE_IMMUTABLE;
-	vbDesc.ByteWidth = sizeof(SVertex) * grid.m_vertices.size();
-	vbDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-	vbDesc.CPUAccessFlags = 0;
-	vbDesc.MiscFlags = 0;
-
-	D3D11_SUBRESOURCE_DATA vInitData;
-	vInitData.pSysMem = vertices.data();
-
-	ThrowIfFailed(m_d3dDevice->CreateBuffer(
-		&vbDesc, &vInitData, m_VB.GetAddressOf()
-	));
-
-	D3D11_BUFFER_DESC ibDesc;
-	ibDesc.Usage = D3D11_USAGE_IMMUTABLE;
-	ibDesc.ByteWidth = sizeof(UINT) * m_gridIndexCount;
-	ibDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-	ibDesc.CPUAccessFlags = 0;
-	ibDesc.MiscFlags = 0;
-
-	D3D11_SUBRESOURCE_DATA iInitData;
-	iInitData.pSysMem = grid.m_indices.data();
+		dhdx = XMVectorAdd(dhdx, detailDx);
+		dhdz = XMVectorAdd(dhdz, detailDz);
+		return h;
+	};
 
-	ThrowIfFailed(m_d3dDevice->CreateBuffer(
-		&ibDesc, &iInitData, m_IB.GetAddressOf()
-	));
+	m_terrain.initialize(m_d3dDevice.Get(), desc);
 }
 
 void CHillsApp::buildFX()
@@ -232,7 +201,7 @@ void CHillsApp::buildFX()
 	ComPtr<ID3D10Blob> compiledShader;
 	ComPtr<ID3D10Blob> compilationMsgs;
 	HRESULT hr = D3DCompileFromFile(
-		L"FX/color.fx",
+		L"FX/terrain.fx",
 		nullptr,
 		nullptr,
 		nullptr,
@@ -258,16 +227,23 @@ void CHillsApp::buildFX()
 		m_FX.GetAddressOf()
 	));
 
-	m_tech = m_FX->GetTechniqueByName("ColorTech");
-	m_fxWorldViewProj = m_FX->GetVariableByName("gWorldViewProj")->AsMatrix();
+	m_tech = m_FX->GetTechniqueByName("TerrainTech");
+	m_fxViewProj = m_FX->GetVariableByName("gViewProj")->AsMatrix();
+	m_fxEyePosW = m_FX->GetVariableByName("gEyePosW")->AsVector();
+	m_fxLightDirW = m_FX->GetVariableByName("gLightDirW")->AsVector();
+	m_fxMorphRange = m_FX->GetVariableByName("gMorphRange")->AsVector();
 }
 
 void CHillsApp::buildVertexLayout()
 {
-	std::array<D3D11_INPUT_ELEMENT_DESC, 2> vertexDesc = {
+	std::array<D3D11_INPUT_ELEMENT_DESC, 4> vertexDesc = {
 		D3D11_INPUT_ELEMENT_DESC({"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0,
 			D3D11_INPUT_PER_VERTEX_DATA, 0}),
-		D3D11_INPUT_ELEMENT_DESC({"COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 12,
+		D3D11_INPUT_ELEMENT_DESC({"POSITION", 1, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12,
+			D3D11_INPUT_PER_VERTEX_DATA, 0}),
+		D3D11_INPUT_ELEMENT_DESC({"NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 24,
+			D3D11_INPUT_PER_VERTEX_DATA, 0}),
+		D3D11_INPUT_ELEMENT_DESC({"NORMAL", 1, DXGI_FORMAT_R32G32B32_FLOAT, 0, 36,
 			D3D11_INPUT_PER_VERTEX_DATA, 0})
 	};
 
@@ -1,15 +1,10 @@
 ﻿#pragma once
 
 #include "../Common/d3dapp.h"
+#include "../Common/cdlodterrain.h"
 
 using namespace DirectX;
 
-struct SVertex
-{
-	XMFLOAT3 m_pos;
-	XMFLOAT4 m_color;
-};
-
 class CHillsApp : public CD3DApp
 {
 public:
@@ -28,24 +23,23 @@ protected:
 	virtual void onMouseMove(WPARAM btnState, int x, int y) override;
 
 private:
-	float getHeight(float x, float z) const;
-	void buildGeometryBuffers();
+	void buildTerrain();
 	void buildFX();
 	void buildVertexLayout();
 
 protected:
-	ComPtr<ID3D11Buffer> m_VB;
-	ComPtr<ID3D11Buffer> m_IB;
+	CCdlodTerrain m_terrain;
 
 	ComPtr<ID3DX11Effect> m_FX;
 	ComPtr<ID3DX11EffectTechnique> m_tech;
-	ComPtr<ID3DX11EffectMatrixVariable> m_fxWorldViewProj;
+	ComPtr<ID3DX11EffectMatrixVariable> m_fxViewProj;
+	ComPtr<ID3DX11EffectVectorVariable> m_fxEyePosW;
+	ComPtr<ID3DX11EffectVectorVariable> m_fxLightDirW;
+	ComPtr<ID3DX11EffectVectorVariable> m_fxMorphRange;
 
 	ComPtr<ID3D11InputLayout> m_inputLayout;
 
-	UINT m_gridIndexCount;
-
-	XMFLOAT4X4 m_world;
+	XMFLOAT3 m_eyePosW;
 	XMFLOAT4X4 m_view;
 	XMFLOAT4X4 m_proj;
 
@@ -6,6 +6,7 @@
 
 #include "../Common/mathhelper.h"
 #include "../Common/geometrygenerator.h"
+#include "../Common/terrain.h"
 
 CLightApp::CLightApp(HINSTANCE hInstance) :
 	CD3DApp(hInstance),
@@ -142,7 +143,7 @@ void CLightApp::update(const CGameTimer& timer)
 	m_pointLight.m_position.x = 70.0f * cosf(0.2f * timer.getTotalTime());
 	m_pointLight.m_position.z = 70.0f * sinf(0.2f * timer.getTotalTime());
 	m_pointLight.m_position.y = MathHelper::max(
-		getHillHeight(m_pointLight.m_position.x, m_pointLight.m_position.z),
+		Terrain::getHillHeight(m_pointLight.m_position.x, m_pointLight.m_position.z),
 		-3.0f
 	) + 10.0f;
 
@@ -275,25 +276,6 @@ void CLightApp::onMouseMove(WPARAM btnState, int x, int y)
 	m_lastMousePos = { x, y };
 }
 
-float CLightApp::getHillHeight(float x, float z) const
-{
-	return 0.3f * (z * sinf(0.1f * x) + x * cosf(0.1f * z));
-}
-
-DirectX::XMFLOAT3 CLightApp::getHillNormal(float x, float z) const
-{
-	XMFLOAT3 n(
-		-0.03f * z * cosf(0.1f * x) - 0.3f * cosf(0.1f * z),
-		1.0f,
-		-0.3f * sinf(0.1f * x) + 0.03f * x * sinf(0.1f * z)
-	);
-
-	XMVECTOR unitNormal = XMVector3Normalize(XMLoadFloat3(&n));
-	XMStoreFloat3(&n, unitNormal);
-
-	return n;
-}
-
 void CLightApp::buildGridGeometryBuffers()
 {
 	GeometryGenerator::SMeshData grid;
@@ -301,15 +283,15 @@ void CLightApp::buildGridGeometryBuffers()
 
 	m_gridIndexCount = grid.m_indices.size();
 
+	std::vector<XMFLOAT3> positions;
+	std::vector<XMFLOAT3> normals;
+	Terrain::evaluateGrid(160.0f, 160.0f, 50, 50, Terrain::hills, positions, &normals);
+
 	std::vector<SVertex> vertices(grid.m_vertices.size());
 	for (size_t i = 0; i < grid.m_vertices.size(); ++i)
 	{
-		XMFLOAT3 p = grid.m_vertices[i].m_position;
-
-		p.y = getHillHeight(p.x, p.z);
-
-		vertices[i].m_pos = p;
-		vertices[i].m_normal = getHillNormal(p.x, p.z);
+		vertices[i].m_pos = positions[i];
+		vertices[i].m_normal = normals[i];
 	}
 
 	D3D11_BUFFER_DESC vbDesc;
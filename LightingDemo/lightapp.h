@@ -31,8 +31,6 @@ protected:
 	virtual void onMouseMove(WPARAM btnState, int x, int y) override;
 
 private:
-	float getHillHeight(float x, float z) const;
-	XMFLOAT3 getHillNormal(float x, float z) const;
 	void buildGridGeometryBuffers();
 	void buildWavesGeometryBuffers();
 	void buildFX();
@@ -36,6 +36,14 @@ struct SVertexIn
 	float3 m_normalL : NORMAL;
 };
 
+// Vertex::SPackedPosNormal: positions as 16 bit unorm in the mesh bounds,
+// decoded by the world matrices, and octahedral normals.
+struct SPackedVertexIn
+{
+	float4 m_posL : POSITION;
+	float2 m_normalL : NORMAL;
+};
+
 struct SVertexOut
 {
 	float4 m_posH : SV_POSITION;
@@ -55,6 +63,30 @@ SVertexOut VS(SVertexIn vIn)
 	return vOut;
 }
 
+float3 decodeOctahedral(float2 e)
+{
+	float3 n = float3(e.x, e.y, 1.0f - abs(e.x) - abs(e.y));
+	if (n.z < 0.0f)
+	{
+		n.xy = (1.0f - abs(n.yx)) * (n.xy >= 0.0f ? 1.0f : -1.0f);
+	}
+	return normalize(n);
+}
+
+SVertexOut PackedVS(SPackedVertexIn vIn)
+{
+	SVertexOut vOut;
+
+	float3 normalL = decodeOctahedral(vIn.m_normalL);
+
+	vOut.m_posW = mul(float4(vIn.m_posL.xyz, 1.0f), g_world).xyz;
+	vOut.m_normalW = mul(normalL, (float3x3)g_worldInvTranspose);
+
+	vOut.m_posH = mul(float4(vIn.m_posL.xyz, 1.0f), g_worldViewProj);
+
+	return vOut;
+}
+
 float4 PS(SVertexOut pIn, uniform int g_lightCount) : SV_Target
 {
 	pIn.m_normalW = normalize(pIn.m_normalW);
@@ -115,3 +147,33 @@ technique11 Light3
 		SetPixelShader(CompileShader(ps_5_0, PS(3)));
 	}
 }
+
+technique11 Light1Packed
+{
+	pass P0
+	{
+		SetVertexShader(CompileShader(vs_5_0, PackedVS()));
+		SetGeometryShader(NULL);
+		SetPixelShader(CompileShader(ps_5_0, PS(1)));
+	}
+}
+
+technique11 Light2Packed
+{
+	pass P0
+	{
+		SetVertexShader(CompileShader(vs_5_0, PackedVS()));
+		SetGeometryShader(NULL);
+		SetPixelShader(CompileShader(ps_5_0, PS(2)));
+	}
+}
+
+technique11 Light3Packed
+{
+	pass P0
+	{
+		SetVertexShader(CompileShader(vs_5_0, PackedVS()));
+		SetGeometryShader(NULL);
+		SetPixelShader(CompileShader(ps_5_0, PS(3)));
+	}
+}
@@ -31,6 +31,9 @@ CBasicEffect::CBasicEffect(ID3D11Device* device, const std::wstring& filename) :
 	m_light1Tech = m_FX->GetTechniqueByName("Light1");
 	m_light2Tech = m_FX->GetTechniqueByName("Light2");
 	m_light3Tech = m_FX->GetTechniqueByName("Light3");
+	m_light1PackedTech = m_FX->GetTechniqueByName("Light1Packed");
+	m_light2PackedTech = m_FX->GetTechniqueByName("Light2Packed");
+	m_light3PackedTech = m_FX->GetTechniqueByName("Light3Packed");
 	m_worldViewProj = m_FX->GetVariableByName("g_worldViewProj")->AsMatrix();
 	m_world = m_FX->GetVariableByName("g_world")->AsMatrix();
 	m_worldInvTranspose = m_FX->GetVariableByName("g_worldInvTranspose")->AsMatrix();
@@ -35,6 +35,12 @@ public:
 	ComPtr<ID3DX11EffectTechnique> m_light2Tech;
 	ComPtr<ID3DX11EffectTechnique> m_light3Tech;
 
+	// For Vertex::SPackedPosNormal, with the decode matrix of the positions
+	// folded into the world matrices.
+	ComPtr<ID3DX11EffectTechnique> m_light1PackedTech;
+	ComPtr<ID3DX11EffectTechnique> m_light2PackedTech;
+	ComPtr<ID3DX11EffectTechnique> m_light3PackedTech;
+
 	ComPtr<ID3DX11EffectMatrixVariable> m_worldViewProj;
 	ComPtr<ID3DX11EffectMatrixVariable> m_world;
 	ComPtr<ID3DX11EffectMatrixVariable> m_worldInvTranspose;
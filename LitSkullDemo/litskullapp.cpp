@@ -1,11 +1,13 @@
 ﻿#include "litskullapp.h"
 
-#include <fstream>
 #include <array>
 #include <DirectXColors.h>
 
 #include "../Common/mathhelper.h"
 #include "../Common/geometrygenerator.h"
+#include "../Common/meshcache.h"
+#include "../Common/meshoptimizer.h"
+#include "../Common/assetcache.h"
 #include "effects.h"
 #include "vertex.h"
 
@@ -90,11 +92,19 @@ bool CLitSkullApp::initialize()
 		return false;
 	}
 
+	// The skull loads on the workers while everything else is set up.
+	CAsyncLoader loader;
+	CAsyncLoader::SHandle<void> skullBuffers = buildSkullGeometryBuffers(loader);
+
 	CEffects::initAll(m_d3dDevice.Get());
 	CInputLayouts::initAll(m_d3dDevice.Get());
 
 	buildShapeGeometryBuffers();
-	buildSkullGeometryBuffers();
+
+	loader.wait();
+
+	// Rethrows a failed buffer creation.
+	skullBuffers.get();
 
 	return true;
 }
@@ -163,19 +173,32 @@ void CLitSkullApp::draw(const CGameTimer& timer)
 	CEffects::ms_basicFX->setEyePosW(m_eyePosW);
 
 	ComPtr<ID3DX11EffectTechnique> activeTech = CEffects::ms_basicFX->m_light1Tech;
+	ComPtr<ID3DX11EffectTechnique> activePackedTech = CEffects::ms_basicFX->m_light1PackedTech;
 	switch (m_lightCount)
 	{
 	case 1:
 		activeTech = CEffects::ms_basicFX->m_light1Tech;
+		activePackedTech = CEffects::ms_basicFX->m_light1PackedTech;
 		break;
 	case 2:
 		activeTech = CEffects::ms_basicFX->m_light2Tech;
+		activePackedTech = CEffects::ms_basicFX->m_light2PackedTech;
 		break;
 	case 3:
 		activeTech = CEffects::ms_basicFX->m_light3Tech;
+		activePackedTech = CEffects::ms_basicFX->m_light3PackedTech;
 		break;
 	}
 
+	m_skullDrawRanges.clear();
+	MeshletBuilder::cullMeshlets(
+		m_skullMeshlets,
+		XMLoadFloat4x4(&m_skullWorld),
+		viewProj,
+		m_eyePosW,
+		m_skullDrawRanges
+	);
+
 	D3DX11_TECHNIQUE_DESC techDesc;
 	activeTech->GetDesc(&techDesc);
 	for (UINT p = 0; p < techDesc.Passes; ++p)
@@ -244,26 +267,39 @@ void CLitSkullApp::draw(const CGameTimer& timer)
 			m_d3dImmediateContext->DrawIndexed(
 				m_sphereIndexCount, m_sphereIndexOffset, m_sphereVertexOffset);
 		}
+	}
 
-		m_d3dImmediateContext->IASetVertexBuffers(
-			0, 1, m_skullVB.GetAddressOf(), &stride, &offset
-		);
-		m_d3dImmediateContext->IASetIndexBuffer(
-			m_skullIB.Get(), DXGI_FORMAT_R32_UINT, 0
-		);
+	m_d3dImmediateContext->IASetInputLayout(
+		CInputLayouts::ms_packedPosNormal.Get()
+	);
 
-		world = XMLoadFloat4x4(&m_skullWorld);
-		worldInvTranspose = MathHelper::inverseTranspose(world);
-		worldViewProj = world * view * proj;
+	UINT packedStride = sizeof(Vertex::SPackedPosNormal);
+	m_d3dImmediateContext->IASetVertexBuffers(
+		0, 1, m_skullVB.GetAddressOf(), &packedStride, &offset
+	);
+	m_d3dImmediateContext->IASetIndexBuffer(
+		m_skullIB.Get(), DXGI_FORMAT_R32_UINT, 0
+	);
 
-		CEffects::ms_basicFX->setWorld(world);
-		CEffects::ms_basicFX->setWorldInvTranspose(worldInvTranspose);
-		CEffects::ms_basicFX->setWorldViewProj(worldViewProj);
-		CEffects::ms_basicFX->setMaterial(m_skullMat);
+	// The positions decode to mesh space through the world matrix; the
+	// normals are decoded in the shader, so theirs is that of the mesh.
+	XMMATRIX skullWorld = XMLoadFloat4x4(&m_skullWorld);
+	XMMATRIX world = m_skullQuantization.getDecodeMatrix() * skullWorld;
 
-		activeTech->GetPassByIndex(p)->Apply(0, m_d3dImmediateContext.Get());
-		m_d3dImmediateContext->DrawIndexed(
-			m_skullIndexCount, 0, 0);
+	CEffects::ms_basicFX->setWorld(world);
+	CEffects::ms_basicFX->setWorldInvTranspose(MathHelper::inverseTranspose(skullWorld));
+	CEffects::ms_basicFX->setWorldViewProj(world * view * proj);
+	CEffects::ms_basicFX->setMaterial(m_skullMat);
+
+	activePackedTech->GetDesc(&techDesc);
+	for (UINT p = 0; p < techDesc.Passes; ++p)
+	{
+		activePackedTech->GetPassByIndex(p)->Apply(0, m_d3dImmediateContext.Get());
+		for (const MeshletBuilder::SDrawRange& range : m_skullDrawRanges)
+		{
+			m_d3dImmediateContext->DrawIndexed(
+				range.m_indexCount, range.m_indexOffset, 0);
+		}
 	}
 
 	ThrowIfFailed(m_swapChain->Present(0, 0));
@@ -319,15 +355,16 @@ void CLitSkullApp::onMouseMove(WPARAM btnState, int x, int y)
 
 void CLitSkullApp::buildShapeGeometryBuffers()
 {
-	GeometryGenerator::SMeshData box;
-	GeometryGenerator::SMeshData grid;
-	GeometryGenerator::SMeshData sphere;
-	GeometryGenerator::SMeshData cylinder;
+	CMeshCache& meshCache = CMeshCache::getShared();
+	CMeshCache::MeshPtr boxMesh = meshCache.getBox(1.0f, 1.0f, 1.0f);
+	CMeshCache::MeshPtr gridMesh = meshCache.getGrid(20.0f, 30.0f, 60, 40);
+	CMeshCache::MeshPtr sphereMesh = meshCache.getSphere(0.5f, 20, 20);
+	CMeshCache::MeshPtr cylinderMesh = meshCache.getCylinder(0.5f, 0.3f, 3.0f, 20, 20);
 
-	createBox(1.0f, 1.0f, 1.0f, box);
-	createGrid(20.0f, 30.0f, 60, 40, grid);
-	createSphere(0.5f, 20, 20, sphere);
-	createCylinder(0.5f, 0.3f, 3.0f, 20, 20, cylinder);
+	const GeometryGenerator::SMeshData& box = *boxMesh;
+	const GeometryGenerator::SMeshData& grid = *gridMesh;
+	const GeometryGenerator::SMeshData& sphere = *sphereMesh;
+	const GeometryGenerator::SMeshData& cylinder = *cylinderMesh;
 
 	m_boxVertexOffset = 0;
 	m_gridVertexOffset = box.m_vertices.size();
@@ -422,85 +459,116 @@ void CLitSkullApp::buildShapeGeometryBuffers()
 	));
 }
 
-void CLitSkullApp::buildSkullGeometryBuffers()
+CAsyncLoader::SHandle<void> CLitSkullApp::buildSkullGeometryBuffers(CAsyncLoader& loader)
 {
-	std::ifstream fin("Models/skull.txt");
-
-	if (!fin)
+	struct SSkull
 	{
-		MessageBox(nullptr, L"Models/skull.txt not found", 0, 0);
-		return;
-	}
+		std::vector<Vertex::SPackedPosNormal> m_vertices;
+		VertexPacking::SPositionQuantization m_quantization;
+		std::string m_error;
+	};
+
+	// Loading, overdraw optimization and meshlet building run on a worker;
+	// only the buffers are created on this thread.
+	CAsyncLoader::SHandle<SSkull> skullLoad = loader.submit([this]()
+	{
+		SSkull result;
 
-	UINT vCount = 0;
-	UINT tCount = 0;
-	std::string ignore;
+		MeshStreams::SMeshStreams skull;
+		if (!CAssetCache::getShared().loadMesh("Models/skull.txt", skull, &result.m_error))
+		{
+			return result;
+		}
 
-	fin >> ignore >> vCount;
-	fin >> ignore >> tCount;
-	fin >> ignore >> ignore >> ignore >> ignore;
+		const UINT vCount = skull.getVertexCount();
 
-	float nx, ny, nz;
-	XMFLOAT4 black(0.0f, 0.0f, 0.0f, 1.0f);
+		std::vector<Vertex::SPosNormal> vertices(vCount);
+		MeshStreams::scatter(skull.m_positions, &Vertex::SPosNormal::m_pos, vertices);
+		MeshStreams::scatter(skull.m_normals, &Vertex::SPosNormal::m_normal, vertices);
 
-	std::vector<Vertex::SPosNormal> vertices(vCount);
-	for (UINT i = 0; i < vCount; ++i)
-	{
-		fin >>
-			vertices[i].m_pos.x >>
-			vertices[i].m_pos.y >>
-			vertices[i].m_pos.z;
-		fin >>
-			vertices[i].m_normal.x >>
-			vertices[i].m_normal.y >>
-			vertices[i].m_normal.z;
-	}
+		std::vector<UINT> indices = std::move(skull.m_indices);
 
-	fin >> ignore;
-	fin >> ignore;
-	fin >> ignore;
-
-	m_skullIndexCount = 3 * tCount;
-	std::vector<UINT> indices(m_skullIndexCount);
-	for (UINT i = 0; i < tCount; ++i)
-	{
-		fin >>
-			indices[i * 3 + 0] >>
-			indices[i * 3 + 1] >>
-			indices[i * 3 + 2];
-	}
-
-	fin.close();
+		MeshOptimizer::optimizeOverdraw(
+			indices,
+			&vertices[0].m_pos,
+			vCount,
+			sizeof(Vertex::SPosNormal)
+		);
 
-	D3D11_BUFFER_DESC vbDesc;
-	vbDesc.Usage = D3D11_USAGE_IMMUTABLE;
-	vbDesc.ByteWidth = vCount * sizeof(Vertex::SPosNormal);
-	vbDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-	vbDesc.CPUAccessFlags = 0;
-	vbDesc.MiscFlags = 0;
+		// The index buffer is uploaded meshlet by meshlet, so the meshlets
+		// keep the overdraw order.
+		MeshletBuilder::buildMeshlets(
+			indices,
+			&vertices[0].m_pos,
+			vCount,
+			sizeof(Vertex::SPosNormal),
+			m_skullMeshlets,
+			MeshletBuilder::MaxMeshletVertices,
+			MeshletBuilder::MaxMeshletTriangles,
+			true
+		);
 
-	D3D11_SUBRESOURCE_DATA vInitData;
-	vInitData.pSysMem = vertices.data();
+		// The meshlets and their bounds come from the full precision
+		// positions; only the vertex buffer is packed.
+		result.m_quantization = VertexPacking::computeQuantization(
+			&vertices[0].m_pos, vCount, sizeof(Vertex::SPosNormal));
 
-	ThrowIfFailed(m_d3dDevice->CreateBuffer(
-		&vbDesc,
-		&vInitData,
-		m_skullVB.GetAddressOf()
-	));
+		result.m_vertices.resize(vCount);
+		VertexPacking::encodePositions(
+			&vertices[0].m_pos, vCount, sizeof(Vertex::SPosNormal),
+			result.m_quantization,
+			&result.m_vertices[0].m_pos, sizeof(Vertex::SPackedPosNormal)
+		);
+		VertexPacking::encodeOctahedral(
+			&vertices[0].m_normal, vCount, sizeof(Vertex::SPosNormal),
+			&result.m_vertices[0].m_normal, sizeof(Vertex::SPackedPosNormal)
+		);
 
-	D3D11_BUFFER_DESC ibDesc;
-	ibDesc.Usage = D3D11_USAGE_IMMUTABLE;
-	ibDesc.ByteWidth = m_skullIndexCount * sizeof(UINT);
-	ibDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-	ibDesc.CPUAccessFlags = 0;
-	ibDesc.MiscFlags = 0;
+		return result;
+	});
 
-	D3D11_SUBRESOURCE_DATA iInitData;
-	iInitData.pSysMem = indices.data();
+	return loader.submitToOwner([this, skullLoad]()
+	{
+		const SSkull& skull = skullLoad.get();
+		if (!skull.m_error.empty())
+		{
+			MessageBox(nullptr, ansiToWString(skull.m_error).c_str(), 0, 0);
+			return;
+		}
 
-	ThrowIfFailed(m_d3dDevice->CreateBuffer(
-		&ibDesc,
-		&iInitData,
-		m_skullIB.GetAddressOf()
-	));
+		m_skullIndexCount = (UINT)m_skullMeshlets.m_indices.size();
+		m_skullQuantization = skull.m_quantization;
+
+		D3D11_BUFFER_DESC vbDesc;
+		vbDesc.Usage = D3D11_USAGE_IMMUTABLE;
+		vbDesc.ByteWidth = (UINT)skull.m_vertices.size() * sizeof(Vertex::SPackedPosNormal);
+		vbDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		vbDesc.CPUAccessFlags = 0;
+		vbDesc.MiscFlags = 0;
+
+		D3D11_SUBRESOURCE_DATA vInitData;
+		vInitData.pSysMem = skull.m_vertices.data();
+
+		ThrowIfFailed(m_d3dDevice->CreateBuffer(
+			&vbDesc,
+			&vInitData,
+			m_skullVB.GetAddressOf()
+		));
+
+		D3D11_BUFFER_DESC ibDesc;
+		ibDesc.Usage = D3D11_USAGE_IMMUTABLE;
+		ibDesc.ByteWidth = m_skullIndexCount * sizeof(UINT);
+		ibDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+		ibDesc.CPUAccessFlags = 0;
+		ibDesc.MiscFlags = 0;
+
+		D3D11_SUBRESOURCE_DATA iInitData;
+		iInitData.pSysMem = m_skullMeshlets.m_indices.data();
+
+		ThrowIfFailed(m_d3dDevice->CreateBuffer(
+			&ibDesc,
+			&iInitData,
+			m_skullIB.GetAddressOf()
+		));
+	}, { skullLoad.m_job });
 }
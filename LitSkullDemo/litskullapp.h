@@ -1,7 +1,10 @@
 ﻿#pragma once
 
 #include "../Common/d3dapp.h"
+#include "../Common/asyncloader.h"
 #include "../Common/lighthelper.h"
+#include "../Common/meshletbuilder.h"
+#include "../Common/vertexpacking.h"
 
 using namespace DirectX;
 
@@ -24,7 +27,7 @@ protected:
 
 private:
 	void buildShapeGeometryBuffers();
-	void buildSkullGeometryBuffers();
+	CAsyncLoader::SHandle<void> buildSkullGeometryBuffers(CAsyncLoader& loader);
 
 protected:
 	ComPtr<ID3D11Buffer> m_shapesVB;
@@ -66,6 +69,12 @@ protected:
 
 	UINT m_skullIndexCount;
 
+	// The skull's vertices are Vertex::SPackedPosNormal.
+	VertexPacking::SPositionQuantization m_skullQuantization;
+
+	MeshletBuilder::SMeshletData m_skullMeshlets;
+	std::vector<MeshletBuilder::SDrawRange> m_skullDrawRanges;
+
 	UINT m_lightCount;
 
 	XMFLOAT3 m_eyePosW;
@@ -9,6 +9,7 @@ const D3D11_INPUT_ELEMENT_DESC CInputLayoutDesc::ms_posNormal[2] =
 };
 
 ComPtr<ID3D11InputLayout> CInputLayouts::ms_posNormal = nullptr;
+ComPtr<ID3D11InputLayout> CInputLayouts::ms_packedPosNormal = nullptr;
 
 void CInputLayouts::initAll(ID3D11Device* device)
 {
@@ -21,4 +22,13 @@ void CInputLayouts::initAll(ID3D11Device* device)
 		passDesc.IAInputSignatureSize,
 		ms_posNormal.GetAddressOf()
 	));
+
+	CEffects::ms_basicFX->m_light1PackedTech->GetPassByIndex(0)->GetDesc(&passDesc);
+	ThrowIfFailed(device->CreateInputLayout(
+		CPackedInputLayoutDesc::ms_packedPosNormal,
+		2,
+		passDesc.pIAInputSignature,
+		passDesc.IAInputSignatureSize,
+		ms_packedPosNormal.GetAddressOf()
+	));
 }
@@ -1,6 +1,7 @@
 ﻿#pragma once
 
 #include "../Common/d3dutil.h"
+#include "../Common/vertexpacking.h"
 using namespace DirectX;
 using Microsoft::WRL::ComPtr;
 
@@ -11,6 +12,8 @@ namespace Vertex
 		XMFLOAT3 m_pos;
 		XMFLOAT3 m_normal;
 	};
+
+	typedef VertexPacking::SPackedPosNormal SPackedPosNormal;
 }
 
 class CInputLayoutDesc
@@ -25,4 +28,5 @@ public:
 	static void initAll(ID3D11Device* device);
 
 	static ComPtr<ID3D11InputLayout> ms_posNormal;
+	static ComPtr<ID3D11InputLayout> ms_packedPosNormal;
 };
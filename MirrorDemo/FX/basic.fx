@@ -17,6 +17,9 @@ cbuffer cbPerObject
 	float4x4 g_worldViewProj;
 	float4x4 g_texTransform;
 	SMaterial g_material;
+
+	// Scale and offset of the image within g_diffuseMap when it is an atlas.
+	float4 g_atlasRect = float4(1.0f, 1.0f, 0.0f, 0.0f);
 };
 
 Texture2D g_diffuseMap;
@@ -78,7 +81,16 @@ float4 PS(
 	float4 texColor = float4(1.0f, 1.0f, 1.0f, 1.0f);
 	if (g_useTexture)
 	{
-		texColor = g_diffuseMap.Sample(samAnisotropic, pIn.m_tex);
+		// Tiling coordinates wrap within the image's rect; the gradients
+		// are those of the unwrapped coordinates, so the seam of the wrap
+		// does not drop to the smallest mip.
+		float2 atlasTex = frac(pIn.m_tex) * g_atlasRect.xy + g_atlasRect.zw;
+		texColor = g_diffuseMap.SampleGrad(
+			samAnisotropic,
+			atlasTex,
+			ddx(pIn.m_tex) * g_atlasRect.xy,
+			ddy(pIn.m_tex) * g_atlasRect.xy
+		);
 
 		if (g_alphaClip)
 		{
@@ -60,6 +60,7 @@ CBasicEffect::CBasicEffect(ID3D11Device* device, const std::wstring& filename) :
 	m_world = m_FX->GetVariableByName("g_world")->AsMatrix();
 	m_worldInvTranspose = m_FX->GetVariableByName("g_worldInvTranspose")->AsMatrix();
 	m_texTransform = m_FX->GetVariableByName("g_texTransform")->AsMatrix();
+	m_atlasRect = m_FX->GetVariableByName("g_atlasRect")->AsVector();
 	m_eyePosW = m_FX->GetVariableByName("g_eyePosW")->AsVector();
 	m_fogColor = m_FX->GetVariableByName("g_fogColor")->AsVector();
 	m_fogStart = m_FX->GetVariableByName("g_fogStart")->AsScalar();
@@ -94,6 +95,11 @@ void CBasicEffect::setTexTransform(CXMMATRIX M)
 	m_texTransform->SetMatrix(reinterpret_cast<const float*>(&M));
 }
 
+void CBasicEffect::setAtlasRect(const XMFLOAT4& v)
+{
+	m_atlasRect->SetFloatVector(reinterpret_cast<const float*>(&v));
+}
+
 void CBasicEffect::setEyePosW(const XMFLOAT3& v)
 {
 	m_eyePosW->SetRawValue(&v, 0, sizeof(v));
@@ -28,6 +28,7 @@ public:
 	void setWorld(CXMMATRIX M);
 	void setWorldInvTranspose(CXMMATRIX M);
 	void setTexTransform(CXMMATRIX M);
+	void setAtlasRect(const XMFLOAT4& v);
 	void setEyePosW(const XMFLOAT3& v);
 	void setFogColor(const FXMVECTOR v);
 	void setFogStart(float f);
@@ -68,6 +69,7 @@ public:
 	ComPtr<ID3DX11EffectMatrixVariable> m_world;
 	ComPtr<ID3DX11EffectMatrixVariable> m_worldInvTranspose;
 	ComPtr<ID3DX11EffectMatrixVariable> m_texTransform;
+	ComPtr<ID3DX11EffectVectorVariable> m_atlasRect;
 	ComPtr<ID3DX11EffectVectorVariable> m_eyePosW;
 	ComPtr<ID3DX11EffectVectorVariable> m_fogColor;
 	ComPtr<ID3DX11EffectScalarVariable> m_fogStart;
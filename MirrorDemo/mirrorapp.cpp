@@ -1,18 +1,31 @@
 ﻿#include "mirrorapp.h"
 
-#include <fstream>
 #include <array>
 #include <DirectXColors.h>
-#include "DDSTextureLoader.h"
 
 #include "../Common/mathhelper.h"
 #include "../Common/geometrygenerator.h"
+#include "../Common/meshoptimizer.h"
+#include "../Common/assetcache.h"
+#include "../Common/textureatlas.h"
 #include "effects.h"
 #include "vertex.h"
 #include "renderstates.h"
 
+namespace
+{
+	// Images of Textures/room.atlas, in the order it lists them.
+	const UINT FloorImage = 0;
+	const UINT WallImage = 1;
+	const UINT MirrorImage = 2;
+}
+
 CMirrorApp::CMirrorApp(HINSTANCE hInstance) :
 	CD3DApp(hInstance),
+	m_roomAtlas(CTextureManager::InvalidHandle),
+	m_floorTexRect(1.0f, 1.0f, 0.0f, 0.0f),
+	m_wallTexRect(1.0f, 1.0f, 0.0f, 0.0f),
+	m_mirrorTexRect(1.0f, 1.0f, 0.0f, 0.0f),
 	m_skullIndexCount(0),
 	m_skullTranslation(0.0f, 1.0f, -5.0f),
 	m_theta(1.24f * XM_PI),
@@ -76,26 +89,24 @@ bool CMirrorApp::initialize()
 	CInputLayouts::initAll(m_d3dDevice.Get());
 	CRenderStates::initAll(m_d3dDevice.Get());
 
-	ThrowIfFailed(CreateDDSTextureFromFile(
-		m_d3dDevice.Get(),
-		L"Textures/checkboard.dds",
-		nullptr,
-		m_floorDiffuseMapSRV.GetAddressOf()
-	));
+	// The floor, wall and mirror textures share an atlas, which the asset
+	// cache builds from the manifest on the first run, so the room binds a
+	// single texture per frame.
+	m_textureManager.initialize(m_d3dDevice.Get(), STextureManagerDesc());
+	m_roomAtlas = m_textureManager.add("Textures/room.atlas");
 
-	ThrowIfFailed(CreateDDSTextureFromFile(
-		m_d3dDevice.Get(),
-		L"Textures/brick01.dds",
-		nullptr,
-		m_wallDiffuseMapSRV.GetAddressOf()
-	));
+	std::string error;
+	TextureAtlas::SLayout roomLayout;
+	if (!TextureAtlas::loadLayout("Textures/room.atlas", roomLayout, &error) ||
+		!m_textureManager.acquire(m_roomAtlas, &error))
+	{
+		MessageBox(nullptr, ansiToWString(error).c_str(), 0, 0);
+		return false;
+	}
 
-	ThrowIfFailed(CreateDDSTextureFromFile(
-		m_d3dDevice.Get(),
-		L"Textures/ice.dds",
-		nullptr,
-		m_mirrorDiffuseMapSRV.GetAddressOf()
-	));
+	m_floorTexRect = TextureAtlas::getTexRect(roomLayout, FloorImage);
+	m_wallTexRect = TextureAtlas::getTexRect(roomLayout, WallImage);
+	m_mirrorTexRect = TextureAtlas::getTexRect(roomLayout, MirrorImage);
 
 	buildRoomGeometryBuffers();
 	buildSkullGeometryBuffers();
@@ -234,11 +245,14 @@ void CMirrorApp::draw(const CGameTimer& timer)
 		CEffects::ms_basicFX->setTexTransform(XMMatrixIdentity());
 		CEffects::ms_basicFX->setMaterial(m_roomMat);
 
-		CEffects::ms_basicFX->setDiffuseMap(m_floorDiffuseMapSRV.Get());
+		// Floor and walls tile different images of the atlas, so they stay
+		// two draws, but the texture stays bound from here to the mirror.
+		CEffects::ms_basicFX->setDiffuseMap(m_textureManager.acquire(m_roomAtlas));
+		CEffects::ms_basicFX->setAtlasRect(m_floorTexRect);
 		pass->Apply(0, m_d3dImmediateContext.Get());
 		m_d3dImmediateContext->Draw(6, 0);
 
-		CEffects::ms_basicFX->setDiffuseMap(m_wallDiffuseMapSRV.Get());
+		CEffects::ms_basicFX->setAtlasRect(m_wallTexRect);
 		pass->Apply(0, m_d3dImmediateContext.Get());
 		m_d3dImmediateContext->Draw(18, 6);
 	}
@@ -383,7 +397,7 @@ void CMirrorApp::draw(const CGameTimer& timer)
 		CEffects::ms_basicFX->setWorldViewProj(worldViewProj);
 		CEffects::ms_basicFX->setTexTransform(XMMatrixIdentity());
 		CEffects::ms_basicFX->setMaterial(m_mirrorMat);
-		CEffects::ms_basicFX->setDiffuseMap(m_mirrorDiffuseMapSRV.Get());
+		CEffects::ms_basicFX->setAtlasRect(m_mirrorTexRect);
 
 		m_d3dImmediateContext->OMSetBlendState(
 			CRenderStates::ms_transparentBS.Get(),
@@ -436,6 +450,8 @@ void CMirrorApp::draw(const CGameTimer& timer)
 
 
 	ThrowIfFailed(m_swapChain->Present(0, 0));
+
+	m_textureManager.update();
 }
 
 void CMirrorApp::onResize()
@@ -550,53 +566,29 @@ void CMirrorApp::buildRoomGeometryBuffers()
 
 void CMirrorApp::buildSkullGeometryBuffers()
 {
-	std::ifstream fin("Models/skull.txt");
-
-	if (!fin)
+	MeshStreams::SMeshStreams skull;
+	std::string error;
+	if (!CAssetCache::getShared().loadMesh("Models/skull.txt", skull, &error))
 	{
-		MessageBox(nullptr, L"Models/skull.txt not found", 0, 0);
+		MessageBox(nullptr, ansiToWString(error).c_str(), 0, 0);
 		return;
 	}
 
-	UINT vCount = 0;
-	UINT tCount = 0;
-	std::string ignore;
-
-	fin >> ignore >> vCount;
-	fin >> ignore >> tCount;
-	fin >> ignore >> ignore >> ignore >> ignore;
-
-	float nx, ny, nz;
-	XMFLOAT4 black(0.0f, 0.0f, 0.0f, 1.0f);
+	const UINT vCount = skull.getVertexCount();
 
 	std::vector<Vertex::SBasic32> vertices(vCount);
-	for (UINT i = 0; i < vCount; ++i)
-	{
-		fin >>
-			vertices[i].m_pos.x >>
-			vertices[i].m_pos.y >>
-			vertices[i].m_pos.z;
-		fin >>
-			vertices[i].m_normal.x >>
-			vertices[i].m_normal.y >>
-			vertices[i].m_normal.z;
-	}
+	MeshStreams::scatter(skull.m_positions, &Vertex::SBasic32::m_pos, vertices);
+	MeshStreams::scatter(skull.m_normals, &Vertex::SBasic32::m_normal, vertices);
 
-	fin >> ignore;
-	fin >> ignore;
-	fin >> ignore;
+	std::vector<UINT> indices = std::move(skull.m_indices);
+	m_skullIndexCount = (UINT)indices.size();
 
-	m_skullIndexCount = 3 * tCount;
-	std::vector<UINT> indices(m_skullIndexCount);
-	for (UINT i = 0; i < tCount; ++i)
-	{
-		fin >>
-			indices[i * 3 + 0] >>
-			indices[i * 3 + 1] >>
-			indices[i * 3 + 2];
-	}
-
-	fin.close();
+	MeshOptimizer::optimizeOverdraw(
+		indices,
+		&vertices[0].m_pos,
+		vCount,
+		sizeof(Vertex::SBasic32)
+	);
 
 	D3D11_BUFFER_DESC vbDesc;
 	vbDesc.Usage = D3D11_USAGE_IMMUTABLE;
@@ -2,6 +2,7 @@
 
 #include "../Common/d3dapp.h"
 #include "../Common/lighthelper.h"
+#include "../Common/texturemanager.h"
 
 using namespace DirectX;
 
@@ -39,9 +40,11 @@ protected:
 	ComPtr<ID3D11Buffer> m_skullVB;
 	ComPtr<ID3D11Buffer> m_skullIB;
 
-	ComPtr<ID3D11ShaderResourceView> m_floorDiffuseMapSRV;
-	ComPtr<ID3D11ShaderResourceView> m_wallDiffuseMapSRV;
-	ComPtr<ID3D11ShaderResourceView> m_mirrorDiffuseMapSRV;
+	CTextureManager m_textureManager;
+	CTextureManager::Handle m_roomAtlas;
+	XMFLOAT4 m_floorTexRect;
+	XMFLOAT4 m_wallTexRect;
+	XMFLOAT4 m_mirrorTexRect;
 
 	SDirectionalLight m_dirLights[3];
 	SMaterial m_roomMat;
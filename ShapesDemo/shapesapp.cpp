@@ -5,6 +5,7 @@
 
 #include "../Common/mathhelper.h"
 #include "../Common/geometrygenerator.h"
+#include "../Common/meshcache.h"
 
 CShapesApp::CShapesApp(HINSTANCE hInstance) :
 	CD3DApp(hInstance),
@@ -232,15 +233,16 @@ float CShapesApp::getHeight(float x, float z) const
 
 void CShapesApp::buildGeometryBuffers()
 {
-	GeometryGenerator::SMeshData box;
-	GeometryGenerator::SMeshData grid;
-	GeometryGenerator::SMeshData sphere;
-	GeometryGenerator::SMeshData cylinder;
-
-	createBox(1.0f, 1.0f, 1.0f, box);
-	createGrid(20.0f, 30.0f, 60, 40, grid);
-	createSphere(0.5f, 20, 20, sphere);
-	createCylinder(0.5f, 0.3f, 3.0f, 20, 20, cylinder);
+	CMeshCache& meshCache = CMeshCache::getShared();
+	CMeshCache::MeshPtr boxMesh = meshCache.getBox(1.0f, 1.0f, 1.0f);
+	CMeshCache::MeshPtr gridMesh = meshCache.getGrid(20.0f, 30.0f, 60, 40);
+	CMeshCache::MeshPtr sphereMesh = meshCache.getSphere(0.5f, 20, 20);
+	CMeshCache::MeshPtr cylinderMesh = meshCache.getCylinder(0.5f, 0.3f, 3.0f, 20, 20);
+
+	const GeometryGenerator::SMeshData& box = *boxMesh;
+	const GeometryGenerator::SMeshData& grid = *gridMesh;
+	const GeometryGenerator::SMeshData& sphere = *sphereMesh;
+	const GeometryGenerator::SMeshData& cylinder = *cylinderMesh;
 
 	m_boxVertexOffset = 0;
 	m_gridVertexOffset = box.m_vertices.size();
@@ -1,11 +1,12 @@
 ﻿#include "skullapp.h"
 
 #include <array>
-#include <fstream>
 #include <vector>
 #include <DirectXColors.h>
 
 #include "../Common/mathhelper.h"
+#include "../Common/meshsimplifier.h"
+#include "../Common/assetcache.h"
 
 using namespace DirectX;
 
@@ -107,13 +108,25 @@ void CSkullApp::draw(const CGameTimer& timer)
 
 	m_fxWorldViewProj->SetMatrix(reinterpret_cast<float*>(&worldViewProj));
 
+	const UINT lod = MeshSimplifier::selectLod(
+		m_skullLodErrors,
+		1.0f,
+		m_radius,
+		XM_PIDIV4,
+		(float)m_clientHeight
+	);
+
 	D3DX11_TECHNIQUE_DESC techDesc;
 	m_tech->GetDesc(&techDesc);
 	for (UINT p = 0; p < techDesc.Passes; ++p)
 	{
 		m_tech->GetPassByIndex(p)->Apply(0, m_d3dImmediateContext.Get());
 
-		m_d3dImmediateContext->DrawIndexed(m_skullIndexCount, 0, 0);
+		if (lod < m_skullLodIndexCounts.size())
+		{
+			m_d3dImmediateContext->DrawIndexed(
+				m_skullLodIndexCounts[lod], m_skullLodIndexOffsets[lod], 0);
+		}
 	}
 
 	ThrowIfFailed(m_swapChain->Present(0, 0));
@@ -169,53 +182,47 @@ void CSkullApp::onMouseMove(WPARAM btnState, int x, int y)
 
 void CSkullApp::buildGeometryBuffers()
 {
-	std::ifstream fin("Models/skull.txt");
-
-	if (!fin)
+	MeshStreams::SMeshStreams skull;
+	std::string error;
+	if (!CAssetCache::getShared().loadMesh("Models/skull.txt", skull, &error))
 	{
-		MessageBox(nullptr, L"Models/skull.txt not found", 0, 0);
+		MessageBox(nullptr, ansiToWString(error).c_str(), 0, 0);
 		return;
 	}
 
-	UINT vCount = 0;
-	UINT tCount = 0;
-	std::string ignore;
-
-	fin >> ignore >> vCount;
-	fin >> ignore >> tCount;
-	fin >> ignore >> ignore >> ignore >> ignore;
-
-	float nx, ny, nz;
+	const UINT vCount = skull.getVertexCount();
 	XMFLOAT4 black(0.0f, 0.0f, 0.0f, 1.0f);
 
 	std::vector<SVertex> vertices(vCount);
-	for (UINT i = 0; i < vCount; ++i)
+	MeshStreams::scatter(skull.m_positions, &SVertex::m_pos, vertices);
+	for (SVertex& vertex : vertices)
 	{
-		fin >>
-			vertices[i].m_pos.x >>
-			vertices[i].m_pos.y >>
-			vertices[i].m_pos.z;
-
-		vertices[i].m_color = black;
-
-		fin >> nx >> ny >> nz;
+		vertex.m_color = black;
 	}
 
-	fin >> ignore;
-	fin >> ignore;
-	fin >> ignore;
+	std::vector<UINT> indices = std::move(skull.m_indices);
+	m_skullIndexCount = (UINT)indices.size();
+
+	std::vector<MeshSimplifier::SLod> lods;
+	MeshSimplifier::buildLodChain(
+		indices,
+		&vertices[0].m_pos,
+		nullptr,
+		vCount,
+		sizeof(SVertex),
+		{ 0.5f, 0.25f, 0.125f, 0.0625f },
+		lods
+	);
 
-	m_skullIndexCount = 3 * tCount;
-	std::vector<UINT> indices(m_skullIndexCount);
-	for (UINT i = 0; i < tCount; ++i)
+	indices.clear();
+	for (const MeshSimplifier::SLod& lod : lods)
 	{
-		fin >>
-			indices[i * 3 + 0] >>
-			indices[i * 3 + 1] >>
-			indices[i * 3 + 2];
-	}
+		m_skullLodIndexOffsets.push_back((UINT)indices.size());
+		m_skullLodIndexCounts.push_back((UINT)lod.m_indices.size());
+		m_skullLodErrors.push_back(lod.m_error);
 
-	fin.close();
+		indices.insert(indices.end(), lod.m_indices.begin(), lod.m_indices.end());
+	}
 
 	D3D11_BUFFER_DESC vbDesc;
 	vbDesc.Usage = D3D11_USAGE_IMMUTABLE;
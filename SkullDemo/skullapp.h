@@ -2,6 +2,8 @@
 
 #include "../Common/d3dapp.h"
 
+#include <vector>
+
 using namespace DirectX;
 
 struct SVertex
@@ -46,6 +48,10 @@ protected:
 
 	UINT m_skullIndexCount;
 
+	std::vector<UINT> m_skullLodIndexOffsets;
+	std::vector<UINT> m_skullLodIndexCounts;
+	std::vector<float> m_skullLodErrors;
+
 	XMFLOAT4X4 m_world;
 	XMFLOAT4X4 m_view;
 	XMFLOAT4X4 m_proj;
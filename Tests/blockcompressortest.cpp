@@ -0,0 +1,73 @@
+﻿#include <cstdio>
+#include <random>
+
+#include "blockcompressor.h"
+
+// Compresses random BC1 blocks at every quality and checks the alpha they
+// decode to: opaque pixels must stay opaque, which an encoder using the
+// transparent black of 3-color blocks for dark pixels would break, and
+// transparent ones must stay transparent.
+namespace
+{
+	const UINT BlockCount = 50000;
+
+	const char* const QualityNames[] = { "Fast", "Normal", "High" };
+
+	// Dark colors, where black is the nearest palette entry most often, and
+	// colors of any brightness.
+	UINT makeColor(std::mt19937& random, bool isDark)
+	{
+		const UINT limit = isDark ? 48 : 256;
+		const UINT r = random() % limit;
+		const UINT g = random() % limit;
+		const UINT b = random() % limit;
+		return r | (g << 8) | (b << 16);
+	}
+
+	int testQuality(BlockCompressor::EQuality quality, bool hasTransparent)
+	{
+		std::mt19937 random(1234);
+		int failureCount = 0;
+
+		for (UINT n = 0; n < BlockCount; ++n)
+		{
+			const bool isDark = n % 2 == 0;
+			UINT pixels[16];
+			bool isTransparent[16];
+			for (UINT i = 0; i < 16; ++i)
+			{
+				isTransparent[i] = hasTransparent && random() % 4 == 0;
+				pixels[i] = makeColor(random, isDark) | (isTransparent[i] ? 0 : 0xFF000000);
+			}
+
+			unsigned char block[8];
+			UINT decoded[16];
+			BlockCompressor::compressBlock(BlockCompressor::EFormat::Bc1, quality, pixels, block);
+			BlockCompressor::decompressBlock(BlockCompressor::EFormat::Bc1, block, decoded);
+
+			for (UINT i = 0; i < 16; ++i)
+			{
+				if ((decoded[i] >> 24) != (isTransparent[i] ? 0u : 0xFFu))
+				{
+					++failureCount;
+					break;
+				}
+			}
+		}
+
+		std::printf("%s, %s pixels: %d of %u blocks with wrong alpha\n",
+			QualityNames[(int)quality], hasTransparent ? "transparent" : "opaque", failureCount, BlockCount);
+		return failureCount;
+	}
+}
+
+int main()
+{
+	int failureCount = 0;
+	for (int quality = 0; quality < 3; ++quality)
+	{
+		failureCount += testQuality((BlockCompressor::EQuality)quality, false);
+		failureCount += testQuality((BlockCompressor::EQuality)quality, true);
+	}
+	return failureCount == 0 ? 0 : 1;
+}
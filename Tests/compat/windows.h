@@ -0,0 +1,11 @@
+﻿#pragma once
+
+// The Windows types that the modules under test use, for building them on
+// other platforms.
+typedef unsigned char BYTE;
+typedef unsigned short USHORT;
+typedef unsigned short WORD;
+typedef int INT;
+typedef unsigned int UINT;
+typedef unsigned int DWORD;
+typedef int BOOL;
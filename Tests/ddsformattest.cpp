@@ -0,0 +1,175 @@
+﻿#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "ddsformat.h"
+
+namespace fs = std::filesystem;
+
+// Parses every DDS file under the directory given, checks that each fails
+// once truncated or without its magic, and writes each 2D texture out again
+// to check that the copy parses to the same description and bytes.
+namespace
+{
+	int g_failureCount = 0;
+
+	void fail(const fs::path& path, const std::string& message)
+	{
+		std::printf("FAILED %s: %s\n", path.string().c_str(), message.c_str());
+		++g_failureCount;
+	}
+
+	bool readFile(const fs::path& path, std::vector<unsigned char>& data)
+	{
+		std::ifstream fin(path, std::ios::binary);
+		if (!fin)
+		{
+			return false;
+		}
+		data.assign(std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>());
+		return true;
+	}
+
+	bool isSameDescription(const DdsFile::SDescription& a, const DdsFile::SDescription& b)
+	{
+		return a.m_format == b.m_format && a.m_dimension == b.m_dimension &&
+			a.m_width == b.m_width && a.m_height == b.m_height && a.m_depth == b.m_depth &&
+			a.m_mipCount == b.m_mipCount && a.m_arraySize == b.m_arraySize && a.m_isCubeMap == b.m_isCubeMap;
+	}
+
+	void testFile(const fs::path& path, const fs::path& copyPath)
+	{
+		std::vector<unsigned char> data;
+		if (!readFile(path, data))
+		{
+			fail(path, "cannot be read");
+			return;
+		}
+
+		std::string error;
+		DdsFile::SDescription description;
+		std::vector<D3D11_SUBRESOURCE_DATA> subresources;
+		if (!DdsFile::parse(data.data(), data.size(), description, subresources, &error))
+		{
+			fail(path, "does not parse: " + error);
+			return;
+		}
+
+		if (subresources.size() != (size_t)description.m_mipCount * description.m_arraySize)
+		{
+			fail(path, "has " + std::to_string(subresources.size()) + " subresources");
+			return;
+		}
+
+		// One after another, the last ending at the end of the file.
+		const unsigned char* end = (const unsigned char*)subresources[0].pSysMem;
+		for (UINT slice = 0; slice < description.m_arraySize; ++slice)
+		{
+			for (UINT mip = 0; mip < description.m_mipCount; ++mip)
+			{
+				const D3D11_SUBRESOURCE_DATA& subresource = subresources[mip + slice * description.m_mipCount];
+				if (subresource.pSysMem != end)
+				{
+					fail(path, "has a gap before subresource " + std::to_string(mip + slice * description.m_mipCount));
+					return;
+				}
+
+				const UINT depth = std::max(description.m_depth >> mip, 1u);
+				end += (size_t)subresource.SysMemSlicePitch * depth;
+			}
+		}
+		if (end != data.data() + data.size())
+		{
+			fail(path, std::to_string(data.data() + data.size() - end) + " bytes after the last subresource");
+		}
+
+		if (DdsFile::parse(data.data(), data.size() - 1, description, subresources))
+		{
+			fail(path, "parses when truncated");
+		}
+
+		std::vector<unsigned char> badMagic(data);
+		badMagic[0] ^= 0xFF;
+		if (DdsFile::parse(badMagic.data(), badMagic.size(), description, subresources))
+		{
+			fail(path, "parses without its magic");
+		}
+
+		// The parses above may have left description and subresources in
+		// any state.
+		DdsFile::parse(data.data(), data.size(), description, subresources);
+		if (description.m_dimension != D3D11_RESOURCE_DIMENSION_TEXTURE2D || description.m_arraySize != 1)
+		{
+			return;
+		}
+
+		const unsigned char* mips = (const unsigned char*)subresources[0].pSysMem;
+		const size_t mipsSize = end - mips;
+		if (!DdsFile::write(copyPath.string(), description.m_format, description.m_width, description.m_height,
+			description.m_mipCount, mips, mipsSize, &error))
+		{
+			fail(path, "cannot be written: " + error);
+			return;
+		}
+
+		std::vector<unsigned char> copy;
+		DdsFile::SDescription copyDescription;
+		std::vector<D3D11_SUBRESOURCE_DATA> copySubresources;
+		if (!readFile(copyPath, copy) ||
+			!DdsFile::parse(copy.data(), copy.size(), copyDescription, copySubresources, &error))
+		{
+			fail(path, "written does not parse: " + error);
+			return;
+		}
+
+		if (!isSameDescription(description, copyDescription) ||
+			copy.size() - ((const unsigned char*)copySubresources[0].pSysMem - copy.data()) != mipsSize ||
+			std::memcmp(copySubresources[0].pSysMem, mips, mipsSize) != 0)
+		{
+			fail(path, "written does not read back the same");
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc != 2)
+	{
+		std::printf("Usage: ddsformattest <directory>\n");
+		return 2;
+	}
+
+	const fs::path copyPath = fs::temp_directory_path() / "ddsformattest.dds";
+
+	int fileCount = 0;
+	for (fs::recursive_directory_iterator it(argv[1]), end; it != end; ++it)
+	{
+		if (it->is_directory() && it->path().filename().string()[0] == '.')
+		{
+			it.disable_recursion_pending();
+			continue;
+		}
+
+		if (it->is_regular_file() && it->path().extension() == ".dds")
+		{
+			testFile(it->path(), copyPath);
+			++fileCount;
+		}
+	}
+
+	fs::remove(copyPath);
+
+	if (fileCount == 0)
+	{
+		std::printf("No DDS files under %s\n", argv[1]);
+		return 1;
+	}
+
+	std::printf("%d DDS files, %d failures\n", fileCount, g_failureCount);
+	return g_failureCount == 0 ? 0 : 1;
+}
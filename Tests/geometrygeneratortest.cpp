@@ -0,0 +1,221 @@
+﻿#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include "geometrygenerator.h"
+#include "mathhelper.h"
+
+using namespace GeometryGenerator;
+
+// Checks that the box and geosphere built from the compile time tables of
+// primitivetables.h match, to the bit, those of the runtime generator the
+// tables replaced, which is kept here as the reference.
+namespace
+{
+	void createReferenceBox(float width, float height, float depth, SMeshData& meshData)
+	{
+		const float w2 = 0.5f * width;
+		const float h2 = 0.5f * height;
+		const float d2 = 0.5f * depth;
+
+		const SVertex v[24] =
+		{
+			// Front.
+			SVertex(-w2, -h2, -d2, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f),
+			SVertex(-w2, +h2, -d2, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f),
+			SVertex(+w2, +h2, -d2, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f),
+			SVertex(+w2, -h2, -d2, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f),
+
+			// Back.
+			SVertex(-w2, -h2, +d2, 0.0f, 0.0f, 1.0f, -1.0f, 0.0f, 0.0f, 1.0f, 1.0f),
+			SVertex(+w2, -h2, +d2, 0.0f, 0.0f, 1.0f, -1.0f, 0.0f, 0.0f, 0.0f, 1.0f),
+			SVertex(+w2, +h2, +d2, 0.0f, 0.0f, 1.0f, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f),
+			SVertex(-w2, +h2, +d2, 0.0f, 0.0f, 1.0f, -1.0f, 0.0f, 0.0f, 1.0f, 0.0f),
+
+			// Top.
+			SVertex(-w2, +h2, -d2, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f),
+			SVertex(-w2, +h2, +d2, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f),
+			SVertex(+w2, +h2, +d2, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f),
+			SVertex(+w2, +h2, -d2, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f),
+
+			// Bottom.
+			SVertex(-w2, -h2, -d2, 0.0f, -1.0f, 0.0f, -1.0f, 0.0f, 0.0f, 1.0f, 1.0f),
+			SVertex(+w2, -h2, -d2, 0.0f, -1.0f, 0.0f, -1.0f, 0.0f, 0.0f, 0.0f, 1.0f),
+			SVertex(+w2, -h2, +d2, 0.0f, -1.0f, 0.0f, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f),
+			SVertex(-w2, -h2, +d2, 0.0f, -1.0f, 0.0f, -1.0f, 0.0f, 0.0f, 1.0f, 0.0f),
+
+			// Left.
+			SVertex(-w2, -h2, +d2, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f),
+			SVertex(-w2, +h2, +d2, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 0.0f, 0.0f),
+			SVertex(-w2, +h2, -d2, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f),
+			SVertex(-w2, -h2, -d2, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 1.0f, 1.0f),
+
+			// Right.
+			SVertex(+w2, -h2, -d2, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f),
+			SVertex(+w2, +h2, -d2, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f),
+			SVertex(+w2, +h2, +d2, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f),
+			SVertex(+w2, -h2, +d2, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f)
+		};
+
+		const UINT i[36] =
+		{
+			0, 1, 2, 0, 2, 3,
+			4, 5, 6, 4, 6, 7,
+			8, 9, 10, 8, 10, 11,
+			12, 13, 14, 12, 14, 15,
+			16, 17, 18, 16, 18, 19,
+			20, 21, 22, 20, 22, 23
+		};
+
+		meshData.m_vertices.assign(v, v + 24);
+		meshData.m_indices.assign(i, i + 36);
+	}
+
+	void subdivideReference(SMeshData& meshData)
+	{
+		const SMeshData input = meshData;
+
+		meshData.m_vertices.clear();
+		meshData.m_indices.clear();
+
+		const UINT triangleCount = (UINT)input.m_indices.size() / 3;
+		for (UINT i = 0; i < triangleCount; ++i)
+		{
+			const SVertex v0 = input.m_vertices[input.m_indices[i * 3 + 0]];
+			const SVertex v1 = input.m_vertices[input.m_indices[i * 3 + 1]];
+			const SVertex v2 = input.m_vertices[input.m_indices[i * 3 + 2]];
+
+			SVertex m0;
+			SVertex m1;
+			SVertex m2;
+			m0.m_position = XMFLOAT3(
+				0.5f * (v0.m_position.x + v1.m_position.x),
+				0.5f * (v0.m_position.y + v1.m_position.y),
+				0.5f * (v0.m_position.z + v1.m_position.z));
+			m1.m_position = XMFLOAT3(
+				0.5f * (v1.m_position.x + v2.m_position.x),
+				0.5f * (v1.m_position.y + v2.m_position.y),
+				0.5f * (v1.m_position.z + v2.m_position.z));
+			m2.m_position = XMFLOAT3(
+				0.5f * (v0.m_position.x + v2.m_position.x),
+				0.5f * (v0.m_position.y + v2.m_position.y),
+				0.5f * (v0.m_position.z + v2.m_position.z));
+
+			meshData.m_vertices.push_back(v0);
+			meshData.m_vertices.push_back(v1);
+			meshData.m_vertices.push_back(v2);
+			meshData.m_vertices.push_back(m0);
+			meshData.m_vertices.push_back(m1);
+			meshData.m_vertices.push_back(m2);
+
+			const UINT indices[12] = { 0, 3, 5, 3, 4, 5, 5, 4, 2, 3, 1, 4 };
+			for (UINT index : indices)
+			{
+				meshData.m_indices.push_back(i * 6 + index);
+			}
+		}
+	}
+
+	void createReferenceGeosphere(float radius, UINT subdivisionCount, SMeshData& meshData)
+	{
+		subdivisionCount = MathHelper::min(subdivisionCount, 5u);
+
+		const float X = 0.525731f;
+		const float Z = 0.850651f;
+
+		const XMFLOAT3 positions[12] =
+		{
+			XMFLOAT3(-X, 0.0f, Z), XMFLOAT3(X, 0.0f, Z),
+			XMFLOAT3(-X, 0.0f, -Z), XMFLOAT3(X, 0.0f, -Z),
+			XMFLOAT3(0.0f, Z, X), XMFLOAT3(0.0f, Z, -X),
+			XMFLOAT3(0.0f, -Z, X), XMFLOAT3(0.0f, -Z, -X),
+			XMFLOAT3(Z, X, 0.0f), XMFLOAT3(-Z, X, 0.0f),
+			XMFLOAT3(Z, -X, 0.0f), XMFLOAT3(-Z, -X, 0.0f)
+		};
+
+		const UINT indices[60] =
+		{
+			1, 4, 0, 4, 9, 0, 4, 5, 9, 8, 5, 4, 1, 8, 4,
+			1, 10, 8, 10, 3, 8, 8, 3, 5, 3, 2, 5, 3, 7, 2,
+			3, 10, 7, 10, 6, 7, 6, 11, 7, 6, 0, 11, 6, 1, 0,
+			10, 1, 6, 11, 0, 9, 2, 11, 9, 5, 2, 9, 11, 2, 7
+		};
+
+		meshData.m_vertices.resize(12);
+		for (UINT i = 0; i < 12; ++i)
+		{
+			meshData.m_vertices[i].m_position = positions[i];
+		}
+		meshData.m_indices.assign(indices, indices + 60);
+
+		for (UINT i = 0; i < subdivisionCount; ++i)
+		{
+			subdivideReference(meshData);
+		}
+
+		for (SVertex& vertex : meshData.m_vertices)
+		{
+			const XMVECTOR n = XMVector3Normalize(XMLoadFloat3(&vertex.m_position));
+			XMStoreFloat3(&vertex.m_position, radius * n);
+			XMStoreFloat3(&vertex.m_normal, n);
+
+			const float theta = MathHelper::angleFromXY(vertex.m_position.x, vertex.m_position.z);
+			const float phi = acosf(vertex.m_position.y / radius);
+
+			vertex.m_texC.x = theta / XM_2PI;
+			vertex.m_texC.y = phi / XM_PI;
+
+			vertex.m_tangentU.x = -radius * sinf(phi) * sinf(theta);
+			vertex.m_tangentU.y = 0.0f;
+			vertex.m_tangentU.z = +radius * sinf(phi) * cosf(theta);
+			XMStoreFloat3(&vertex.m_tangentU, XMVector3Normalize(XMLoadFloat3(&vertex.m_tangentU)));
+		}
+	}
+
+	bool isSame(const SMeshData& a, const SMeshData& b)
+	{
+		return a.m_vertices.size() == b.m_vertices.size() &&
+			a.m_indices == b.m_indices &&
+			std::memcmp(a.m_vertices.data(), b.m_vertices.data(), a.m_vertices.size() * sizeof(SVertex)) == 0;
+	}
+}
+
+int main()
+{
+	int failureCount = 0;
+
+	const float boxSizes[][3] = { { 1.0f, 1.0f, 1.0f }, { 2.0f, 3.0f, 4.0f }, { 0.1f, 7.25f, 1000.0f } };
+	for (const float* size : boxSizes)
+	{
+		SMeshData box;
+		SMeshData reference;
+		createBox(size[0], size[1], size[2], box);
+		createReferenceBox(size[0], size[1], size[2], reference);
+		if (!isSame(box, reference))
+		{
+			std::printf("FAILED box %g x %g x %g\n", size[0], size[1], size[2]);
+			++failureCount;
+		}
+	}
+
+	const float radii[] = { 0.5f, 1.0f, 3.0f };
+	for (float radius : radii)
+	{
+		// Past the deepest table, and past the limit of 5.
+		for (UINT level = 0; level <= 6; ++level)
+		{
+			SMeshData sphere;
+			SMeshData reference;
+			createGeosphere(radius, level, sphere);
+			createReferenceGeosphere(radius, level, reference);
+			if (!isSame(sphere, reference))
+			{
+				std::printf("FAILED geosphere of radius %g at level %u\n", radius, level);
+				++failureCount;
+			}
+		}
+	}
+
+	std::printf("%d failures\n", failureCount);
+	return failureCount == 0 ? 0 : 1;
+}
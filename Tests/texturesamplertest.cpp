@@ -0,0 +1,177 @@
+﻿#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "ddsformat.h"
+#include "texturesampler.h"
+
+namespace fs = std::filesystem;
+
+// Samples textures of the demos at random coordinates and footprints with
+// every filter and address mode, and checks that the SSE2 and AVX2 batches
+// give the results of the scalar path to the last bit. Batches the CPU
+// cannot run fall back to the scalar path and pass trivially.
+namespace
+{
+	const UINT PixelCount = 1 << 16;
+
+	const char* const FilterNames[] = { "Point", "Bilinear", "Trilinear", "Anisotropic" };
+	const char* const AddressModeNames[] = { "Wrap", "Mirror", "Clamp" };
+
+	// A BC3 and a BC1 texture, both with full mip chains.
+	const char* const TexturePaths[] =
+	{
+		"CrateDemo/Textures/WoodCrate01.dds",
+		"CrateDemo/Textures/darkbrickdxt1.dds"
+	};
+
+	struct SPixels
+	{
+		std::vector<float> m_u;
+		std::vector<float> m_v;
+		std::vector<float> m_dudx;
+		std::vector<float> m_dvdx;
+		std::vector<float> m_dudy;
+		std::vector<float> m_dvdy;
+	};
+
+	bool readFile(const fs::path& path, std::vector<unsigned char>& data)
+	{
+		std::ifstream fin(path, std::ios::binary);
+		if (!fin)
+		{
+			return false;
+		}
+		data.assign(std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>());
+		return true;
+	}
+
+	// Coordinates mostly around the texture, every sixteenth far from it, and
+	// footprints from a fraction of a texel to the whole texture, stretched
+	// in any direction.
+	void makePixels(SPixels& pixels)
+	{
+		std::mt19937 random(1234);
+		std::uniform_real_distribution<float> coord(-3.0f, 4.0f);
+		std::uniform_real_distribution<float> farCoord(-20000.0f, 20000.0f);
+		std::uniform_real_distribution<float> logScale(-12.0f, 1.0f);
+		std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+		std::uniform_real_distribution<float> stretch(0.0f, 5.0f);
+
+		pixels.m_u.resize(PixelCount);
+		pixels.m_v.resize(PixelCount);
+		pixels.m_dudx.resize(PixelCount);
+		pixels.m_dvdx.resize(PixelCount);
+		pixels.m_dudy.resize(PixelCount);
+		pixels.m_dvdy.resize(PixelCount);
+
+		for (UINT i = 0; i < PixelCount; ++i)
+		{
+			const bool isFar = i % 16 == 0;
+			pixels.m_u[i] = isFar ? farCoord(random) : coord(random);
+			pixels.m_v[i] = isFar ? farCoord(random) : coord(random);
+
+			const float size = std::exp2(logScale(random));
+			const float length = size * std::exp2(stretch(random));
+			const float a = angle(random);
+			pixels.m_dudx[i] = length * std::cos(a);
+			pixels.m_dvdx[i] = length * std::sin(a);
+			pixels.m_dudy[i] = -size * std::sin(a);
+			pixels.m_dvdy[i] = size * std::cos(a);
+		}
+	}
+
+	int testSampler(const TextureSampler::STexture& texture, const TextureSampler::SSampler& sampler, const SPixels& pixels)
+	{
+		const TextureSampler::SCoords coords =
+		{
+			pixels.m_u.data(), pixels.m_v.data(),
+			pixels.m_dudx.data(), pixels.m_dvdx.data(),
+			pixels.m_dudy.data(), pixels.m_dvdy.data()
+		};
+
+		std::vector<XMFLOAT4> scalar(PixelCount);
+		TextureSampler::sample(texture, sampler, coords, PixelCount, scalar.data(), 1);
+
+		int failureCount = 0;
+		for (UINT batchSize = 4; batchSize <= 8; batchSize *= 2)
+		{
+			std::vector<XMFLOAT4> batched(PixelCount);
+			TextureSampler::sample(texture, sampler, coords, PixelCount, batched.data(), batchSize);
+
+			UINT mismatchCount = 0;
+			for (UINT i = 0; i < PixelCount; ++i)
+			{
+				if (std::memcmp(&scalar[i], &batched[i], sizeof(XMFLOAT4)) != 0)
+				{
+					++mismatchCount;
+				}
+			}
+
+			if (mismatchCount > 0)
+			{
+				std::printf("FAILED %s, %s/%s, batches of %u: %u of %u pixels differ\n",
+					FilterNames[(int)sampler.m_filter], AddressModeNames[(int)sampler.m_addressU],
+					AddressModeNames[(int)sampler.m_addressV], batchSize, mismatchCount, PixelCount);
+				++failureCount;
+			}
+		}
+		return failureCount;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc != 2)
+	{
+		std::printf("usage: texturesamplertest <repository directory>\n");
+		return 1;
+	}
+
+	std::printf("batches of up to %u pixels\n", TextureSampler::getMaxBatchSize());
+
+	SPixels pixels;
+	makePixels(pixels);
+
+	int failureCount = 0;
+	for (const char* texturePath : TexturePaths)
+	{
+		const fs::path path = fs::path(argv[1]) / texturePath;
+		std::vector<unsigned char> data;
+		std::string error;
+		DdsFile::SDescription description;
+		std::vector<D3D11_SUBRESOURCE_DATA> subresources;
+		TextureSampler::STexture texture;
+		if (!readFile(path, data) ||
+			!DdsFile::parse(data.data(), data.size(), description, subresources, &error) ||
+			!TextureSampler::load(description, subresources.data(), texture, &error))
+		{
+			std::printf("FAILED %s: cannot be loaded %s\n", path.string().c_str(), error.c_str());
+			++failureCount;
+			continue;
+		}
+
+		for (int filter = 0; filter < 4; ++filter)
+		{
+			for (int addressU = 0; addressU < 3; ++addressU)
+			{
+				for (int addressV = 0; addressV < 3; ++addressV)
+				{
+					TextureSampler::SSampler sampler;
+					sampler.m_filter = (TextureSampler::EFilter)filter;
+					sampler.m_addressU = (TextureSampler::EAddressMode)addressU;
+					sampler.m_addressV = (TextureSampler::EAddressMode)addressV;
+					failureCount += testSampler(texture, sampler, pixels);
+				}
+			}
+		}
+		std::printf("%s: %u pixels per filter and address modes\n", texturePath, PixelCount);
+	}
+	return failureCount == 0 ? 0 : 1;
+}
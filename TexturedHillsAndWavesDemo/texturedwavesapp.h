@@ -2,6 +2,7 @@
 
 #include "../Common/d3dapp.h"
 #include "../Common/lighthelper.h"
+#include "../Common/texturemanager.h"
 #include "../Common/waves.h"
 
 using namespace DirectX;
@@ -24,8 +25,6 @@ protected:
 	virtual void onMouseMove(WPARAM btnState, int x, int y) override;
 
 private:
-	float getHillHeight(float x, float z) const;
-	XMFLOAT3 getHillNormal(float x, float z) const;
 	void buildLandGeometryBuffers();
 	void buildWaveGeometryBuffers();
 
@@ -36,8 +35,9 @@ protected:
 	ComPtr<ID3D11Buffer> m_wavesVB;
 	ComPtr<ID3D11Buffer> m_wavesIB;
 
-	ComPtr<ID3D11ShaderResourceView> m_grassMapSRV;
-	ComPtr<ID3D11ShaderResourceView> m_wavesMapSRV;
+	CTextureManager m_textureManager;
+	CTextureManager::Handle m_grassTexture;
+	CTextureManager::Handle m_wavesTexture;
 
 	CWaves m_waves;
 
@@ -5,6 +5,7 @@
 
 #include "../Common/mathhelper.h"
 #include "../Common/geometrygenerator.h"
+#include "../Common/terrain.h"
 
 CWaveApp::CWaveApp(HINSTANCE hInstance) :
 	CD3DApp(hInstance),
@@ -23,6 +24,9 @@ CWaveApp::CWaveApp(HINSTANCE hInstance) :
 
 	XMStoreFloat4x4(&m_gridWorld, I);
 	XMStoreFloat4x4(&m_wavesWorld, I);
+
+	m_gustDesc.m_octaveCount = 3;
+	m_gustDesc.m_frequency = 0.08f;
 }
 
 CWaveApp::~CWaveApp()
@@ -78,12 +82,19 @@ void CWaveApp::update(const CGameTimer& timer)
 	{
 		t_base += 0.25f;
 
-		DWORD i = 5 + rand() % 190;
-		DWORD j = 5 + rand() % 190;
-
-		float r = MathHelper::randF(1.0f, 2.0f);
+		// Gusts: the high lobes of a noise field drifting through time, in
+		// place of single random drops.
+		Noise::fillSlice(
+			0.0f, 0.0f, 0.5f * t_base, 1.0f, 1.0f,
+			m_waves.getRowCount(), m_waves.getColumnCount(),
+			7, m_gustDesc, m_gustPattern
+		);
+		for (float& height : m_gustPattern)
+		{
+			height = MathHelper::max(height - 0.5f, 0.0f);
+		}
 
-		m_waves.disturb(i, j, r);
+		m_waves.disturb(m_gustPattern, 2.0f);
 	}
 
 	m_waves.update(timer.getDeltaTime());
@@ -218,11 +229,6 @@ void CWaveApp::onMouseMove(WPARAM btnState, int x, int y)
 	m_lastMousePos = { x, y };
 }
 
-float CWaveApp::getHeight(float x, float z) const
-{
-	return 0.3f * (z * sinf(0.1f * x) + x * cosf(0.1f * z));
-}
-
 void CWaveApp::buildGridGeometryBuffers()
 {
 	GeometryGenerator::SMeshData grid;
@@ -230,12 +236,13 @@ void CWaveApp::buildGridGeometryBuffers()
 
 	m_gridIndexCount = grid.m_indices.size();
 
+	std::vector<XMFLOAT3> positions;
+	Terrain::evaluateGrid(160.0f, 160.0f, 50, 50, Terrain::hills, positions, nullptr);
+
 	std::vector<SVertex> vertices(grid.m_vertices.size());
 	for (size_t i = 0; i < grid.m_vertices.size(); ++i)
 	{
-		XMFLOAT3 p = grid.m_vertices[i].m_position;
-
-		p.y = getHeight(p.x, p.z);
+		const XMFLOAT3& p = positions[i];
 
 		vertices[i].m_pos = p;
 
@@ -2,6 +2,7 @@
 
 #include "../Common/d3dapp.h"
 
+#include "../Common/noise.h"
 #include "../Common/waves.h"
 
 using namespace DirectX;
@@ -30,7 +31,6 @@ protected:
 	virtual void onMouseMove(WPARAM btnState, int x, int y) override;
 
 private:
-	float getHeight(float x, float z) const;
 	void buildGridGeometryBuffers();
 	void buildWavesGeometryBuffers();
 	void buildFX();
@@ -54,6 +54,9 @@ protected:
 
 	CWaves m_waves;
 
+	Noise::SFbmDesc m_gustDesc;
+	std::vector<float> m_gustPattern;
+
 	XMFLOAT4X4 m_gridWorld;
 	XMFLOAT4X4 m_wavesWorld;
 